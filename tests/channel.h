@@ -0,0 +1,49 @@
+/*
+ * channel.h
+ *
+ * Gilbert loss model shared by the packet tests: in the good state a packet
+ * is lost with probability enter, which also moves the channel to the bad
+ * state. There every packet is lost until the channel leaves with
+ * probability leave per packet and draws again as good. leave = 1 gives
+ * independent random loss, and bursts average 1 / leave packets.
+ */
+
+#ifndef TESTS_CHANNEL_H_
+#define TESTS_CHANNEL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct Channel {
+    const char *name;
+    double   enter;
+    double   leave;
+    bool     bad;
+    uint32_t seed;
+} Channel;
+
+static inline double channel_random(Channel *ch) {
+    ch->seed = ch->seed * 1664525u + 1013904223u;
+    return (ch->seed >> 8) / 16777216.0;
+}
+
+/// @return True if the next packet gets through
+static inline bool channel_pass(Channel *ch) {
+    if (ch->bad && channel_random(ch) < ch->leave) {
+        ch->bad = false;
+    }
+    if (!ch->bad) {
+        ch->bad = channel_random(ch) < ch->enter;
+    }
+    return !ch->bad;
+}
+
+static inline void channel_init(Channel *ch, const char *name, double enter, double leave) {
+    ch->name = name;
+    ch->enter = enter;
+    ch->leave = leave;
+    ch->bad = false;
+    ch->seed = 12345;
+}
+
+#endif /* TESTS_CHANNEL_H_ */
@@ -0,0 +1,28 @@
+/*
+ * check.h
+ *
+ * Minimal assertions for the host tests. A failed CHECK prints the condition
+ * and keeps going, so one run reports every failure; check_exit() turns the
+ * count into the process exit status make looks at.
+ */
+
+#ifndef TESTS_CHECK_H_
+#define TESTS_CHECK_H_
+
+#include <stdio.h>
+
+static int checkFailures = 0;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            checkFailures++; \
+        } \
+    } while (0)
+
+static inline int check_exit(const char *name) {
+    printf("%s: %s\n", name, checkFailures ? "FAILED" : "ok");
+    return checkFailures ? 1 : 0;
+}
+
+#endif /* TESTS_CHECK_H_ */
@@ -0,0 +1,26 @@
+/*
+ * Host stand-in for the TI ADCBuf driver.
+ */
+#ifndef ti_drivers_ADCBuf_h
+#define ti_drivers_ADCBuf_h
+
+#include <xdc/std.h>
+
+typedef struct ADCBuf_Config *ADCBuf_Handle;
+
+typedef struct ADCBuf_Conversion {
+    uint32_t adcChannel;
+    void    *arg;
+    void    *sampleBuffer;
+    void    *sampleBufferTwo;
+    uint16_t samplesRequestedCount;
+} ADCBuf_Conversion;
+
+typedef struct ADCBuf_Params {
+    int      returnMode;
+    int      recurrenceMode;
+    void    *callbackFxn;
+    uint32_t samplingFrequency;
+} ADCBuf_Params;
+
+#endif
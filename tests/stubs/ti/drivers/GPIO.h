@@ -0,0 +1,15 @@
+/*
+ * Host stand-in for the TI GPIO driver.
+ */
+#ifndef ti_drivers_GPIO_h
+#define ti_drivers_GPIO_h
+
+#include <xdc/std.h>
+
+typedef void (*GPIO_CallbackFxn)(uint_least8_t index);
+
+void GPIO_write(uint_least8_t index, unsigned int value);
+unsigned int GPIO_read(uint_least8_t index);
+void GPIO_toggle(uint_least8_t index);
+
+#endif
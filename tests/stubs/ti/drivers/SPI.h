@@ -0,0 +1,23 @@
+/*
+ * Host stand-in for the TI SPI driver.
+ */
+#ifndef ti_drivers_SPI_h
+#define ti_drivers_SPI_h
+
+#include <xdc/std.h>
+
+typedef struct SPI_Config *SPI_Handle;
+
+typedef struct SPI_Params {
+    uint32_t bitRate;
+    uint32_t dataSize;
+    int      frameFormat;
+} SPI_Params;
+
+typedef struct SPI_Transaction {
+    size_t  count;
+    void   *txBuf;
+    void   *rxBuf;
+} SPI_Transaction;
+
+#endif
@@ -0,0 +1,27 @@
+/*
+ * Host stand-in for the TI Timer driver.
+ */
+#ifndef ti_drivers_Timer_h
+#define ti_drivers_Timer_h
+
+#include <xdc/std.h>
+
+typedef struct Timer_Config *Timer_Handle;
+typedef void (*Timer_CallBackFxn)(Timer_Handle handle, int_fast16_t status);
+
+typedef struct Timer_Params {
+    int               period;
+    int               periodUnits;
+    Timer_CallBackFxn timerCallback;
+    int               timerMode;
+} Timer_Params;
+
+#define Timer_PERIOD_US         0
+#define Timer_STATUS_SUCCESS    0
+#define Timer_STATUS_ERROR      (-1)
+
+int32_t Timer_start(Timer_Handle handle);
+void Timer_stop(Timer_Handle handle);
+int32_t Timer_setPeriod(Timer_Handle handle, int periodUnits, uint32_t period);
+
+#endif
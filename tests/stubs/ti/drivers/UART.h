@@ -0,0 +1,22 @@
+/*
+ * Host stand-in for the TI UART driver.
+ */
+#ifndef ti_drivers_UART_h
+#define ti_drivers_UART_h
+
+#include <xdc/std.h>
+
+typedef struct UART_Config *UART_Handle;
+
+typedef struct UART_Params {
+    int      readDataMode;
+    int      writeDataMode;
+    int      readReturnMode;
+    int      readEcho;
+    uint32_t baudRate;
+} UART_Params;
+
+int UART_write(UART_Handle handle, const void *buffer, size_t size);
+int UART_read(UART_Handle handle, void *buffer, size_t size);
+
+#endif
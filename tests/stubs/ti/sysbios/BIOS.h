@@ -0,0 +1,21 @@
+/*
+ * Host stand-in for the SYS/BIOS kernel module.
+ */
+#ifndef ti_sysbios_BIOS_h
+#define ti_sysbios_BIOS_h
+
+#include <xdc/std.h>
+
+#define BIOS_WAIT_FOREVER   (~0u)
+#define BIOS_NO_WAIT        0
+
+typedef enum {
+    BIOS_ThreadType_Hwi,
+    BIOS_ThreadType_Swi,
+    BIOS_ThreadType_Task,
+    BIOS_ThreadType_Main
+} BIOS_ThreadType;
+
+BIOS_ThreadType BIOS_getThreadType(void);
+
+#endif
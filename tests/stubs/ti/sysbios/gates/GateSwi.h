@@ -0,0 +1,14 @@
+/*
+ * Host stand-in for SYS/BIOS Swi gates.
+ */
+#ifndef ti_sysbios_gates_GateSwi_h
+#define ti_sysbios_gates_GateSwi_h
+
+#include <xdc/std.h>
+
+typedef struct GateSwi_Struct *GateSwi_Handle;
+
+UInt GateSwi_enter(GateSwi_Handle handle);
+void GateSwi_leave(GateSwi_Handle handle, UInt key);
+
+#endif
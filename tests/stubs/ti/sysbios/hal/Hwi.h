@@ -0,0 +1,24 @@
+/*
+ * Host stand-in for SYS/BIOS hardware interrupts.
+ */
+#ifndef ti_sysbios_hal_Hwi_h
+#define ti_sysbios_hal_Hwi_h
+
+#include <xdc/std.h>
+
+typedef struct Hwi_Struct *Hwi_Handle;
+
+typedef struct Hwi_StackInfo {
+    SizeT   hwiStackPeak;
+    SizeT   hwiStackSize;
+    Ptr     hwiStackBase;
+} Hwi_StackInfo;
+
+UInt Hwi_disable(void);
+void Hwi_restore(UInt key);
+Bool Hwi_getStackInfo(Hwi_StackInfo *info, Bool computeStackDepth);
+
+Ptr Hwi_getHookContext(Hwi_Handle handle, Int id);
+void Hwi_setHookContext(Hwi_Handle handle, Int id, Ptr context);
+
+#endif
@@ -0,0 +1,16 @@
+/*
+ * Host stand-in for SYS/BIOS queues.
+ */
+#ifndef ti_sysbios_knl_Queue_h
+#define ti_sysbios_knl_Queue_h
+
+#include <xdc/std.h>
+
+typedef struct Queue_Elem {
+    struct Queue_Elem *next;
+    struct Queue_Elem *prev;
+} Queue_Elem;
+
+typedef struct Queue_Struct *Queue_Handle;
+
+#endif
@@ -0,0 +1,14 @@
+/*
+ * Host stand-in for SYS/BIOS semaphores.
+ */
+#ifndef ti_sysbios_knl_Semaphore_h
+#define ti_sysbios_knl_Semaphore_h
+
+#include <xdc/std.h>
+
+typedef struct Semaphore_Struct *Semaphore_Handle;
+
+Bool Semaphore_pend(Semaphore_Handle handle, UInt timeout);
+void Semaphore_post(Semaphore_Handle handle);
+
+#endif
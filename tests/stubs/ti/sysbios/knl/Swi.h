@@ -0,0 +1,16 @@
+/*
+ * Host stand-in for SYS/BIOS software interrupts.
+ */
+#ifndef ti_sysbios_knl_Swi_h
+#define ti_sysbios_knl_Swi_h
+
+#include <xdc/std.h>
+
+typedef struct Swi_Struct *Swi_Handle;
+
+void Swi_post(Swi_Handle handle);
+
+Ptr Swi_getHookContext(Swi_Handle handle, Int id);
+void Swi_setHookContext(Swi_Handle handle, Int id, Ptr context);
+
+#endif
@@ -0,0 +1,32 @@
+/*
+ * Host stand-in for SYS/BIOS tasks.
+ */
+#ifndef ti_sysbios_knl_Task_h
+#define ti_sysbios_knl_Task_h
+
+#include <xdc/std.h>
+
+typedef struct Task_Struct *Task_Handle;
+
+typedef struct Task_Stat {
+    Int     priority;
+    Ptr     stack;
+    SizeT   stackSize;
+    SizeT   used;
+} Task_Stat;
+
+void Task_sleep(UInt ticks);
+void Task_yield(void);
+Task_Handle Task_self(void);
+Task_Handle Task_getIdleTask(void);
+void Task_stat(Task_Handle handle, Task_Stat *stat);
+
+Ptr Task_getHookContext(Task_Handle handle, Int id);
+void Task_setHookContext(Task_Handle handle, Int id, Ptr context);
+
+Int Task_Object_count(void);
+Task_Handle Task_Object_get(Ptr array, Int i);
+Task_Handle Task_Object_first(void);
+Task_Handle Task_Object_next(Task_Handle handle);
+
+#endif
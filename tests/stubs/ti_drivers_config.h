@@ -0,0 +1,15 @@
+/*
+ * Host stand-in for the SysConfig generated board configuration.
+ */
+#ifndef ti_drivers_config_h
+#define ti_drivers_config_h
+
+enum {
+    CONFIG_GPIO_LED_0, CONFIG_GPIO_LED_1, CONFIG_GPIO_LED_2, CONFIG_GPIO_LED_3,
+    CONFIG_GPIO_4, CONFIG_GPIO_5, CONFIG_GPIO_SWITCH_6, CONFIG_GPIO_SWITCH_7,
+    CONFIG_GPIO_SW1, CONFIG_GPIO_SW2,
+    CONFIG_UART_0, CONFIG_UART_1, CONFIG_GPT_0, CONFIG_GPT_1,
+    CONFIG_SPI_0, CONFIG_ADCBUF_0, ADCBUF_CHANNEL_0
+};
+
+#endif
@@ -0,0 +1,15 @@
+/*
+ * Host stand-in for the XDCtools error blocks.
+ */
+#ifndef xdc_runtime_Error_h
+#define xdc_runtime_Error_h
+
+#include <xdc/std.h>
+
+typedef struct Error_Block {
+    Int     id;
+} Error_Block;
+
+void Error_init(Error_Block *eb);
+
+#endif
@@ -0,0 +1,22 @@
+/*
+ * Host stand-in for the XDCtools heap interface.
+ */
+#ifndef xdc_runtime_Memory_h
+#define xdc_runtime_Memory_h
+
+#include <xdc/std.h>
+#include <xdc/runtime/Error.h>
+
+typedef Ptr IHeap_Handle;
+
+typedef struct Memory_Stats {
+    SizeT   totalSize;
+    SizeT   totalFreeSize;
+    SizeT   largestFreeSize;
+} Memory_Stats;
+
+Ptr Memory_alloc(IHeap_Handle heap, SizeT size, SizeT align, Error_Block *eb);
+void Memory_free(IHeap_Handle heap, Ptr block, SizeT size);
+void Memory_getStats(IHeap_Handle heap, Memory_Stats *stats);
+
+#endif
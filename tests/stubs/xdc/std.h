@@ -0,0 +1,26 @@
+/*
+ * Host stand-in for the XDCtools base types. Only what the firmware headers
+ * reach from p100.h is declared; tests define any function they call.
+ */
+#ifndef xdc_std_h
+#define xdc_std_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef void           *Ptr;
+typedef int             Int;
+typedef unsigned        UInt;
+typedef unsigned long   UArg;
+typedef int             Bool;
+typedef char            Char;
+typedef unsigned long   SizeT;
+typedef int32_t         Int32;
+typedef uint32_t        UInt32;
+typedef uint16_t        UInt16;
+
+#define TRUE  1
+#define FALSE 0
+
+#endif
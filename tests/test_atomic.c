@@ -0,0 +1,121 @@
+/*
+ *  ======== test_atomic.c ========
+ *  Threads hammering registers[] through atomic.h (the C11 path on the host)
+ *  and through reg_apply(). Any lost update shows up in the final sums.
+ *  Arithmetic at the ends of the int32_t range wraps, the Makefile aborts on
+ *  signed overflow.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <netinet/in.h>     // struct sockaddr_in, used by p100.h
+
+#include "p100.h"
+#include "register.h"
+#include "atomic.h"
+#include "watch.h"
+#include "check.h"
+
+#define THREADS 8
+#define ROUNDS  200000
+
+static int64_t taken[THREADS];      // Values each thread got back from atomic32_xchg
+
+void AddProgramMessage(char *msg) {
+}
+
+void AddPayload(char *payload) {
+}
+
+// No watches, so watch_notify() never calls out
+uint8_t watchMask[NUM_REGISTERS];
+
+void watch_check(int reg) {
+}
+
+static void *worker(void *arg) {
+    int32_t id = (int32_t)(intptr_t)arg;
+    int32_t i, old, value, three = 3;
+
+    for (i = 0; i < ROUNDS; i++) {
+        atomic32_fetch_add(&registers[1], 1);
+        atomic32_fetch_add(&registers[2], id + 1);
+
+        // Add 2 through a compare-and-swap loop
+        old = atomic32_load(&registers[3]);
+        while (!atomic32_cas(&registers[3], &old, old + 2)) {
+        }
+
+        // Running maximum through compare-and-swap
+        value = i * THREADS + id;
+        old = atomic32_load(&registers[4]);
+        while (old < value && !atomic32_cas(&registers[4], &old, value)) {
+        }
+
+        // Every value put in comes out exactly once
+        taken[id] += atomic32_xchg(&registers[5], value + 1);
+
+        reg_apply(REG_INC, &registers[6], NULL);
+        reg_apply(REG_ADD, &registers[7], &three);
+    }
+    return NULL;
+}
+
+static void test_wrap() {
+    int32_t dst, src;
+    char range[] = "R8:R9", imm[] = "#-2147483648";
+
+    dst = 5;
+    src = INT32_MIN;
+    CHECK(reg_apply(REG_SUB, &dst, &src) && dst == INT32_MIN + 5);
+    dst = INT32_MAX;
+    src = 1;
+    CHECK(reg_apply(REG_ADD, &dst, &src) && dst == INT32_MIN);
+    dst = INT32_MIN;
+    CHECK(reg_apply(REG_NEG, &dst, NULL) && dst == INT32_MIN);
+    dst = 0x10000;
+    src = 0x10000;
+    CHECK(reg_apply(REG_MUL, &dst, &src) && dst == 0);
+
+    registers[8] = 5;
+    registers[9] = -5;
+    CHECK(vec_exec(VEC_SUB, range, imm, NULL, true) != 0);
+    CHECK(registers[8] == INT32_MIN + 5 && registers[9] == INT32_MAX - 4);
+    registers[8] = registers[9] = 0;
+}
+
+int main() {
+    pthread_t threads[THREADS];
+    int64_t put = 0, got;
+    int32_t i, id;
+
+    memset(registers, 0, sizeof(registers));
+    test_wrap();
+    for (id = 0; id < THREADS; id++) {
+        pthread_create(&threads[id], NULL, worker, (void *)(intptr_t)id);
+    }
+    for (id = 0; id < THREADS; id++) {
+        pthread_join(threads[id], NULL);
+    }
+
+    for (id = 0; id < THREADS; id++) {
+        for (i = 0; i < ROUNDS; i++) {
+            put += i * THREADS + id + 1;
+        }
+    }
+    got = registers[5];
+    for (id = 0; id < THREADS; id++) {
+        got += taken[id];
+    }
+
+    printf("R1 %d R2 %d R3 %d R4 %d R6 %d R7 %d, xchg %lld of %lld\n", registers[1], registers[2],
+           registers[3], registers[4], registers[6], registers[7], (long long)got, (long long)put);
+    CHECK(registers[1] == THREADS * ROUNDS);
+    CHECK(registers[2] == THREADS * (THREADS + 1) / 2 * ROUNDS);
+    CHECK(registers[3] == 2 * THREADS * ROUNDS);
+    CHECK(registers[4] == (ROUNDS - 1) * THREADS + THREADS - 1);
+    CHECK(got == put);
+    CHECK(registers[6] == THREADS * ROUNDS);
+    CHECK(registers[7] == 3 * THREADS * ROUNDS);
+    return check_exit("test_atomic");
+}
@@ -0,0 +1,197 @@
+/*
+ *  ======== test_cpuload.c ========
+ *  CPU load accounting on a simulated clock: time is charged to the context
+ *  that ran, a Hwi preempting a Swi hands the CPU back to the Swi, the load
+ *  fades out over CPU_LOAD_WINDOWS sub-windows, and contexts past
+ *  CPU_LOAD_SLOTS share the "other" slot.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <netinet/in.h>     // struct sockaddr_in, used by p100.h
+
+#include "p100.h"
+#include "tickers.h"
+#include "cpuload.h"
+#include "check.h"
+
+struct Task_Struct { Ptr context; };
+struct Swi_Struct { Ptr context; };
+struct Hwi_Struct { Ptr context; };
+
+static struct Task_Struct idleTask, worker, extraTasks[CPU_LOAD_SLOTS + 4];
+static struct Swi_Struct swi;
+static struct Hwi_Struct hwi;
+static Task_Handle running = &worker;
+
+static uint64_t simNs = 1000000000ull;  // Simulated CLOCK_MONOTONIC
+static char output[8192];
+
+/// @brief The host timestamp_now() reads CLOCK_MONOTONIC, so the test owns the clock
+int clock_gettime(clockid_t clock, struct timespec *ts) {
+    ts->tv_sec = simNs / 1000000000u;
+    ts->tv_nsec = simNs % 1000000000u;
+    return 0;
+}
+
+static void run(uint32_t us) {
+    simNs += (uint64_t)us * 1000;
+}
+
+void AddProgramMessage(char *msg) {
+    strncat(output, msg, sizeof(output) - strlen(output) - 1);
+}
+
+const char *bios_object_name(const void *handle) {
+    if (handle == &idleTask)    return "Idle";
+    if (handle == &worker)      return "worker";
+    if (handle == &swi)         return "swi";
+    return NULL;
+}
+
+UInt Hwi_disable(void) {
+    return 0;
+}
+
+void Hwi_restore(UInt key) {
+}
+
+Task_Handle Task_self(void) {
+    return running;
+}
+
+Task_Handle Task_getIdleTask(void) {
+    return &idleTask;
+}
+
+Ptr Task_getHookContext(Task_Handle handle, Int id) {
+    return handle->context;
+}
+
+void Task_setHookContext(Task_Handle handle, Int id, Ptr context) {
+    handle->context = context;
+}
+
+Ptr Swi_getHookContext(Swi_Handle handle, Int id) {
+    return handle->context;
+}
+
+void Swi_setHookContext(Swi_Handle handle, Int id, Ptr context) {
+    handle->context = context;
+}
+
+Ptr Hwi_getHookContext(Hwi_Handle handle, Int id) {
+    return handle->context;
+}
+
+void Hwi_setHookContext(Hwi_Handle handle, Int id, Ptr context) {
+    handle->context = context;
+}
+
+static void switch_to(Task_Handle next) {
+    cpuload_taskSwitch(running, next);
+    running = next;
+}
+
+/**
+ * @brief One ticker tick of work: worker 3 ms, a Swi for 1.5 ms that a Hwi
+ * preempts for 0.5 ms of it, then Idle for 5.5 ms. CPU 45%, Swi 10%, Hwi 5%.
+ */
+static void busy_tick() {
+    run(3000);
+    cpuload_swiBegin(&swi);
+    run(600);
+    cpuload_hwiBegin(&hwi);
+    run(500);
+    cpuload_hwiEnd(&hwi);
+    run(400);
+    cpuload_swiEnd(&swi);
+    switch_to(&idleTask);
+    run(5500);
+    switch_to(&worker);
+    cpuload_tick();
+}
+
+static void idle_tick() {
+    switch_to(&idleTask);
+    run(TICKER_TICK_MS * 1000);
+    switch_to(&worker);
+    cpuload_tick();
+}
+
+static void run_windows(int windows, void (*tick)()) {
+    int i;
+    for (i = 0; i < windows * CPU_LOAD_SUB_MS / TICKER_TICK_MS; i++) {
+        tick();
+    }
+}
+
+static void test_off() {
+    busy_tick();
+    CHECK(cpuload_total() == 0);
+    CHECK(worker.context == NULL);          // Hooks do nothing until enabled
+    print_cpuload();
+    CHECK(strstr(output, "\"-cpu on\"") != NULL);
+}
+
+static void test_load() {
+    cpuload_enable(true);
+    run_windows(CPU_LOAD_WINDOWS, busy_tick);
+    CHECK(cpuload_total() == 450);
+    CHECK(cpuload_kind(CPU_LOAD_TASK) == 300);
+    CHECK(cpuload_kind(CPU_LOAD_SWI) == 100);
+    CHECK(cpuload_kind(CPU_LOAD_HWI) == 50);
+
+    output[0] = 0;
+    print_cpuload();
+    CHECK(strstr(output, "| CPU 45.0%  Task 30.0%  Swi 10.0%  Hwi 5.0%  over 1000 ms") != NULL);
+    CHECK(strstr(output, "| Task | Idle               |  55.0% |  55.0%") != NULL);
+    CHECK(strstr(output, "| Swi  | swi                |  10.0% |  10.0%") != NULL);
+    CHECK(strstr(output, "| Hwi  | 0x") != NULL);  // No name, printed as the handle
+    CHECK(strstr(output, "(other)") == NULL);
+}
+
+static void test_fade() {
+    run_windows(CPU_LOAD_WINDOWS / 2, idle_tick);
+    CHECK(cpuload_total() == 225);
+    CHECK(cpuload_kind(CPU_LOAD_HWI) == 25);
+    run_windows(CPU_LOAD_WINDOWS / 2, idle_tick);
+    CHECK(cpuload_total() == 0);
+
+    cpuload_reset();
+    CHECK(cpuload_total() == 0);
+    run_windows(1, busy_tick);
+    CHECK(cpuload_total() == 450);         // Averaged over the one window since the reset
+}
+
+static void test_other_slot() {
+    int i;
+
+    // Every task gets 1 ms of each tick in turn, the ones without a slot share slot 0
+    for (i = 0; i < CPU_LOAD_WINDOWS * CPU_LOAD_SUB_MS / TICKER_TICK_MS; i++) {
+        switch_to(&extraTasks[i % (CPU_LOAD_SLOTS + 4)]);
+        run(1000);
+        switch_to(&idleTask);
+        run(TICKER_TICK_MS * 1000 - 1000);
+        switch_to(&worker);
+        cpuload_tick();
+    }
+    CHECK(cpuload_total() == 100);
+    CHECK(cpuload_kind(CPU_LOAD_TASK) + cpuload_kind(CPU_LOAD_OTHER) > 95);     // Each slot rounds down
+    CHECK(cpuload_kind(CPU_LOAD_OTHER) > 0);
+
+    output[0] = 0;
+    print_cpuload();
+    CHECK(strstr(output, "(other)") != NULL);
+
+    cpuload_enable(false);
+    CHECK(cpuload_total() == 0);
+}
+
+int main() {
+    test_off();
+    test_load();
+    test_fade();
+    test_other_slot();
+    return check_exit("test_cpuload");
+}
@@ -0,0 +1,231 @@
+/*
+ *  ======== test_fec.c ========
+ *  Sends a voice-like stream through a lossy channel with the firmware's own
+ *  send and receive path: VoiceSend() builds the voice, redundant and parity
+ *  packets, and the ones that get through go to VoiceReceiveBlock(),
+ *  VoiceReceiveRedundant() and VoiceReceiveParity() as udpEcho.c hands them
+ *  over. VoicePlayoutBlock() then plays one block per packet interval, as the
+ *  Timer0 Swi does. Asserts minimum recovery rates for random and burst loss,
+ *  that the receive statistics add up, that XOR rebuilds blocks exactly and
+ *  that redundant copies stay intelligible.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <netinet/in.h>     // struct sockaddr_in, used by p100.h
+
+#include "p100.h"
+#include "voice.h"
+#include "fec.h"
+#include "channel.h"
+#include "check.h"
+
+#define BLOCKS      20000
+#define SAFE_BLOCKS JITTER_SLOTS    // Sent without loss so the playout starts cleanly
+
+typedef struct Packet {
+    NetPacketHeader hdr;
+    uint16_t body[DATABLOCKSIZE + sizeof(FecRedundant) / sizeof(uint16_t)];
+} Packet;
+
+static uint16_t sent[BLOCKS][FEC_BLOCK_SAMPLES];
+static bool     arrived[BLOCKS];            // Voice packet of the block got through
+static Packet   outbox[2];                  // Voice packet and maybe a parity packet
+static int32_t  outCount;
+
+GateSwi_Handle gateSwi0;
+NetStats netStats;
+
+void AddProgramMessage(char *msg) {
+}
+
+UInt GateSwi_enter(GateSwi_Handle handle) {
+    return 0;
+}
+
+void GateSwi_leave(GateSwi_Handle handle, UInt key) {
+}
+
+void netstat_drop(NetDirStats *dir, NetDropReason reason) {
+}
+
+bool AddNetPacket(uint32_t ipAddr, uint16_t port, const NetPacketHeader *hdr, const void *body, int32_t bodyLen) {
+    CHECK(outCount < 2 && bodyLen <= (int32_t)sizeof(outbox[0].body));
+    outbox[outCount].hdr = *hdr;
+    memcpy(outbox[outCount].body, body, bodyLen);
+    outCount++;
+    return true;
+}
+
+/// @brief What NetHandleVoice() and NetHandleParity() in udpEcho.c do with a valid packet
+static void deliver(const Packet *pkt) {
+    if (pkt->hdr.type == NETPKT_PARITY) {
+        VoiceReceiveParity(&pkt->hdr, pkt->body);
+        return;
+    }
+    VoiceReceiveBlock(pkt->hdr.dest, pkt->hdr.seq, pkt->body);
+    if (pkt->hdr.type == NETPKT_VOICE_RED) {
+        VoiceReceiveRedundant(pkt->hdr.dest, pkt->hdr.seq - 1, (const FecRedundant *)&pkt->body[DATABLOCKSIZE]);
+    }
+}
+
+/// @brief Two tones plus a little noise around mid-scale of the 14-bit DAC
+static void make_stream() {
+    uint32_t seed = 1;
+    int32_t b, i, n = 0;
+
+    for (b = 0; b < BLOCKS; b++) {
+        for (i = 0; i < FEC_BLOCK_SAMPLES; i++, n++) {
+            seed = seed * 1664525u + 1013904223u;
+            sent[b][i] = (uint16_t)lround(8192 + 3000 * sin(n * 0.041) + 1200 * sin(n * 0.173)
+                                          + (int32_t)(seed >> 26) - 32);
+        }
+    }
+}
+
+/// @brief Signal to error ratio in dB of a decoded redundant copy, with the DC removed
+static double red_snr_db(const uint16_t *got, const uint16_t *want) {
+    double sig = 0, err = 0, d;
+    int32_t i;
+
+    for (i = 0; i < FEC_BLOCK_SAMPLES; i++) {
+        d = (double)want[i] - 8192;
+        sig += d * d;
+        d = (double)got[i] - want[i];
+        err += d * d;
+    }
+    return 10 * log10(sig / (err + 1e-9));
+}
+
+/**
+ * @brief Streams every block to TX0 with the given FEC and plays it out. The
+ * jitter buffer holds K blocks for XOR, so a group's parity arrives before its
+ * first block plays, and the default depth for RED.
+ * @return Share of the lost blocks played from FEC instead of concealed
+ */
+static double run(Channel *ch, FecMode mode, int32_t k, double *worstSnr) {
+    TXBufControl *tx = &glo.audioController.txBufControl[0];
+    VoiceRxStats *st = &voiceRxStats[0];
+    NetPacketHeader hdr;
+    int32_t b, i, play = 0, lost = 0, concealed = 0, wrong = 0;
+    uint32_t before;
+    bool playing, prevConcealed = false, isConcealed;
+    double snr;
+
+    VoiceInit();
+    memset(st, 0, sizeof(*st));
+    tx->TX_Completed = NULL;
+    fec_encoder_init(&fecTx[0], mode, k);
+    VoiceSetDepth(mode == FEC_XOR ? fecTx[0].k : JITTER_DEFAULT_DEPTH);
+    *worstSnr = 1000;
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic[0] = NETPKT_MAGIC0;
+    hdr.magic[1] = NETPKT_MAGIC1;
+    hdr.count = DATABLOCKSIZE;
+
+    for (b = 0; play < BLOCKS; b++) {
+        playing = tx->TX_Completed != NULL;
+
+        if (b < BLOCKS) {
+            hdr.seq = (uint16_t)b;
+            outCount = 0;
+            VoiceSend(0, &hdr, sent[b]);
+            for (i = 0; i < outCount; i++) {
+                bool pass = b < SAFE_BLOCKS || channel_pass(ch);
+                if (outbox[i].hdr.type != NETPKT_PARITY) {
+                    arrived[b] = pass;
+                    lost += !pass;
+                }
+                if (pass) {
+                    deliver(&outbox[i]);
+                }
+            }
+        }
+
+        // The playout started during this block with block 0, or takes the next one now
+        before = tx->plc.concealedBlocks;
+        if (playing) {
+            tx->TX_Completed = tx->TX_Completed == tx->TX_Ping ? tx->TX_Pong : tx->TX_Ping;
+            VoicePlayoutBlock(0);
+        } else if (tx->TX_Completed == NULL) {
+            continue;
+        }
+
+        isConcealed = tx->plc.concealedBlocks != before;
+        concealed += isConcealed;
+        if (!isConcealed && !prevConcealed) {   // After a concealment the block is crossfaded
+            if (arrived[play] || mode == FEC_XOR) {
+                wrong += memcmp(tx->TX_Completed, sent[play], sizeof(sent[play])) != 0;
+            } else {
+                snr = red_snr_db(tx->TX_Completed, sent[play]);
+                if (snr < *worstSnr) {
+                    *worstSnr = snr;
+                }
+            }
+        }
+        prevConcealed = isConcealed;
+        play++;
+    }
+
+    printf("%-7s %-4s", ch->name, fecModeNames[mode]);
+    if (mode == FEC_XOR) {
+        printf(" K=%d", (int)fecTx[0].k);
+    } else {
+        printf("    ");
+    }
+    printf(": lost %5.2f%%, recovered %5.1f%%", 100.0 * lost / BLOCKS, 100.0 * (lost - concealed) / lost);
+    if (mode == FEC_RED) {
+        printf(", worst copy %.1f dB", *worstSnr);
+    }
+    printf("\n");
+
+    CHECK(wrong == 0);
+    CHECK(st->restarts == 0);
+    CHECK(st->received == (uint32_t)(BLOCKS - lost));
+    CHECK(st->xorRecovered + st->redRecovered == (uint32_t)(lost - concealed));
+    CHECK(mode == FEC_XOR ? st->redRecovered == 0 : st->xorRecovered == 0);
+    return (double)(lost - concealed) / lost;
+}
+
+static void test_encoder_limits() {
+    FecEncoder enc;
+
+    fec_encoder_init(&enc, FEC_XOR, 1);
+    CHECK(enc.k == FEC_MIN_K);
+    fec_encoder_init(&enc, FEC_XOR, 99);
+    CHECK(enc.k == FEC_MAX_K);
+    CHECK(sizeof(FecRedundant) == 68);      // Size the packet format promises
+}
+
+int main() {
+    Channel ch;
+    double snr;
+
+    make_stream();
+    test_encoder_limits();
+
+    // Without FEC every lost block is concealed
+    channel_init(&ch, "random", 0.05, 1.0);
+    CHECK(run(&ch, FEC_NONE, 0, &snr) == 0);
+
+    // 5% independent loss: a block is rebuilt when the other K - 1 blocks and
+    // the parity arrive, 0.95^K of the time, and by RED when the next packet does.
+    channel_init(&ch, "random", 0.05, 1.0);
+    CHECK(run(&ch, FEC_XOR, 2, &snr) > 0.80);
+    CHECK(run(&ch, FEC_XOR, 4, &snr) > 0.70);
+    CHECK(run(&ch, FEC_XOR, 8, &snr) > 0.55);
+    CHECK(run(&ch, FEC_RED, 0, &snr) > 0.90);
+    CHECK(snr > 15);
+
+    // Bursts averaging 2.5 packets at a similar loss rate hurt both schemes:
+    // a burst recovers at most its last block, and only if it is alone in its group.
+    channel_init(&ch, "burst", 0.02, 0.4);
+    CHECK(run(&ch, FEC_XOR, 2, &snr) > 0.20);
+    CHECK(run(&ch, FEC_XOR, 4, &snr) > 0.15);
+    CHECK(run(&ch, FEC_XOR, 8, &snr) > 0.12);
+    CHECK(run(&ch, FEC_RED, 0, &snr) > 0.30);
+    CHECK(snr > 15);
+
+    return check_exit("test_fec");
+}
@@ -0,0 +1,176 @@
+/*
+ *  ======== test_flashstore.c ========
+ *  The flash store on the RAM flash of flash_hal_ram.c: write, overwrite and
+ *  delete, reclaim as the head wraps around the sectors, running out of room,
+ *  and remounting after a write that a reset cut short.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "flashstore.h"
+#include "check.h"
+
+#define SECTOR      256
+#define SECTORS     4
+
+static uint8_t flash[SECTOR * SECTORS];
+static FlashHal ram;
+
+// A write cut short: the next program call stores only cutBytes, then the "reset"
+static FlashHal cutHal;
+static int32_t cutBytes = -1;
+
+static bool cut_program(void *ctx, uint32_t offset, const void *data, uint32_t bytes) {
+    if (cutBytes >= 0 && (uint32_t)cutBytes < bytes) {
+        ram.program(ctx, offset, data, (uint32_t)cutBytes);
+        cutBytes = -1;
+        return false;
+    }
+    return ram.program(ctx, offset, data, bytes);
+}
+
+static bool read_u32(uint16_t key, uint32_t *value) {
+    return flashstore_read(key, value, sizeof(*value)) == sizeof(*value);
+}
+
+static void test_write_read() {
+    FlashStoreStats stats;
+    char text[32];
+    uint32_t v;
+
+    flash_hal_ram_init(&ram, flash, SECTOR, SECTORS);
+    CHECK(flashstore_mount(&ram));
+    CHECK(flashstore_read(1, &v, sizeof(v)) == -1);
+
+    v = 0x11111111;
+    CHECK(flashstore_write(1, &v, sizeof(v)));
+    CHECK(flashstore_write(2, "hello", 6));
+    v = 0x22222222;
+    CHECK(flashstore_write(1, &v, sizeof(v)));     // Overwrite
+    CHECK(flashstore_write(1, &v, sizeof(v)));     // Unchanged, skipped
+    flashstore_stats(&stats);
+    CHECK(stats.keys == 2);
+    CHECK(stats.writes == 3);
+    CHECK(stats.skipped == 1);
+
+    v = 0;
+    CHECK(read_u32(1, &v) && v == 0x22222222);
+    CHECK(flashstore_read(2, text, sizeof(text)) == 6 && strcmp(text, "hello") == 0);
+    CHECK(flashstore_read(2, text, 2) == 6);       // Truncated copy, full length returned
+
+    CHECK(flashstore_delete(2));
+    CHECK(flashstore_read(2, text, sizeof(text)) == -1);
+    CHECK(flashstore_delete(2));                    // Already gone
+    CHECK(!flashstore_write(FLASHSTORE_KEY_NONE, &v, sizeof(v)));
+
+    // Everything above survives a remount
+    CHECK(flashstore_mount(&ram));
+    flashstore_stats(&stats);
+    CHECK(stats.keys == 1);
+    CHECK(stats.corrupt == 0);
+    CHECK(read_u32(1, &v) && v == 0x22222222);
+    CHECK(flashstore_read(2, text, sizeof(text)) == -1);
+}
+
+/// @brief Rewrites a few keys until the head has gone around the ring several times
+static void test_wrap() {
+    FlashStoreStats stats;
+    uint32_t n, v, key, last[4] = { 0 };
+    uint32_t heads = 0, prevHead = 0;
+
+    flash_hal_ram_init(&ram, flash, SECTOR, SECTORS);
+    CHECK(flashstore_mount(&ram));
+    for (n = 1; n <= 400; n++) {
+        key = 10 + n % 4;
+        CHECK(flashstore_write((uint16_t)key, &n, sizeof(n)));
+        last[key - 10] = n;
+
+        flashstore_stats(&stats);
+        if (stats.head != prevHead) {
+            heads++;
+            prevHead = stats.head;
+        }
+    }
+    flashstore_stats(&stats);
+    printf("400 writes: head moved %u times, %u erases\n", heads, stats.erases);
+    CHECK(heads >= 3 * SECTORS);
+    CHECK(stats.erases >= 3 * SECTORS);
+
+    for (key = 10; key < 14; key++) {
+        CHECK(read_u32((uint16_t)key, &v) && v == last[key - 10]);
+    }
+    CHECK(flashstore_mount(&ram));
+    flashstore_stats(&stats);
+    CHECK(stats.keys == 4);
+    CHECK(stats.corrupt == 0);
+    for (key = 10; key < 14; key++) {
+        CHECK(read_u32((uint16_t)key, &v) && v == last[key - 10]);
+    }
+}
+
+static void test_full() {
+    FlashStoreStats stats;
+    uint8_t value[64];
+    uint16_t key;
+
+    flash_hal_ram_init(&ram, flash, SECTOR, SECTORS);
+    CHECK(flashstore_mount(&ram));
+    memset(value, 0x5A, sizeof(value));
+    for (key = 1; flashstore_write(key, value, sizeof(value)); key++) {
+    }
+    flashstore_stats(&stats);
+    printf("full after %u keys: %u of %u live bytes\n", stats.keys, stats.liveBytes, stats.capacity);
+    CHECK(stats.keys > 0);
+    CHECK(stats.liveBytes <= stats.capacity);
+    CHECK(stats.liveBytes + 8 + sizeof(value) > stats.capacity);
+
+    // Deleting makes room again
+    CHECK(flashstore_delete(1));
+    CHECK(flashstore_write(key, value, sizeof(value)));
+}
+
+/// @brief A reset part way through programming a record leaves a bad CRC, skipped on mount
+static void test_cut_write() {
+    FlashStoreStats stats;
+    uint32_t v, value[4] = { 1, 2, 3, 4 };
+
+    flash_hal_ram_init(&ram, flash, SECTOR, SECTORS);
+    cutHal = ram;
+    cutHal.program = cut_program;
+    CHECK(flashstore_mount(&cutHal));
+    v = 7;
+    CHECK(flashstore_write(1, &v, sizeof(v)));
+    CHECK(flashstore_write(2, value, sizeof(value)));
+
+    cutBytes = 12;                                  // Header and one word of the data
+    value[0] = 100;
+    CHECK(!flashstore_write(2, value, sizeof(value)));
+
+    CHECK(flashstore_mount(&cutHal));
+    flashstore_stats(&stats);
+    CHECK(stats.corrupt == 1);
+    CHECK(read_u32(1, &v) && v == 7);
+    CHECK(flashstore_read(2, &v, sizeof(v)) == sizeof(value) && v == 1);   // Previous value
+
+    // The store carries on after the bad record
+    CHECK(flashstore_write(2, value, sizeof(value)));
+    CHECK(flashstore_mount(&cutHal));
+    CHECK(flashstore_read(2, &v, sizeof(v)) == sizeof(value) && v == 100);
+
+    // A sector header cut short is erased on mount rather than trusted
+    flash_hal_ram_init(&ram, flash, SECTOR, SECTORS);
+    CHECK(flashstore_mount(&ram));
+    flash[SECTOR * 2] = 0x00;
+    CHECK(flashstore_mount(&ram));
+    flashstore_stats(&stats);
+    CHECK(stats.erases == 1);
+    CHECK(flash[SECTOR * 2] == FLASH_HAL_ERASED);
+}
+
+int main() {
+    test_write_read();
+    test_wrap();
+    test_full();
+    test_cut_write();
+    return check_exit("test_flashstore");
+}
@@ -0,0 +1,114 @@
+/*
+ *  ======== test_latency.c ========
+ *  Latency histograms: the log2 bucketing at every power of two, what
+ *  lat_record() keeps per sample, and the bucket bounds -lat prints.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <netinet/in.h>     // struct sockaddr_in, used by p100.h
+
+#include "p100.h"
+#include "latency.h"
+#include "timestamp.h"
+#include "check.h"
+
+static char output[4096];
+
+void AddProgramMessage(char *msg) {
+    strncat(output, msg, sizeof(output) - strlen(output) - 1);
+}
+
+/// @brief floor(log2(ticks)) the slow way
+static int reference_bucket(uint32_t ticks) {
+    int b = 0;
+    while (ticks > 1) {
+        ticks >>= 1;
+        b++;
+    }
+    return b;
+}
+
+static void test_bucket() {
+    uint32_t seed = 1, v;
+    int b, bad = 0;
+
+    CHECK(lat_bucket(0) == 0);
+    CHECK(lat_bucket(1) == 0);
+    CHECK(lat_bucket(0xFFFFFFFFu) == LAT_BUCKETS - 1);
+    for (b = 1; b < 32; b++) {
+        bad += lat_bucket(1u << b) != b;
+        bad += lat_bucket((1u << b) - 1) != b - 1;
+        bad += lat_bucket((1u << b) + 1) != b;
+    }
+    for (v = 0; v < 100000; v++) {
+        seed = seed * 1664525u + 1013904223u;
+        bad += lat_bucket(seed >> (seed & 31)) != reference_bucket(seed >> (seed & 31));
+    }
+    CHECK(bad == 0);
+}
+
+/// @brief Records a sample that started ticks ago. The clock moves on a little before it is read.
+static void record_ago(LatPoint point, uint32_t ticks) {
+    lat_record(point, timestamp_now() - ticks);
+}
+
+static void test_record() {
+    LatHist *hist = &latHist[LAT_ADC];
+    uint32_t sum = 0;
+    int b;
+
+    lat_reset();
+    record_ago(LAT_ADC, 1000000);       // 8.3 ms at 120 MHz
+    record_ago(LAT_ADC, 3000);
+    record_ago(LAT_ADC, 3000);
+
+    CHECK(hist->count == 3);
+    CHECK(hist->min >= 3000 && hist->min < 3000 + 120000);
+    CHECK(hist->max >= 1000000 && hist->max < 1000000 + 120000);
+    CHECK(hist->total >= 1006000);
+    CHECK(hist->buckets[19] == 1);      // 2^19 <= 1000000 < 2^20
+    for (b = 0; b < LAT_BUCKETS; b++) {
+        sum += hist->buckets[b];
+    }
+    CHECK(sum == 3);
+    CHECK(latHist[LAT_TIMER0].count == 0);
+}
+
+static void test_print() {
+    lat_reset();
+    output[0] = '\0';
+    print_latency();
+    CHECK(strstr(output, "No latency samples yet.") != NULL);
+
+    latHist[LAT_TIMER0].count = 2;
+    latHist[LAT_TIMER0].min = 1;
+    latHist[LAT_TIMER0].max = 1u << 19;
+    latHist[LAT_TIMER0].total = 1 + (1u << 19);
+    latHist[LAT_TIMER0].buckets[0] = 1;
+    latHist[LAT_TIMER0].buckets[19] = 1;
+    output[0] = '\0';
+    print_latency();
+    CHECK(strstr(output, "Timer0 Hwi -> Swi") != NULL);
+    CHECK(strstr(output, "max 4369.0 us") != NULL);     // 2^19 ticks at 120 MHz
+    CHECK(strstr(output, "<       16 ns") != NULL);     // Bucket 0 ends at 2 ticks
+    CHECK(strstr(output, "<   8738.1 us") != NULL);     // Bucket 19 ends at 2^20 ticks
+    CHECK(strstr(output, "No latency samples") == NULL);
+}
+
+static void test_timestamp() {
+    uint64_t a, b;
+
+    CHECK(timestamp_ticks_per_us() == CYCLES_PER_US);
+    a = timestamp_us64();
+    b = timestamp_us64();
+    CHECK(b >= a);
+    CHECK(timestamp_us() - (uint32_t)b < 1000000);    // Same clock, 32 bits
+}
+
+int main() {
+    test_bucket();
+    test_record();
+    test_print();
+    test_timestamp();
+    return check_exit("test_latency");
+}
@@ -0,0 +1,141 @@
+/*
+ *  ======== test_memstat.c ========
+ *  RAM report: mem_alloc()/mem_free() keep the allocation counters and the
+ *  bytes in use and at peak, and -mem lists every task stack, flags the ones
+ *  near overflow, and prints the system stack, heap and counters.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netinet/in.h>     // struct sockaddr_in, used by p100.h
+
+#include <xdc/runtime/Error.h>
+#include <xdc/runtime/Memory.h>
+#include <ti/sysbios/hal/Hwi.h>
+
+#include "p100.h"
+#include "memstat.h"
+#include "check.h"
+
+#define HEAP_LIMIT 1024     // Larger requests fail
+
+struct Task_Struct { SizeT stackSize; SizeT used; Int priority; };
+
+// Two tasks from release.cfg and one created at runtime
+static struct Task_Struct staticTasks[2] = { { 768, 300, 0 }, { 2048, 1900, 4 } };
+static struct Task_Struct runtimeTask = { 1024, 1000, 1 };
+
+static char output[8192];
+
+void AddProgramMessage(char *msg) {
+    strncat(output, msg, sizeof(output) - strlen(output) - 1);
+}
+
+const char *bios_object_name(const void *handle) {
+    if (handle == &staticTasks[0])  return "Idle";
+    if (handle == &staticTasks[1])  return "PayloadExecutor";
+    return NULL;
+}
+
+UInt Hwi_disable(void) {
+    return 0;
+}
+
+void Hwi_restore(UInt key) {
+}
+
+Bool Hwi_getStackInfo(Hwi_StackInfo *info, Bool computeStackDepth) {
+    info->hwiStackPeak = 700;
+    info->hwiStackSize = 4096;
+    info->hwiStackBase = NULL;
+    return FALSE;
+}
+
+void Error_init(Error_Block *eb) {
+    eb->id = 0;
+}
+
+Ptr Memory_alloc(IHeap_Handle heap, SizeT size, SizeT align, Error_Block *eb) {
+    return size > HEAP_LIMIT ? NULL : malloc(size);
+}
+
+void Memory_free(IHeap_Handle heap, Ptr block, SizeT size) {
+    free(block);
+}
+
+void Memory_getStats(IHeap_Handle heap, Memory_Stats *stats) {
+    stats->totalSize = 32768;
+    stats->totalFreeSize = 30000;
+    stats->largestFreeSize = 12000;
+}
+
+void Task_stat(Task_Handle handle, Task_Stat *stat) {
+    stat->priority = handle->priority;
+    stat->stack = NULL;
+    stat->stackSize = handle->stackSize;
+    stat->used = handle->used;
+}
+
+Int Task_Object_count(void) {
+    return 2;
+}
+
+Task_Handle Task_Object_get(Ptr array, Int i) {
+    return &staticTasks[i];
+}
+
+Task_Handle Task_Object_first(void) {
+    return &runtimeTask;
+}
+
+Task_Handle Task_Object_next(Task_Handle handle) {
+    return NULL;
+}
+
+static void test_counters() {
+    void *a, *b, *c;
+
+    a = mem_alloc(100);
+    b = mem_alloc(200);
+    CHECK(a != NULL && b != NULL);
+    CHECK(memStats.allocs == 2 && memStats.bytesInUse == 300 && memStats.bytesPeak == 300);
+
+    c = mem_alloc(HEAP_LIMIT + 1);
+    CHECK(c == NULL);
+    CHECK(memStats.failed == 1 && memStats.allocs == 2 && memStats.bytesInUse == 300);
+
+    mem_free(a, 100);
+    CHECK(memStats.frees == 1 && memStats.bytesInUse == 200 && memStats.bytesPeak == 300);
+    a = mem_alloc(50);
+    CHECK(memStats.bytesInUse == 250 && memStats.bytesPeak == 300);     // Peak is kept
+    mem_free(a, 50);
+    mem_free(b, 200);
+    CHECK(memStats.allocs == 3 && memStats.frees == 3 && memStats.bytesInUse == 0);
+}
+
+static void test_report() {
+    char line[128];
+
+    print_memstat();
+    CHECK(strstr(output, "| Idle               |   768 |   300 |  39% |  0\r\n") != NULL);
+    CHECK(strstr(output, "| PayloadExecutor    |  2048 |  1900 |  92% |  4  <- near overflow\r\n") != NULL);
+
+    // The runtime task has no name and is printed as its handle, at 97% of its stack
+    sprintf(line, "| 0x%08X         |  1024 |  1000 |  97%% |  1  <- near overflow",
+            (unsigned)(uintptr_t)&runtimeTask);
+    CHECK(strstr(output, line) != NULL);
+
+    CHECK(strstr(output, "| System stack (Hwi, Swi): 700 of 4096 bytes used\r\n") != NULL);
+    CHECK(strstr(output, "| Heap: 32768 total, 30000 free, largest free block 12000\r\n") != NULL);
+    CHECK(strstr(output, "| Allocations: 3, freed 3, failed 1, 0 bytes in use, peak 300\r\n") != NULL);
+
+    sprintf(line, "| %-28s %6u\r\n", "glo", (unsigned)sizeof(glo));
+    CHECK(strstr(output, line) != NULL);
+    CHECK(strstr(output, "| latHist") != NULL);
+}
+
+int main() {
+    test_counters();
+    test_report();
+    return check_exit("test_memstat");
+}
@@ -0,0 +1,82 @@
+/*
+ *  ======== test_netstat.c ========
+ *  Voice transit and jitter on a simulated clock, with sender and receiver
+ *  stamping timestamp_us() as over loopback. The stream crosses the wrap of
+ *  the 32-bit tick counter (~35.8 s at 120 MHz) and of the 32-bit microsecond
+ *  count (~71.6 minutes), and neither may show up in the figures.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <netinet/in.h>     // struct sockaddr_in, used by p100.h
+
+#include "p100.h"
+#include "netstat.h"
+#include "timestamp.h"
+#include "check.h"
+
+#define PEER        0x0A000002u     // 10.0.0.2
+#define TRANSIT_US  1500            // Mean time in flight
+#define SPREAD_US   100             // Transit alternates between mean - and mean + this
+#define INTERVAL_US 20000           // One voice packet per interval
+#define PACKETS     100
+
+static uint64_t simNs;              // Simulated CLOCK_MONOTONIC
+static uint16_t seq;
+
+GateSwi_Handle gateSwi4;
+
+void AddProgramMessage(char *msg) {
+}
+
+UInt GateSwi_enter(GateSwi_Handle handle) {
+    return 0;
+}
+
+void GateSwi_leave(GateSwi_Handle handle, UInt key) {
+}
+
+/// @brief The host timestamp_ticks() reads CLOCK_MONOTONIC, so the test owns the clock
+int clock_gettime(clockid_t clock, struct timespec *ts) {
+    ts->tv_sec = simNs / 1000000000u;
+    ts->tv_nsec = simNs % 1000000000u;
+    return 0;
+}
+
+/**
+ * @brief Sends PACKETS voice packets centred on the given time in microseconds
+ * since boot and returns the peer's figures
+ */
+static NetPeerStats *run(uint64_t centreUs) {
+    uint32_t stamp;
+    int32_t i, transit;
+
+    netstat_reset();
+    simNs = (centreUs - PACKETS / 2 * INTERVAL_US) * 1000;
+    for (i = 0; i < PACKETS; i++) {
+        stamp = timestamp_us();
+        transit = TRANSIT_US + (i & 1 ? SPREAD_US : -SPREAD_US);
+        simNs += (uint64_t)transit * 1000;
+        netstat_voice_rx(PEER, seq++, stamp);
+        simNs += (uint64_t)(INTERVAL_US - transit) * 1000;
+    }
+    return &netStats.peers[0];
+}
+
+static void check_peer(const char *name, NetPeerStats *peer) {
+    printf("%-10s: transit %d/%d/%d us, jitter %u us\n", name, (int)peer->transitMin,
+           (int)(peer->transitSum / peer->voicePackets), (int)peer->transitMax, (unsigned)(peer->jitter16 >> 4));
+    CHECK(peer->addr == PEER && peer->voicePackets == PACKETS && peer->lost == 0);
+    CHECK(peer->transitMin == TRANSIT_US - SPREAD_US);
+    CHECK(peer->transitMax == TRANSIT_US + SPREAD_US);
+    CHECK(peer->transitSum == (int64_t)TRANSIT_US * PACKETS);
+    // Every difference is 2 * SPREAD_US, the estimate approaches it from 0 by 1/16 a packet
+    CHECK((peer->jitter16 >> 4) > 2 * SPREAD_US * 95 / 100 && (peer->jitter16 >> 4) <= 2 * SPREAD_US);
+}
+
+int main() {
+    check_peer("start", run(10 * 1000000u));
+    check_peer("tick wrap", run(((uint64_t)1 << 32) / CYCLES_PER_US));
+    check_peer("us wrap", run((uint64_t)1 << 32));
+    return check_exit("test_netstat");
+}
@@ -0,0 +1,317 @@
+/*
+ *  ======== test_plc.c ========
+ *  Packet loss concealment on synthetic voice: pitch estimate, how closely the
+ *  first concealed block follows the lost signal, the mute after 60 ms and the
+ *  statistics. Also reports the cost of good and concealed blocks in cycles.
+ *
+ *  No recorded PCM is checked in, so the loss pattern runs use speech_make(), a
+ *  documented speech-like generator, through the Gilbert channel of channel.h:
+ *  random loss, short bursts, and long gaps past the 60 ms mute.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "plc.h"
+#include "cycles.h"
+#include "channel.h"
+#include "check.h"
+
+#define BLOCK   128
+#define DC      2048
+#define AMP     800
+
+#define SPEECH_BLOCKS   2000            // 32 s at 8 kHz
+#define SPEECH_DC       8192            // Mid-scale of the 14-bit DAC
+#define SPEECH_PEAK     3000
+
+static int32_t phase;
+
+/// @brief Next block of a sine with the given period, continuing from the previous call
+static void sine_block(uint16_t *block, double period) {
+    int32_t i;
+
+    for (i = 0; i < BLOCK; i++, phase++) {
+        block[i] = (uint16_t)lround(DC + AMP * sin(2 * M_PI * phase / period));
+    }
+}
+
+static void prime(PlcState *st, PlcMode mode, double period, int32_t blocks) {
+    uint16_t block[BLOCK];
+
+    plc_init(st, mode, BLOCK);
+    phase = 0;
+    while (blocks-- > 0) {
+        sine_block(block, period);
+        plc_good_block(st, block);
+    }
+}
+
+/// @brief Signal to error ratio in dB of the first n samples of a concealed block
+static double snr_db(const uint16_t *got, const uint16_t *want, int32_t n) {
+    double sig = 0, err = 0, d;
+    int32_t i;
+
+    for (i = 0; i < n; i++) {
+        d = (double)want[i] - DC;
+        sig += d * d;
+        d = (double)got[i] - want[i];
+        err += d * d;
+    }
+    return 10 * log10(sig / (err + 1e-9));
+}
+
+static void test_pitch(double period) {
+    PlcState st;
+    uint16_t block[BLOCK], want[BLOCK];
+
+    prime(&st, PLC_PITCH, period, 8);
+    sine_block(want, period);
+    memcpy(block, want, sizeof(block));
+    plc_conceal_block(&st, block);
+
+    printf("period %.1f: pitch %d, first 10 ms %.1f dB\n", period, (int)st.lastPitch,
+           snr_db(block, want, PLC_ATTEN_START));
+    CHECK(fabs(st.lastPitch - period) <= 1);
+    CHECK(snr_db(block, want, PLC_ATTEN_START) > 20);
+}
+
+static void test_mute(PlcMode mode) {
+    PlcState st;
+    uint16_t block[BLOCK];
+    int32_t i, n, loud = 0;
+
+    prime(&st, mode, 73, 8);
+    for (n = 0; n < 6; n++) {
+        sine_block(block, 73);
+        plc_conceal_block(&st, block);
+        for (i = 0; i < BLOCK; i++) {
+            if (n * BLOCK + i >= PLC_MUTE_SAMPLES && block[i] != st.dc) {
+                loud++;
+            }
+        }
+    }
+    CHECK(loud == 0);
+    CHECK(st.erasures == 1);
+    CHECK(st.concealedBlocks == 6);
+    CHECK(st.mutedBlocks == 2);     // Blocks starting at 512 and 640 samples
+
+    sine_block(block, 73);
+    plc_good_block(&st, block);
+    CHECK(st.erased == 0);
+    CHECK(st.goodBlocks == 9);
+}
+
+static void test_unprimed() {
+    PlcState st;
+    uint16_t block[BLOCK];
+    int32_t i;
+
+    plc_init(&st, PLC_PITCH, BLOCK);
+    for (i = 0; i < BLOCK; i++) {
+        block[i] = (uint16_t)i;
+    }
+    plc_conceal_block(&st, block);
+    for (i = 0; i < BLOCK && block[i] == i; i++) {
+    }
+    CHECK(i == BLOCK);     // Nothing to conceal from, the buffer is left alone
+    CHECK(st.erasures == 0);
+}
+
+static uint16_t speech[SPEECH_BLOCKS][BLOCK];
+
+static uint32_t speechSeed = 1;
+
+/// @return Uniform in [0, 1)
+static double speech_random() {
+    speechSeed = speechSeed * 1664525u + 1013904223u;
+    return (speechSeed >> 8) / 16777216.0;
+}
+
+/// @brief Two-pole resonator at freq Hz with the given pole radius, one sample
+static double resonate(double x, double freq, double r, double *y1, double *y2) {
+    double y = x + 2 * r * cos(2 * M_PI * freq / 8000) * *y1 - r * r * *y2;
+    *y2 = *y1;
+    *y1 = y;
+    return y;
+}
+
+/**
+ * @brief Fills speech[] with a speech-like signal: syllables of 120-250 ms of
+ * voiced sound separated by 40-120 ms of either a hiss or near silence. Voiced
+ * sound is a glottal pulse train whose period glides between 60 and 100
+ * samples (80-133 Hz) through two formants that change per syllable, under a
+ * raised cosine envelope. That gives the pitch search real, drifting periods
+ * and the loss runs erasures at onsets, in the middle of vowels and in pauses.
+ */
+static void speech_make() {
+    static double raw[SPEECH_BLOCKS * BLOCK];
+    double y1a = 0, y2a = 0, y1b = 0, y2b = 0;
+    double f1 = 600, f2 = 1400, period = 80, glide = 0, phase = 0, env, peak = 0;
+    int32_t n = 0, len, i, total = SPEECH_BLOCKS * BLOCK;
+    bool voiced = true;
+
+    while (n < total) {
+        if (voiced) {
+            len = 960 + (int32_t)(speech_random() * 1040);
+            f1 = 400 + speech_random() * 400;
+            f2 = 1000 + speech_random() * 1200;
+            glide = (speech_random() - 0.5) * 30 / len;
+        } else {
+            len = 320 + (int32_t)(speech_random() * 640);
+        }
+        for (i = 0; i < len && n < total; i++, n++) {
+            env = 0.5 - 0.5 * cos(2 * M_PI * i / len);
+            if (voiced) {
+                period += glide;
+                if (period < 60) period = 60;
+                if (period > 100) period = 100;
+                phase += 1;
+                raw[n] = 0;
+                if (phase >= period) {
+                    phase -= period;
+                    raw[n] = 1;
+                }
+                raw[n] = env * (resonate(raw[n], f1, 0.97, &y1a, &y2a) + 0.5 * resonate(raw[n], f2, 0.95, &y1b, &y2b));
+            } else {
+                raw[n] = env * (n % 2 ? 0.3 : 0.02) * (speech_random() - 0.5);
+            }
+            if (fabs(raw[n]) > peak) {
+                peak = fabs(raw[n]);
+            }
+        }
+        voiced = !voiced;
+    }
+    for (n = 0; n < total; n++) {
+        speech[n / BLOCK][n % BLOCK] = (uint16_t)lround(SPEECH_DC + SPEECH_PEAK * raw[n] / peak);
+    }
+}
+
+/**
+ * @brief Plays speech[] through a channel, concealing every lost block. Checks
+ * that each lost block is concealed, that nothing is heard past the mute point
+ * of an erasure and that the statistics count the erasures and muted blocks of
+ * the pattern. Reports the concealment cost.
+ * @return Match of the first 10 ms of each erasure against the lost speech in dB,
+ * 0 dB being what silence would give
+ */
+static double run_pattern(PlcMode mode, const char *modeName, double enter, double leave,
+                        const char *name) {
+    PlcState st;
+    Channel ch;
+    uint16_t block[BLOCK];
+    uint32_t start, cycles, total = 0, worst = 0;
+    uint32_t lost = 0, runs = 0, muted = 0, loud = 0, longest = 0, run = 0;
+    double sig = 0, err = 0, d;
+    int32_t b, i;
+
+    plc_init(&st, mode, BLOCK);
+    channel_init(&ch, name, enter, leave);
+    for (b = 0; b < SPEECH_BLOCKS; b++) {
+        if (b < 8 || channel_pass(&ch)) {       // Let the history fill first
+            memcpy(block, speech[b], sizeof(block));
+            plc_good_block(&st, block);
+            run = 0;
+            continue;
+        }
+
+        lost++;
+        runs += run == 0;
+        muted += run * BLOCK >= PLC_MUTE_SAMPLES;
+        memset(block, 0, sizeof(block));        // Stale ring buffer contents
+        start = cycles_now();
+        plc_conceal_block(&st, block);
+        cycles = cycles_now() - start;
+        total += cycles;
+        if (cycles > worst) worst = cycles;
+
+        for (i = 0; i < BLOCK; i++) {
+            if (run * BLOCK + i >= PLC_MUTE_SAMPLES && block[i] != st.dc) {
+                loud++;
+            }
+            if (run == 0 && i < PLC_ATTEN_START) {
+                d = (double)speech[b][i] - SPEECH_DC;
+                sig += d * d;
+                d = (double)block[i] - speech[b][i];
+                err += d * d;
+            }
+        }
+        run++;
+        if (run > longest) longest = run;
+    }
+
+    printf("%-6s %-6s: lost %4.1f%%, %4u erasures up to %2u blocks, first 10 ms %5.1f dB, "
+           "%4u cycles per concealed block (worst %u)\n",
+           name, modeName, 100.0 * lost / SPEECH_BLOCKS, (unsigned)runs, (unsigned)longest,
+           10 * log10(sig / err), (unsigned)(total / lost), (unsigned)worst);
+    CHECK(lost > 0 && runs > 0);
+    CHECK(st.concealedBlocks == lost);
+    CHECK(st.erasures == runs);
+    CHECK(st.mutedBlocks == muted);
+    CHECK(loud == 0);
+    return 10 * log10(sig / err);
+}
+
+/**
+ * @brief Cycles per block, every concealed block starting a new erasure so it pays
+ * for the pitch search. On the host these are nanoseconds scaled to the 120 MHz
+ * core clock (cycles.h), so compare them with each other rather than the target.
+ */
+static void bench(PlcMode mode, const char *name) {
+    PlcState st;
+    uint16_t block[BLOCK];
+    uint32_t start, good = 0, conceal = 0;
+    int32_t n, rounds = 2000;
+
+    prime(&st, mode, 73, 8);
+    for (n = 0; n < rounds; n++) {
+        sine_block(block, 73);
+        start = cycles_now();
+        plc_good_block(&st, block);
+        good += cycles_now() - start;
+
+        start = cycles_now();
+        plc_conceal_block(&st, block);
+        conceal += cycles_now() - start;
+    }
+    printf("%-6s good block %6u cycles, concealed block %6u cycles (%d MHz)\n",
+           name, good / rounds, conceal / rounds, CYCLES_PER_US);
+}
+
+static const struct {
+    const char *name;
+    double enter;
+    double leave;
+} patterns[] = {
+    // Random loss, bursts averaging 2.5 blocks (40 ms), and gaps averaging 10 blocks past the mute
+    { "random", 0.05, 1.0 },
+    { "burst", 0.02, 0.4 },
+    { "gaps", 0.01, 0.1 },
+};
+
+int main() {
+    double pitch, repeat;
+    int32_t i;
+
+    test_pitch(73);
+    test_pitch(72.5);       // Not a whole number of samples, so the loop is not exact
+    test_pitch(50);
+    test_pitch(110);
+    test_mute(PLC_PITCH);
+    test_mute(PLC_REPEAT);
+    test_unprimed();
+
+    bench(PLC_REPEAT, "repeat");
+    bench(PLC_PITCH, "pitch");
+
+    // Looping a whole block is out of phase with the speech, so only pitch mode
+    // must beat silence, and by 3 dB more than repeat mode does
+    speech_make();
+    for (i = 0; i < 3; i++) {
+        pitch = run_pattern(PLC_PITCH, "pitch", patterns[i].enter, patterns[i].leave, patterns[i].name);
+        repeat = run_pattern(PLC_REPEAT, "repeat", patterns[i].enter, patterns[i].leave, patterns[i].name);
+        CHECK(pitch > 3);
+        CHECK(pitch > repeat + 3);
+    }
+    return check_exit("test_plc");
+}
@@ -0,0 +1,260 @@
+/*
+ *  ======== test_scriptvm.c ========
+ *  Throughput of compiled script lines against re-parsing them. The same
+ *  -reg lines run through the script VM and through the text path
+ *  execute_payload() takes for them, and both must leave the registers equal.
+ *  Also checks when -loop stops for counters that start at 0 or below, and
+ *  that starting, suspending and killing contexts leaves the gate balanced.
+ *
+ *  p100.c is the whole firmware and does not build on the host, so
+ *  reparse_line() repeats what execute_payload() and CMD_reg() do for a -reg
+ *  line: copy, tokenize, lowercase, walk the command names in p100.c's order
+ *  to "-reg", then the CMD_reg checks ahead of reg_exec(). Keep it in step.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <netinet/in.h>     // struct sockaddr_in, used by p100.h
+
+#include "p100.h"
+#include "script.h"
+#include "scriptvm.h"
+#include "register.h"
+#include "shadow.h"
+#include "tickers.h"
+#include "callback.h"
+#include "timestamp.h"
+#include "check.h"
+
+#define RUNS    20000
+
+Ticker tickers[MAX_TICKERS];
+CommandCallback callbacks[MAX_CALLBACKS];
+GateSwi_Handle gateSwi1;
+
+static int32_t gateDepth;       // GateSwi_enter() calls not yet left
+
+UInt GateSwi_enter(GateSwi_Handle handle) {
+    gateDepth++;
+    return 0;
+}
+
+void GateSwi_leave(GateSwi_Handle handle, UInt key) {
+    gateDepth--;
+}
+
+void AddProgramMessage(char *msg) {
+}
+
+void AddPayload(char *payload) {
+}
+
+void Semaphore_post(Semaphore_Handle handle) {
+}
+
+BIOS_ThreadType BIOS_getThreadType() {
+    return BIOS_ThreadType_Task;
+}
+
+Task_Handle Task_self() {
+    return glo.bios.PayloadExecutor;
+}
+
+// Commands execute_payload() compares before reaching "-reg"
+static const char *commandsBeforeReg[] = {
+    "-about", "-audio", "-callback", "-cpu", "-dial", "-error", "-fec", "-goto", "-call",
+    "-ret", "-loop", "-gpio", "-help", "-if", "-lat", "-load", "-mem", "-memr", "-netstat",
+    "-plc", "-print",
+};
+
+static void reparse_line(char *msg) {
+    char copy[BUFFER_SIZE];
+    char *saveptr, *token, *op_token, *arg1, *arg2, *p;
+    size_t i;
+    RegOp op;
+
+    strncpy(copy, msg, BUFFER_SIZE);
+    copy[BUFFER_SIZE - 1] = '\0';
+    token = strtok_r(copy, " \t\r\n", &saveptr);
+    if (token == NULL) {
+        return;
+    }
+    for (p = token; *p; ++p) {
+        *p = tolower((unsigned char)*p);
+    }
+    for (i = 0; i < sizeof(commandsBeforeReg) / sizeof(commandsBeforeReg[0]); i++) {
+        if (strcmp(token, commandsBeforeReg[i]) == 0) {
+            return;
+        }
+    }
+    if (strcmp(token, "-reg") != 0) {
+        return;
+    }
+
+    op_token = strtok_r(NULL, " \t\r\n", &saveptr);
+    if (!op_token || strcmp(op_token, "q") == 0) {
+        return;
+    }
+    for (p = op_token; *p; ++p) {
+        *p = tolower((unsigned char)*p);
+    }
+    if (strcmp(op_token, "exec") == 0 || (op_token[1] == '\0' && strchr("lfs", op_token[0]))) {
+        return;
+    }
+    arg1 = strtok_r(NULL, " \t\r\n", &saveptr);
+    arg2 = strtok_r(NULL, " \t\r\n", &saveptr);
+    if (vec_lookup_op(op_token) != VEC_OP_COUNT) {
+        return;
+    }
+    op = reg_lookup_op(op_token);
+    if (op == REG_OP_COUNT || !arg1 || (reg_op_operands(op) == 2 && !arg2)) {
+        return;
+    }
+    reg_exec(op, arg1, arg2, true);
+}
+
+void execute_payload(char *msg) {
+    reparse_line(msg);
+}
+
+static const char *program[] = {
+    "-reg inc R1",
+    "-reg add R2 R1",
+    "-reg sub R3 #7",
+    "-reg xor R4 R2",
+    "-reg mov R5 R4",
+    "-reg mul R6 #3",
+    "-reg add R6 R5",
+    "-reg and R7 #0xFF",
+    "-reg ior R7 R1",
+    "-reg dec R8",
+    "-reg xchg R9 R10",
+    "-reg max R11 R3",
+};
+
+#define PROGRAM_LINES ((int)(sizeof(program) / sizeof(program[0])))
+
+#define LOOP_LINE       40      // Past the end of program[]
+
+/**
+ * @brief Runs "top: -reg inc R21 / [body] / -loop R20 top / -reg inc R22" with R20
+ * starting at count, giving up after a bounded number of quanta
+ * @return Times the loop body ran, -1 when the script did not end
+ */
+static int32_t run_loop(int32_t count, const char *body) {
+    int32_t quanta;
+
+    strcpy(scriptLines[LOOP_LINE], "top: -reg inc R21");
+    strcpy(scriptLines[LOOP_LINE + 1], body);
+    strcpy(scriptLines[LOOP_LINE + 2], "-loop R20 top");
+    strcpy(scriptLines[LOOP_LINE + 3], "-reg inc R22");
+    script_compile_all();
+
+    registers[20] = count;
+    registers[21] = 0;
+    registers[22] = 0;
+    script_start(LOOP_LINE);
+    for (quanta = 0; script_runnable() && quanta < 1000; quanta++) {
+        script_run_quantum();
+    }
+    if (script_runnable()) {
+        script_kill_all();
+        return -1;
+    }
+    CHECK(registers[22] == 1);
+    return registers[21];
+}
+
+static void test_loop() {
+    CHECK(run_loop(3, "-reg inc R23") == 3);
+    CHECK(registers[20] == 0);
+    CHECK(run_loop(1, "-reg inc R23") == 1);
+    CHECK(run_loop(0, "-reg inc R23") == 1);      // Body runs once, the counter goes to -1
+    CHECK(registers[20] == -1);
+    CHECK(run_loop(-1, "-reg inc R23") == 1);
+    CHECK(registers[20] == -2);
+    CHECK(run_loop(INT32_MIN, "-reg inc R23") == 1);
+    CHECK(registers[20] == INT32_MAX);          // Wraps, but the loop still ends
+    CHECK(run_loop(5, "-reg mov R20 #0") == 1);   // Body clears the counter
+
+    memset(scriptLines[LOOP_LINE], 0, 4 * SCRIPT_LINE_SIZE);
+    script_compile_all();
+}
+
+static void test_contexts() {
+    int32_t ids = 0;
+    int id, i;
+
+    strcpy(scriptLines[LOOP_LINE], "-reg inc R21");
+    script_compile_all();
+    for (i = 0; i < SCRIPT_CONTEXTS; i++) {
+        id = script_start(LOOP_LINE);
+        CHECK(id >= 0 && id < SCRIPT_CONTEXTS);
+        ids |= 1 << id;
+    }
+    CHECK(ids == (1 << SCRIPT_CONTEXTS) - 1);    // Every start got its own context
+    CHECK(script_start(LOOP_LINE) == -1);
+    CHECK(gateDepth == 0);
+
+    CHECK(script_suspend(0, true));
+    CHECK(scriptContexts[0].state == CTX_SUSPENDED);
+    script_kill(1);
+    CHECK(!script_suspend(1, false));
+    CHECK(script_start(LOOP_LINE) == 1);
+    script_kill_all();
+    CHECK(!script_runnable());
+    CHECK(gateDepth == 0);
+
+    scriptLines[LOOP_LINE][0] = '\0';
+    script_compile_all();
+}
+
+static void test_throughput() {
+    int32_t vmRegs[NUM_REGISTERS];
+    uint64_t start, vmUs, reparseUs;
+    int32_t run, i;
+    char line[BUFFER_SIZE];
+
+    for (i = 0; i < PROGRAM_LINES; i++) {
+        strcpy(scriptLines[i], program[i]);
+    }
+    script_compile_all();
+    shadowRegisters[SHADOW_QUIET] = 1;
+    glo.scriptContext = -1;
+
+    memset(registers, 0, sizeof(registers));
+    start = timestamp_us64();
+    for (run = 0; run < RUNS; run++) {
+        script_start(0);
+        while (script_runnable()) {
+            script_run_quantum();
+        }
+    }
+    vmUs = timestamp_us64() - start;
+    memcpy(vmRegs, registers, sizeof(vmRegs));
+
+    memset(registers, 0, sizeof(registers));
+    start = timestamp_us64();
+    for (run = 0; run < RUNS; run++) {
+        for (i = 0; i < PROGRAM_LINES; i++) {
+            strcpy(line, scriptLines[i]);
+            execute_payload(line);
+        }
+    }
+    reparseUs = timestamp_us64() - start;
+
+    CHECK(registers[1] == RUNS);
+    CHECK(memcmp(vmRegs, registers, sizeof(vmRegs)) == 0);
+
+    printf("compiled VM: %8.0f lines/s\n", 1e6 * RUNS * PROGRAM_LINES / vmUs);
+    printf("re-parsing:  %8.0f lines/s\n", 1e6 * RUNS * PROGRAM_LINES / reparseUs);
+    printf("speedup:     %8.1fx\n", (double)reparseUs / vmUs);
+    CHECK(vmUs < reparseUs);
+}
+
+int main() {
+    test_throughput();
+    test_loop();
+    test_contexts();
+    return check_exit("test_scriptvm");
+}
@@ -0,0 +1,99 @@
+/*
+ *  ======== test_shadow.c ========
+ *  Shadow registers: lookup, value parsing, range checks, the -shadow listing,
+ *  and LOG() skipping its arguments when the level is filtered out.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <netinet/in.h>     // struct sockaddr_in, used by p100.h
+
+#include "p100.h"
+#include "shadow.h"
+#include "check.h"
+
+static char output[2048];
+static int outputLines;
+
+void AddProgramMessage(char *msg) {
+    strncat(output, msg, sizeof(output) - strlen(output) - 1);
+    outputLines++;
+}
+
+static int evaluated;
+
+static double argument() {
+    evaluated++;
+    return 1.5;
+}
+
+static void test_parse() {
+    int32_t v;
+
+    CHECK(shadow_lookup("log_net") == SHADOW_LOG_NET);
+    CHECK(shadow_lookup("outq_max") == SHADOW_OUTQ_MAX);
+    CHECK(shadow_lookup("LOG_NET") == -1);
+    CHECK(shadow_lookup("nope") == -1);
+
+    CHECK(shadow_parse_value(SHADOW_LOG_NET, "debug", &v) && v == LOG_DEBUG);
+    CHECK(shadow_parse_value(SHADOW_LOG_CMD, "off", &v) && v == LOG_OFF);
+    CHECK(shadow_parse_value(SHADOW_ECHO, "on", &v) && v == 1);
+    CHECK(shadow_parse_value(SHADOW_ECHO, "off", &v) && v == 0);
+    CHECK(!shadow_parse_value(SHADOW_ECHO, "debug", &v));      // Level names only for log_xxx
+    CHECK(shadow_parse_value(SHADOW_OUTQ_MAX, "0x10", &v) && v == 16);
+    CHECK(shadow_parse_value(SHADOW_OUTQ_MAX, "-3", &v) && v == -3);
+    CHECK(!shadow_parse_value(SHADOW_OUTQ_MAX, "12x", &v));
+    CHECK(!shadow_parse_value(SHADOW_OUTQ_MAX, "", &v));
+}
+
+static void test_set() {
+    init_shadow_registers();
+    CHECK(shadowRegisters[SHADOW_LOG_AUDIO] == LOG_INFO);
+    CHECK(shadowRegisters[SHADOW_OUTQ_MAX] == MAX_QUEUE_SIZE);
+
+    CHECK(shadow_set(SHADOW_LOG_NET, LOG_DEBUG));
+    CHECK(!shadow_set(SHADOW_LOG_NET, LOG_DEBUG + 1));
+    CHECK(shadowRegisters[SHADOW_LOG_NET] == LOG_DEBUG);       // Unchanged by the refused value
+    CHECK(!shadow_set(SHADOW_OUTQ_MAX, 0));
+    CHECK(!shadow_set(SHADOW_OUTQ_MAX, MAX_QUEUE_SIZE + 1));
+    CHECK(shadow_set(SHADOW_OUTQ_MAX, 1));
+    CHECK(!shadow_set(SHADOW_QUIET, -1));
+}
+
+static void test_log() {
+    init_shadow_registers();
+    output[0] = '\0';
+
+    LOG(AUDIO, LOG_DEBUG, "dropped %.2f\r\n", argument());
+    CHECK(evaluated == 0);                          // Filtered before the arguments
+    CHECK(output[0] == '\0');
+
+    LOG(AUDIO, LOG_INFO, "kept %.2f\r\n", argument());
+    CHECK(evaluated == 1);
+    CHECK(strcmp(output, "kept 1.50\r\n") == 0);
+
+    shadow_set(SHADOW_LOG_AUDIO, LOG_OFF);
+    LOG(AUDIO, LOG_ERROR, "off\r\n");
+    CHECK(strcmp(output, "kept 1.50\r\n") == 0);
+}
+
+static void test_print() {
+    char *line;
+
+    init_shadow_registers();
+    shadow_set(SHADOW_LOG_NET, LOG_DEBUG);
+    output[0] = '\0';
+    outputLines = 0;
+    print_all_shadow_registers();
+    CHECK(outputLines == 3 + SHADOW_COUNT);
+    CHECK(strstr(output, "| log_net    | debug | off..debug |") != NULL);
+    line = strstr(output, "| outq_max ");
+    CHECK(line != NULL && strstr(line, "1..") != NULL);
+}
+
+int main() {
+    test_parse();
+    test_set();
+    test_log();
+    test_print();
+    return check_exit("test_shadow");
+}
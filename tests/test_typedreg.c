@@ -0,0 +1,124 @@
+/*
+ *  ======== test_typedreg.c ========
+ *  The L (64-bit), F (float) and S (string) register banks through reg_exec(),
+ *  the path CMD_reg and -reg exec batches take: conversions between banks,
+ *  the errors for undefined operations and the string register size limit.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <netinet/in.h>     // struct sockaddr_in, used by p100.h
+
+#include "p100.h"
+#include "register.h"
+#include "watch.h"
+#include "check.h"
+
+static char lastMsg[128];
+
+void AddProgramMessage(char *msg) {
+    strncpy(lastMsg, msg, sizeof(lastMsg) - 1);
+}
+
+void AddPayload(char *payload) {
+}
+
+uint8_t watchMask[NUM_REGISTERS];
+
+void watch_check(int reg) {
+}
+
+/// @brief Runs "-reg op a b" quietly, src may be NULL
+static bool run(const char *op, const char *dst, const char *src) {
+    char a[64], b[64];
+
+    strcpy(a, dst);
+    if (src) {
+        strcpy(b, src);
+    }
+    lastMsg[0] = '\0';
+    return reg_exec(reg_lookup_op(op), a, src ? b : NULL, true);
+}
+
+static void test_parse() {
+    RegType type;
+    int index;
+
+    CHECK(parse_typed_register("F15", &type, &index) && type == RT_FLOAT && index == 15);
+    CHECK(parse_typed_register("l7", &type, &index) && type == RT_LONG && index == 7);
+    CHECK(parse_typed_register("S0", &type, &index) && type == RT_STRING && index == 0);
+    CHECK(!parse_typed_register("F16", &type, &index));
+    CHECK(!parse_typed_register("S8", &type, &index));
+    CHECK(!parse_typed_register("Fx", &type, &index));
+    CHECK(!parse_typed_register("R1", &type, &index));
+}
+
+static void test_float() {
+    CHECK(run("mov", "f0", "#3.5"));
+    CHECK(run("mul", "f0", "#2"));
+    CHECK(floatRegisters[0] == 7.0f);
+
+    CHECK(!run("div", "f0", "#0.0"));
+    CHECK(strstr(lastMsg, "Division by zero") != NULL);
+    CHECK(!run("and", "f0", "#1"));
+    CHECK(strstr(lastMsg, "not defined for float") != NULL);
+    CHECK(floatRegisters[0] == 7.0f);
+
+    CHECK(run("mov", "f1", "#1e3"));
+    CHECK(run("xchg", "f0", "f1"));
+    CHECK(floatRegisters[0] == 1000.0f && floatRegisters[1] == 7.0f);
+    CHECK(!run("xchg", "f0", "r1"));                // Different banks
+}
+
+static void test_conversions() {
+    CHECK(run("mov", "f0", "#7.75"));
+    CHECK(run("mov", "r1", "f0"));
+    CHECK(registers[1] == 7);                       // Truncated toward zero
+
+    CHECK(run("mov", "r2", "#10"));
+    CHECK(run("add", "r2", "#2.9"));                // Float immediate into an Rn
+    CHECK(registers[2] == 12);
+
+    CHECK(run("mov", "l0", "#x7fffffff"));
+    CHECK(run("mul", "l0", "l0"));
+    CHECK(longRegisters[0] == 0x3FFFFFFF00000001LL);
+    CHECK(run("mov", "l1", "#5"));
+    CHECK(run("neg", "l1", NULL));
+    CHECK(longRegisters[1] == -5);
+    CHECK(!run("rem", "l1", "#0"));
+}
+
+static void test_string() {
+    CHECK(run("mov", "s0", "\"hi\""));
+    CHECK(run("mov", "f2", "#7"));
+    CHECK(run("add", "s0", "f2"));
+    CHECK(strcmp(stringRegisters[0], "hi7") == 0);
+    CHECK(run("add", "s0", "l0"));
+    CHECK(strcmp(stringRegisters[0], "hi74611686014132420609") == 0);
+
+    // Appending past the register size truncates
+    CHECK(run("add", "s0", "l0"));
+    CHECK(strlen(stringRegisters[0]) == STRING_REGISTER_SIZE - 1);
+    CHECK(!run("mul", "s0", "#2"));
+
+    CHECK(run("mov", "s1", "\"abc\""));
+    CHECK(run("xchg", "s0", "s1"));
+    CHECK(strcmp(stringRegisters[0], "abc") == 0);
+}
+
+static void test_batch() {
+    char ops[] = "mov f3 #0.25; add r4 #1; mul f3 #4";
+
+    registers[4] = 0;
+    CHECK(reg_batch(ops, true) == 3);
+    CHECK(floatRegisters[3] == 1.0f);
+    CHECK(registers[4] == 1);
+}
+
+int main() {
+    test_parse();
+    test_float();
+    test_conversions();
+    test_string();
+    test_batch();
+    return check_exit("test_typedreg");
+}
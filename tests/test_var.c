@@ -0,0 +1,90 @@
+/*
+ *  ======== test_var.c ========
+ *  Named variables: name rules, slots that stay put, lookups that must not
+ *  match a prefix, and the hash table filled to the pool limit.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <netinet/in.h>     // struct sockaddr_in, used by p100.h
+
+#include "p100.h"
+#include "var.h"
+#include "check.h"
+
+static char output[4096];
+
+void AddProgramMessage(char *msg) {
+    strncat(output, msg, sizeof(output) - strlen(output) - 1);
+}
+
+static int intern(const char *name) {
+    return var_intern(name, strlen(name));
+}
+
+static int lookup(const char *name) {
+    return var_lookup(name, strlen(name));
+}
+
+static void test_names() {
+    CHECK(intern("gain") == 0);
+    CHECK(intern("gain") == 0);                     // Same slot on every use
+    CHECK(var_parse("$peer_count") == 1);
+    CHECK(var_parse("$gain") == 0);
+    CHECK(intern("Gain") == 2);                     // Case sensitive
+
+    CHECK(intern("") == -1);
+    CHECK(intern("9lives") == -1);
+    CHECK(intern("a-b") == -1);
+    CHECK(intern("abcdefghijklmno") == 3);          // 15 characters fit
+    CHECK(intern("abcdefghijklmnop") == -1);
+    CHECK(var_parse("gain") == -1);                 // Needs the '$'
+    CHECK(var_parse(NULL) == -1);
+
+    // A name that is a prefix of another, or the other way round, is a different name
+    CHECK(lookup("abcdefghijklmn") == -1);
+    CHECK(lookup("gai") == -1);
+    CHECK(lookup("gains") == -1);
+    CHECK(var_lookup("gains", 4) == 0);             // Only len characters count
+
+    CHECK(strcmp(var_name(1), "peer_count") == 0);
+    CHECK(var_slot(&varValues[1]) == 1);
+    CHECK(var_slot(&varValues[MAX_VARS - 1]) == -1);    // Not defined yet
+    CHECK(var_count() == 4);
+}
+
+static void test_fill() {
+    char name[VAR_NAME_SIZE];
+    int i, probe = 0, slot, first = var_count();
+    const char *p;
+
+    for (i = first; i < MAX_VARS; i++) {
+        sprintf(name, "v%d", i * 7919);
+        slot = intern(name);
+        CHECK(slot == i);
+        varValues[slot] = i;
+    }
+    CHECK(var_count() == MAX_VARS);
+    CHECK(intern("one_too_many") == -1);
+    CHECK(intern("gain") == 0);                     // Existing names still resolve
+
+    for (i = first; i < MAX_VARS; i++) {
+        sprintf(name, "v%d", i * 7919);
+        CHECK(lookup(name) == i && varValues[i] == i);
+    }
+
+    output[0] = '\0';
+    print_all_vars();
+    p = strstr(output, "longest probe ");
+    CHECK(p != NULL && sscanf(p, "longest probe %d", &probe) == 1);
+    printf("%d variables, longest probe %d of %d buckets\n", MAX_VARS, probe, VAR_TABLE_SIZE);
+    CHECK(probe > 0 && probe <= 16);
+
+    var_zero_all();
+    CHECK(varValues[MAX_VARS - 1] == 0 && var_count() == MAX_VARS);
+}
+
+int main() {
+    test_names();
+    test_fill();
+    return check_exit("test_var");
+}
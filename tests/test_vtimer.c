@@ -0,0 +1,197 @@
+/*
+ *  ======== test_vtimer.c ========
+ *  Virtual timers on a simulated Timer0: the base tick follows the GCD of the
+ *  active periods, every timer fires on exact multiples of its period, and a
+ *  running timer keeps its next fire time when another timer changes the base.
+ *  A timer that runs out of fires hands Timer0 back to the remaining timers.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <netinet/in.h>     // struct sockaddr_in, used by p100.h
+
+#include "p100.h"
+#include "vtimer.h"
+#include "check.h"
+
+GateSwi_Handle gateSwi0;
+
+static uint32_t now;                    // Simulated time in us
+static bool timerRunning;
+
+// Fire times of each timer, relative to when it was started
+static uint32_t fired[MAX_VTIMERS][64];
+static int32_t fireCount[MAX_VTIMERS];
+static char lastPayload[BUFFER_SIZE];
+
+void AddProgramMessage(char *msg) {
+}
+
+void execute_payload(char *msg) {
+    strcpy(lastPayload, msg);
+}
+
+UInt GateSwi_enter(GateSwi_Handle handle) {
+    return 0;
+}
+
+void GateSwi_leave(GateSwi_Handle handle, UInt key) {
+}
+
+int32_t Timer_start(Timer_Handle handle) {
+    timerRunning = true;
+    return Timer_STATUS_SUCCESS;
+}
+
+void Timer_stop(Timer_Handle handle) {
+    timerRunning = false;
+}
+
+int32_t Timer_setPeriod(Timer_Handle handle, int periodUnits, uint32_t period) {
+    return Timer_STATUS_SUCCESS;
+}
+
+static void record(UArg arg) {
+    if (fireCount[arg] < 64) {
+        fired[arg][fireCount[arg]] = now;
+    }
+    fireCount[arg]++;
+}
+
+/// @brief Runs Timer0 for us microseconds at whatever base tick is programmed
+static void advance(uint32_t us) {
+    uint32_t end = now + us;
+
+    while (timerRunning && now + glo.Timer0Period <= end) {
+        now += glo.Timer0Period;
+        vtimer_dispatch();
+    }
+    now = end;
+}
+
+static bool start(int id, uint32_t periodUs, int32_t count) {
+    const char *error = NULL;
+
+    fireCount[id] = 0;
+    return vtimer_start(id, periodUs, record, id, NULL, count, &error);
+}
+
+static void test_gcd() {
+    const char *error = NULL;
+    int32_t i;
+
+    CHECK(start(VTIMER_AUDIO, 125, -1));
+    CHECK(glo.Timer0Period == 125);
+    CHECK(start(VTIMER_CALLBACK, 1000, -1));
+    CHECK(glo.Timer0Period == 125);
+
+    advance(10000);
+    CHECK(fireCount[VTIMER_AUDIO] == 80);
+    CHECK(fireCount[VTIMER_CALLBACK] == 10);
+    for (i = 0; i < 10; i++) {
+        CHECK(fired[VTIMER_CALLBACK][i] == 1000 * (uint32_t)(i + 1));
+    }
+
+    // 125 and 300 would need a 25 us tick
+    CHECK(!vtimer_start(VTIMER_USER, 300, NULL, 0, "-print x", -1, &error));
+    CHECK(error != NULL && strstr(error, "base tick") != NULL);
+    CHECK(!vtimer_start(VTIMER_USER, 50, NULL, 0, "-print x", -1, &error));
+    CHECK(glo.Timer0Period == 125);
+
+    // A payload timer with a count stops itself
+    CHECK(vtimer_start(VTIMER_USER, 250, NULL, 0, "-print x", 3, &error));
+    advance(2000);
+    CHECK(vtimers[VTIMER_USER].fires == 3);
+    CHECK(!vtimers[VTIMER_USER].active);
+    CHECK(strcmp(lastPayload, "-print x") == 0);
+
+    vtimer_stop_all();
+    CHECK(glo.Timer0Period == 0);
+    CHECK(!timerRunning);
+}
+
+static void test_rescale() {
+    uint32_t t0;
+
+    // Callback alone runs Timer0 at 1000 us
+    now = 0;
+    CHECK(start(VTIMER_CALLBACK, 1000, -1));
+    CHECK(glo.Timer0Period == 1000);
+    advance(3000);
+    CHECK(fireCount[VTIMER_CALLBACK] == 3);
+
+    // Audio joins at 3000 us: the base drops to 125 us and the callback's
+    // remaining 1000 us become 8 ticks, so it still fires at 4000 and 5000
+    CHECK(start(VTIMER_AUDIO, 125, -1));
+    CHECK(glo.Timer0Period == 125);
+    advance(2000);
+    CHECK(fireCount[VTIMER_CALLBACK] == 5);
+    CHECK(fired[VTIMER_CALLBACK][3] == 4000 && fired[VTIMER_CALLBACK][4] == 5000);
+    CHECK(fireCount[VTIMER_AUDIO] == 16);
+
+    // Audio stops right after a callback fire: the base goes back to 1000 us
+    // with no drift
+    vtimer_stop(VTIMER_AUDIO);
+    CHECK(glo.Timer0Period == 1000);
+    advance(2000);
+    CHECK(fireCount[VTIMER_CALLBACK] == 7);
+    CHECK(fired[VTIMER_CALLBACK][6] == 7000);
+
+    // Audio joins and leaves off the 1000 us grid: 250 us remain when it stops,
+    // which round up to one 1000 us tick, so the next fire is late by less than a tick
+    CHECK(start(VTIMER_AUDIO, 125, -1));
+    advance(750);
+    vtimer_stop(VTIMER_AUDIO);
+    t0 = now;
+    advance(2000);
+    CHECK(fireCount[VTIMER_CALLBACK] == 9);
+    CHECK(fired[VTIMER_CALLBACK][7] >= 8000 && fired[VTIMER_CALLBACK][7] < 8000 + 1000);
+    CHECK(fired[VTIMER_CALLBACK][8] - fired[VTIMER_CALLBACK][7] == 1000);
+    printf("rescale: fire due at 8000 us came at %u us (stop at %u us)\n",
+           (unsigned)fired[VTIMER_CALLBACK][7], (unsigned)t0);
+
+    vtimer_stop_all();
+}
+
+static void test_expire() {
+    const char *error = NULL;
+
+    // A one-shot timer alone fires once and stops Timer0
+    now = 0;
+    CHECK(start(VTIMER_USER, 100, 1));
+    CHECK(glo.Timer0Period == 100);
+    advance(1000);
+    CHECK(fireCount[VTIMER_USER] == 1 && fired[VTIMER_USER][0] == 100);
+    CHECK(!vtimers[VTIMER_USER].active);
+    CHECK(glo.Timer0Period == 0);
+    CHECK(!timerRunning);
+
+    // Two fires at 250 us next to the callback. The second is off the 1000 us
+    // grid, so the base stays at 250 us until the callback fires at 1000 us,
+    // then returns to 1000 us and the callback keeps its period
+    now = 0;
+    CHECK(start(VTIMER_CALLBACK, 1000, -1));
+    CHECK(start(VTIMER_USER, 250, 2));
+    CHECK(glo.Timer0Period == 250);
+    advance(750);
+    CHECK(fireCount[VTIMER_USER] == 2 && fired[VTIMER_USER][1] == 500);
+    CHECK(glo.Timer0Period == 250);
+    advance(2250);
+    CHECK(glo.Timer0Period == 1000);
+    CHECK(fireCount[VTIMER_CALLBACK] == 3);
+    CHECK(fired[VTIMER_CALLBACK][0] == 1000 && fired[VTIMER_CALLBACK][2] == 3000);
+
+    // A count of 0 would never run out, so it is refused
+    CHECK(!vtimer_start(VTIMER_USER, 1000, NULL, 0, "-print x", 0, &error));
+    CHECK(error != NULL && strstr(error, "Count") != NULL);
+    CHECK(!vtimer_start(VTIMER_USER, 1000, NULL, 0, "-print x", -2, &error));
+    CHECK(!vtimers[VTIMER_USER].active);
+
+    vtimer_stop_all();
+}
+
+int main() {
+    test_gcd();
+    test_rescale();
+    test_expire();
+    return check_exit("test_vtimer");
+}
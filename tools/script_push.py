@@ -0,0 +1,107 @@
+#!/usr/bin/env python3
+"""Upload a script file to a board in one transfer.
+
+Line N of the file becomes script line N on the board (at most 64 lines of
+up to 79 characters). A script line on the board has room for 255, but the
+script compiler and the payload executor only read the first BUFFER_SIZE - 1
+(p100.h), so longer lines are refused here rather than cut short there.
+
+The file is sent as NETPKT_SCRIPT chunks, either as UDP datagrams to the
+board's listen port or as frames on UART7 (UART1 in the firmware). The board replaces all script lines once every chunk has arrived
+and the CRC matches, and only while no script is running.
+
+    script_push.py blink.txt --udp 192.168.1.20
+    script_push.py blink.txt --serial /dev/ttyUSB0 --repeat 2
+
+Sending the same transfer more than once is harmless: chunks the board already
+has are ignored, and chunks that were lost are filled in. Check the result on
+the console or with "-script image".
+"""
+
+import argparse
+import os
+import socket
+import struct
+import sys
+import time
+import zlib
+
+NETPKT_MAGIC = b"\xd5M"
+NETPKT_SCRIPT = 3           # NetPacketType in netpacket.h
+SCRIPT_IMAGE_CHUNK = 1024   # scriptimage.h
+SCRIPT_LINE_COUNT = 64
+SCRIPT_LINE_MAX = 79        # BUFFER_SIZE - 1 in p100.h
+DEFAULT_NET_PORT = 1000
+
+HEADER = struct.Struct("<2sBBHHI")      # NetPacketHeader
+CHUNK = struct.Struct("<HHHHII")        # ScriptImageChunk
+
+
+def load_image(path):
+    with open(path, "r", encoding="ascii") as f:
+        lines = f.read().splitlines()
+    if len(lines) > SCRIPT_LINE_COUNT:
+        sys.exit("%s: %d lines, the board has %d" % (path, len(lines), SCRIPT_LINE_COUNT))
+    for number, line in enumerate(lines):
+        if len(line) > SCRIPT_LINE_MAX:
+            sys.exit("%s: line %d is longer than %d characters" % (path, number, SCRIPT_LINE_MAX))
+    if not lines:
+        sys.exit("%s: empty script" % path)
+    return "".join(line + "\n" for line in lines).encode("ascii")
+
+
+def packets(image, transfer):
+    crc = zlib.crc32(image) & 0xFFFFFFFF
+    chunks = (len(image) + SCRIPT_IMAGE_CHUNK - 1) // SCRIPT_IMAGE_CHUNK
+    for index in range(chunks):
+        data = image[index * SCRIPT_IMAGE_CHUNK:(index + 1) * SCRIPT_IMAGE_CHUNK]
+        header = HEADER.pack(NETPKT_MAGIC, NETPKT_SCRIPT, 0, index, 0, 0)
+        chunk = CHUNK.pack(transfer, index, chunks, len(data), len(image), crc)
+        yield header + chunk + data
+
+
+def parse_udp(target):
+    host, _, port = target.partition(":")
+    return host, int(port) if port else DEFAULT_NET_PORT
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Upload a script file to a board.")
+    parser.add_argument("file", help="script text, one script line per line")
+    link = parser.add_mutually_exclusive_group(required=True)
+    link.add_argument("--udp", metavar="HOST[:PORT]", help="board address, port %d by default" % DEFAULT_NET_PORT)
+    link.add_argument("--serial", metavar="DEVICE", help="serial port wired to the board's UART7")
+    parser.add_argument("--baud", type=int, default=115200, help="serial baud rate (115200)")
+    parser.add_argument("--repeat", type=int, default=1, help="send the whole transfer this many times (1)")
+    parser.add_argument("--gap", type=float, default=5.0, help="milliseconds between packets (5)")
+    args = parser.parse_args()
+
+    image = load_image(args.file)
+    transfer = int.from_bytes(os.urandom(2), "little")
+    frames = list(packets(image, transfer))
+
+    if args.udp:
+        address = parse_udp(args.udp)
+        sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        send = lambda frame: sock.sendto(frame, address)
+    else:
+        try:
+            import serial
+        except ImportError:
+            sys.exit("--serial needs pyserial (pip install pyserial)")
+        port = serial.Serial(args.serial, args.baud)
+        # A frame must start a line on the board, so end any partial command first
+        port.write(b"\r")
+        send = port.write
+
+    for _ in range(max(args.repeat, 1)):
+        for frame in frames:
+            send(frame)
+            time.sleep(args.gap / 1000.0)
+
+    print("Sent %d lines, %d bytes in %d chunks, transfer %d, crc 0x%08X"
+          % (image.count(b"\n"), len(image), len(frames), transfer, zlib.crc32(image) & 0xFFFFFFFF))
+
+
+if __name__ == "__main__":
+    main()
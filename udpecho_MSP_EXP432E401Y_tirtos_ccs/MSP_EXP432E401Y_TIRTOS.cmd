@@ -39,7 +39,9 @@ HEAPSIZE = 0x20000;  /* Size of heap buffer used by HeapMem */
 
 MEMORY
 {
-    FLASH (RX) : origin = 0x00000000, length = 0x00100000
+    FLASH (RX) : origin = 0x00000000, length = 0x000F0000
+    /* Last 64 KB (4 erase blocks) hold the flash store, see src/flash_hal.h */
+    FLASHSTORE (R) : origin = 0x000F0000, length = 0x00010000
     SRAM (RWX) : origin = 0x20000000, length = 0x00040000
 }
 
@@ -0,0 +1,105 @@
+/*
+ * atomic.h
+ *
+ * Lock-free 32-bit atomics for data shared between tasks, Swis and Hwis, such
+ * as registers[]. On the Cortex-M4F the read-modify-write operations are
+ * LDREX/STREX loops: an interrupt taken between the two clears the exclusive
+ * monitor, the STREX fails and the loop retries, so no update is lost and
+ * interrupts are never disabled. Aligned 32-bit loads and stores are atomic
+ * on their own. Host builds use C11 atomics.
+ */
+
+#ifndef SRC_ATOMIC_H_
+#define SRC_ATOMIC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#if defined(__TI_ARM__)
+
+// TI compiler intrinsics, __strex() returns 0 when the store succeeded
+
+static inline int32_t atomic32_load(volatile int32_t *p) {
+    return *p;
+}
+
+static inline void atomic32_store(volatile int32_t *p, int32_t value) {
+    *p = value;
+}
+
+// Sums wrap in uint32_t like the C11 atomics, signed overflow would be undefined
+
+/// @return The value before the addition
+static inline int32_t atomic32_fetch_add(volatile int32_t *p, int32_t value) {
+    int32_t old;
+    do {
+        old = __ldrex((void *)p);
+    } while (__strex((int32_t)((uint32_t)old + (uint32_t)value), (void *)p));
+    return old;
+}
+
+/// @return The value before the subtraction
+static inline int32_t atomic32_fetch_sub(volatile int32_t *p, int32_t value) {
+    int32_t old;
+    do {
+        old = __ldrex((void *)p);
+    } while (__strex((int32_t)((uint32_t)old - (uint32_t)value), (void *)p));
+    return old;
+}
+
+/// @return The value before the exchange
+static inline int32_t atomic32_xchg(volatile int32_t *p, int32_t value) {
+    int32_t old;
+    do {
+        old = __ldrex((void *)p);
+    } while (__strex(value, (void *)p));
+    return old;
+}
+
+/// @brief Stores desired if *p still holds *expected, otherwise loads *p into *expected
+static inline bool atomic32_cas(volatile int32_t *p, int32_t *expected, int32_t desired) {
+    int32_t old;
+    do {
+        old = __ldrex((void *)p);
+        if (old != *expected) {
+            // The open reservation is harmless: every STREX here follows its own LDREX
+            *expected = old;
+            return false;
+        }
+    } while (__strex(desired, (void *)p));
+    return true;
+}
+
+#else
+
+// GCC for ARM turns these into the same LDREX/STREX loops
+#include <stdatomic.h>
+
+static inline int32_t atomic32_load(volatile int32_t *p) {
+    return atomic_load_explicit((volatile _Atomic int32_t *)p, memory_order_relaxed);
+}
+
+static inline void atomic32_store(volatile int32_t *p, int32_t value) {
+    atomic_store_explicit((volatile _Atomic int32_t *)p, value, memory_order_relaxed);
+}
+
+static inline int32_t atomic32_fetch_add(volatile int32_t *p, int32_t value) {
+    return atomic_fetch_add_explicit((volatile _Atomic int32_t *)p, value, memory_order_relaxed);
+}
+
+static inline int32_t atomic32_fetch_sub(volatile int32_t *p, int32_t value) {
+    return atomic_fetch_sub_explicit((volatile _Atomic int32_t *)p, value, memory_order_relaxed);
+}
+
+static inline int32_t atomic32_xchg(volatile int32_t *p, int32_t value) {
+    return atomic_exchange_explicit((volatile _Atomic int32_t *)p, value, memory_order_relaxed);
+}
+
+static inline bool atomic32_cas(volatile int32_t *p, int32_t *expected, int32_t desired) {
+    return atomic_compare_exchange_strong_explicit((volatile _Atomic int32_t *)p, expected, desired,
+                                                   memory_order_relaxed, memory_order_relaxed);
+}
+
+#endif
+
+#endif /* SRC_ATOMIC_H_ */
@@ -54,6 +54,8 @@ void initAudio() {
     glo.audioController.lutDelta = 0.0;
     glo.audioController.setFreq = 0.0;
 
+    VoiceInit();
+
     // Initialize the SPI
     SPI_Params_init(&glo.audioController.audioSPIParams);
     //glo.audioSPIParams.bitRate = 4000000;  // Set SPI bit rate (e.g., 4 MHz)
@@ -5,11 +5,14 @@
 #include <ti/drivers/SPI.h>
 #include <ti/drivers/ADCBuf.h>
 
+#include "plc.h"
+
 
 #define SINE_TABLE_SIZE 256
 #define DATABLOCKSIZE 128
 #define DATADELAY 8
 #define TXBUFCOUNT 2
+#define AUDIO_SAMPLE_PERIOD_US 125   // 8 kHz sine generation and playout
 
 // Sine table provided
 extern const uint16_t SINETABLE[SINE_TABLE_SIZE+1];
@@ -18,6 +21,7 @@ extern const uint16_t SINETABLE[SINE_TABLE_SIZE+1];
 typedef struct ADCBufControl{
     ADCBuf_Conversion conversion;
     uint16_t *RX_Completed;
+    uint32_t completedAt;       // timestamp_now() when RX_Completed was set (latency.h)
     uint32_t converting;
     uint32_t ping_count;
     uint32_t pong_count;
@@ -34,6 +38,8 @@ typedef struct TXBufControl{
     uint32_t TX_sample_count;
     uint16_t TX_Ping[DATABLOCKSIZE];
     uint16_t TX_Pong[DATABLOCKSIZE];
+    volatile bool TX_fresh[2];  // Ping/Pong written since last played, cleared by the playout
+    PlcState plc;               // Loss concealment for blocks that were not refreshed
 } TXBufControl;
 
 // Structure to hold audio control variables and SPI handle
@@ -4,9 +4,15 @@
 #include "p100.h"
 #include "callback.h"
 #include "audio.h"
+#include "profile.h"
+#include "vtimer.h"
+#include "latency.h"
+#include "timestamp.h"
 
 CommandCallback callbacks[MAX_CALLBACKS];  // Array of callbacks
 
+static volatile uint32_t timer0Stamp;      // timestamp_now() at the last Timer0 interrupt
+
 void print_all_callbacks() {
     char msg[BUFFER_SIZE];
     int i;
@@ -23,18 +29,25 @@ void print_all_callbacks() {
 
 // Timer0 Callback Function
 void timer0Callback_fxn(Timer_Handle handle, int_fast16_t status) {
+    timer0Stamp = timestamp_now();
     Swi_post(glo.bios.Timer0_swi);
 }
 
-// Timer0 SWI Handler
+// Timer0 SWI Handler, runs the virtual timers that are due (vtimer.h)
 void timer0SWI(UArg arg0, UArg arg1) {
-    // The sine generation logic should be tied to the callback payload now
-    // If using callback0 for -sine or -audio, we no longer directly call generateSineSample() here.
-    // Instead, -sine will be triggered by execute_payload().
+    lat_record(LAT_TIMER0, timer0Stamp);
+    vtimer_dispatch();
+}
 
+// Callback 0, run by the VTIMER_CALLBACK virtual timer at the -timer period
+void callback0_fire(UArg arg) {
     if (callbacks[0].count != 0 && callbacks[0].payload[0] != '\0') {
         // Immediately execute the callback payload
+        uint32_t start = cycles_now();
         execute_payload(callbacks[0].payload);
+        if (profilePayloads) {
+            profile_record_tag(PROFILE_TAG(PROF_CALLBACK, 0), cycles_now() - start);
+        }
 
         uint16_t gateKey = GateSwi_enter(gateSwi2);
         if (callbacks[0].count > 0) {
@@ -57,7 +70,7 @@ void sw1Callback_fxn(uint_least8_t index) {
 void sw1SWI(UArg arg0, UArg arg1) {
     uint16_t gateKey = GateSwi_enter(gateSwi2);
     if (callbacks[1].count != 0) {
-        AddPayload(callbacks[1].payload);
+        AddPayloadTagged(callbacks[1].payload, CONSOLE_UART, profile_tag(PROF_CALLBACK, 1));
 
         if (callbacks[1].count > 0) {
             callbacks[1].count--;
@@ -78,7 +91,7 @@ void sw2Callback_fxn(uint_least8_t index) {
 void sw2SWI(UArg arg0, UArg arg1) {
     uint16_t gateKey = GateSwi_enter(gateSwi2);
     if (callbacks[2].count != 0) {
-        AddPayload(callbacks[2].payload);
+        AddPayloadTagged(callbacks[2].payload, CONSOLE_UART, profile_tag(PROF_CALLBACK, 2));
 
         if (callbacks[2].count > 0) {
             callbacks[2].count--;
@@ -102,6 +115,7 @@ void ADCBufCallback(ADCBuf_Handle handle, ADCBuf_Conversion *conversion, void *b
 
     // Mark which buffer completed
     glo.audioController.adcBufControl.RX_Completed = buffer;
+    glo.audioController.adcBufControl.completedAt = timestamp_now();
     // Post semaphore so ADCStream task can handle the data
     Semaphore_post(glo.bios.ADCSemaphore);
 }
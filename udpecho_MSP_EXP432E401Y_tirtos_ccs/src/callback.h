@@ -16,6 +16,7 @@ void print_all_callbacks();
 
 void timer0Callback_fxn(Timer_Handle handle, int_fast16_t status);
 void timer0SWI(UArg arg0, UArg arg1);
+void callback0_fire(UArg arg);
 
 void sw1Callback_fxn(uint_least8_t index);
 void sw1SWI(UArg arg0, UArg arg1);
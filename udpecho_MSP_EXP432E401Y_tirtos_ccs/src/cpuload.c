@@ -0,0 +1,324 @@
+/*
+ *  ======== cpuload.c ========
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "p100.h"
+#include "tickers.h"
+#include "timestamp.h"
+#include "cpuload.h"
+
+#define CPU_LOAD_SUB_TICKS  (CPU_LOAD_SUB_MS / TICKER_TICK_MS)
+
+bool cpuLoadEnabled = false;
+
+static CpuLoadSlot cpuLoadSlots[CPU_LOAD_SLOTS];    // Slot 0 collects CPU_LOAD_OTHER
+static int cpuLoadCount = 1;            // Slots handed out, never taken back
+static int cpuLoadOwner;                // Slot being charged
+static uint8_t cpuLoadStack[CPU_LOAD_NEST];         // Owners preempted by the running Swis and Hwis
+static int cpuLoadDepth;
+static uint32_t cpuLoadLast;            // timestamp_now() of the last charge
+static uint32_t cpuLoadSubStart;        // timestamp_now() when the open sub-window began
+static int cpuLoadSub;                  // permille[] index of the open sub-window
+static int cpuLoadSubCount;             // Closed sub-windows, up to CPU_LOAD_WINDOWS
+static int cpuLoadTicks;                // Ticker ticks into the open sub-window
+
+static Int cpuLoadTaskHookId;
+static Int cpuLoadSwiHookId;
+static Int cpuLoadHwiHookId;
+
+static const char *cpuLoadKindNames[CPU_LOAD_KIND_COUNT] = { "", "Task", "Swi", "Hwi" };
+
+static int cpuload_new_slot(CpuLoadKind kind, void *handle) {
+    int slot;
+
+    if (cpuLoadCount >= CPU_LOAD_SLOTS) {
+        return 0;
+    }
+    slot = cpuLoadCount++;
+    cpuLoadSlots[slot].kind = kind;
+    cpuLoadSlots[slot].handle = handle;
+    return slot;
+}
+
+// The slot of a context is kept in its hook context as slot + 1, 0 until it first runs
+
+static int cpuload_task_slot(Task_Handle task) {
+    int slot = (int)(uintptr_t)Task_getHookContext(task, cpuLoadTaskHookId);
+    if (slot == 0) {
+        slot = cpuload_new_slot(CPU_LOAD_TASK, task) + 1;
+        Task_setHookContext(task, cpuLoadTaskHookId, (Ptr)(uintptr_t)slot);
+    }
+    return slot - 1;
+}
+
+static int cpuload_swi_slot(Swi_Handle swi) {
+    int slot = (int)(uintptr_t)Swi_getHookContext(swi, cpuLoadSwiHookId);
+    if (slot == 0) {
+        slot = cpuload_new_slot(CPU_LOAD_SWI, swi) + 1;
+        Swi_setHookContext(swi, cpuLoadSwiHookId, (Ptr)(uintptr_t)slot);
+    }
+    return slot - 1;
+}
+
+static int cpuload_hwi_slot(Hwi_Handle hwi) {
+    int slot = (int)(uintptr_t)Hwi_getHookContext(hwi, cpuLoadHwiHookId);
+    if (slot == 0) {
+        slot = cpuload_new_slot(CPU_LOAD_HWI, hwi) + 1;
+        Hwi_setHookContext(hwi, cpuLoadHwiHookId, (Ptr)(uintptr_t)slot);
+    }
+    return slot - 1;
+}
+
+/// @brief Charges the time since the last event to the owner and hands the CPU to next. Hwis must be disabled.
+static inline void cpuload_charge(int next) {
+    uint32_t now = timestamp_now();
+    cpuLoadSlots[cpuLoadOwner].ticks += now - cpuLoadLast;
+    cpuLoadLast = now;
+    cpuLoadOwner = next;
+}
+
+static void cpuload_begin(int slot) {
+    if (cpuLoadDepth < CPU_LOAD_NEST) {
+        cpuLoadStack[cpuLoadDepth] = cpuLoadOwner;
+    }
+    cpuLoadDepth++;
+    cpuload_charge(slot);
+}
+
+static void cpuload_end() {
+    if (cpuLoadDepth == 0) {
+        return;
+    }
+    cpuLoadDepth--;
+    cpuload_charge(cpuLoadDepth < CPU_LOAD_NEST ? cpuLoadStack[cpuLoadDepth] : 0);
+}
+
+void cpuload_taskRegister(Int id) {
+    cpuLoadTaskHookId = id;
+}
+
+void cpuload_taskSwitch(Task_Handle prev, Task_Handle next) {
+    UInt key;
+
+    if (!cpuLoadEnabled) {
+        return;
+    }
+    key = Hwi_disable();
+    cpuload_charge(cpuload_task_slot(next));
+    Hwi_restore(key);
+}
+
+void cpuload_swiRegister(Int id) {
+    cpuLoadSwiHookId = id;
+}
+
+void cpuload_swiBegin(Swi_Handle swi) {
+    UInt key;
+
+    if (!cpuLoadEnabled) {
+        return;
+    }
+    key = Hwi_disable();
+    cpuload_begin(cpuload_swi_slot(swi));
+    Hwi_restore(key);
+}
+
+void cpuload_swiEnd(Swi_Handle swi) {
+    UInt key;
+
+    if (!cpuLoadEnabled) {
+        return;
+    }
+    key = Hwi_disable();
+    cpuload_end();
+    Hwi_restore(key);
+}
+
+void cpuload_hwiRegister(Int id) {
+    cpuLoadHwiHookId = id;
+}
+
+void cpuload_hwiBegin(Hwi_Handle hwi) {
+    UInt key;
+
+    if (!cpuLoadEnabled) {
+        return;
+    }
+    key = Hwi_disable();
+    cpuload_begin(cpuload_hwi_slot(hwi));
+    Hwi_restore(key);
+}
+
+void cpuload_hwiEnd(Hwi_Handle hwi) {
+    UInt key;
+
+    if (!cpuLoadEnabled) {
+        return;
+    }
+    key = Hwi_disable();
+    cpuload_end();
+    Hwi_restore(key);
+}
+
+/**
+ * @brief Starts or stops the accounting. Called from a task, so no Swi or Hwi is
+ * running and the nesting stack starts empty.
+ */
+void cpuload_enable(bool enable) {
+    UInt key = Hwi_disable();
+    int i;
+
+    if (enable && !cpuLoadEnabled) {
+        for (i = 0; i < cpuLoadCount; i++) {
+            cpuLoadSlots[i].ticks = 0;
+        }
+        cpuLoadDepth = 0;
+        cpuLoadOwner = cpuload_task_slot(Task_self());
+        cpuLoadLast = timestamp_now();
+        cpuLoadSubStart = cpuLoadLast;
+        cpuLoadTicks = 0;
+    }
+    cpuLoadEnabled = enable;
+    Hwi_restore(key);
+    if (enable) {
+        cpuload_reset();
+    }
+}
+
+/// @brief Forgets the closed sub-windows, the contexts keep their slots
+void cpuload_reset() {
+    int i;
+
+    for (i = 0; i < CPU_LOAD_SLOTS; i++) {
+        memset(cpuLoadSlots[i].permille, 0, sizeof(cpuLoadSlots[i].permille));
+    }
+    cpuLoadSub = 0;
+    cpuLoadSubCount = 0;
+}
+
+/// @brief Closes a sub-window every CPU_LOAD_SUB_MS, called every TICKER_TICK_MS by the ticker task
+void cpuload_tick() {
+    uint32_t ticks[CPU_LOAD_SLOTS];
+    uint32_t total;
+    UInt key;
+    int count, i;
+
+    if (!cpuLoadEnabled || ++cpuLoadTicks < CPU_LOAD_SUB_TICKS) {
+        return;
+    }
+    cpuLoadTicks = 0;
+
+    key = Hwi_disable();
+    cpuload_charge(cpuLoadOwner);
+    total = cpuLoadLast - cpuLoadSubStart;
+    cpuLoadSubStart = cpuLoadLast;
+    count = cpuLoadCount;
+    for (i = 0; i < count; i++) {
+        ticks[i] = cpuLoadSlots[i].ticks;
+        cpuLoadSlots[i].ticks = 0;
+    }
+    Hwi_restore(key);
+
+    for (i = 0; i < count; i++) {
+        cpuLoadSlots[i].permille[cpuLoadSub] = total ? (uint16_t)((uint64_t)ticks[i] * 1000 / total) : 0;
+    }
+    cpuLoadSub = (cpuLoadSub + 1) % CPU_LOAD_WINDOWS;
+    if (cpuLoadSubCount < CPU_LOAD_WINDOWS) {
+        cpuLoadSubCount++;
+    }
+}
+
+/// @return Share of the window in per mille
+static int32_t cpuload_slot_permille(const CpuLoadSlot *slot) {
+    int32_t sum = 0;
+    int i;
+
+    if (cpuLoadSubCount == 0) {
+        return 0;
+    }
+    for (i = 0; i < CPU_LOAD_WINDOWS; i++) {
+        sum += slot->permille[i];
+    }
+    return sum / cpuLoadSubCount;
+}
+
+static bool cpuload_is_idle(const CpuLoadSlot *slot) {
+    return slot->kind == CPU_LOAD_TASK && slot->handle == Task_getIdleTask();
+}
+
+/// @return Load of everything but the Idle task in per mille, 0 while accounting is off
+int32_t cpuload_total() {
+    int i;
+
+    if (!cpuLoadEnabled || cpuLoadSubCount == 0) {
+        return 0;
+    }
+    for (i = 1; i < cpuLoadCount; i++) {
+        if (cpuload_is_idle(&cpuLoadSlots[i])) {
+            return 1000 - cpuload_slot_permille(&cpuLoadSlots[i]);
+        }
+    }
+    return 1000;
+}
+
+/// @return Load of all contexts of one kind in per mille, Idle not included
+int32_t cpuload_kind(CpuLoadKind kind) {
+    int32_t sum = 0;
+    int i;
+
+    for (i = 0; i < cpuLoadCount; i++) {
+        if (cpuLoadSlots[i].kind == kind && !cpuload_is_idle(&cpuLoadSlots[i])) {
+            sum += cpuload_slot_permille(&cpuLoadSlots[i]);
+        }
+    }
+    return sum;
+}
+
+static void cpuload_format(char *text, int32_t permille) {
+    sprintf(text, "%3d.%d%%", (int)(permille / 10), (int)(permille % 10));
+}
+
+void print_cpuload() {
+    char msg[MAX_LINE_LENGTH * 2];
+    char load[16], last[16];
+    const CpuLoadSlot *slot;
+    const char *name;
+    int i, lastSub;
+
+    if (!cpuLoadEnabled) {
+        AddProgramMessage("CPU load accounting is off, \"-cpu on\" starts it.\r\n");
+        return;
+    }
+
+    AddProgramMessage("=================================== CPU Load ===================================\r\n");
+    sprintf(msg, "| CPU %d.%d%%  Task %d.%d%%  Swi %d.%d%%  Hwi %d.%d%%  over %d ms\r\n",
+            (int)(cpuload_total() / 10), (int)(cpuload_total() % 10),
+            (int)(cpuload_kind(CPU_LOAD_TASK) / 10), (int)(cpuload_kind(CPU_LOAD_TASK) % 10),
+            (int)(cpuload_kind(CPU_LOAD_SWI) / 10), (int)(cpuload_kind(CPU_LOAD_SWI) % 10),
+            (int)(cpuload_kind(CPU_LOAD_HWI) / 10), (int)(cpuload_kind(CPU_LOAD_HWI) % 10),
+            cpuLoadSubCount * CPU_LOAD_SUB_MS);
+    AddProgramMessage(msg);
+    AddProgramMessage("| Kind | Context            |   Load | Last 100 ms\r\n");
+    AddProgramMessage("|------|--------------------|--------|------------\r\n");
+
+    lastSub = (cpuLoadSub + CPU_LOAD_WINDOWS - 1) % CPU_LOAD_WINDOWS;
+    for (i = 0; i < cpuLoadCount; i++) {
+        slot = &cpuLoadSlots[i];
+        if (i == 0 && cpuLoadCount < CPU_LOAD_SLOTS) {
+            continue;           // "other" only collects once the slots run out
+        }
+        cpuload_format(load, cpuload_slot_permille(slot));
+        cpuload_format(last, cpuLoadSubCount ? slot->permille[lastSub] : 0);
+        name = slot->kind == CPU_LOAD_OTHER ? "(other)" : bios_object_name(slot->handle);
+        if (name) {
+            sprintf(msg, "| %-4s | %-18s | %s | %s\r\n", cpuLoadKindNames[slot->kind], name, load, last);
+        } else {
+            sprintf(msg, "| %-4s | 0x%08X         | %s | %s\r\n", cpuLoadKindNames[slot->kind],
+                    (unsigned)(uintptr_t)slot->handle, load, last);
+        }
+        AddProgramMessage(msg);
+    }
+    AddProgramMessage("================================================================================\r\n");
+}
@@ -0,0 +1,70 @@
+/*
+ * cpuload.h
+ *
+ * CPU load per Task, Swi and Hwi. Hook sets in release.cfg tell this module
+ * about every task switch and every Swi and Hwi begin and end, and the time
+ * between two of those events (timestamp_now() ticks, which keep running
+ * while Idle sleeps the core) is charged to the context that ran. The
+ * SYS/BIOS Load module does the same but is not built into this image.
+ *
+ * Every CPU_LOAD_SUB_MS the ticker task closes a sub-window, and the load
+ * reported is the share of the last CPU_LOAD_WINDOWS sub-windows, so a busy
+ * second shows up within 100 ms and fades out after one second. The CPU load
+ * is everything but the Idle task.
+ *
+ * Accounting costs two timer reads per hook, well under 1% of the CPU with
+ * 8 kHz audio running, and is off until "-cpu on". The totals can be
+ * streamed with the register service, glo fields cpuLoad, swiLoad and
+ * hwiLoad (netregs.h).
+ */
+
+#ifndef SRC_CPULOAD_H_
+#define SRC_CPULOAD_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "p100.h"
+#include <ti/sysbios/hal/Hwi.h>
+
+#define CPU_LOAD_SLOTS      24      // Contexts tracked, later ones share the "other" slot
+#define CPU_LOAD_NEST       8       // Swis and Hwis preempting each other
+#define CPU_LOAD_SUB_MS     100
+#define CPU_LOAD_WINDOWS    10      // Sub-windows averaged, 1 s
+
+typedef enum {
+    CPU_LOAD_OTHER,
+    CPU_LOAD_TASK,
+    CPU_LOAD_SWI,
+    CPU_LOAD_HWI,
+
+    CPU_LOAD_KIND_COUNT
+} CpuLoadKind;
+
+typedef struct CpuLoadSlot {
+    uint8_t  kind;                  // CpuLoadKind
+    void    *handle;
+    uint32_t ticks;                 // Charged in the open sub-window
+    uint16_t permille[CPU_LOAD_WINDOWS];    // Share of each closed sub-window
+} CpuLoadSlot;
+
+extern bool cpuLoadEnabled;
+
+void cpuload_enable(bool enable);
+void cpuload_tick();
+void cpuload_reset();
+int32_t cpuload_total();
+int32_t cpuload_kind(CpuLoadKind kind);
+void print_cpuload();
+
+// Hook functions named in release.cfg
+void cpuload_taskRegister(Int id);
+void cpuload_taskSwitch(Task_Handle prev, Task_Handle next);
+void cpuload_swiRegister(Int id);
+void cpuload_swiBegin(Swi_Handle swi);
+void cpuload_swiEnd(Swi_Handle swi);
+void cpuload_hwiRegister(Int id);
+void cpuload_hwiBegin(Hwi_Handle hwi);
+void cpuload_hwiEnd(Hwi_Handle hwi);
+
+#endif /* SRC_CPULOAD_H_ */
@@ -0,0 +1,17 @@
+/*
+ * crc32.h
+ *
+ * CRC-32 (IEEE 802.3, reflected polynomial 0xEDB88320) with a 16 entry table,
+ * small enough to keep in flash next to the code that uses it.
+ */
+
+#ifndef SRC_CRC32_H_
+#define SRC_CRC32_H_
+
+#include <stdint.h>
+
+#define CRC32_INIT 0        // Start value, chain calls by passing the previous result
+
+uint32_t crc32(uint32_t crc, const void *data, uint32_t len);
+
+#endif /* SRC_CRC32_H_ */
@@ -0,0 +1,51 @@
+/*
+ * cycles.h
+ *
+ * Core clock cycle counter. On the Cortex-M4F this is the DWT cycle counter,
+ * which costs one load to read and wraps every ~35 s at 120 MHz, so only
+ * differences of short intervals are meaningful. Host builds count
+ * nanoseconds of the monotonic clock scaled to the same rate.
+ */
+
+#ifndef SRC_CYCLES_H_
+#define SRC_CYCLES_H_
+
+#include <stdint.h>
+
+#define CYCLES_PER_US 120       // MSP432E401Y core clock, 120 MHz
+
+#if defined(__TI_ARM__) || defined(__ARM_ARCH)
+
+#define CYCLES_DEMCR        (*(volatile uint32_t *)0xE000EDFC)
+#define CYCLES_DEMCR_TRCENA 0x01000000
+#define CYCLES_DWT_CTRL     (*(volatile uint32_t *)0xE0001000)
+#define CYCLES_DWT_CYCCNTENA 0x00000001
+#define CYCLES_DWT_CYCCNT   (*(volatile uint32_t *)0xE0001004)
+
+/// @brief Starts the DWT cycle counter. A debugger may have started it already.
+static inline void cycles_init() {
+    CYCLES_DEMCR |= CYCLES_DEMCR_TRCENA;
+    CYCLES_DWT_CYCCNT = 0;
+    CYCLES_DWT_CTRL |= CYCLES_DWT_CYCCNTENA;
+}
+
+static inline uint32_t cycles_now() {
+    return CYCLES_DWT_CYCCNT;
+}
+
+#else
+
+#include <time.h>
+
+static inline void cycles_init() {
+}
+
+static inline uint32_t cycles_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(((uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec) * CYCLES_PER_US / 1000);
+}
+
+#endif
+
+#endif /* SRC_CYCLES_H_ */
@@ -0,0 +1,275 @@
+/*
+ *  ======== expr.c ========
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "p100.h"
+#include "expr.h"
+#include "scriptvm.h"
+#include "var.h"
+
+typedef struct ExprParser {
+    const char  *p;             // Next character to read
+    ExprProgram *prog;
+    int          depth;         // Stack depth after the instructions emitted so far
+    int          nesting;       // Open parentheses and unary operators being parsed
+    bool         allowPrivate;
+    const char  *error;
+} ExprParser;
+
+// Binary operators, two character ones first so "<=" is not read as "<"
+static const struct {
+    const char *text;
+    uint8_t     op;
+    uint8_t     level;          // Higher binds tighter
+} exprBinaryOps[] = {
+    { "||", EXPR_LOR,  1 }, { "&&", EXPR_LAND, 2 },
+    { "==", EXPR_EQ,   6 }, { "!=", EXPR_NE,   6 },
+    { "<=", EXPR_LE,   7 }, { ">=", EXPR_GE,   7 },
+    { "|",  EXPR_IOR,  3 }, { "^",  EXPR_XOR,  4 }, { "&",  EXPR_AND,  5 },
+    { "=",  EXPR_EQ,   6 }, { "<",  EXPR_LT,   7 }, { ">",  EXPR_GT,   7 },
+    { "+",  EXPR_ADD,  8 }, { "-",  EXPR_SUB,  8 },
+    { "*",  EXPR_MUL,  9 }, { "/",  EXPR_DIV,  9 }, { "%",  EXPR_REM,  9 },
+};
+
+#define EXPR_BINARY_OPS (sizeof(exprBinaryOps) / sizeof(exprBinaryOps[0]))
+
+static void expr_skip_blanks(ExprParser *ps) {
+    while (isspace((unsigned char)*ps->p)) {
+        ps->p++;
+    }
+}
+
+/// @brief Appends an instruction, tracking the stack depth it leaves behind
+static bool expr_emit(ExprParser *ps, ExprOp op, int stackChange) {
+    if (ps->prog->count >= EXPR_MAX_INSNS) {
+        ps->error = "Expression too long";
+        return false;
+    }
+    ps->depth += stackChange;
+    if (ps->depth > EXPR_STACK_SIZE) {
+        ps->error = "Expression nested too deep";
+        return false;
+    }
+    ps->prog->insns[ps->prog->count].op = op;
+    ps->prog->insns[ps->prog->count].reg = -1;
+    ps->prog->count++;
+    return true;
+}
+
+/// @brief Compiles one operand token: #imm, @address, p0..p7, $name or a register
+static bool expr_parse_operand(ExprParser *ps) {
+    char token[BUFFER_SIZE];
+    ExprInsn *insn;
+    uint32_t address;
+    char *endptr;
+    int len = 0;
+    int reg;
+
+    if (*ps->p == '#' && (ps->p[1] == '-' || ps->p[1] == '+')) {
+        token[len++] = *ps->p++;    // Signed immediate
+        token[len++] = *ps->p++;
+    }
+    while ((isalnum((unsigned char)*ps->p) || *ps->p == '#' || *ps->p == '@' || *ps->p == '_' || *ps->p == '$')
+           && len < BUFFER_SIZE - 1) {
+        token[len++] = *ps->p++;
+    }
+    token[len] = '\0';
+    if (len == 0) {
+        ps->error = *ps->p ? "Missing operand" : "Incomplete expression";
+        return false;
+    }
+
+    if (!expr_emit(ps, EXPR_PUSH_IMM, 1)) {
+        return false;
+    }
+    insn = &ps->prog->insns[ps->prog->count - 1];
+
+    if (token[0] == '#') {
+        insn->arg.imm = (int32_t)strtol(&token[1], &endptr, 0);
+        if (*endptr == '\0' && token[1] != '\0') {
+            return true;
+        }
+        ps->error = "Invalid immediate value";
+    } else if (token[0] == '@') {
+        if (parse_memory_address(token, &address) && is_valid_memory_address(address)) {
+            insn->op = EXPR_PUSH_PTR;
+            insn->arg.ptr = (volatile int32_t *)address;
+            return true;
+        }
+        ps->error = "Invalid memory address";
+    } else if ((reg = script_parse_private(token)) != -1) {
+        if (ps->allowPrivate) {
+            insn->op = EXPR_PUSH_PRIV;
+            insn->reg = (int8_t)reg;
+            return true;
+        }
+        ps->error = "Private registers only exist in scripts";
+    } else if ((reg = parse_register(token)) != -1) {
+        insn->op = EXPR_PUSH_PTR;
+        insn->arg.ptr = &registers[reg];
+        return true;
+    } else if (token[0] == '$') {
+        if ((reg = var_parse(token)) != -1) {
+            insn->op = EXPR_PUSH_PTR;
+            insn->arg.ptr = &varValues[reg];
+            return true;
+        }
+        ps->error = "Invalid variable name";
+    } else {
+        ps->error = "Invalid register";
+    }
+    return false;
+}
+
+static bool expr_parse_binary(ExprParser *ps, int minLevel);
+
+/// @brief Compiles a unary expression: operand, (expression) or ! - ~ applied to one
+static bool expr_parse_unary(ExprParser *ps) {
+    char ch;
+
+    expr_skip_blanks(ps);
+    ch = *ps->p;
+
+    if (ch == '!' || ch == '-' || ch == '~' || ch == '(') {
+        // Recursion happens before anything is emitted, so bound it here
+        if (++ps->nesting > EXPR_STACK_SIZE) {
+            ps->error = "Expression nested too deep";
+            return false;
+        }
+    }
+    if (ch == '!' || ch == '-' || ch == '~') {
+        ps->p++;
+        if (!expr_parse_unary(ps)) {
+            return false;
+        }
+        ps->nesting--;
+        return expr_emit(ps, ch == '!' ? EXPR_NOT : (ch == '-' ? EXPR_NEG : EXPR_INV), 0);
+    }
+    if (ch == '(') {
+        ps->p++;
+        if (!expr_parse_binary(ps, 1)) {
+            return false;
+        }
+        expr_skip_blanks(ps);
+        if (*ps->p != ')') {
+            ps->error = "Missing )";
+            return false;
+        }
+        ps->p++;
+        ps->nesting--;
+        return true;
+    }
+    return expr_parse_operand(ps);
+}
+
+/// @brief Precedence climbing over exprBinaryOps, emitting operators after their operands
+static bool expr_parse_binary(ExprParser *ps, int minLevel) {
+    size_t i, len;
+
+    if (!expr_parse_unary(ps)) {
+        return false;
+    }
+
+    while (1) {
+        expr_skip_blanks(ps);
+        for (i = 0; i < EXPR_BINARY_OPS; i++) {
+            len = strlen(exprBinaryOps[i].text);
+            if (strncmp(ps->p, exprBinaryOps[i].text, len) == 0) {
+                break;
+            }
+        }
+        if (i == EXPR_BINARY_OPS || exprBinaryOps[i].level < minLevel) {
+            return true;
+        }
+
+        ps->p += len;
+        if (!expr_parse_binary(ps, exprBinaryOps[i].level + 1)
+            || !expr_emit(ps, (ExprOp)exprBinaryOps[i].op, -1)) {
+            return false;
+        }
+    }
+}
+
+/**
+ * @brief Compiles an expression. Registers and memory are resolved to pointers,
+ * private registers p0..p7 are only accepted when allowPrivate is set.
+ * @return False with *error describing the problem if the text is not a valid expression
+ */
+bool expr_compile(const char *text, bool allowPrivate, ExprProgram *prog, const char **error) {
+    ExprParser ps;
+
+    ps.p = text;
+    ps.prog = prog;
+    ps.depth = 0;
+    ps.nesting = 0;
+    ps.allowPrivate = allowPrivate;
+    ps.error = NULL;
+    prog->count = 0;
+
+    if (expr_parse_binary(&ps, 1)) {
+        expr_skip_blanks(&ps);
+        if (*ps.p == '\0') {
+            return true;
+        }
+        ps.error = "Unexpected character";
+    }
+    prog->count = 0;
+    *error = ps.error;
+    return false;
+}
+
+/**
+ * @brief Evaluates a compiled expression. priv holds the private registers of the
+ * running script, and may be NULL for expressions compiled without them.
+ * @return False on division by zero
+ */
+bool expr_eval(const ExprProgram *prog, const int32_t *priv, int32_t *result) {
+    int32_t stack[EXPR_STACK_SIZE];
+    const ExprInsn *insn = prog->insns;
+    const ExprInsn *end = insn + prog->count;
+    int32_t *top = stack - 1;
+    int32_t b;
+
+    for (; insn < end; insn++) {
+        switch (insn->op) {
+        case EXPR_PUSH_IMM:  *++top = insn->arg.imm;    continue;
+        case EXPR_PUSH_PTR:  *++top = *insn->arg.ptr;   continue;
+        case EXPR_PUSH_PRIV: *++top = priv[insn->reg];  continue;
+        case EXPR_NEG:       *top = -*top;              continue;
+        case EXPR_NOT:       *top = !*top;              continue;
+        case EXPR_INV:       *top = ~*top;              continue;
+        default:             break;
+        }
+
+        b = *top--;
+        switch (insn->op) {
+        case EXPR_MUL:  *top *= b;          break;
+        case EXPR_DIV:
+        case EXPR_REM:
+            if (b == 0) {
+                return false;
+            }
+            *top = insn->op == EXPR_DIV ? *top / b : *top % b;
+            break;
+        case EXPR_ADD:  *top += b;          break;
+        case EXPR_SUB:  *top -= b;          break;
+        case EXPR_LT:   *top = *top < b;    break;
+        case EXPR_LE:   *top = *top <= b;   break;
+        case EXPR_GT:   *top = *top > b;    break;
+        case EXPR_GE:   *top = *top >= b;   break;
+        case EXPR_EQ:   *top = *top == b;   break;
+        case EXPR_NE:   *top = *top != b;   break;
+        case EXPR_AND:  *top &= b;          break;
+        case EXPR_XOR:  *top ^= b;          break;
+        case EXPR_IOR:  *top |= b;          break;
+        case EXPR_LAND: *top = *top && b;   break;
+        default:        *top = *top || b;   break;
+        }
+    }
+
+    *result = *top;
+    return true;
+}
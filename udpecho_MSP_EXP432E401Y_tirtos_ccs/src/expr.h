@@ -0,0 +1,55 @@
+/*
+ * expr.h
+ *
+ * Integer expressions for -if conditions. A condition is compiled once into a
+ * small RPN program whose operands are already resolved to pointers, then
+ * evaluated on a fixed size stack without allocating or touching the text:
+ *
+ *   operands     #5 #-3 #0x10    immediate
+ *                R3 r3 3         register
+ *                @0x20000000 @R1 memory, 32-bit read on every evaluation
+ *                p0..p7          private register of the running script
+ *                $name           variable (var.h)
+ *   operators    ( )  ! - ~ (unary)  * / %  + -  < <= > >=  == = !=  &  ^  |  &&  ||
+ *
+ * Binary operators follow C precedence; "=" is the old equality test. Logical
+ * and comparison operators give 0 or 1, && and || evaluate both sides.
+ */
+
+#ifndef SRC_EXPR_H_
+#define SRC_EXPR_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define EXPR_MAX_INSNS  16      // Operands plus operators in one expression
+#define EXPR_STACK_SIZE 8       // Deepest operand nesting
+
+typedef enum {
+    EXPR_PUSH_IMM,      // imm
+    EXPR_PUSH_PTR,      // *ptr, a register or memory
+    EXPR_PUSH_PRIV,     // Private register reg of the running script
+    EXPR_NEG, EXPR_NOT, EXPR_INV,
+    EXPR_MUL, EXPR_DIV, EXPR_REM, EXPR_ADD, EXPR_SUB,
+    EXPR_LT, EXPR_LE, EXPR_GT, EXPR_GE, EXPR_EQ, EXPR_NE,
+    EXPR_AND, EXPR_XOR, EXPR_IOR, EXPR_LAND, EXPR_LOR,
+} ExprOp;
+
+typedef struct ExprInsn {
+    uint8_t op;             // ExprOp
+    int8_t  reg;            // EXPR_PUSH_PRIV register number
+    union {
+        int32_t imm;
+        volatile int32_t *ptr;
+    } arg;
+} ExprInsn;
+
+typedef struct ExprProgram {
+    uint8_t  count;
+    ExprInsn insns[EXPR_MAX_INSNS];
+} ExprProgram;
+
+bool expr_compile(const char *text, bool allowPrivate, ExprProgram *prog, const char **error);
+bool expr_eval(const ExprProgram *prog, const int32_t *priv, int32_t *result);
+
+#endif /* SRC_EXPR_H_ */
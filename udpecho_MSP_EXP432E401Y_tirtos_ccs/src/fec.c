@@ -0,0 +1,105 @@
+/*
+ *  ======== fec.c ========
+ */
+#include <string.h>
+
+#include "fec.h"
+
+const char *fecModeNames[FEC_MODE_COUNT] = { "off", "red", "xor" };
+
+void fec_encoder_init(FecEncoder *enc, FecMode mode, int32_t k) {
+    memset(enc, 0, sizeof(FecEncoder));
+    enc->mode = mode;
+    if (k < FEC_MIN_K) k = FEC_MIN_K;
+    if (k > FEC_MAX_K) k = FEC_MAX_K;
+    enc->k = k;
+}
+
+/**
+ * @brief Accumulates one sent block into the XOR parity of the current group.
+ * @return True when the group is complete. enc->parity and enc->firstSeq then
+ *         describe the parity packet to send, and the next call starts a new group.
+ */
+bool fec_xor_add(FecEncoder *enc, uint16_t seq, const uint16_t *block) {
+    int32_t i;
+
+    if (enc->count == 0) {
+        enc->firstSeq = seq;
+        memcpy(enc->parity, block, sizeof(enc->parity));
+    } else {
+        for (i = 0; i < FEC_BLOCK_SAMPLES; i++) {
+            enc->parity[i] ^= block[i];
+        }
+    }
+
+    if (++enc->count >= enc->k) {
+        enc->count = 0;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Rebuilds the single missing block of a parity group.
+ * @param blocks The k blocks of the group in order, with NULL for the missing one
+ * @param out Receives the missing block
+ */
+void fec_xor_recover(const uint16_t *parity, const uint16_t *const *blocks, int32_t k, uint16_t *out) {
+    int32_t i, j;
+
+    memcpy(out, parity, sizeof(uint16_t) * FEC_BLOCK_SAMPLES);
+    for (j = 0; j < k; j++) {
+        if (blocks[j] == NULL) {
+            continue;
+        }
+        for (i = 0; i < FEC_BLOCK_SAMPLES; i++) {
+            out[i] ^= blocks[j][i];
+        }
+    }
+}
+
+/// @brief Encodes a block as 2:1 decimated 8-bit samples, scaled to the block's own range
+void fec_red_encode(const uint16_t *block, FecRedundant *red) {
+    uint16_t dec[FEC_RED_SAMPLES];
+    uint16_t lo = 0xFFFF, hi = 0;
+    uint32_t range, v;
+    uint8_t shift = 0;
+    int32_t i;
+
+    for (i = 0; i < FEC_RED_SAMPLES; i++) {
+        dec[i] = (uint16_t)(((uint32_t)block[2 * i] + block[2 * i + 1] + 1) >> 1);
+        if (dec[i] < lo) lo = dec[i];
+        if (dec[i] > hi) hi = dec[i];
+    }
+
+    range = hi - lo;
+    while ((range >> shift) > 0xFF) {
+        shift++;
+    }
+
+    red->base = lo;
+    red->shift = shift;
+    red->reserved = 0;
+    for (i = 0; i < FEC_RED_SAMPLES; i++) {
+        v = ((uint32_t)(dec[i] - lo) + ((1u << shift) >> 1)) >> shift;
+        red->samples[i] = (uint8_t)(v > 0xFF ? 0xFF : v);
+    }
+}
+
+static uint32_t fec_red_sample(const FecRedundant *red, int32_t i) {
+    uint32_t v = red->base + ((uint32_t)red->samples[i] << red->shift);
+    return v > 0xFFFF ? 0xFFFF : v;   // Rounding in the encoder can overshoot by one step
+}
+
+/// @brief Expands a redundant copy back to a full block using linear interpolation
+void fec_red_decode(const FecRedundant *red, uint16_t *block) {
+    uint32_t cur, next;
+    int32_t i;
+
+    for (i = 0; i < FEC_RED_SAMPLES; i++) {
+        cur = fec_red_sample(red, i);
+        next = (i + 1 < FEC_RED_SAMPLES) ? fec_red_sample(red, i + 1) : cur;
+        block[2 * i] = (uint16_t)cur;
+        block[2 * i + 1] = (uint16_t)((cur + next) >> 1);
+    }
+}
@@ -0,0 +1,66 @@
+/*
+ * fec.h
+ *
+ * Forward error correction for voice blocks. Retransmission is useless at a
+ * 16 ms block cadence, so a lost block is rebuilt from data the sender adds
+ * up front. Two schemes, selectable per dial target:
+ *
+ *   FEC_RED: every voice packet also carries a low-bitrate copy of the previous
+ *            block (2:1 decimated, 8 bits per sample with a per-block base and
+ *            shift, 68 bytes). Recovers any single loss one block later.
+ *   FEC_XOR: after every K voice blocks a parity packet carries the XOR of the
+ *            K blocks. Recovers one loss per group at full quality, K blocks later.
+ *
+ * Plain C with no driver dependencies.
+ */
+
+#ifndef SRC_FEC_H_
+#define SRC_FEC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define FEC_BLOCK_SAMPLES 128                       // Must match DATABLOCKSIZE
+#define FEC_RED_SAMPLES   (FEC_BLOCK_SAMPLES / 2)
+#define FEC_MIN_K         2
+#define FEC_MAX_K         8
+#define FEC_DEFAULT_K     4
+
+typedef enum {
+    FEC_NONE,       // Voice packets only
+    FEC_RED,        // Redundant low-bitrate copy of the previous block
+    FEC_XOR,        // XOR parity packet every K blocks
+
+    FEC_MODE_COUNT  // Keeps track of the number of modes
+} FecMode;
+
+extern const char *fecModeNames[FEC_MODE_COUNT];
+
+// Low-bitrate copy of one block, appended to a NETPKT_VOICE_RED packet
+typedef struct FecRedundant {
+    uint16_t base;                      // Smallest decimated sample
+    uint8_t  shift;                     // Right shift applied to (sample - base)
+    uint8_t  reserved;
+    uint8_t  samples[FEC_RED_SAMPLES];
+} FecRedundant;
+
+// Sender state for one dial target
+typedef struct FecEncoder {
+    FecMode  mode;
+    int32_t  k;                             // XOR group size
+    int32_t  count;                         // Blocks in the current group
+    uint16_t firstSeq;                      // Sequence number of the first block in the group
+    uint16_t parity[FEC_BLOCK_SAMPLES];
+    bool     havePrev;
+    uint16_t prevSeq;
+    FecRedundant prev;                      // Redundant copy of the previous block
+} FecEncoder;
+
+void fec_encoder_init(FecEncoder *enc, FecMode mode, int32_t k);
+bool fec_xor_add(FecEncoder *enc, uint16_t seq, const uint16_t *block);
+void fec_xor_recover(const uint16_t *parity, const uint16_t *const *blocks, int32_t k, uint16_t *out);
+
+void fec_red_encode(const uint16_t *block, FecRedundant *red);
+void fec_red_decode(const FecRedundant *red, uint16_t *block);
+
+#endif /* SRC_FEC_H_ */
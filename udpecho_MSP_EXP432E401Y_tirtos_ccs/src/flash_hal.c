@@ -0,0 +1,31 @@
+/*
+ *  ======== flash_hal.c ========
+ *  On-chip flash of the MSP432E4. The CPU stalls while a sector is erased or
+ *  words are programmed, so only the payload executor should call into it.
+ */
+#include <string.h>
+
+#include <ti/devices/msp432e4/driverlib/driverlib.h>
+
+#include "flash_hal.h"
+
+static void flash_internal_read(void *ctx, uint32_t offset, void *data, uint32_t bytes) {
+    memcpy(data, (const void *)((uint32_t)ctx + offset), bytes);    // Memory mapped
+}
+
+static bool flash_internal_program(void *ctx, uint32_t offset, const void *data, uint32_t bytes) {
+    return FlashProgram((uint32_t *)data, (uint32_t)ctx + offset, bytes) == 0;
+}
+
+static bool flash_internal_erase(void *ctx, uint32_t offset, uint32_t bytes) {
+    return FlashErase((uint32_t)ctx + offset) == 0;
+}
+
+const FlashHal flashHalInternal = {
+    FLASH_STORE_SECTOR,
+    FLASH_STORE_SECTORS,
+    (void *)FLASH_STORE_BASE,
+    flash_internal_read,
+    flash_internal_program,
+    flash_internal_erase,
+};
@@ -0,0 +1,41 @@
+/*
+ * flash_hal.h
+ *
+ * Sector erase / word program interface under flashstore.c. Offsets are
+ * relative to the first sector owned by the store. Two implementations:
+ *
+ *   flashHalInternal    on-chip flash of the MSP432E4 (flash_hal.c), the
+ *                       FLASHSTORE region reserved in MSP_EXP432E401Y_TIRTOS.cmd
+ *   flash_hal_ram_init  a RAM buffer behaving like erased/programmed flash
+ *                       (flash_hal_ram.c), for running the store on a host
+ */
+
+#ifndef SRC_FLASH_HAL_H_
+#define SRC_FLASH_HAL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define FLASH_HAL_ERASED 0xFF   // Value of every byte after erase
+
+typedef struct FlashHal {
+    uint32_t sectorSize;        // Erase unit in bytes
+    uint32_t sectors;           // Sectors owned by the store
+    void    *ctx;               // Implementation data: base address or RAM buffer
+
+    void (*read)(void *ctx, uint32_t offset, void *data, uint32_t bytes);
+    // offset and bytes are multiples of 4. Programming can only clear bits.
+    bool (*program)(void *ctx, uint32_t offset, const void *data, uint32_t bytes);
+    // Erases the sector at offset, bytes is always sectorSize
+    bool (*erase)(void *ctx, uint32_t offset, uint32_t bytes);
+} FlashHal;
+
+#define FLASH_STORE_BASE    0x000F0000      // Last 64 KB of the 1 MB flash
+#define FLASH_STORE_SECTOR  0x4000          // MSP432E4 flash erase block
+#define FLASH_STORE_SECTORS 4
+
+extern const FlashHal flashHalInternal;
+
+void flash_hal_ram_init(FlashHal *hal, uint8_t *buffer, uint32_t sectorSize, uint32_t sectors);
+
+#endif /* SRC_FLASH_HAL_H_ */
@@ -0,0 +1,41 @@
+/*
+ *  ======== flash_hal_ram.c ========
+ *  RAM buffer with flash semantics: erase sets a sector to 0xFF and programming
+ *  can only clear bits, so the store behaves on a host as it does on the chip.
+ */
+#include <string.h>
+
+#include "flash_hal.h"
+
+static void flash_ram_read(void *ctx, uint32_t offset, void *data, uint32_t bytes) {
+    memcpy(data, (uint8_t *)ctx + offset, bytes);
+}
+
+static bool flash_ram_program(void *ctx, uint32_t offset, const void *data, uint32_t bytes) {
+    uint8_t *dst = (uint8_t *)ctx + offset;
+    const uint8_t *src = (const uint8_t *)data;
+
+    if ((offset & 3) || (bytes & 3)) {
+        return false;
+    }
+    while (bytes--) {
+        *dst++ &= *src++;
+    }
+    return true;
+}
+
+static bool flash_ram_erase(void *ctx, uint32_t offset, uint32_t bytes) {
+    memset((uint8_t *)ctx + offset, FLASH_HAL_ERASED, bytes);
+    return true;
+}
+
+/// @brief Sets up hal on buffer, which must hold sectorSize * sectors bytes. Starts out erased.
+void flash_hal_ram_init(FlashHal *hal, uint8_t *buffer, uint32_t sectorSize, uint32_t sectors) {
+    hal->sectorSize = sectorSize;
+    hal->sectors = sectors;
+    hal->ctx = buffer;
+    hal->read = flash_ram_read;
+    hal->program = flash_ram_program;
+    hal->erase = flash_ram_erase;
+    memset(buffer, FLASH_HAL_ERASED, sectorSize * sectors);
+}
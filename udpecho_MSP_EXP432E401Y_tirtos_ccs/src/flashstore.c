@@ -0,0 +1,377 @@
+/*
+ *  ======== flashstore.c ========
+ */
+#include <string.h>
+
+#include "crc32.h"
+#include "flashstore.h"
+
+#define FLASHSTORE_MAGIC  0x31534650    // "PFS1"
+#define SECTOR_HEADER     8             // magic, seq
+#define RECORD_HEADER     8             // key, len, crc
+
+typedef struct FlashRecordHeader {
+    uint16_t key;
+    uint16_t len;               // 0 deletes the key
+    uint32_t crc;
+} FlashRecordHeader;
+
+// Where the newest record of each key lives
+typedef struct FlashStoreEntry {
+    uint16_t key;
+    uint16_t len;
+    uint32_t offset;            // Record header, from the start of the store
+    uint32_t crc;
+} FlashStoreEntry;
+
+static const FlashHal *store;   // NULL until mounted
+static FlashStoreEntry entries[FLASHSTORE_MAX_KEYS];
+static uint32_t entryCount;
+static uint32_t head;           // Sector records are appended to
+static uint32_t headOffset;     // Next free byte in it
+static uint32_t seq;            // Sequence number of the head sector
+static FlashStoreStats counters;
+
+// One record, word aligned for programming. Only the payload executor uses the store.
+static uint32_t recordBuffer[(RECORD_HEADER + FLASHSTORE_MAX_VALUE) / 4];
+
+static uint32_t record_size(uint32_t len) {
+    return RECORD_HEADER + ((len + 3) & ~3u);
+}
+
+static uint32_t record_crc(uint16_t key, uint16_t len, const void *data) {
+    uint16_t fields[2] = { key, len };
+    return crc32(crc32(CRC32_INIT, fields, sizeof(fields)), data, len);
+}
+
+static uint32_t capacity() {
+    // One sector is kept erased and one may be filled by copies of the oldest
+    return (store->sectors - 2) * (store->sectorSize - SECTOR_HEADER);
+}
+
+static int32_t find_entry(uint16_t key) {
+    uint32_t i;
+    for (i = 0; i < entryCount; i++) {
+        if (entries[i].key == key) {
+            return (int32_t)i;
+        }
+    }
+    return -1;
+}
+
+/// @brief Records that the newest version of key is at offset. A zero length removes the key.
+static bool index_update(uint16_t key, uint16_t len, uint32_t offset, uint32_t crc) {
+    int32_t i = find_entry(key);
+
+    if (len == 0) {
+        if (i >= 0) {
+            entries[i] = entries[--entryCount];
+        }
+        return true;
+    }
+    if (i < 0) {
+        if (entryCount == FLASHSTORE_MAX_KEYS) {
+            return false;
+        }
+        i = (int32_t)entryCount++;
+    }
+    entries[i].key = key;
+    entries[i].len = len;
+    entries[i].offset = offset;
+    entries[i].crc = crc;
+    return true;
+}
+
+typedef enum {
+    SECTOR_ERASED,
+    SECTOR_VALID,
+    SECTOR_GARBAGE,
+} SectorState;
+
+static SectorState sector_state(uint32_t sector, uint32_t *sectorSeq) {
+    uint32_t header[2];
+
+    store->read(store->ctx, sector * store->sectorSize, header, sizeof(header));
+    *sectorSeq = header[1];
+    if (header[0] == FLASHSTORE_MAGIC) {
+        return SECTOR_VALID;
+    }
+    return (header[0] == 0xFFFFFFFF && header[1] == 0xFFFFFFFF) ? SECTOR_ERASED : SECTOR_GARBAGE;
+}
+
+static bool sector_erase(uint32_t sector) {
+    counters.erases++;
+    return store->erase(store->ctx, sector * store->sectorSize, store->sectorSize);
+}
+
+/// @brief True when nothing has been programmed from offset to the end of the sector
+static bool sector_blank_from(uint32_t sector, uint32_t offset) {
+    uint32_t chunk, i;
+
+    while (offset < store->sectorSize) {
+        chunk = store->sectorSize - offset;
+        if (chunk > sizeof(recordBuffer)) {
+            chunk = sizeof(recordBuffer);
+        }
+        store->read(store->ctx, sector * store->sectorSize + offset, recordBuffer, chunk);
+        for (i = 0; i < chunk / 4; i++) {
+            if (recordBuffer[i] != 0xFFFFFFFF) {
+                return false;
+            }
+        }
+        offset += chunk;
+    }
+    return true;
+}
+
+/**
+ * @brief Indexes the valid records of a sector, in the order they were written.
+ * @return Offset in the sector where the next record can be appended, sectorSize
+ * when the sector is full or its free space is not blank
+ */
+static uint32_t sector_scan(uint32_t sector) {
+    uint32_t base = sector * store->sectorSize;
+    uint32_t offset = SECTOR_HEADER;
+    FlashRecordHeader *rec = (FlashRecordHeader *)recordBuffer;
+    uint32_t size;
+
+    while (offset + RECORD_HEADER <= store->sectorSize) {
+        store->read(store->ctx, base + offset, rec, RECORD_HEADER);
+        if (rec->key == FLASHSTORE_KEY_NONE && rec->len == 0xFFFF && rec->crc == 0xFFFFFFFF) {
+            return sector_blank_from(sector, offset) ? offset : store->sectorSize;
+        }
+
+        size = record_size(rec->len);
+        if (rec->len > FLASHSTORE_MAX_VALUE || offset + size > store->sectorSize) {
+            counters.corrupt++;     // Header cut short, nothing after it can be trusted
+            return store->sectorSize;
+        }
+
+        store->read(store->ctx, base + offset + RECORD_HEADER, &recordBuffer[RECORD_HEADER / 4], rec->len);
+        if (rec->key != FLASHSTORE_KEY_NONE && rec->crc == record_crc(rec->key, rec->len, &recordBuffer[RECORD_HEADER / 4])) {
+            index_update(rec->key, rec->len, base + offset, rec->crc);
+        } else {
+            counters.corrupt++;
+        }
+        offset += size;
+    }
+    return store->sectorSize;
+}
+
+/// @brief Appends a prepared record (in recordBuffer) to the head sector, which must have room
+static bool head_append(uint32_t size) {
+    FlashRecordHeader *rec = (FlashRecordHeader *)recordBuffer;
+    uint32_t offset = head * store->sectorSize + headOffset;
+
+    if (headOffset + size > store->sectorSize || !store->program(store->ctx, offset, recordBuffer, size)) {
+        return false;
+    }
+    headOffset += size;
+    counters.writes++;
+    return index_update(rec->key, rec->len, offset, rec->crc);
+}
+
+/// @brief Copies the live records of a sector to the head, then erases it
+static bool sector_reclaim(uint32_t sector) {
+    uint32_t start = sector * store->sectorSize;
+    uint32_t end = start + store->sectorSize;
+    uint32_t i, size;
+
+    for (i = 0; i < entryCount; i++) {
+        if (entries[i].offset < start || entries[i].offset >= end) {
+            continue;
+        }
+        size = record_size(entries[i].len);
+        store->read(store->ctx, entries[i].offset, recordBuffer, size);
+        if (!head_append(size)) {
+            return false;
+        }
+    }
+    return sector_erase(sector);
+}
+
+/// @brief Makes the erased sector after the head the new head, and reclaims the oldest sector
+static bool head_advance() {
+    uint32_t next = (head + 1) % store->sectors;
+    uint32_t header[2] = { FLASHSTORE_MAGIC, seq + 1 };
+    uint32_t nextSeq;
+
+    if (sector_state(next, &nextSeq) != SECTOR_ERASED && !sector_erase(next)) {
+        return false;
+    }
+    if (!store->program(store->ctx, next * store->sectorSize, header, sizeof(header))) {
+        return false;
+    }
+    head = next;
+    headOffset = SECTOR_HEADER;
+    seq++;
+
+    next = (head + 1) % store->sectors;
+    if (sector_state(next, &nextSeq) != SECTOR_ERASED) {
+        return sector_reclaim(next);
+    }
+    return true;
+}
+
+/// @brief Erases every sector and starts an empty log in sector 0
+bool flashstore_format() {
+    uint32_t header[2] = { FLASHSTORE_MAGIC, 1 };
+    uint32_t i;
+
+    if (store == NULL) {
+        return false;
+    }
+    for (i = 0; i < store->sectors; i++) {
+        if (!sector_erase(i)) {
+            return false;
+        }
+    }
+    entryCount = 0;
+    head = 0;
+    headOffset = SECTOR_HEADER;
+    seq = 1;
+    return store->program(store->ctx, 0, header, sizeof(header));
+}
+
+/**
+ * @brief Rebuilds the index from the sectors of hal, oldest first. A blank or
+ * unrecognised store is formatted.
+ * @return False if the flash could not be erased or programmed
+ */
+bool flashstore_mount(const FlashHal *hal) {
+    uint32_t order[FLASH_STORE_SECTORS * 4];
+    uint32_t seqs[FLASH_STORE_SECTORS * 4];
+    uint32_t valid = 0, offset = 0;
+    uint32_t i, j, sectorSeq, tmp;
+
+    store = hal;
+    entryCount = 0;
+    memset(&counters, 0, sizeof(counters));
+    if (hal->sectors < 2 || hal->sectors > FLASH_STORE_SECTORS * 4) {
+        store = NULL;
+        return false;
+    }
+
+    for (i = 0; i < hal->sectors; i++) {
+        switch (sector_state(i, &sectorSeq)) {
+        case SECTOR_VALID:
+            // Insert by sequence number, which is also ring order from the oldest sector
+            for (j = valid; j > 0 && seqs[j - 1] > sectorSeq; j--) {
+                seqs[j] = seqs[j - 1];
+                order[j] = order[j - 1];
+            }
+            seqs[j] = sectorSeq;
+            order[j] = i;
+            valid++;
+            break;
+        case SECTOR_GARBAGE:
+            if (!sector_erase(i)) {     // Header cut short while the sector was opened
+                return false;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    if (valid == 0) {
+        return flashstore_format();
+    }
+
+    for (i = 0; i < valid; i++) {
+        offset = sector_scan(order[i]);
+    }
+    head = order[valid - 1];
+    headOffset = offset;
+    seq = seqs[valid - 1];
+
+    // A reset during head_advance() can leave the oldest sector unreclaimed
+    tmp = (head + 1) % hal->sectors;
+    if (sector_state(tmp, &sectorSeq) == SECTOR_VALID && tmp != head) {
+        sector_reclaim(tmp);
+    }
+    return true;
+}
+
+bool flashstore_mounted() {
+    return store != NULL;
+}
+
+/**
+ * @brief Writes a new value for key. Nothing is written when the value is unchanged.
+ * @return False if the store is not mounted, full, or the flash failed
+ */
+bool flashstore_write(uint16_t key, const void *data, uint16_t len) {
+    FlashRecordHeader *rec = (FlashRecordHeader *)recordBuffer;
+    int32_t i = find_entry(key);
+    uint32_t size = record_size(len);
+    uint32_t crc, live, tries;
+    FlashStoreStats stats;
+
+    if (store == NULL || key == FLASHSTORE_KEY_NONE || len > FLASHSTORE_MAX_VALUE) {
+        return false;
+    }
+
+    crc = record_crc(key, len, data);
+    if ((i >= 0 && entries[i].len == len && entries[i].crc == crc) || (i < 0 && len == 0)) {
+        counters.skipped++;
+        return true;
+    }
+    if (i < 0 && entryCount == FLASHSTORE_MAX_KEYS) {
+        return false;
+    }
+
+    flashstore_stats(&stats);
+    live = stats.liveBytes - (i >= 0 ? record_size(entries[i].len) : 0);
+    if (len > 0 && live + size > capacity()) {
+        return false;
+    }
+
+    for (tries = 0; headOffset + size > store->sectorSize; tries++) {
+        if (tries == store->sectors || !head_advance()) {
+            return false;
+        }
+    }
+
+    // head_advance() reuses recordBuffer, so the record is built afterwards
+    memset(recordBuffer, FLASH_HAL_ERASED, size);
+    rec->key = key;
+    rec->len = len;
+    rec->crc = crc;
+    if (len > 0) {
+        memcpy(&recordBuffer[RECORD_HEADER / 4], data, len);
+    }
+    return head_append(size);
+}
+
+/**
+ * @brief Copies up to maxLen bytes of the value of key into data.
+ * @return Length of the stored value, -1 if the key is not stored
+ */
+int32_t flashstore_read(uint16_t key, void *data, uint16_t maxLen) {
+    int32_t i = find_entry(key);
+
+    if (store == NULL || i < 0) {
+        return -1;
+    }
+    store->read(store->ctx, entries[i].offset + RECORD_HEADER, data,
+                entries[i].len < maxLen ? entries[i].len : maxLen);
+    return entries[i].len;
+}
+
+bool flashstore_delete(uint16_t key) {
+    return flashstore_write(key, NULL, 0);
+}
+
+void flashstore_stats(FlashStoreStats *stats) {
+    uint32_t i;
+
+    *stats = counters;
+    stats->keys = entryCount;
+    stats->liveBytes = 0;
+    for (i = 0; i < entryCount; i++) {
+        stats->liveBytes += record_size(entries[i].len);
+    }
+    stats->capacity = store ? capacity() : 0;
+    stats->head = head;
+    stats->headFree = store ? store->sectorSize - headOffset : 0;
+}
@@ -0,0 +1,51 @@
+/*
+ * flashstore.h
+ *
+ * Log structured key/value store on the sectors of a FlashHal. Records are
+ * appended to the head sector; a newer record for the same key supersedes the
+ * older one and a zero length record deletes it. Sectors are used as a ring:
+ * when the head fills up the next sector becomes the head, and the sector
+ * after it (the oldest one) has its live records copied forward and is
+ * erased. Every sector is therefore erased equally often, and one erased
+ * sector is always kept ahead of the head.
+ *
+ *   sector   | magic | seq | record | record | ... | 0xFF ...
+ *   record   | key:16 | len:16 | crc32 | data, padded to 4 bytes
+ *
+ * The CRC covers key, len and data. Records that fail it (a write cut short by
+ * a reset) are skipped when the store is mounted.
+ */
+
+#ifndef SRC_FLASHSTORE_H_
+#define SRC_FLASHSTORE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "flash_hal.h"
+
+#define FLASHSTORE_MAX_KEYS   128   // Distinct keys kept in the RAM index
+#define FLASHSTORE_MAX_VALUE  512   // Largest record in bytes
+#define FLASHSTORE_KEY_NONE   0xFFFF
+
+typedef struct FlashStoreStats {
+    uint32_t keys;              // Live keys
+    uint32_t liveBytes;         // Space taken by live records, headers included
+    uint32_t capacity;          // Most live bytes the store accepts
+    uint32_t head;              // Sector written to
+    uint32_t headFree;          // Bytes left in it
+    uint32_t erases;            // Sector erases since mount
+    uint32_t writes;            // Records written since mount
+    uint32_t skipped;           // Writes skipped because the value was unchanged
+    uint32_t corrupt;           // Bad records found at mount
+} FlashStoreStats;
+
+bool flashstore_mount(const FlashHal *hal);
+bool flashstore_format();
+bool flashstore_write(uint16_t key, const void *data, uint16_t len);
+int32_t flashstore_read(uint16_t key, void *data, uint16_t maxLen);
+bool flashstore_delete(uint16_t key);
+bool flashstore_mounted();
+void flashstore_stats(FlashStoreStats *stats);
+
+#endif /* SRC_FLASHSTORE_H_ */
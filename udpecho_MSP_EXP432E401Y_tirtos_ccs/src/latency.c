@@ -0,0 +1,87 @@
+/*
+ *  ======== latency.c ========
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "p100.h"
+#include "latency.h"
+
+#define LAT_BAR_WIDTH 40
+#define LAT_NS_BUCKETS 11     // 2^10 ticks = 8.5 us at 120 MHz, the last bound printed in ns
+
+LatHist latHist[LAT_POINT_COUNT];
+
+static const char *latNames[LAT_POINT_COUNT] = {
+    "Timer0 Hwi -> Swi",        // LAT_TIMER0
+    "AddPayload -> execute",    // LAT_PAYLOAD
+    "ADC callback -> stream",   // LAT_ADC
+    "Net queue -> sendto",      // LAT_NET_TX
+};
+
+void lat_reset() {
+    memset(latHist, 0, sizeof(latHist));
+}
+
+/// @return Ticks in tenths of a microsecond, for printing as %u.%u
+static uint32_t lat_tenths(uint64_t ticks) {
+    return (uint32_t)(ticks * 10 / timestamp_ticks_per_us());
+}
+
+/// @brief Prints each histogram that has samples, one bar per non-empty bucket
+void print_latency() {
+    LatHist hist;
+    char msg[2 * MAX_LINE_LENGTH];
+    char bar[LAT_BAR_WIDTH + 1];
+    uint32_t peak, avg, upper;
+    int point, b, width;
+    bool any = false;
+
+    AddProgramMessage("=================================== Latency ====================================\r\n");
+    for (point = 0; point < LAT_POINT_COUNT; point++) {
+        hist = latHist[point];      // Snapshot, the writer keeps recording
+        if (hist.count == 0) {
+            continue;
+        }
+        any = true;
+
+        avg = lat_tenths(hist.total / hist.count);
+        sprintf(msg, "| %-22s %8u  min %u.%u  avg %u.%u  max %u.%u us\r\n", latNames[point],
+                (unsigned)hist.count, (unsigned)(lat_tenths(hist.min) / 10), (unsigned)(lat_tenths(hist.min) % 10),
+                (unsigned)(avg / 10), (unsigned)(avg % 10),
+                (unsigned)(lat_tenths(hist.max) / 10), (unsigned)(lat_tenths(hist.max) % 10));
+        AddProgramMessage(msg);
+
+        peak = 0;
+        for (b = 0; b < LAT_BUCKETS; b++) {
+            if (hist.buckets[b] > peak) {
+                peak = hist.buckets[b];
+            }
+        }
+        for (b = 0; b < LAT_BUCKETS; b++) {
+            if (hist.buckets[b] == 0) {
+                continue;
+            }
+            width = (int)((uint64_t)hist.buckets[b] * LAT_BAR_WIDTH / peak);
+            if (width == 0) {
+                width = 1;
+            }
+            memset(bar, '#', width);
+            bar[width] = '\0';
+            // Bucket bounds below 10 us are shown in ns, tenths of a us would round them to 0
+            if (b + 1 < LAT_NS_BUCKETS) {
+                upper = (uint32_t)(((uint64_t)1 << (b + 1)) * 1000 / timestamp_ticks_per_us());
+                sprintf(msg, "| | < %8u ns %8u %s\r\n", (unsigned)upper, (unsigned)hist.buckets[b], bar);
+            } else {
+                upper = lat_tenths((uint64_t)1 << (b + 1));
+                sprintf(msg, "| | < %6u.%u us %8u %s\r\n", (unsigned)(upper / 10), (unsigned)(upper % 10),
+                        (unsigned)hist.buckets[b], bar);
+            }
+            AddProgramMessage(msg);
+        }
+    }
+    if (!any) {
+        AddProgramMessage("| No latency samples yet.\r\n");
+    }
+    AddProgramMessage("================================================================================\r\n");
+}
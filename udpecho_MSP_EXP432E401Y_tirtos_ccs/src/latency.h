@@ -0,0 +1,77 @@
+/*
+ * latency.h
+ *
+ * Latency histograms of the hand-offs between an interrupt or producer and
+ * the context that serves it. Each sample is counted in timestamp_now()
+ * ticks, which keep running while the core sleeps, and lands in the power of
+ * two bucket holding it, so 32 buckets cover 8 ns to 35 s at 120 MHz with
+ * constant relative resolution:
+ *
+ *   LAT_TIMER0     Timer0 Hwi -> Timer0 Swi
+ *   LAT_PAYLOAD    AddPayload -> executePayloadTask starting it
+ *   LAT_ADC        ADCBuf callback -> ADCStream task
+ *   LAT_NET_TX     network queue -> sendto() in TransmitFxn
+ *
+ * Every histogram is written only by the context at the end of its hand-off,
+ * so recording needs no gate.
+ */
+
+#ifndef SRC_LATENCY_H_
+#define SRC_LATENCY_H_
+
+#include <stdint.h>
+
+#include "timestamp.h"
+
+#define LAT_BUCKETS 32
+
+typedef enum {
+    LAT_TIMER0,
+    LAT_PAYLOAD,
+    LAT_ADC,
+    LAT_NET_TX,
+
+    LAT_POINT_COUNT
+} LatPoint;
+
+typedef struct LatHist {
+    uint32_t count;
+    uint32_t min;               // Timestamp ticks
+    uint32_t max;
+    uint64_t total;
+    uint32_t buckets[LAT_BUCKETS];  // buckets[b] counts samples of 2^b to 2^(b+1)-1 ticks
+} LatHist;
+
+extern LatHist latHist[LAT_POINT_COUNT];
+
+/// @return floor(log2(ticks)), 0 for 0 and 1
+static inline int lat_bucket(uint32_t ticks) {
+    int b = 0;
+    if (ticks >= 1u << 16) { ticks >>= 16; b += 16; }
+    if (ticks >= 1u << 8)  { ticks >>= 8;  b += 8; }
+    if (ticks >= 1u << 4)  { ticks >>= 4;  b += 4; }
+    if (ticks >= 1u << 2)  { ticks >>= 2;  b += 2; }
+    if (ticks >= 1u << 1)  { b += 1; }
+    return b;
+}
+
+/// @brief Records the time since start, which was taken with timestamp_now()
+static inline void lat_record(LatPoint point, uint32_t start) {
+    LatHist *hist = &latHist[point];
+    uint32_t ticks = timestamp_now() - start;
+
+    if (hist->count == 0 || ticks < hist->min) {
+        hist->min = ticks;
+    }
+    if (ticks > hist->max) {
+        hist->max = ticks;
+    }
+    hist->count++;
+    hist->total += ticks;
+    hist->buckets[lat_bucket(ticks)]++;
+}
+
+void lat_reset();
+void print_latency();
+
+#endif /* SRC_LATENCY_H_ */
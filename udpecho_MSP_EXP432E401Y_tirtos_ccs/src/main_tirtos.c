@@ -44,6 +44,8 @@
 
 #include <ti/drivers/Board.h>
 #include "p100.h"
+#include "storage.h"
+#include "cycles.h"
 
 #ifdef Globals
 extern Globals glo;
@@ -76,10 +78,12 @@ int main(void)
 
 
 
+    cycles_init();
     init_globals();
     init_drivers();
     init_tickers();
     init_script_lines();
+    storage_init();     // Mounts the flash store, may load the saved state
 
     if (glo.uart0 == NULL) {
         /* UART_open() failed */
@@ -0,0 +1,135 @@
+/*
+ *  ======== memstat.c ========
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include <xdc/runtime/Error.h>
+#include <xdc/runtime/Memory.h>
+#include <ti/sysbios/hal/Hwi.h>
+
+#include "p100.h"
+#include "script.h"
+#include "scriptvm.h"
+#include "register.h"
+#include "tickers.h"
+#include "profile.h"
+#include "var.h"
+#include "latency.h"
+#include "memstat.h"
+
+#define MEMSTAT_STACK_WARN 90   // Percent of a stack used that is flagged
+
+MemStats memStats;
+
+/// @brief Memory_alloc() from the default heap, counted. Callable from tasks and Swis.
+void *mem_alloc(SizeT size) {
+    Error_Block eb;
+    void *ptr;
+    UInt key;
+
+    Error_init(&eb);
+    ptr = Memory_alloc(NULL, size, 0, &eb);
+
+    key = Hwi_disable();
+    if (ptr == NULL) {
+        memStats.failed++;
+    } else {
+        memStats.allocs++;
+        memStats.bytesInUse += size;
+        if (memStats.bytesInUse > memStats.bytesPeak) {
+            memStats.bytesPeak = memStats.bytesInUse;
+        }
+    }
+    Hwi_restore(key);
+    return ptr;
+}
+
+void mem_free(void *ptr, SizeT size) {
+    UInt key;
+
+    Memory_free(NULL, ptr, size);
+
+    key = Hwi_disable();
+    memStats.frees++;
+    memStats.bytesInUse -= size;
+    Hwi_restore(key);
+}
+
+static void memstat_print_task(Task_Handle task) {
+    Task_Stat stat;
+    char msg[MAX_LINE_LENGTH * 2];
+    char hex[12];
+    const char *name = bios_object_name(task);
+    uint32_t percent;
+
+    Task_stat(task, &stat);
+    if (name == NULL) {
+        sprintf(hex, "0x%08X", (unsigned)(uintptr_t)task);
+        name = hex;
+    }
+    percent = stat.stackSize ? (uint32_t)(stat.used * 100 / stat.stackSize) : 0;
+    sprintf(msg, "| %-18s | %5u | %5u | %3u%% | %2d%s\r\n", name, (unsigned)stat.stackSize,
+            (unsigned)stat.used, (unsigned)percent, stat.priority,
+            percent >= MEMSTAT_STACK_WARN ? "  <- near overflow" : "");
+    AddProgramMessage(msg);
+}
+
+static void memstat_print_block(const char *name, uint32_t bytes) {
+    char msg[MAX_LINE_LENGTH * 2];
+    sprintf(msg, "| %-28s %6u\r\n", name, (unsigned)bytes);
+    AddProgramMessage(msg);
+}
+
+void print_memstat() {
+    Hwi_StackInfo hwiStack;
+    Memory_Stats heap;
+    MemStats counts;
+    Task_Handle task;
+    char msg[MAX_LINE_LENGTH * 2];
+    UInt key;
+    Int i;
+
+    AddProgramMessage("==================================== Memory ====================================\r\n");
+    AddProgramMessage("| Task               |  Size |  Used |  Use | Pri\r\n");
+    AddProgramMessage("|--------------------|-------|-------|------|----\r\n");
+    for (i = 0; i < Task_Object_count(); i++) {
+        memstat_print_task(Task_Object_get(NULL, i));       // Created in release.cfg
+    }
+    for (task = Task_Object_first(); task != NULL; task = Task_Object_next(task)) {
+        memstat_print_task(task);                           // Created at runtime, e.g. by the NDK
+    }
+
+    Hwi_getStackInfo(&hwiStack, TRUE);
+    sprintf(msg, "| System stack (Hwi, Swi): %u of %u bytes used\r\n",
+            (unsigned)hwiStack.hwiStackPeak, (unsigned)hwiStack.hwiStackSize);
+    AddProgramMessage(msg);
+
+    Memory_getStats(NULL, &heap);
+    sprintf(msg, "| Heap: %u total, %u free, largest free block %u\r\n",
+            (unsigned)heap.totalSize, (unsigned)heap.totalFreeSize, (unsigned)heap.largestFreeSize);
+    AddProgramMessage(msg);
+
+    key = Hwi_disable();
+    counts = memStats;
+    Hwi_restore(key);
+    sprintf(msg, "| Allocations: %u, freed %u, failed %u, %u bytes in use, peak %u\r\n",
+            (unsigned)counts.allocs, (unsigned)counts.frees, (unsigned)counts.failed,
+            (unsigned)counts.bytesInUse, (unsigned)counts.bytesPeak);
+    AddProgramMessage(msg);
+
+    AddProgramMessage("| Static blocks                  Bytes\r\n");
+    memstat_print_block("glo", sizeof(glo));
+    memstat_print_block("| glo.audioController", sizeof(glo.audioController));
+    memstat_print_block("| glo.NetOutQ", sizeof(glo.NetOutQ));
+    memstat_print_block("| glo.Discoveries", sizeof(glo.Discoveries));
+    memstat_print_block("scriptLines", sizeof(scriptLines));
+    memstat_print_block("scriptContexts", sizeof(scriptContexts));
+    memstat_print_block("profileScript", SCRIPT_LINE_COUNT * sizeof(ProfileEntry));
+    memstat_print_block("tickers", sizeof(tickers));
+    memstat_print_block("registers, all banks", sizeof(registers) + sizeof(longRegisters)
+                        + sizeof(floatRegisters) + sizeof(stringRegisters));
+    memstat_print_block("varValues", sizeof(varValues));
+    memstat_print_block("latHist", sizeof(latHist));
+    AddProgramMessage("================================================================================\r\n");
+}
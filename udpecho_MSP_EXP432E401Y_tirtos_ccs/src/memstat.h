@@ -0,0 +1,37 @@
+/*
+ * memstat.h
+ *
+ * RAM use at run time, for sizing stacks and buffers:
+ *
+ *   task stacks     high-water mark of each Task, from the 0xBE fill
+ *                   pattern SYS/BIOS writes into every stack at creation
+ *   system stack    peak of the stack shared by Hwis and Swis
+ *   heap            HeapMem total, free and largest free block
+ *   allocations     every payload and message buffer goes through
+ *                   mem_alloc()/mem_free(), which count them and the
+ *                   allocations that failed
+ *   static blocks   sizes of the largest statically allocated tables
+ */
+
+#ifndef SRC_MEMSTAT_H_
+#define SRC_MEMSTAT_H_
+
+#include <stdint.h>
+
+#include <xdc/std.h>
+
+typedef struct MemStats {
+    uint32_t allocs;
+    uint32_t frees;
+    uint32_t failed;            // Allocations the heap could not satisfy
+    uint32_t bytesInUse;        // Requested sizes, not counting heap headers
+    uint32_t bytesPeak;
+} MemStats;
+
+extern MemStats memStats;
+
+void *mem_alloc(SizeT size);
+void mem_free(void *ptr, SizeT size);
+void print_memstat();
+
+#endif /* SRC_MEMSTAT_H_ */
@@ -0,0 +1,65 @@
+/*
+ * netpacket.h
+ *
+ * Binary UDP packet format shared by TransmitFxn and ListenFxn. Script uploads
+ * use the same framing on UART1 (scriptimage.h).
+ *
+ * Every binary packet starts with a NetPacketHeader at offset 0. The first
+ * magic byte is outside the ASCII range, so a text payload such as
+ * "-print hello" can never be mistaken for a binary packet and the receive
+ * path can classify a datagram by looking at its first bytes only.
+ * Anything without the magic prefix is handled as a text payload.
+ *
+ * Both ends of the link are MSP432E4 boards, so multi-byte fields are sent in
+ * the native (little-endian) byte order.
+ */
+
+#ifndef SRC_NETPACKET_H_
+#define SRC_NETPACKET_H_
+
+#include <stdint.h>
+
+#define NETPKT_MAGIC0 0xD5
+#define NETPKT_MAGIC1 'M'
+
+// Packet types, used as the index into the ListenFxn handler table
+typedef enum {
+    NETPKT_VOICE,       // DATABLOCKSIZE audio samples for one TX buffer
+    NETPKT_VOICE_RED,   // NETPKT_VOICE followed by a FecRedundant copy of block seq - 1
+    NETPKT_PARITY,      // XOR of the count voice blocks starting at seq (fec.h)
+    NETPKT_SCRIPT,      // ScriptImageChunk of a script upload (scriptimage.h)
+    NETPKT_REGS,        // NetRegsHeader, register file access (netregs.h)
+
+    NETPKT_TYPE_COUNT   // Keeps track of the number of packet types
+} NetPacketType;
+
+typedef struct NetPacketHeader {
+    uint8_t  magic[2];  // NETPKT_MAGIC0, NETPKT_MAGIC1
+    uint8_t  type;      // NetPacketType
+    uint8_t  dest;      // Voice: dest_choice (0/1 = TX0 ping/pong, 2/3 = TX1 ping/pong), parity: 0 or 2
+    uint16_t seq;       // Per-sender sequence number
+    uint16_t count;     // Voice: number of uint16_t samples following the header, parity: blocks covered
+    uint32_t timestamp; // Sender's timestamp_us() when the packet was queued
+} NetPacketHeader;
+
+// Follows the NetPacketHeader of a NETPKT_SCRIPT packet, then length bytes of the image
+typedef struct ScriptImageChunk {
+    uint16_t transfer;      // Sender's id for the upload, a new id restarts reception
+    uint16_t index;         // Chunk number, data goes at index * SCRIPT_IMAGE_CHUNK
+    uint16_t chunks;        // Chunks in the image
+    uint16_t length;        // Data bytes in this chunk
+    uint32_t imageLength;   // Bytes in the whole image
+    uint32_t imageCrc;      // crc32() of the whole image
+} ScriptImageChunk;
+
+// Follows the NetPacketHeader of a NETPKT_REGS packet, then one int32_t per selected
+// value: the registers in regMask from R0 up, then the fields in gloMask (netregs.h)
+typedef struct NetRegsHeader {
+    uint8_t  op;            // NetRegsOp
+    uint8_t  status;        // NetRegsStatus of a NETREGS_VALUES reply
+    uint16_t periodMs;      // NETREGS_SUBSCRIBE: push period, 0 cancels the subscription
+    uint32_t regMask;       // Bit n selects Rn
+    uint32_t gloMask;       // Bit n selects glo field n, read only
+} NetRegsHeader;
+
+#endif /* SRC_NETPACKET_H_ */
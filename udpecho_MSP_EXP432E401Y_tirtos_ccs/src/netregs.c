@@ -0,0 +1,255 @@
+/*
+ *  ======== netregs.c ========
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "p100.h"
+#include "register.h"
+#include "tickers.h"
+#include "atomic.h"
+#include "watch.h"
+#include "netregs.h"
+#include "timestamp.h"
+#include "cpuload.h"
+
+#define NETREGS_MAX_VALUES  (NUM_REGISTERS + NETREGS_GLO_COUNT)
+#define NETREGS_GLO_ALL     ((1u << NETREGS_GLO_COUNT) - 1)
+
+typedef struct NetRegsSubscriber {
+    uint32_t addr;              // Host byte order, 0 when the slot is free
+    uint16_t port;
+    uint16_t seq;
+    uint32_t regMask;
+    uint32_t gloMask;
+    uint16_t periodTicks;
+    uint16_t countdown;         // Ticks to the next push
+    uint32_t leaseTicks;        // Ticks until the subscription expires
+    uint32_t pushes;
+} NetRegsSubscriber;
+
+const char *netRegsGloNames[NETREGS_GLO_COUNT] = {
+    "Timer0Period", "scriptContext", "emergencyStopActive", "ping_count", "pong_count",
+    "cpuLoad", "swiLoad", "hwiLoad"
+};
+
+static NetRegsSubscriber netRegsSubscribers[NETREGS_SUBSCRIBERS];   // Guarded by gateSwi4
+static uint32_t netRegsRequests;
+
+static int32_t netregs_glo_value(int field) {
+    switch (field) {
+    case 0:  return glo.Timer0Period;
+    case 1:  return glo.scriptContext;
+    case 2:  return glo.emergencyStopActive;
+    case 3:  return (int32_t)glo.audioController.adcBufControl.ping_count;
+    case 4:  return (int32_t)glo.audioController.adcBufControl.pong_count;
+    case 5:  return cpuload_total();
+    case 6:  return cpuload_kind(CPU_LOAD_SWI);
+    default: return cpuload_kind(CPU_LOAD_HWI);
+    }
+}
+
+static int netregs_count(uint32_t mask) {
+    int n = 0;
+    for (; mask; mask &= mask - 1) {
+        n++;
+    }
+    return n;
+}
+
+/// @brief Sends a NETREGS_VALUES packet with the selected values, read as late as possible
+static void netregs_send(uint32_t addr, uint16_t port, uint16_t seq, uint8_t status,
+                         uint32_t regMask, uint32_t gloMask) {
+    struct {
+        NetRegsHeader head;
+        int32_t values[NETREGS_MAX_VALUES];
+    } body;
+    NetPacketHeader hdr;
+    int n = 0;
+    int i;
+
+    for (i = 0; i < NUM_REGISTERS; i++) {
+        if (regMask & (1u << i)) {
+            body.values[n++] = atomic32_load(&registers[i]);
+        }
+    }
+    for (i = 0; i < NETREGS_GLO_COUNT; i++) {
+        if (gloMask & (1u << i)) {
+            body.values[n++] = netregs_glo_value(i);
+        }
+    }
+
+    body.head.op = NETREGS_VALUES;
+    body.head.status = status;
+    body.head.periodMs = 0;
+    body.head.regMask = regMask;
+    body.head.gloMask = gloMask;
+
+    hdr.magic[0] = NETPKT_MAGIC0;
+    hdr.magic[1] = NETPKT_MAGIC1;
+    hdr.type = NETPKT_REGS;
+    hdr.dest = 0;
+    hdr.seq = seq;
+    hdr.count = n;
+    hdr.timestamp = timestamp_us();
+
+    AddNetPacket(addr, port, &hdr, &body, sizeof(NetRegsHeader) + n * sizeof(int32_t));
+}
+
+/// @brief Adds, renews or, with a period of 0, cancels the subscription of addr:port
+static NetRegsStatus netregs_subscribe(uint32_t addr, uint16_t port, const NetRegsHeader *req) {
+    NetRegsSubscriber *sub = NULL;
+    uint32_t gateKey;
+    int i;
+
+    gateKey = GateSwi_enter(gateSwi4);
+    for (i = 0; i < NETREGS_SUBSCRIBERS; i++) {
+        if (netRegsSubscribers[i].addr == addr && netRegsSubscribers[i].port == port) {
+            sub = &netRegsSubscribers[i];
+            break;
+        }
+        if (!sub && netRegsSubscribers[i].addr == 0) {
+            sub = &netRegsSubscribers[i];
+        }
+    }
+
+    if (req->periodMs == 0) {
+        if (sub && sub->addr == addr && sub->port == port) {
+            sub->addr = 0;
+        }
+        GateSwi_leave(gateSwi4, gateKey);
+        return NETREGS_OK;
+    }
+    if (!sub) {
+        GateSwi_leave(gateSwi4, gateKey);
+        return NETREGS_NO_SUBSCRIBER;
+    }
+
+    if (sub->addr != addr || sub->port != port) {
+        sub->seq = 0;
+        sub->pushes = 0;
+    }
+    sub->addr = addr;
+    sub->port = port;
+    sub->regMask = req->regMask;
+    sub->gloMask = req->gloMask;
+    sub->periodTicks = (req->periodMs + TICKER_TICK_MS - 1) / TICKER_TICK_MS;
+    sub->countdown = sub->periodTicks;
+    sub->leaseTicks = NETREGS_LEASE_MS / TICKER_TICK_MS;
+    GateSwi_leave(gateSwi4, gateKey);
+    return NETREGS_OK;
+}
+
+/**
+ * @brief Serves one NETPKT_REGS request from ListenFxn. Every request is answered,
+ * with a status other than NETREGS_OK when it could not be carried out.
+ * @param addr Sender's IP address in host byte order
+ * @param port Sender's port in host byte order
+ */
+void netregs_receive(const char *packet, int32_t len, uint32_t addr, uint16_t port) {
+    const NetPacketHeader *hdr = (const NetPacketHeader *)packet;
+    const NetRegsHeader *req = (const NetRegsHeader *)(hdr + 1);
+    const int32_t *values = (const int32_t *)(req + 1);
+    int32_t count;
+    uint8_t status = NETREGS_OK;
+    int i;
+
+    if (len < (int32_t)(sizeof(NetPacketHeader) + sizeof(NetRegsHeader))) {
+        netstat_drop(&netStats.rx, NET_DROP_SHORT);
+        return;
+    }
+    count = (len - (int32_t)(sizeof(NetPacketHeader) + sizeof(NetRegsHeader))) / (int32_t)sizeof(int32_t);
+    netRegsRequests++;
+
+    if (req->gloMask & ~NETREGS_GLO_ALL) {
+        status = NETREGS_BAD_REQUEST;
+    } else if (req->op == NETREGS_WRITE) {
+        if (req->gloMask != 0) {
+            status = NETREGS_READ_ONLY;
+        } else if (count != netregs_count(req->regMask)) {
+            status = NETREGS_BAD_REQUEST;
+        } else {
+            for (i = 0; i < NUM_REGISTERS; i++) {
+                if (req->regMask & (1u << i)) {
+                    atomic32_store(&registers[i], *values++);
+                    watch_notify(i);
+                }
+            }
+        }
+    } else if (req->op == NETREGS_SUBSCRIBE) {
+        status = netregs_subscribe(addr, port, req);
+    } else if (req->op != NETREGS_READ) {
+        status = NETREGS_BAD_REQUEST;
+    }
+
+    if (status == NETREGS_OK) {
+        netregs_send(addr, port, hdr->seq, status, req->regMask, req->gloMask);
+    } else {
+        netregs_send(addr, port, hdr->seq, status, 0, 0);
+    }
+}
+
+/// @brief Pushes the subscriptions that are due, called every TICKER_TICK_MS by the ticker task
+void netregs_tick() {
+    NetRegsSubscriber due;
+    uint32_t gateKey;
+    int i;
+
+    for (i = 0; i < NETREGS_SUBSCRIBERS; i++) {
+        gateKey = GateSwi_enter(gateSwi4);
+        NetRegsSubscriber *sub = &netRegsSubscribers[i];
+        if (sub->addr == 0) {
+            GateSwi_leave(gateSwi4, gateKey);
+            continue;
+        }
+        if (--sub->leaseTicks == 0) {
+            sub->addr = 0;
+            GateSwi_leave(gateSwi4, gateKey);
+            continue;
+        }
+        if (--sub->countdown != 0) {
+            GateSwi_leave(gateSwi4, gateKey);
+            continue;
+        }
+        sub->countdown = sub->periodTicks;
+        sub->seq++;
+        sub->pushes++;
+        due = *sub;
+        GateSwi_leave(gateSwi4, gateKey);
+
+        netregs_send(due.addr, due.port, due.seq, NETREGS_OK, due.regMask, due.gloMask);
+    }
+}
+
+/// @brief Cancels every subscription
+void netregs_clear() {
+    uint32_t gateKey = GateSwi_enter(gateSwi4);
+    memset(netRegsSubscribers, 0, sizeof(netRegsSubscribers));
+    GateSwi_leave(gateSwi4, gateKey);
+}
+
+void print_netregs() {
+    NetRegsSubscriber snapshot[NETREGS_SUBSCRIBERS];
+    char msg[MAX_LINE_LENGTH + 8];
+    uint32_t gateKey;
+    int i;
+
+    gateKey = GateSwi_enter(gateSwi4);
+    memcpy(snapshot, netRegsSubscribers, sizeof(snapshot));
+    GateSwi_leave(gateSwi4, gateKey);
+
+    sprintf(msg, "Register service requests: %u\r\n", (unsigned)netRegsRequests);
+    AddProgramMessage(msg);
+    for (i = 0; i < NETREGS_SUBSCRIBERS; i++) {
+        NetRegsSubscriber *sub = &snapshot[i];
+        if (sub->addr == 0) {
+            continue;
+        }
+        sprintf(msg, "| %d.%d.%d.%d:%u every %u ms, regs 0x%08X glo 0x%02X, %u pushes\r\n",
+                (uint8_t)(sub->addr >> 24), (uint8_t)(sub->addr >> 16),
+                (uint8_t)(sub->addr >> 8), (uint8_t)sub->addr, sub->port,
+                sub->periodTicks * TICKER_TICK_MS, (unsigned)sub->regMask,
+                (unsigned)sub->gloMask, (unsigned)sub->pushes);
+        AddProgramMessage(msg);
+    }
+}
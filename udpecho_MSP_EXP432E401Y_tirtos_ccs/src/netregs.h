@@ -0,0 +1,56 @@
+/*
+ * netregs.h
+ *
+ * Binary register service on the UDP port. A NETPKT_REGS request reads or
+ * writes any subset of the register file in one datagram and is answered with
+ * a NETREGS_VALUES packet to the sender's address and port:
+ *
+ *   NETREGS_READ       regMask, gloMask          -> values of the selection
+ *   NETREGS_WRITE      regMask + values          -> values read back
+ *   NETREGS_SUBSCRIBE  regMask, gloMask, period  -> values now, then pushed
+ *                                                   every period
+ *
+ * A subscription is pushed from the ticker task, so the period is rounded up
+ * to TICKER_TICK_MS (100 Hz at most). It lasts NETREGS_LEASE_MS and is renewed
+ * by subscribing again; a period of 0 cancels it. The glo fields are read
+ * only, netRegsGloNames lists them by bit. The load fields are per mille
+ * over the last second (cpuload.h).
+ */
+
+#ifndef SRC_NETREGS_H_
+#define SRC_NETREGS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define NETREGS_SUBSCRIBERS 4
+#define NETREGS_LEASE_MS    10000
+
+typedef enum {
+    NETREGS_READ,
+    NETREGS_WRITE,
+    NETREGS_SUBSCRIBE,
+    NETREGS_VALUES,         // Reply and subscription push
+
+    NETREGS_OP_COUNT        // Keeps track of the number of operations
+} NetRegsOp;
+
+typedef enum {
+    NETREGS_OK,
+    NETREGS_BAD_REQUEST,    // Unknown op, or the values do not match the masks
+    NETREGS_READ_ONLY,      // Write selecting glo fields
+    NETREGS_NO_SUBSCRIBER,  // All subscriptions in use
+
+    NETREGS_STATUS_COUNT    // Keeps track of the number of status codes
+} NetRegsStatus;
+
+#define NETREGS_GLO_COUNT 8
+
+extern const char *netRegsGloNames[NETREGS_GLO_COUNT];
+
+void netregs_receive(const char *packet, int32_t len, uint32_t addr, uint16_t port);
+void netregs_tick();
+void netregs_clear();
+void print_netregs();
+
+#endif /* SRC_NETREGS_H_ */
@@ -0,0 +1,163 @@
+/*
+ *  ======== netstat.c ========
+ */
+#include <string.h>
+#include <stdio.h>
+
+#include "p100.h"
+#include "netstat.h"
+#include "timestamp.h"
+
+NetStats netStats;
+
+static const char *dropNames[NET_DROP_COUNT] = {
+    "queue full",       // NET_DROP_QUEUE_FULL
+    "too large",        // NET_DROP_TOO_LARGE
+    "parse",            // NET_DROP_PARSE
+    "sendto",           // NET_DROP_SENDTO
+    "short",            // NET_DROP_SHORT
+    "unknown type",     // NET_DROP_UNKNOWN_TYPE
+    "bad dest",         // NET_DROP_BAD_DEST
+    "late",             // NET_DROP_LATE
+};
+
+/// @brief Clear all counters and forget all peers
+void netstat_reset() {
+    uint32_t gateKey = GateSwi_enter(gateSwi4);
+    memset(&netStats, 0, sizeof(netStats));
+    GateSwi_leave(gateSwi4, gateKey);
+}
+
+void netstat_rx(int32_t bytes) {
+    netStats.rx.packets++;
+    netStats.rx.bytes += bytes;
+}
+
+void netstat_tx(int32_t bytes) {
+    netStats.tx.packets++;
+    netStats.tx.bytes += bytes;
+}
+
+void netstat_drop(NetDirStats *dir, NetDropReason reason) {
+    if (reason < NET_DROP_COUNT) {
+        dir->drops[reason]++;
+    }
+}
+
+/// @brief Record the current NetOutQ depth. Called with gateSwi4 held.
+void netstat_queue_depth(int32_t depth) {
+    if (depth > netStats.queueHighWater) {
+        netStats.queueHighWater = depth;
+    }
+}
+
+/**
+ * @brief Update the per-peer latency, jitter and loss figures for one voice packet.
+ * Called from ListenFxn only, so the peer table has a single writer.
+ * @param addr Sender IP in host byte order
+ * @param seq Header sequence number
+ * @param timestamp Header timestamp (sender's timestamp_us())
+ */
+void netstat_voice_rx(uint32_t addr, uint16_t seq, uint32_t timestamp) {
+    NetPeerStats *peer = NULL;
+    int32_t transit;
+    int i;
+
+    for (i = 0; i < NET_MAX_PEERS; i++) {
+        if (netStats.peers[i].addr == addr) {
+            peer = &netStats.peers[i];
+            break;
+        }
+        if (peer == NULL && netStats.peers[i].addr == 0) {
+            peer = &netStats.peers[i];  // Remember first free slot, keep looking for a match
+        }
+    }
+    if (peer == NULL) {
+        netStats.untrackedPeers++;
+        return;
+    }
+
+    // Sender and receiver clocks are not synchronized, so transit carries a constant
+    // offset. Min/max/avg spread and jitter are still exact; absolute values are only
+    // meaningful when both ends share a clock (loopback).
+    transit = (int32_t)(timestamp_us() - timestamp);
+
+    if (peer->addr == 0) {
+        peer->addr = addr;
+        peer->transitMin = transit;
+        peer->transitMax = transit;
+    } else {
+        int16_t gap = (int16_t)(seq - peer->lastSeq);
+        if (gap <= 0 && gap > -NET_SEQ_RESYNC) {
+            return;     // Reordered, the jitter buffer decides whether it is late
+        }
+        // A large backwards jump means the sender restarted, so follow its new sequence
+        if (gap > 0) {
+            peer->lost += gap - 1;
+        }
+
+        // RFC 3550: J += (|D| - J) / 16, kept scaled by 16
+        int32_t d = transit - peer->transitLast;
+        if (d < 0) d = -d;
+        peer->jitter16 += d - ((peer->jitter16 + 8) >> 4);
+
+        if (transit < peer->transitMin) peer->transitMin = transit;
+        if (transit > peer->transitMax) peer->transitMax = transit;
+    }
+
+    peer->lastSeq = seq;
+    peer->transitLast = transit;
+    peer->transitSum += transit;
+    peer->voicePackets++;
+}
+
+static void print_netstat_dir(const char *name, NetDirStats *dir) {
+    char msg[BUFFER_SIZE];
+    int i;
+
+    sprintf(msg, "%-3s packets: %u  bytes: %u\r\n", name, dir->packets, dir->bytes);
+    AddProgramMessage(msg);
+    for (i = 0; i < NET_DROP_COUNT; i++) {
+        if (dir->drops[i] != 0) {
+            sprintf(msg, "|   dropped (%s): %u\r\n", dropNames[i], dir->drops[i]);
+            AddProgramMessage(msg);
+        }
+    }
+}
+
+void print_netstat() {
+    char msg[MAX_LINE_LENGTH * 2];      // A peer line with full-width counters is over 88 bytes
+    NetStats snapshot;
+    int i;
+
+    // Take a consistent copy so the UART output does not hold the network gate
+    uint32_t gateKey = GateSwi_enter(gateSwi4);
+    memcpy(&snapshot, &netStats, sizeof(snapshot));
+    GateSwi_leave(gateSwi4, gateKey);
+
+    AddProgramMessage("=================================== Netstat ====================================\r\n");
+    print_netstat_dir("RX", &snapshot.rx);
+    print_netstat_dir("TX", &snapshot.tx);
+    sprintf(msg, "TX queue high-water: %d / %d\r\n", snapshot.queueHighWater, NetQueueLen - 1);
+    AddProgramMessage(msg);
+
+    AddProgramMessage("Peer            | Packets | Lost  | Transit us (min/avg/max) | Jitter us\r\n");
+    AddProgramMessage("----------------|---------|-------|--------------------------|----------\r\n");
+    for (i = 0; i < NET_MAX_PEERS; i++) {
+        NetPeerStats *peer = &snapshot.peers[i];
+        if (peer->addr == 0) {
+            continue;
+        }
+        sprintf(msg, "%3d.%3d.%3d.%3d | %7u | %5u | %7d/%7d/%7d | %9u\r\n",
+                (uint8_t)(peer->addr >> 24), (uint8_t)(peer->addr >> 16),
+                (uint8_t)(peer->addr >> 8), (uint8_t)peer->addr,
+                peer->voicePackets, peer->lost,
+                peer->transitMin, (int32_t)(peer->transitSum / peer->voicePackets), peer->transitMax,
+                peer->jitter16 >> 4);
+        AddProgramMessage(msg);
+    }
+    if (snapshot.untrackedPeers != 0) {
+        sprintf(msg, "Untracked voice packets: %u\r\n", snapshot.untrackedPeers);
+        AddProgramMessage(msg);
+    }
+}
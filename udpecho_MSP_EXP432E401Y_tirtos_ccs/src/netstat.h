@@ -0,0 +1,72 @@
+/*
+ * netstat.h
+ *
+ * Counters for the UDP subsystem, displayed by -netstat.
+ * Every update is a handful of integer operations so the counters can stay
+ * enabled in production.
+ */
+
+#ifndef SRC_NETSTAT_H_
+#define SRC_NETSTAT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define NET_MAX_PEERS 8     // Voice senders tracked for latency and jitter
+#define NET_SEQ_RESYNC 32   // Sequence numbers further back than this are a sender restart, not a late block
+
+typedef enum {
+    // Transmit
+    NET_DROP_QUEUE_FULL,    // NetOutQ was full
+    NET_DROP_TOO_LARGE,     // Packet did not fit in a NetOutQ slot
+    NET_DROP_PARSE,         // Text payload address could not be parsed
+    NET_DROP_SENDTO,        // sendto() failed or was short
+
+    // Receive
+    NET_DROP_SHORT,         // Packet shorter than its header claims
+    NET_DROP_UNKNOWN_TYPE,  // Magic matched but the type has no handler
+    NET_DROP_BAD_DEST,      // Voice dest_choice out of range
+    NET_DROP_LATE,          // Voice block arrived after its turn to play
+
+    NET_DROP_COUNT          // Keeps track of the number of drop reasons
+} NetDropReason;
+
+typedef struct NetDirStats {
+    uint32_t packets;
+    uint32_t bytes;
+    uint32_t drops[NET_DROP_COUNT];
+} NetDirStats;
+
+typedef struct NetPeerStats {
+    uint32_t addr;          // Peer IP (host byte order), 0 = unused slot
+    uint32_t voicePackets;
+    uint32_t lost;          // Blocks missing according to sequence gaps
+    uint16_t lastSeq;
+    int32_t  transitLast;   // Arrival time - header timestamp (us)
+    int32_t  transitMin;
+    int32_t  transitMax;
+    int64_t  transitSum;
+    uint32_t jitter16;      // RFC 3550 inter-arrival jitter estimate, us * 16
+} NetPeerStats;
+
+typedef struct NetStats {
+    NetDirStats rx;
+    NetDirStats tx;
+    int32_t queueHighWater;             // Most NetOutQ slots in use at once
+    uint32_t untrackedPeers;            // Voice packets from senders beyond NET_MAX_PEERS
+    NetPeerStats peers[NET_MAX_PEERS];
+} NetStats;
+
+extern NetStats netStats;
+
+void netstat_reset();
+
+void netstat_rx(int32_t bytes);
+void netstat_tx(int32_t bytes);
+void netstat_drop(NetDirStats *dir, NetDropReason reason);
+void netstat_queue_depth(int32_t depth);
+void netstat_voice_rx(uint32_t addr, uint16_t seq, uint32_t timestamp);
+
+void print_netstat();
+
+#endif /* SRC_NETSTAT_H_ */
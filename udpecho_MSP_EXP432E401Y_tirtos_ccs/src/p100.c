@@ -37,6 +37,7 @@
 #include <stddef.h>
 #include <string.h>
 #include <stdio.h>
+#include <ctype.h>
 
 // Driver Header files
 #include <ti/drivers/GPIO.h>
@@ -69,6 +70,21 @@
 #include "tickers.h"
 #include "register.h"
 #include "script.h"
+#include "scriptvm.h"
+#include "flashstore.h"
+#include "storage.h"
+#include "profile.h"
+#include "scriptimage.h"
+#include "watch.h"
+#include "var.h"
+#include "shadow.h"
+#include "vtimer.h"
+#include "latency.h"
+#include "timestamp.h"
+#include "cpuload.h"
+#include "memstat.h"
+#include "atomic.h"
+#include "netregs.h"
 
 #ifdef Globals
 extern Globals glo;
@@ -104,7 +120,9 @@ void init_globals() {
         glo.inputBuffer_uart1[i] = 0;
     }
 
-    glo.scriptPointer = -1;  // No script loaded
+    glo.scriptContext = -1;  // No script running
+    glo.payloadSource = CONSOLE_UART;
+    init_shadow_registers();
 
 
     // BIOS Tasks
@@ -205,6 +223,7 @@ void init_drivers() {
     glo.uartParams1.readDataMode = UART_DATA_BINARY;
     glo.uartParams1.readReturnMode = UART_RETURN_FULL;
     glo.uartParams1.baudRate = 115200;
+    glo.uartParams1.readTimeout = UART1_READ_TIMEOUT_MS;  // Clock ticks are 1 ms, lets a cut frame be dropped
     glo.uart1 = UART_open(CONFIG_UART_1, &glo.uartParams1);
 
     if (glo.uart1 == NULL) {
@@ -298,7 +317,7 @@ const char* errorMessages[] = {
 
     "Error: Invalid syntax for -if command.\r\n",                   // ERR_INVALID_IF_SYNTAX
     "Error: Missing destinations in -if command.\r\n",              // ERR_MISSING_DESTINATION
-    "Error: Invalid condition operator.\r\n",                       // ERR_INVALID_CONDITION
+    "Error: Invalid condition.\r\n",                                // ERR_INVALID_CONDITION
     "Error: UART 7 write failed.\r\n",                              // ERR_UART1_WRITE_FAILED
 
 };
@@ -387,12 +406,8 @@ void emergency_stop() {
     UInt hwi_key = Hwi_disable();
     UInt swi_key = Swi_disable();
 
-    // Stop the timer
-    gateKey = GateSwi_enter(gateSwi0);
-    Timer_stop(glo.Timer0);
-    glo.Timer0Period = 0;
-    Timer_setPeriod(glo.Timer0, Timer_PERIOD_US, 0);  // Set period to 0 to stop timer
-    GateSwi_leave(gateSwi0, gateKey);
+    // Stop the virtual timers and Timer0
+    vtimer_stop_all();
 
     // Clear the tickers
     for (i = 0; i < MAX_TICKERS; i++) {
@@ -412,16 +427,19 @@ void emergency_stop() {
     }
     GateSwi_leave(gateSwi2, gateKey);
 
+    watch_clear_all();
+    netregs_clear();
+
     gateKey = GateSwi_enter(gateSwi1);
     // Clear the payload queue
     while (!Queue_empty(glo.bios.PayloadQueue)) {
         Queue_Elem *elem = Queue_get(glo.bios.PayloadQueue);
         PayloadMessage *message = (PayloadMessage *)elem;
-        Memory_free(NULL, message->data, strlen(message->data) + 1);
-        Memory_free(NULL, message, sizeof(PayloadMessage));
+        mem_free(message->data, strlen(message->data) + 1);
+        mem_free(message, sizeof(PayloadMessage));
     }
     Semaphore_reset(glo.bios.PayloadSem, 0);  // Reset the semaphore count (no payloads to execute)
-    glo.scriptPointer = -1;  // Reset the script pointer to disable script execution
+    script_kill_all();  // Stop every script context
     GateSwi_leave(gateSwi1, gateKey);
 
     gateKey = GateSwi_enter(gateSwi3);
@@ -429,8 +447,8 @@ void emergency_stop() {
     while (!Queue_empty(glo.bios.OutMsgQueue)) {
         Queue_Elem *elem = Queue_get(glo.bios.OutMsgQueue);
         PayloadMessage *message = (PayloadMessage *)elem;
-        Memory_free(NULL, message->data, strlen(message->data) + 1);
-        Memory_free(NULL, message, sizeof(PayloadMessage));
+        mem_free(message->data, strlen(message->data) + 1);
+        mem_free(message, sizeof(PayloadMessage));
     }
     Semaphore_reset(glo.bios.UARTWriteSem, 0);  // Reset the semaphore count (no messages to write)
     GateSwi_leave(gateSwi3, gateKey);
@@ -463,20 +481,36 @@ void emergency_stop() {
 // Utility
 //================================================
 
-// Custom string duplication function using Memory_alloc
+// Custom string duplication function using mem_alloc
 char *memory_strdup(const char *src) {
     if (src == NULL) {
         return NULL;
     }
 
     size_t len = strlen(src) + 1; // +1 for the null terminator
-    char *dst = (char *)Memory_alloc(NULL, len, 0, NULL);
+    char *dst = (char *)mem_alloc(len);
     if (dst != NULL) {
         strcpy(dst, src);
     }
     return dst;
 }
 
+/// @return Instance name of a task or Swi from release.cfg, NULL for one created at runtime
+const char *bios_object_name(const void *handle) {
+    if (handle == NULL)                             return NULL;
+    if (handle == Task_getIdleTask())               return "Idle";
+    if (handle == glo.bios.UARTReader0)             return "UARTReader0";
+    if (handle == glo.bios.UARTReader1)             return "UARTReader1";
+    if (handle == glo.bios.UARTWriter)              return "UARTWriter";
+    if (handle == glo.bios.PayloadExecutor)         return "PayloadExecutor";
+    if (handle == glo.bios.TickerProcessor)         return "TickerProcessor";
+    if (handle == ADCStreamer)                      return "ADCStreamer";
+    if (handle == glo.bios.Timer0_swi)              return "Timer0_swi";
+    if (handle == glo.bios.SW1_swi)                 return "SW1_swi";
+    if (handle == glo.bios.SW2_swi)                 return "SW2_swi";
+    return NULL;
+}
+
 int isPrintable(char ch) { return (ch >= 32 && ch <= 126); }  // ASCII printable characters
 
 bool isNumeric(const char *str) {
@@ -601,26 +635,34 @@ char *strtok_r(char *str, const char *delim, char **saveptr) {
 
 void AddProgramMessage(char *data) {
 
+    // Output of a payload typed into a TCP console goes back to that console
+    if (console_capture(data)) {
+        return;
+    }
+
     uint16_t gateKey = GateSwi_enter(gateSwi3);  // Enter the gate to protect the queue
-    if(Semaphore_getCount(glo.bios.UARTWriteSem) >= MAX_QUEUE_SIZE) {
+    if(Semaphore_getCount(glo.bios.UARTWriteSem) >= shadowRegisters[SHADOW_OUTQ_MAX]) {
         raiseError(ERR_PAYLOAD_QUEUE_OF); // Can't display error if queue is full!
         GateSwi_leave(gateSwi3, gateKey);  // Leave the gate
         return;  // Do not add message in case of overflow
     }
 
-    PayloadMessage *message = (PayloadMessage *)Memory_alloc(NULL, sizeof(PayloadMessage), 0, NULL);
+    // Out of heap the message is dropped, memStats.failed counts it (-mem)
+    PayloadMessage *message = (PayloadMessage *)mem_alloc(sizeof(PayloadMessage));
     if (message == NULL) {
-        //System_abort("Failed to allocate memory for message");
-        while(1);
+        GateSwi_leave(gateSwi3, gateKey);
+        return;
     }
 
     message->data = memory_strdup(data);
     message->isProgramOutput = true;
+    message->source = CONSOLE_UART;
+    message->profile = PROFILE_NONE;
 
     if (message->data == NULL) {
-        Memory_free(NULL, message, sizeof(PayloadMessage));
-        //System_abort("Failed to allocate memory for message data");
-        while(1);
+        mem_free(message, sizeof(PayloadMessage));
+        GateSwi_leave(gateSwi3, gateKey);
+        return;
     }
 
     Queue_put(glo.bios.OutMsgQueue, &(message->elem));
@@ -632,23 +674,27 @@ void AddProgramMessage(char *data) {
 void AddOutMessage(const char *data) {
 
     uint16_t gateKey = GateSwi_enter(gateSwi3);  // Enter the gate to protect the queue
-    if(Semaphore_getCount(glo.bios.UARTWriteSem) >= MAX_QUEUE_SIZE) {
+    if(Semaphore_getCount(glo.bios.UARTWriteSem) >= shadowRegisters[SHADOW_OUTQ_MAX]) {
         raiseError(ERR_PAYLOAD_QUEUE_OF); // Can't display error if queue is full!
         GateSwi_leave(gateSwi3, gateKey);  // Leave the gate
         return;  // Do not add message in case of overflow
     }
 
-    PayloadMessage *message = (PayloadMessage *)Memory_alloc(NULL, sizeof(PayloadMessage), 0, NULL);
+    PayloadMessage *message = (PayloadMessage *)mem_alloc(sizeof(PayloadMessage));
     if (message == NULL) {
-        System_abort("Failed to allocate memory for message");
+        GateSwi_leave(gateSwi3, gateKey);
+        return;
     }
 
     message->data = memory_strdup(data);
     message->isProgramOutput = false;
+    message->source = CONSOLE_UART;
+    message->profile = PROFILE_NONE;
 
     if (message->data == NULL) {
-        Memory_free(NULL, message, sizeof(PayloadMessage));
-        System_abort("Failed to allocate memory for message data");
+        mem_free(message, sizeof(PayloadMessage));
+        GateSwi_leave(gateSwi3, gateKey);
+        return;
     }
 
     Queue_put(glo.bios.OutMsgQueue, &(message->elem));
@@ -753,7 +799,9 @@ void handle_UART0() {
         if (glo.cursor_pos < BUFFER_SIZE - 1) {
             glo.inputBuffer_uart0[glo.cursor_pos++] = key_in;
             glo.inputBuffer_uart0[glo.cursor_pos] = '\0';
-            AddOutMessage(&key_in);  // Use AddOutMessage to echo the character
+            if (shadowRegisters[SHADOW_ECHO]) {
+                AddOutMessage(&key_in);  // Use AddOutMessage to echo the character
+            }
         } else {
             AddOutMessage("\r\n");  // Move to a new line
             reset_buffer();
@@ -842,7 +890,15 @@ void handle_UART1() {
         glo.cursor_pos_uart1 = 0;
     }
 
-    UART_read(glo.uart1, &key_in, 1);
+    if (UART_read(glo.uart1, &key_in, 1) != 1) {
+        return;     // Read timed out, nothing typed
+    }
+
+    // A binary packet can only start a line, text never contains the first magic byte
+    if ((uint8_t)key_in == NETPKT_MAGIC0 && glo.cursor_pos_uart1 == 0) {
+        handle_UART1_packet();
+        return;
+    }
 
     if (key_in == '\r' || key_in == '\n') {  // Enter key
         if(glo.cursor_pos_uart1 > 0) {
@@ -873,6 +929,43 @@ void handle_UART1() {
     }
 }
 
+/**
+ * @brief Reads the rest of a binary packet whose first magic byte was just read.
+ * Only NETPKT_SCRIPT packets are accepted on UART1; the header says how many
+ * bytes follow, so the data may contain any byte value. A frame that stops short
+ * for UART1_READ_TIMEOUT_MS is dropped, so a stray magic byte or a cut transfer
+ * costs at most that long before the reader is back to text.
+ */
+void handle_UART1_packet() {
+    static uint32_t frame[(sizeof(NetPacketHeader) + sizeof(ScriptImageChunk) + SCRIPT_IMAGE_CHUNK + 3) / 4];
+    NetPacketHeader *hdr = (NetPacketHeader *)frame;
+    ScriptImageChunk *chunk = (ScriptImageChunk *)(hdr + 1);
+    char *bytes = (char *)frame;
+
+    bytes[0] = (char)NETPKT_MAGIC0;
+    if (UART_read(glo.uart1, &bytes[1], sizeof(NetPacketHeader) - 1) != sizeof(NetPacketHeader) - 1) {
+        script_image_reject("frame cut short on UART7");
+        return;
+    }
+    if (hdr->magic[1] != NETPKT_MAGIC1 || hdr->type != NETPKT_SCRIPT) {
+        AddProgramMessage("Error: Unsupported packet on UART7.\r\n");
+        return;
+    }
+    if (UART_read(glo.uart1, chunk, sizeof(ScriptImageChunk)) != sizeof(ScriptImageChunk)) {
+        script_image_reject("frame cut short on UART7");
+        return;
+    }
+    if (chunk->length > SCRIPT_IMAGE_CHUNK) {
+        script_image_reject("chunk too long on UART7");
+        return;
+    }
+    if (UART_read(glo.uart1, chunk + 1, chunk->length) != chunk->length) {
+        script_image_reject("frame cut short on UART7");
+        return;
+    }
+    script_image_receive(bytes, sizeof(NetPacketHeader) + sizeof(ScriptImageChunk) + chunk->length);
+}
+
 void reset_buffer_uart1() {
     // Reset the cursor position for UART1 input buffer
     glo.cursor_pos_uart1 = 0;
@@ -895,6 +988,14 @@ void reset_buffer_uart1() {
     Semaphore_post(glo.bios.PayloadSem);  // Post to Semaphore ready to execute
 }*/
 void AddPayload(char *payload) {
+    AddPayloadSource(payload, console_source());    // Payloads queued by a command answer to the same console
+}
+
+void AddPayloadSource(char *payload, int32_t source) {
+    AddPayloadTagged(payload, source, PROFILE_NONE);
+}
+
+void AddPayloadTagged(char *payload, int32_t source, int32_t profile) {
 
     uint16_t gateKey = GateSwi_enter(gateSwi1);
     if(Semaphore_getCount(glo.bios.PayloadSem) >= MAX_QUEUE_SIZE) {
@@ -903,20 +1004,23 @@ void AddPayload(char *payload) {
         return;  // Do not add payload in case of overflow
     }
 
-    // Allocate memory for the message structure
-    PayloadMessage *message = (PayloadMessage *)Memory_alloc(NULL, sizeof(PayloadMessage), 0, NULL);
+    // Allocate memory for the message structure, out of heap the payload is dropped
+    PayloadMessage *message = (PayloadMessage *)mem_alloc(sizeof(PayloadMessage));
     if (message == NULL) {
-        //System_abort("Failed to allocate memory for payload message");
-        while (1); 
+        GateSwi_leave(gateSwi1, gateKey);
+        return;
     }
 
-    // Duplicate the payload string using Memory_alloc
+    // Duplicate the payload string using mem_alloc
     message->data = memory_strdup(payload);
     if (message->data == NULL) {
-        Memory_free(NULL, message, sizeof(PayloadMessage));
-        //System_abort("Failed to allocate memory for payload data");
-        while(1);
+        mem_free(message, sizeof(PayloadMessage));
+        GateSwi_leave(gateSwi1, gateKey);
+        return;
     }
+    message->source = source;
+    message->profile = profile;
+    message->queued = timestamp_now();
 
     // Add the message to the queue
     Queue_put(glo.bios.PayloadQueue, &(message->elem));
@@ -952,12 +1056,22 @@ void execute_payload(char *msg) {
     else if (strcmp(token,      "-callback") == 0) {
         CMD_callback(&saveptr);
     }
+    else if (strcmp(token,      "-cpu") == 0) {
+        CMD_cpu(&saveptr);
+    }
     else if (strcmp(token,      "-dial") == 0) {
         CMD_dial(&saveptr);
     }
     else if (strcmp(token,      "-error") == 0) {
         CMD_error(&saveptr);
     }
+    else if (strcmp(token,      "-fec") == 0) {
+        CMD_fec(&saveptr);
+    }
+    else if (strcmp(token,      "-goto") == 0 || strcmp(token, "-call") == 0
+             || strcmp(token,   "-ret") == 0  || strcmp(token, "-loop") == 0) {
+        CMD_flow(&saveptr);
+    }
     else if (strcmp(token,      "-gpio") == 0) {
         CMD_gpio(&saveptr);
     }
@@ -967,9 +1081,24 @@ void execute_payload(char *msg) {
     else if (strcmp(token,      "-if") == 0) {
         CMD_if(&saveptr);
     }
+    else if (strcmp(token,      "-lat") == 0) {
+        CMD_lat(&saveptr);
+    }
+    else if (strcmp(token,      "-load") == 0) {
+        CMD_load(&saveptr);
+    }
+    else if (strcmp(token,      "-mem") == 0) {
+        CMD_mem(&saveptr);
+    }
     else if (strcmp(token,      "-memr") == 0) {
         CMD_memr(&saveptr);
     }
+    else if (strcmp(token,      "-netstat") == 0) {
+        CMD_netstat(&saveptr);
+    }
+    else if (strcmp(token,      "-plc") == 0) {
+        CMD_plc(&saveptr);
+    }
     else if (strcmp(token,      "-print") == 0) {
         CMD_print(&saveptr);
     }
@@ -979,9 +1108,15 @@ void execute_payload(char *msg) {
     else if (strcmp(token,      "-rem") == 0) {
         CMD_rem(&saveptr);
     }
+    else if (strcmp(token,      "-save") == 0) {
+        CMD_save(&saveptr);
+    }
     else if (strcmp(token,      "-script") == 0) {
         CMD_script(&saveptr);
     }
+    else if (strcmp(token,      "-shadow") == 0) {
+        CMD_shadow(&saveptr);
+    }
     else if(strcmp(token,       "-stream") == 0) {
         CMD_stream(&saveptr);
     }
@@ -997,6 +1132,15 @@ void execute_payload(char *msg) {
     else if (strcmp(token,      "-uart") == 0) {
         CMD_uart(&saveptr);
     }
+    else if (strcmp(token,      "-vtimer") == 0) {
+        CMD_vtimer(&saveptr);
+    }
+    else if (strcmp(token,      "-var") == 0) {
+        CMD_var(&saveptr);
+    }
+    else if (strcmp(token,      "-watch") == 0) {
+        CMD_watch(&saveptr);
+    }
     // -voice has been voted off the island for not following the rules
     // else if (strcmp(token,      "-voice") == 0) {
     //     ParseVoice(msgBufferCopy);
@@ -1073,6 +1217,7 @@ void CMD_audio(char **saveptr) {
                     } else {
                         glo.audioController.txBufControl[i].TX_Completed = glo.audioController.txBufControl[i].TX_Ping;
                     }
+                    VoicePlayoutBlock(i);
                 }
             }
         }
@@ -1117,7 +1262,7 @@ void CMD_callback(char **saveptr) {
     } else {
         //AddProgramMessage(raiseError(ERR_MISSING_COUNT_PARAMETER));
 CLEAR:
-        AddProgramMessage("Clearing callback.\r\n");
+        LOG(CMD, LOG_INFO, "Clearing callback.\r\n");
         gateKey = GateSwi_enter(gateSwi2);
         callbacks[index].count = 0;
         memset(callbacks[index].payload, 0, BUFFER_SIZE);
@@ -1140,11 +1285,30 @@ CLEAR:
     // Set the count
     callbacks[index].count = count;
 
-    // Acknowledge
-    char msg[BUFFER_SIZE];
-    sprintf(msg, "Callback %d set with count %d and payload: %s\r\n", index, count, callbacks[index].payload);
     GateSwi_leave(gateSwi2, gateKey);
-    AddProgramMessage(msg);
+
+    // Acknowledge
+    LOG(CMD, LOG_INFO, "Callback %d set with count %d and payload: %s\r\n", index, count, payload_start);
+}
+
+/// @brief Displays the CPU load, or starts, stops or resets the accounting
+void CMD_cpu(char **saveptr) {
+    char *arg = strtok_r(NULL, " \t\r\n", saveptr);
+
+    if (arg == NULL) {
+        print_cpuload();
+    } else if (strcmp(arg, "on") == 0) {
+        cpuload_enable(true);
+        AddProgramMessage("CPU load accounting on.\r\n");
+    } else if (strcmp(arg, "off") == 0) {
+        cpuload_enable(false);
+        AddProgramMessage("CPU load accounting off.\r\n");
+    } else if (strcmp(arg, "r") == 0) {
+        cpuload_reset();
+        AddProgramMessage("CPU load window cleared.\r\n");
+    } else {
+        AddProgramMessage("Usage: -cpu [on | off | r]\r\n");
+    }
 }
 
 void CMD_error(char **saveptr) {
@@ -1160,6 +1324,64 @@ void CMD_error(char **saveptr) {
     }
 }
 
+/// @brief Configures voice FEC per dial target and the receive jitter depth
+void CMD_fec(char **saveptr) {
+    char *arg = strtok_r(NULL, " \t\r\n", saveptr);
+    char *modeArg, *kArg;
+    char msg[BUFFER_SIZE];
+    int target, mode, k;
+
+    if (arg == NULL) {
+        print_voice_stats();
+        return;
+    }
+
+    if (strcmp(arg, "r") == 0) {
+        memset(voiceRxStats, 0, sizeof(voiceRxStats));
+        AddProgramMessage("FEC statistics cleared.\r\n");
+        return;
+    }
+
+    if (strcmp(arg, "depth") == 0) {
+        kArg = strtok_r(NULL, " \t\r\n", saveptr);
+        if (kArg == NULL) {
+            AddProgramMessage("Usage: -fec depth <blocks>\r\n");
+            return;
+        }
+        VoiceSetDepth(atoi(kArg));
+        sprintf(msg, "Jitter depth set to %d blocks.\r\n", VoiceGetDepth());
+        AddProgramMessage(msg);
+        return;
+    }
+
+    target = atoi(arg);
+    modeArg = strtok_r(NULL, " \t\r\n", saveptr);
+    kArg = strtok_r(NULL, " \t\r\n", saveptr);
+    if ((target != 1 && target != 2) || modeArg == NULL) {
+        AddProgramMessage("Usage: -fec [1|2] [off|red|xor] [K]\r\n");
+        return;
+    }
+
+    for (mode = 0; mode < FEC_MODE_COUNT; mode++) {
+        if (strcmp(modeArg, fecModeNames[mode]) == 0) {
+            break;
+        }
+    }
+    if (mode == FEC_MODE_COUNT) {
+        AddProgramMessage("Usage: -fec [1|2] [off|red|xor] [K]\r\n");
+        return;
+    }
+
+    k = kArg ? atoi(kArg) : FEC_DEFAULT_K;
+    fec_encoder_init(&fecTx[target - 1], (FecMode)mode, k);
+    if (mode == FEC_XOR) {
+        sprintf(msg, "Dial %d FEC set to xor, K = %d.\r\n", target, fecTx[target - 1].k);
+    } else {
+        sprintf(msg, "Dial %d FEC set to %s.\r\n", target, fecModeNames[mode]);
+    }
+    AddProgramMessage(msg);
+}
+
 // Set the REG_DIAL1 register to the provided IP address and start streaming voice data to that address
 void CMD_dial(char **saveptr) {
     char *arg = strtok_r(NULL, " \t\r\n", saveptr);
@@ -1169,8 +1391,10 @@ void CMD_dial(char **saveptr) {
     }
 
     if(strcmp(arg, "0") == 0) {
-        registers[REG_DIAL1] = 0;
-        registers[REG_DIAL2] = 0;
+        atomic32_store(&registers[REG_DIAL1], 0);
+        atomic32_store(&registers[REG_DIAL2], 0);
+        watch_notify(REG_DIAL1);
+        watch_notify(REG_DIAL2);
         AddProgramMessage("DIAL set to 0. Streaming stopped.\r\n");
         execute_payload("-stream 0");
         return;
@@ -1211,7 +1435,8 @@ void CMD_dial(char **saveptr) {
     uint16_t port_host_order = NDK_ntohs(clientAddr.sin_port);
 
     // Store IP and Port into the registers
-    registers[REG_DIAL1] = ip_host_order;
+    atomic32_store(&registers[REG_DIAL1], ip_host_order);
+    watch_notify(REG_DIAL1);
 
     char msg[128];
     sprintf(msg, "DIAL set to %d.%d.%d.%d:%d\r\n",
@@ -1332,6 +1557,23 @@ void CMD_help(char **saveptr) {
             "| Example usage: \"-callback 1\" -> Clears the SW1 callback.\r\n";
 
     }
+    else if (strcmp(cmd_arg_token,      "cpu") == 0 || strcmp(cmd_arg_token,            "-cpu") == 0) {
+        helpMessage =
+           //================================================================================ <-80 characters
+            "Command: -cpu [on | off | r]\r\n"
+            "| args:\r\n"
+            "| | on/off: Start or stop the load accounting.\r\n"
+            "| | r: Forget the measured window.\r\n"
+            "| Description: Displays the CPU load and the load of each Task, Swi and Hwi\r\n"
+            "| |            over the last second, in 100 ms steps. Hooks time every task\r\n"
+            "| |            switch and every Swi and Hwi, and the CPU load is all time\r\n"
+            "| |            not spent in the Idle task.\r\n"
+            "| Note: Accounting costs under 1% of the CPU and may be left on. The totals\r\n"
+            "| |     are glo fields cpuLoad, swiLoad and hwiLoad of the UDP register\r\n"
+            "| |     service, so a NETREGS_SUBSCRIBE streams them (netregs.h).\r\n"
+            "| Example usage: \"-cpu on\" -> Starts measuring.\r\n"
+            "| Example usage: \"-cpu\" -> Displays the load table.\r\n";
+    }
     else if(strcmp(cmd_arg_token,       "dial") == 0 || strcmp(cmd_arg_token,            "-dial") == 0) {
         helpMessage =
            //================================================================================ <-80 characters
@@ -1354,6 +1596,27 @@ void CMD_help(char **saveptr) {
             "| Description: Displays number of times that each error type has triggered.\r\n"
             "| Example usage: \"-error\" -> Displays error count by type.\r\n";
 
+    }
+    else if (strcmp(cmd_arg_token,      "fec") == 0 || strcmp(cmd_arg_token,             "-fec") == 0) {
+        helpMessage =
+           //================================================================================ <-80 characters
+            "Command: -fec [target] [mode] [K]\n\r"
+            "| args:\n\r"
+            "| | target: Dial target 1 (REG_DIAL1) or 2 (REG_DIAL2).\r\n"
+            "| | mode: off : Voice packets only.\r\n"
+            "| |       red : Each packet also carries a low-bitrate copy of the previous\r\n"
+            "| |             block (+27% bandwidth). Needs a jitter depth of 2 or more.\r\n"
+            "| |       xor : A parity packet after every K blocks (+1/K bandwidth).\r\n"
+            "| |             Needs a jitter depth of at least K + 1.\r\n"
+            "| | K: XOR group size (2 to 8, default 4).\r\n"
+            "| Description: Adds forward error correction to the voice stream sent to a\r\n"
+            "|              dial target. The receiver rebuilds a lost block in its jitter\r\n"
+            "|              buffer before the block is due to play. Without arguments,\r\n"
+            "|              displays the configuration and receive statistics.\r\n"
+            "| Example usage: \"-fec 1 xor 4\" -> Parity every 4 blocks to dial target 1.\r\n"
+            "| Special Case:  \"-fec depth 3\" -> Buffer 3 received blocks (48 ms).\r\n"
+            "| Special Case:  \"-fec r\" -> Clears the receive statistics.\r\n";
+
     }
     else if (strcmp(cmd_arg_token,      "gpio") == 0  || strcmp(cmd_arg_token,           "-gpio") == 0) {
         helpMessage =
@@ -1384,21 +1647,50 @@ void CMD_help(char **saveptr) {
     else if(strcmp(cmd_arg_token,       "if") == 0  || strcmp(cmd_arg_token,              "-if") == 0) {
         helpMessage =
            //================================================================================ <-80 characters
-            "Command: -if (A COND B) ? DESTT : DESTF\n\r"
+            "Command: -if EXPR ? DESTT : DESTF\n\r"
             "| args:\n\r"
-            "| | A: The first operand, which can be a register or an immediate value\r\n"
-            "| |    (#value)\r\n"
-            "| | COND: The condition to evaluate. Acceptable values are >, =, or <.\r\n"
-            "| | B: The second operand, which can be a register or an immediate value\r\n"
-            "| |    (#value).\r\n"
+            "| | EXPR: Integer expression, true when not 0. Operands are registers (R3),\r\n"
+            "| |    immediate values (#value), memory (@0x20000000) and, in scripts, p0-p7.\r\n"
+            "| |    Operators: ( ) ! - ~ * / % + - < <= > >= == = != & ^ | && ||\r\n"
             "| | DESTT: The payload to execute if the condition is true. Can be null.\r\n"
             "| | DESTF: The payload to execute if the condition is false. Can be null.\r\n"
-            "| Description: Executes a payload based on the condition.\r\n"
+            "| Description: Executes a payload based on the condition. Script lines compile\r\n"
+            "| | the expression when they are written.\r\n"
             "| Example usage: \"-if (10 > #0) ? -script 5 : -print FALSE\" -> Executes script\r\n"
             "|                 line 5 if the contents of register 10 are greater than 0,\r\n"
-            "|                 otherwise prints FALSE.\r\n";
+            "|                 otherwise prints FALSE.\r\n"
+            "| Example usage: \"-if R1 >= #10 && R2 % #4 != #0 ? -print yes\"\r\n";
 
     }
+    else if (strcmp(cmd_arg_token,      "lat") == 0 || strcmp(cmd_arg_token,            "-lat") == 0) {
+        helpMessage =
+           //================================================================================ <-80 characters
+            "Command: -lat [r]\r\n"
+            "| args:\r\n"
+            "| | r: Reset all latency histograms.\r\n"
+            "| Description: Displays how long work waits between being signalled and\r\n"
+            "| |            being served, as a histogram in power of two buckets:\r\n"
+            "| |            Timer0 Hwi to its Swi, AddPayload to the executor, the ADC\r\n"
+            "| |            callback to ADCStream and the network queue to sendto().\r\n"
+            "| Note: Times come from the 120 MHz timestamp timer, 1/120 us resolution.\r\n"
+            "| Example usage: \"-lat\" -> Displays count, min/avg/max and histograms.\r\n"
+            "| Example usage: \"-lat r\" -> Clears the histograms.\r\n";
+    }
+    else if (strcmp(cmd_arg_token,      "mem") == 0 || strcmp(cmd_arg_token,            "-mem") == 0) {
+        helpMessage =
+           //================================================================================ <-80 characters
+            "Command: -mem\r\n"
+            "| Description: Displays where RAM goes: the stack size and high-water mark\r\n"
+            "| |            of each task, the peak of the Hwi/Swi system stack, HeapMem\r\n"
+            "| |            total, free and largest free block, the count of payload\r\n"
+            "| |            and message allocations with the failed ones, and the\r\n"
+            "| |            sizes of the largest static tables.\r\n"
+            "| Note: The high-water mark is found from the fill pattern of the stack, so\r\n"
+            "| |     it covers the deepest call since boot. Stacks at 90% or more are\r\n"
+            "| |     flagged. A free total much larger than the largest block means the\r\n"
+            "| |     heap is fragmented.\r\n"
+            "| Example usage: \"-mem\" -> Displays the memory report.\r\n";
+    }
     else if (strcmp(cmd_arg_token,      "memr") == 0  || strcmp(cmd_arg_token,           "-memr") == 0) {
         helpMessage =
            //================================================================================ <-80 characters
@@ -1410,6 +1702,23 @@ void CMD_help(char **saveptr) {
             "| Example usage: \"-memr 1000\" -> Displays the contents of address 0x1000.\r\n";
 
     }
+    else if (strcmp(cmd_arg_token,      "netstat") == 0 || strcmp(cmd_arg_token,        "-netstat") == 0) {
+        helpMessage =
+           //================================================================================ <-80 characters
+            "Command: -netstat [r]\n\r"
+            "| args:\n\r"
+            "| | r: Reset all network counters and forget all peers.\r\n"
+            "| Description: Displays UDP packet and byte counts per direction, drops by\r\n"
+            "|              reason, the transmit queue high-water mark, and per-peer voice\r\n"
+            "|              loss, one-way transit time and inter-arrival jitter.\r\n"
+            "|              Also lists the subscribers of the binary register service\r\n"
+            "|              (NETPKT_REGS, see netregs.h), which reads, writes and pushes\r\n"
+            "|              registers over UDP without using the console.\r\n"
+            "| Note: Board clocks are not synchronized, so transit includes a fixed offset.\r\n"
+            "|       The min/max spread and jitter are unaffected.\r\n"
+            "| Example usage: \"-netstat\" -> Displays network statistics.\r\n"
+            "| Example usage: \"-netstat r\" -> Clears network statistics.\r\n";
+    }
     else if (strcmp(cmd_arg_token, "netudp") == 0 || strcmp(cmd_arg_token, "-netudp") == 0) {
     helpMessage =
        //================================================================================ <-80 characters
@@ -1421,6 +1730,22 @@ void CMD_help(char **saveptr) {
         "| Example usage: \"-netudp 192.168.1.100:1000\" -> Sends a UDP packet to\r\n"
         "| 192.168.1.100 on port 1000.\r\n";
     }
+    else if (strcmp(cmd_arg_token,      "plc") == 0  || strcmp(cmd_arg_token,            "-plc") == 0) {
+        helpMessage =
+           //================================================================================ <-80 characters
+            "Command: -plc [mode]\n\r"
+            "| args:\n\r"
+            "| | mode: off    : Replay the stale buffer when a voice block is lost.\r\n"
+            "| |       repeat : Repeat the last block, fading out over 60 ms.\r\n"
+            "| |       pitch  : Repeat the last pitch periods (G.711 Appendix I style),\r\n"
+            "| |                attenuating after 10 ms. Default.\r\n"
+            "| |       r      : Reset the concealment statistics.\r\n"
+            "| Description: Selects packet loss concealment for received voice. Without\r\n"
+            "|              arguments, displays the mode and per-channel statistics\r\n"
+            "|              including the concealment cost per block.\r\n"
+            "| Example usage: \"-plc repeat\" -> Use repeat with fade.\r\n";
+
+    }
     else if (strcmp(cmd_arg_token,      "print") == 0  || strcmp(cmd_arg_token,          "-print") == 0) {
         helpMessage =
            //================================================================================ <-80 characters
@@ -1451,14 +1776,97 @@ void CMD_help(char **saveptr) {
             "| | rem dest src        : Remainder of dest divided by src.\r\n"
             "| | max dest src        : Set dest to max of dest and src.\r\n"
             "| | min dest src        : Set dest to min of dest and src.\r\n"
+            "| Vector operations (range = rA:B, eg. r0:7):\r\n"
+            "| | vmov vadd vsub vmul vand vior vxor vmax vmin range src\r\n"
+            "| |                     : Element-wise, src is a range of the same length\r\n"
+            "| |                       or one value applied to every element.\r\n"
+            "| | vscale range #k [#s]: Multiply by k, shift right by s, saturate.\r\n"
+            "| | vsum dest range     : Saturated sum of the range.\r\n"
+            "| | vdot dest rng1 rng2 : Saturated dot product of two ranges.\r\n"
+            "| | vrmax/vrmin dest range : Largest/smallest value in the range.\r\n"
             "| Operands:\r\n"
             "| | Registers: r0 to r31, (0 to 31 also works)\r\n"
-            "| | Immediate: #value or #xvalue\r\n"
+            "| | Immediate: #value or #xvalue, #1.5 or #2e3 for a float\r\n"
             "| | Memory Address: @address\r\n"
+            "| | Variables: $name, see \"-help var\"\r\n"
+            "| | String: \"text\" without blanks\r\n"
+            "| Typed registers:\r\n"
+            "| | l0 to l7 64-bit, f0 to f15 float, s0 to s7 strings (31 characters)\r\n"
+            "| | The destination's type selects the arithmetic, the source is\r\n"
+            "| | converted to it. Floats have no bitwise ops or rem, strings only\r\n"
+            "| | mov, add (append) and xchg. r registers truncate floats.\r\n"
+            "| | -reg l|f|s          : Print a typed bank.\r\n"
             "| Examples:\r\n"
             "| | -reg mov r0 #10     : Set R0 to 10.\r\n"
             "| | -reg add r0 r1      : Add R1 to R0.\r\n"
-            "| | -reg inc r0         : Increment R0.\r\n";
+            "| | -reg inc r0         : Increment R0.\r\n"
+            "| | -reg vadd r0:7 r8:15: Add R8-R15 to R0-R7.\r\n"
+            "| | -reg vsum r16 r0:15 : Set R16 to the sum of R0-R15.\r\n"
+            "| | -reg q inc r0       : Increment R0 without printing the result.\r\n"
+            "| | -reg mul f0 #0.5    : Halve F0.\r\n"
+            "| | -reg mov s1 f0      : Format F0 into S1.\r\n"
+            "| | -reg exec \"mov r1 #5; add r1 r2; max r3 r1\"\r\n"
+            "| |                     : Apply the operations in order and print one\r\n"
+            "| |                       summary of the registers written. The first\r\n"
+            "| |                       failing operation stops the batch.\r\n"
+            "| Note: Results are not printed inside a script run with quiet on, see\r\n"
+            "| |     \"-help script\".\r\n";
+    }
+    else if (strcmp(cmd_arg_token, "goto") == 0 || strcmp(cmd_arg_token, "-goto") == 0
+             || strcmp(cmd_arg_token, "call") == 0 || strcmp(cmd_arg_token, "-call") == 0
+             || strcmp(cmd_arg_token, "ret") == 0 || strcmp(cmd_arg_token, "-ret") == 0
+             || strcmp(cmd_arg_token, "loop") == 0 || strcmp(cmd_arg_token, "-loop") == 0) {
+        helpMessage =
+           //================================================================================ <-80 characters
+            "Command: -goto [T], -call [T], -ret, -loop [Rn] [T]\n\r"
+            "| args:\n\r"
+            "| | T: Script line number or label.\r\n"
+            "| | Rn: Loop counter, a register R0-R31 or private register p0-p7.\r\n"
+            "| Description: Control flow inside scripts. -goto jumps to T, -call jumps to T\r\n"
+            "| | and -ret returns to the line after the -call (up to 8 deep, -ret with no\r\n"
+            "| | -call pending ends the script). -loop decrements Rn and jumps to T\r\n"
+            "| | while Rn is still above 0, so a count of 0 or less runs the body once.\r\n"
+            "| | A line starting with \"name:\" defines the label name.\r\n"
+            "| Examples:\r\n"
+            "| | -script 10 w -reg mov r1 #5\r\n"
+            "| | -script 11 w top: -call blink\r\n"
+            "| | -script 12 w -loop r1 top\r\n"
+            "| | -script 13 w -goto end\r\n"
+            "| | -script 14 w blink: -gpio 0 t\r\n"
+            "| | -script 15 w -ret\r\n"
+            "| | -script 16 w end: -print done\r\n"
+            "| | -script 10 x  : Toggles GPIO 0 five times, then prints done.\r\n";
+    }
+    else if (strcmp(cmd_arg_token, "load") == 0 || strcmp(cmd_arg_token, "-load") == 0) {
+        helpMessage =
+           //================================================================================ <-80 characters
+            "Command: -load [what]\n\r"
+            "| args:\n\r"
+            "| | what: all (default), reg, script, ticker or callback.\r\n"
+            "| Description: Restores state saved in flash with -save. Script lines, tickers\r\n"
+            "| | and callbacks that were not saved are cleared. Loading scripts stops the\r\n"
+            "| | running ones.\r\n"
+            "| Examples:\r\n"
+            "| | -load        : Restore registers, scripts, tickers and callbacks.\r\n"
+            "| | -load script : Restore only the script lines.\r\n";
+    }
+    else if (strcmp(cmd_arg_token, "save") == 0 || strcmp(cmd_arg_token, "-save") == 0) {
+        helpMessage =
+           //================================================================================ <-80 characters
+            "Command: -save [what | boot [on|off|line] | stat | format]\n\r"
+            "| args:\n\r"
+            "| | what: all (default), reg, script, ticker or callback.\r\n"
+            "| Description: Saves state to the on-chip flash store (last 64 KB of flash).\r\n"
+            "| | Only records that changed are written. The CPU stalls while flash is\r\n"
+            "| | programmed, so avoid saving while streaming.\r\n"
+            "| Examples:\r\n"
+            "| | -save           : Save registers, scripts, tickers and callbacks.\r\n"
+            "| | -save ticker    : Save only the tickers.\r\n"
+            "| | -save boot on   : Load the saved state at startup.\r\n"
+            "| | -save boot 10   : Load the saved state, then run script line 10.\r\n"
+            "| | -save boot off  : Start with a blank state.\r\n"
+            "| | -save stat      : Show flash store usage and the boot setting.\r\n"
+            "| | -save format    : Erase the flash store.\r\n";
     }
     else if (strcmp(cmd_arg_token, "rem") == 0 || strcmp(cmd_arg_token, "-rem") == 0) {
         helpMessage =
@@ -1488,7 +1896,48 @@ void CMD_help(char **saveptr) {
             "| | -script 17 x           : Execute script starting from line 17.\r\n"
             "| | -script 17 c           : Clear script line 17.\r\n"
             "| Special Case:\r\n"
-            "| | -script r              : Reset the script pointer to -1 (stops execution).\r\n";
+            "| | -script r              : Stop all running scripts.\r\n"
+            "| | -script list           : List the script contexts, their line, call depth\r\n"
+            "| |                          and private registers p0-p7.\r\n"
+            "| | -script suspend 1      : Suspend script context 1 (resume 1 continues it).\r\n"
+            "| | -script kill 1         : Stop script context 1.\r\n"
+            "| | -script q              : Show the executor quantum and its statistics,\r\n"
+            "| |                          with the gap in which other tasks run.\r\n"
+            "| | -script q 32 1000      : Run up to 32 lines or 1000 us per quantum before\r\n"
+            "| |                          serving a queued payload (0 = no limit).\r\n"
+            "| | -script q r            : Clear the quantum statistics.\r\n"
+            "| | -script prof           : Runs, total and max cycles per line, most\r\n"
+            "| |                          expensive first.\r\n"
+            "| | -script prof reset     : Clear the profile.\r\n"
+            "| | -script prof payloads on : Also profile ticker and callback payloads.\r\n"
+            "| | -script image          : Show the state of the last script upload.\r\n"
+            "| | -script quiet on       : Register operations of scripts started later\r\n"
+            "| |                          print nothing; in a script line it silences\r\n"
+            "| |                          the running script.\r\n"
+            "| Notes: Up to 4 scripts run side by side, each started with \"x\". Inside a\r\n"
+            "| |      script, \"x\" jumps within the script and p0-p7 are its own registers.\r\n"
+            "| |      A line may start with a label, \"-script top x\" runs from label top.\r\n"
+            "| |      tools/script_push.py uploads a whole script file over UDP or UART7\r\n"
+            "| |      in one transfer; it replaces all lines once no script is running.\r\n";
+    }
+    else if (strcmp(cmd_arg_token,     "shadow") == 0 || strcmp(cmd_arg_token,         "-shadow") == 0) {
+        helpMessage =
+           //================================================================================ <-80 characters
+            "Command: -shadow [name] [value]\r\n"
+            "| args:\r\n"
+            "| | name: Shadow register, see the list.\r\n"
+            "| | value: Number, on/off, or off/error/warn/info/debug for log_xxx.\r\n"
+            "| Description: Shadow registers hold system setup apart from R0-R31:\r\n"
+            "| |            log_cmd, log_audio, log_net, log_script: Diagnostics of\r\n"
+            "| |              each subsystem at or below the level are printed.\r\n"
+            "| |            echo: Echo characters typed on the UART console.\r\n"
+            "| |            quiet: Scripts started from now on run quietly.\r\n"
+            "| |            outq_max: Output messages queued before new ones drop.\r\n"
+            "| Example usage: \"-shadow\" -> Displays all shadow registers.\r\n"
+            "| Example usage: \"-shadow log_audio debug\" -> Shows -sine debug output.\r\n"
+            "| Example usage: \"-shadow log_cmd off\" -> Drops -ticker, -callback and\r\n"
+            "| |              -timer acknowledgements.\r\n"
+            "| Special Case: \"-shadow reset\" -> Restores every default.\r\n";
     }
     else if (strcmp(cmd_arg_token,       "sine") == 0 || strcmp(cmd_arg_token,           "-sine") == 0) {
         helpMessage =
@@ -1498,8 +1947,9 @@ void CMD_help(char **saveptr) {
             "| | frequency: Frequency of the sine wave in Hz.\r\n"
             "| Description: Plays a frequency using the BOOST-XL Audio board.\r\n"
             "| Example usage: \"-sine 1000\" -> Plays a 1000 Hz sine wave.\r\n"
-            "| Example usage: \"-sine 0\" -> Stops the sine wave.\r\n";
-            "| Example usage: \"-sine s\" -> Displays the current frequency.\r\n";
+            "| Example usage: \"-sine 0\" -> Stops the sine wave.\r\n"
+            "| Example usage: \"-sine s\" -> Displays the current frequency.\r\n"
+            "| Example usage: \"-sine f2\" -> Plays the frequency in float register F2.\r\n";
             "| Note: The sine wave will play until stopped.\r\n";
     }
     else if (strcmp(cmd_arg_token,      "stop") == 0 || strcmp(cmd_arg_token,           "-stop") == 0) {
@@ -1529,12 +1979,14 @@ void CMD_help(char **saveptr) {
            //================================================================================ <-80 characters
             "Command: -timer [period_us]\n\r"
             "| args:\n\r"
-            "| | period_us: The period of Timer0 in microseconds. Minimum value is 100 us\r\n"
-            "| Description: Sets the period of Timer0 to the specified period in microseconds.\r\n"
-            "| |            If no period is specified, displays the current Timer0 period.\r\n"
-            "| Example usage: \"-timer 100000\" -> Sets Timer0 period to 100,000 us (100 ms).\r\n"
-            "| Example usage: \"-timer\" -> Displays the current Timer0 period.\r\n"
-            "| Example usage: \"-timer 0\" -> Disables the timer\r\n";
+            "| | period_us: The period of callback 0 in microseconds. Minimum value is 100 us\r\n"
+            "| Description: Sets how often callback 0 runs. It is a virtual timer on\r\n"
+            "| |            Timer0 (see \"-help vtimer\"), so -sine, -stream and -vtimer\r\n"
+            "| |            payloads keep their own periods.\r\n"
+            "| |            If no period is specified, displays the current period.\r\n"
+            "| Example usage: \"-timer 100000\" -> Runs callback 0 every 100,000 us (100 ms).\r\n"
+            "| Example usage: \"-timer\" -> Displays the current period and the Timer0 tick.\r\n"
+            "| Example usage: \"-timer 0\" -> Stops callback 0's timer.\r\n";
 
     }
     else if (strcmp(cmd_arg_token,      "ticker") == 0 || strcmp(cmd_arg_token,           "-ticker") == 0) {
@@ -1566,6 +2018,56 @@ void CMD_help(char **saveptr) {
             "| Description: Sends a payload message over UART7 (RX=PC4 & TX=PC5).\r\n"
             "| Example usage: \"-uart -print Hello, World!\" -> Sends -print over UART7.\r\n";
     }
+    else if (strcmp(cmd_arg_token,      "vtimer") == 0 || strcmp(cmd_arg_token,         "-vtimer") == 0) {
+        helpMessage =
+           //================================================================================ <-80 characters
+            "Command: -vtimer [index] [period_us] [count] [payload]\r\n"
+            "| args:\r\n"
+            "| | index: Payload timer, 2 to 7 (0 is -timer, 1 is -sine/-stream).\r\n"
+            "| | period_us: Period in microseconds, 0 stops the timer.\r\n"
+            "| | count: Number of runs, 1 or more, or -1 for no limit.\r\n"
+            "| | payload: Command run from the Timer0 Swi each period.\r\n"
+            "| Description: Timer0 is shared by virtual timers that each keep their own\r\n"
+            "| |            period. It ticks at the greatest common divisor of the\r\n"
+            "| |            active periods, which must be 100 us or more.\r\n"
+            "| Example usage: \"-vtimer 2 1000 -1 -reg q inc r9\" -> Increments R9 every\r\n"
+            "| |              millisecond, alongside 125 us audio.\r\n"
+            "| Example usage: \"-vtimer\" -> Displays the active timers and the tick.\r\n"
+            "| Example usage: \"-vtimer 2 0\" -> Stops timer 2.\r\n";
+    }
+    else if (strcmp(cmd_arg_token,      "var") == 0 || strcmp(cmd_arg_token,            "-var") == 0) {
+        helpMessage =
+           //================================================================================ <-80 characters
+            "Command: -var [$name | c]\r\n"
+            "| Description: Lists the named variables. A $name operand of -reg, -if,\r\n"
+            "| |            -loop or -watch defines the variable on first use, with the\r\n"
+            "| |            value 0. Script lines resolve names when they are compiled,\r\n"
+            "| |            so a variable costs no more than a register.\r\n"
+            "| Example usage: \"-reg mov $gain #12\" -> Defines $gain and sets it to 12.\r\n"
+            "| Example usage: \"-var\" -> Displays all variables.\r\n"
+            "| Example usage: \"-var $gain\" -> Displays $gain.\r\n"
+            "| Special Case: \"-var c\" -> Sets every variable to 0.\r\n"
+            "| Note: Up to 256 variables, names up to 15 letters, digits or '_'. Names\r\n"
+            "| |     are case sensitive and stay defined until reset.\r\n";
+    }
+    else if (strcmp(cmd_arg_token,      "watch") == 0 || strcmp(cmd_arg_token,          "-watch") == 0) {
+        helpMessage =
+           //================================================================================ <-80 characters
+            "Command: -watch [condition] [payload]\r\n"
+            "| args:\r\n"
+            "| | condition: Expression as in -if, it must read at least one register.\r\n"
+            "| | payload: Command queued each time the condition becomes true.\r\n"
+            "| Description: Watches registers without polling. The condition is checked\r\n"
+            "| |            only when a register it reads is written, by -reg, a script,\r\n"
+            "| |            -load or -dial, and the payload runs when it changes from\r\n"
+            "| |            false to true.\r\n"
+            "| Example usage: \"-watch R5 > #100 -print hot\" -> Prints hot when R5 goes\r\n"
+            "| |              above 100.\r\n"
+            "| Example usage: \"-watch\" -> Displays all watches and their hit counts.\r\n"
+            "| Special Case: \"-watch c 2\" -> Clears watch 2, \"-watch c\" clears all.\r\n"
+            "| Note: Up to 8 watches. The payload starts at the first word beginning\r\n"
+            "| |     with a '-' and two letters.\r\n";
+    }
     else {
         helpMessage =
            //================================================================================ <-80 characters
@@ -1576,27 +2078,43 @@ void CMD_help(char **saveptr) {
             "|                                     |  payload when an event occurs.\r\n"
             "| -error                              |  Displays number of times that each\r\n"
             "|                                     |  error type has triggered.\r\n"
+            "| -cpu       [on/off/r]               |  Display CPU load per Task, Swi and\r\n"
+            "|                                     |  Hwi, start or stop measuring.\r\n"
             "| -dial      [IP_ADDRESS]             |  Sets the IP address in register R0\r\n"
             "|                                     |  (REG_DIAL1) and initiates the streaming\r\n"
             "|                                     |  process by executing \"-stream 1\".\r\n"
+            "| -fec       [target] [mode] [K]      |  Configure voice forward error\r\n"
+            "|                                     |  correction per dial target.\r\n"
+            "| -goto/-call [label], -ret           |  Jump, call and return in scripts.\r\n"
             "| -gpio      [pin] [function] [val]   |  Performs pin function on selected\r\n"
             "|                                     |  GPIO.\r\n"
             "| -help      [command]                |  Display this help message or a\r\n"
             "|                                     |  specific message based on command\r\n"
-            "| -if        [A] [COND] [B] ?         |  Executes a payload based on the\r\n"
+            "| -if        [EXPR] ?                 |  Executes a payload based on the\r\n"
             "|            [DESTT] : [DESTF]        |  condition.\r\n" 
             "|                                     |  to a command. I.E \"-help print\"\r\n"
+            "| -lat       [r]                      |  Display or reset latency histograms.\r\n"
+            "| -load      [what]                   |  Restore state saved in flash.\r\n"
+            "| -loop      [Rn] [label]             |  Decrement Rn, jump to label while > 0.\r\n"
+            "| -mem                                |  Display stack, heap and static RAM\r\n"
+            "|                                     |  use.\r\n"
             "| -memr      [address]                |  Display contents of given memory\r\n"
             "|                                     |  address.\r\n"
+            "| -netstat   [r]                      |  Display or reset network statistics.\r\n"
             "| -netudp   [IP_ADDRESS]:[PORT]       |  Sends a UDP packet to the specified\r\n"
             "|                                     |  IP address and port.\r\n"
+            "| -plc       [off/repeat/pitch/r]     |  Select voice loss concealment or\r\n"
+            "|                                     |  display its statistics.\r\n"
             "| -print     [string]                 |  Display inputted string.\r\n"
             "|                                     |  I.E \"-print abc\"\r\n"
             "| -reg       [operation] [operands]   |  Perform operation on specified\r\n"
             "|                                     |  register.\r\n"
             "| -rem       [remark]                 |  Add comments or remarks in scripts.\r\n" 
+            "| -save      [what/boot/stat/format]  |  Save state to flash, set boot load.\r\n"
             "| -script    [line_number] [operation]|  Manage and execute scripts of\r\n"
             "|                                     |  commands.\r\n"
+            "| -shadow    [name] [value]           |  Show or set shadow registers: log\r\n"
+            "|                                     |  levels and console setup.\r\n"
             "| -sine      [frequency]              |  Play a frequency using the BOOST-XL\r\n"
             "|                                     |  Audio board.\r\n"
             "| -stop                               |  Emergency stop. Resets all timers,\r\n"
@@ -1604,9 +2122,14 @@ void CMD_help(char **saveptr) {
             "| -stream    [1/0]                    |  Start or stop streaming voice data.\r\n"
             "| -ticker    [index] [initialDelay]   |  Configures a ticker to execute a\r\n"
             "|            [period] [count] [payload]  payload after a delay and repeat it.\r\n"
-            "| -timer     [period_us]              |  Sets the period of Timer0 in\r\n"
+            "| -timer     [period_us]              |  Sets the period of callback 0 in\r\n"
             "|                                        microseconds.\r\n"
-            "| -uart      [payload]                |  Sends a payload message over UART7.\r\n";
+            "| -uart      [payload]                |  Sends a payload message over UART7.\r\n"
+            "| -var       [$name | c]              |  List named variables ($name).\r\n"
+            "| -vtimer    [index] [period_us]      |  Run a payload on its own period,\r\n"
+            "|            [count] [payload]        |  sharing Timer0.\r\n"
+            "| -watch     [condition] [payload]    |  Run a payload when a register write\r\n"
+            "|                                     |  makes the condition true.\r\n";
     }
 
     //UART_write_safe(helpMessage, strlen(helpMessage));`
@@ -1615,7 +2138,7 @@ void CMD_help(char **saveptr) {
 }
 
 void CMD_if(char **saveptr) {
-    // Parse the condition (A COND B) or A COND B, where COND is >, =, or <
+    // Everything up to '?' is the condition expression, see expr.h
     char *condition_part = strtok_r(NULL, "?", saveptr);
     if (!condition_part) {
         //AddProgramMessage("Error: Invalid syntax for -if command.\r\n");  // TODO: Add to errors
@@ -1623,19 +2146,15 @@ void CMD_if(char **saveptr) {
         return;
     }
 
-    // Trim leading and trailing whitespaces
-    trim(condition_part);
-
-    // Remove surrounding parentheses if present
-    if (condition_part[0] == '(' && condition_part[strlen(condition_part) - 1] == ')') {
-        condition_part[strlen(condition_part) - 1] = '\0'; // Remove closing parenthesis
-        condition_part++; // Move pointer past opening parenthesis
-    }
-
-    // Extract operands and condition
-    char operandA[BUFFER_SIZE], operandB[BUFFER_SIZE], cond[3];
-    if (sscanf(condition_part, "%s %2[><=] %s", operandA, cond, operandB) != 3) {
-        AddProgramMessage("Error: Invalid condition format.\r\n");
+    // Compile the condition, private registers p0-p7 are valid inside a script
+    ScriptContext *ctx = script_current();
+    ExprProgram condition;
+    const char *error;
+    char msg[BUFFER_SIZE];
+    if (!expr_compile(condition_part, ctx != NULL, &condition, &error)) {
+        AddProgramMessage(raiseError(ERR_INVALID_CONDITION));
+        sprintf(msg, "| %s.\r\n", error);
+        AddProgramMessage(msg);
         return;
     }
 
@@ -1655,26 +2174,12 @@ void CMD_if(char **saveptr) {
     if (destF) trim(destF);
 
     // Evaluate the condition
-    int valueA = getOperandValue(operandA);
-    int valueB = getOperandValue(operandB);
-    if (valueA == INT64_MIN || valueB == INT64_MIN) {
-        // Error message already handled in getOperandValue
-        return;
-    }
-
-    // Determine the result of the condition
-    bool conditionResult = false;
-    if (strcmp(cond, ">") == 0) {
-        conditionResult = (valueA > valueB);
-    } else if (strcmp(cond, "=") == 0 || strcmp(cond, "==") == 0) {
-        conditionResult = (valueA == valueB);
-    } else if (strcmp(cond, "<") == 0) {
-        conditionResult = (valueA < valueB);
-    } else {
-        //AddProgramMessage("Error: Invalid condition operator.\r\n");  // TODO: Add to errors
-        AddProgramMessage(raiseError(ERR_INVALID_CONDITION));
+    int32_t value;
+    if (!expr_eval(&condition, ctx ? ctx->p : NULL, &value)) {
+        AddProgramMessage("Error: Division by zero.\r\n");
         return;
     }
+    bool conditionResult = value != 0;
 
     // Execute the appropriate destination
     if (conditionResult) {
@@ -1753,6 +2258,88 @@ ERROR38:
     AddProgramMessage(raiseError(ERR_ADDR_OUT_OF_RANGE));
 }
 
+/// @brief Displays the latency histograms, or clears them with "-lat r"
+void CMD_lat(char **saveptr) {
+    char *arg = strtok_r(NULL, " \t\r\n", saveptr);
+
+    if (arg == NULL) {
+        print_latency();
+    } else if (strcmp(arg, "r") == 0) {
+        lat_reset();
+        AddProgramMessage("Latency histograms cleared.\r\n");
+    } else {
+        AddProgramMessage("Usage: -lat [r]\r\n");
+    }
+}
+
+/// @brief Displays task stack, heap and static memory use
+void CMD_mem(char **saveptr) {
+    print_memstat();
+}
+
+/// @brief Displays the network counters, or clears them with "-netstat r"
+void CMD_netstat(char **saveptr) {
+    char *arg = strtok_r(NULL, " \t\r\n", saveptr);
+
+    if (arg == NULL) {
+        print_netstat();
+        print_netregs();
+    } else if (strcmp(arg, "r") == 0) {
+        netstat_reset();
+        AddProgramMessage("Network statistics cleared.\r\n");
+    } else {
+        AddProgramMessage("Usage: -netstat [r]\r\n");
+    }
+}
+
+/// @brief Selects the voice loss concealment mode or displays its statistics
+void CMD_plc(char **saveptr) {
+    static const char *modeNames[PLC_MODE_COUNT] = { "off", "repeat", "pitch" };
+    char *arg = strtok_r(NULL, " \t\r\n", saveptr);
+    char msg[MAX_LINE_LENGTH + 8];
+    int i, mode;
+
+    if (arg == NULL) {
+        sprintf(msg, "PLC mode: %s\r\n", modeNames[glo.audioController.txBufControl[0].plc.mode]);
+        AddProgramMessage(msg);
+        for (i = 0; i < TXBUFCOUNT; i++) {
+            PlcState *plc = &glo.audioController.txBufControl[i].plc;
+            sprintf(msg, "| TX%d good: %u  concealed: %u  muted: %u  losses: %u  late: %u\r\n",
+                    i, plc->goodBlocks, plc->concealedBlocks, plc->mutedBlocks, plc->erasures, plc->lateBlocks);
+            AddProgramMessage(msg);
+            sprintf(msg, "|     last pitch: %d  cost us/block avg: %u  max: %u\r\n",
+                    plc->lastPitch,
+                    plc->concealedBlocks ? plc->costTotal / plc->concealedBlocks : 0,
+                    plc->costMax);
+            AddProgramMessage(msg);
+        }
+        return;
+    }
+
+    if (strcmp(arg, "r") == 0) {
+        for (i = 0; i < TXBUFCOUNT; i++) {
+            plc_reset_stats(&glo.audioController.txBufControl[i].plc);
+        }
+        AddProgramMessage("PLC statistics cleared.\r\n");
+        return;
+    }
+
+    for (mode = 0; mode < PLC_MODE_COUNT; mode++) {
+        if (strcmp(arg, modeNames[mode]) == 0) {
+            break;
+        }
+    }
+    if (mode == PLC_MODE_COUNT) {
+        AddProgramMessage("Usage: -plc [off|repeat|pitch|r]\r\n");
+        return;
+    }
+    for (i = 0; i < TXBUFCOUNT; i++) {
+        glo.audioController.txBufControl[i].plc.mode = (PlcMode)mode;
+    }
+    sprintf(msg, "PLC mode set to %s.\r\n", modeNames[mode]);
+    AddProgramMessage(msg);
+}
+
 /// @brief Prints the message after the first token, which should be "-print"
 void CMD_print(char **saveptr) {
     char *msg_token = strtok_r(NULL, "\r\n", saveptr);
@@ -1775,88 +2362,98 @@ void CMD_reg(char **saveptr) {
         return;
     }
 
+    // Register operations of a quiet script, and "-reg q <op> ...", print nothing
+    ScriptContext *ctx = script_current();
+    bool quiet = ctx != NULL && ctx->quiet;
+    if (strcmp(op_token, "q") == 0) {
+        quiet = true;
+        op_token = strtok_r(NULL, " \t\r\n", saveptr);
+        if (!op_token) {
+            AddProgramMessage("Error: Missing operation.\r\n");
+            return;
+        }
+    }
+
     // Convert operation token to lowercase for case-insensitive comparison
     char *p;
     for (p = op_token; *p; ++p) {
         *p = tolower(*p);
     }
 
+    // -reg exec "op a b; op a b; ...": Apply a batch, one summary line
+    if (strcmp(op_token, "exec") == 0) {
+        char *ops = strtok_r(NULL, "\r\n", saveptr);
+        if (!ops) {
+            AddProgramMessage("Usage: -reg exec \"op a b; op a b; ...\"\r\n");
+            return;
+        }
+        reg_batch(ops, quiet);
+        return;
+    }
+
+    // -reg l|f|s: Print a typed bank
+    if (op_token[1] == '\0' && strchr("lfs", op_token[0])) {
+        print_typed_registers(op_token[0] == 'l' ? RT_LONG : op_token[0] == 'f' ? RT_FLOAT : RT_STRING);
+        return;
+    }
+
     // Initialize argument tokens
     char *arg1_token = strtok_r(NULL, " \t\r\n", saveptr);
     char *arg2_token = strtok_r(NULL, " \t\r\n", saveptr);
 
-    // Handle operations that require one operand
-    if (strcmp(op_token, "inc") == 0 ||
-        strcmp(op_token, "dec") == 0 ||
-        strcmp(op_token, "neg") == 0 ||
-        strcmp(op_token, "not") == 0) {
-
-        if (!arg1_token) {
-            AddProgramMessage("Error: Missing operand.\r\n");
+    // Vector operations over register ranges
+    VecOp vop = vec_lookup_op(op_token);
+    if (vop != VEC_OP_COUNT) {
+        if (!arg1_token || !arg2_token) {
+            AddProgramMessage("Error: Missing operands.\r\n");
             return;
         }
+        vec_exec(vop, arg1_token, arg2_token, strtok_r(NULL, " \t\r\n", saveptr), quiet);
+        return;
+    }
 
-        if (strcmp(op_token, "inc") == 0) {
-            reg_inc(arg1_token);
-        } else if (strcmp(op_token, "dec") == 0) {
-            reg_dec(arg1_token);
-        } else if (strcmp(op_token, "neg") == 0) {
-            reg_neg(arg1_token);
-        } else if (strcmp(op_token, "not") == 0) {
-            reg_not(arg1_token);
-        }
+    RegOp op = reg_lookup_op(op_token);
+    if (op == REG_OP_COUNT) {
+        AddProgramMessage("Error: Unknown operation.\r\n");
+        return;
+    }
 
+    // Check the operand count before parsing
+    if (reg_op_operands(op) == 1 && !arg1_token) {
+        AddProgramMessage("Error: Missing operand.\r\n");
+        return;
+    }
+    if (reg_op_operands(op) == 2 && (!arg1_token || !arg2_token)) {
+        AddProgramMessage("Error: Missing operands.\r\n");
+        return;
     }
-    // Handle operations that require two operands
-    else if (strcmp(op_token, "mov") == 0 ||
-             strcmp(op_token, "xchg") == 0 ||
-             strcmp(op_token, "add") == 0 ||
-             strcmp(op_token, "sub") == 0 ||
-             strcmp(op_token, "and") == 0 ||
-             strcmp(op_token, "ior") == 0 ||
-             strcmp(op_token, "xor") == 0 ||
-             strcmp(op_token, "mul") == 0 ||
-             strcmp(op_token, "div") == 0 ||
-             strcmp(op_token, "rem") == 0 ||
-             strcmp(op_token, "max") == 0 ||
-             strcmp(op_token, "min") == 0) {
 
-        if (!arg1_token || !arg2_token) {
-            AddProgramMessage("Error: Missing operands.\r\n");
-            return;
-        }
+    reg_exec(op, arg1_token, arg2_token, quiet);
+}
 
-        if (strcmp(op_token, "mov") == 0) {
-            reg_mov(arg1_token, arg2_token);
-        } else if (strcmp(op_token, "xchg") == 0) {
-            reg_xchg(arg1_token, arg2_token);
-        } else if (strcmp(op_token, "add") == 0) {
-            reg_add(arg1_token, arg2_token);
-        } else if (strcmp(op_token, "sub") == 0) {
-            reg_sub(arg1_token, arg2_token);
-        } else if (strcmp(op_token, "and") == 0) {
-            reg_and(arg1_token, arg2_token);
-        } else if (strcmp(op_token, "ior") == 0) {
-            reg_ior(arg1_token, arg2_token);
-        } else if (strcmp(op_token, "xor") == 0) {
-            reg_xor(arg1_token, arg2_token);
-        } else if (strcmp(op_token, "mul") == 0) {
-            reg_mul(arg1_token, arg2_token);
-        } else if (strcmp(op_token, "div") == 0) {
-            reg_div(arg1_token, arg2_token);
-        } else if (strcmp(op_token, "rem") == 0) {
-            reg_rem(arg1_token, arg2_token);
-        } else if (strcmp(op_token, "max") == 0) {
-            reg_max(arg1_token, arg2_token);
-        } else if (strcmp(op_token, "min") == 0) {
-            reg_min(arg1_token, arg2_token);
-        }
+void CMD_flow(char **saveptr) {
+    // Script lines compile -goto, -call, -ret and -loop, so only invalid ones get here
+    AddProgramMessage("Error: Usage: -goto|-call [label|line], -ret, -loop [Rn|pN] [label|line]\r\n"
+                      "| in script lines only.\r\n");
+}
+
+void CMD_load(char **saveptr) {
+    char *what_token = strtok_r(NULL, " \t\r\n", saveptr);
+    uint32_t what = what_token ? storage_parse_what(what_token) : STORAGE_ALL;
+    char msg[BUFFER_SIZE];
+    int32_t loaded;
 
+    if (what == 0) {
+        AddProgramMessage("Usage: -load [all|reg|script|ticker|callback]\r\n");
+        return;
     }
-    // Unknown operation
-    else {
-        AddProgramMessage("Error: Unknown operation.\r\n");
+    loaded = storage_load(what);
+    if (loaded < 0) {
+        AddProgramMessage("Error: Flash store not mounted.\r\n");
+        return;
     }
+    sprintf(msg, "Loaded %d records from flash.\r\n", (int)loaded);
+    AddProgramMessage(msg);
 }
 
 void CMD_rem(char **saveptr) {
@@ -1864,6 +2461,65 @@ void CMD_rem(char **saveptr) {
     // For now, we can do nothing
 }
 
+void CMD_save(char **saveptr) {
+    char *arg1 = strtok_r(NULL, " \t\r\n", saveptr);
+    char *arg2 = strtok_r(NULL, " \t\r\n", saveptr);
+    uint32_t what = arg1 ? storage_parse_what(arg1) : STORAGE_ALL;
+    StorageBoot boot;
+    char msg[BUFFER_SIZE];
+    int32_t written;
+
+    // -save stat: Usage and boot setting
+    if (arg1 && strcmp(arg1, "stat") == 0) {
+        print_storage();
+        return;
+    }
+
+    // -save format: Erase everything saved
+    if (arg1 && strcmp(arg1, "format") == 0) {
+        AddProgramMessage(flashstore_format() ? "Flash store erased.\r\n" : "Error: Flash erase failed.\r\n");
+        return;
+    }
+
+    // -save boot on|off|line: What startup loads
+    if (arg1 && strcmp(arg1, "boot") == 0) {
+        if (!arg2) {
+            print_storage();
+            return;
+        }
+        boot.autoload = strcmp(arg2, "off") != 0;
+        boot.scriptLine = STORAGE_BOOT_NO_SCRIPT;
+        if (isNumeric(arg2)) {
+            if (atoi(arg2) < 0 || atoi(arg2) >= SCRIPT_LINE_COUNT) {
+                AddProgramMessage(raiseError(ERR_INVALID_SCRIPT_LINE));
+                return;
+            }
+            boot.scriptLine = (int8_t)atoi(arg2);
+        } else if (strcmp(arg2, "on") != 0 && strcmp(arg2, "off") != 0) {
+            AddProgramMessage("Usage: -save boot [on|off|line]\r\n");
+            return;
+        }
+        if (!storage_set_boot(&boot)) {
+            AddProgramMessage("Error: Flash store write failed.\r\n");
+            return;
+        }
+        print_storage();
+        return;
+    }
+
+    if (what == 0) {
+        AddProgramMessage("Usage: -save [all|reg|script|ticker|callback|boot|stat|format]\r\n");
+        return;
+    }
+    written = storage_save(what);
+    if (written < 0) {
+        AddProgramMessage("Error: Flash store write failed (not mounted or full).\r\n");
+        return;
+    }
+    sprintf(msg, "Saved to flash, %d records written.\r\n", (int)written);
+    AddProgramMessage(msg);
+}
+
 void CMD_script(char **saveptr) {
     char *arg1 = strtok_r(NULL, " \t\r\n", saveptr);       // Line number or NULL
     char *arg2 = strtok_r(NULL, " \t\r\n", saveptr);       // 'w', 'x', 'c', or NULL
@@ -1875,14 +2531,103 @@ void CMD_script(char **saveptr) {
         return;
     }
 
-    // -script r: Reset the script execution
+    // -script prof [reset | payloads on|off]: Per line execution profile
+    if (strcmp(arg1, "prof") == 0) {
+        if (rest_of_line) {
+            trim(rest_of_line);
+        }
+        if (!arg2) {
+            print_profile();
+        } else if (strcmp(arg2, "reset") == 0) {
+            profile_reset();
+            AddProgramMessage("Profile cleared.\r\n");
+        } else if (strcmp(arg2, "payloads") == 0 && rest_of_line
+                   && (strcmp(rest_of_line, "on") == 0 || strcmp(rest_of_line, "off") == 0)) {
+            profilePayloads = strcmp(rest_of_line, "on") == 0;
+            AddProgramMessage(profilePayloads ? "Profiling ticker and callback payloads.\r\n"
+                                              : "Ticker and callback payloads no longer profiled.\r\n");
+        } else {
+            AddProgramMessage("Usage: -script prof [reset | payloads on|off]\r\n");
+        }
+        return;
+    }
+
+    // -script quiet on|off: Silence register operations of this script, or of scripts started later
+    if (strcmp(arg1, "quiet") == 0) {
+        ScriptContext *ctx = script_current();
+        if (!arg2 || (strcmp(arg2, "on") != 0 && strcmp(arg2, "off") != 0)) {
+            AddProgramMessage("Usage: -script quiet on|off\r\n");
+            return;
+        }
+        if (ctx) {
+            ctx->quiet = strcmp(arg2, "on") == 0;
+        } else {
+            shadowRegisters[SHADOW_QUIET] = strcmp(arg2, "on") == 0;
+            AddProgramMessage(shadowRegisters[SHADOW_QUIET] ? "Scripts started from now on run quietly.\r\n"
+                                          : "Scripts started from now on print register results.\r\n");
+        }
+        return;
+    }
+
+    // -script q [lines us | r]: Show, set or clear the executor quantum
+    if (strcmp(arg1, "q") == 0) {
+        if (rest_of_line) {
+            trim(rest_of_line);
+        }
+        if (!arg2) {
+            print_script_quantum();
+        } else if (strcmp(arg2, "r") == 0) {
+            script_reset_quantum_stats();
+            AddProgramMessage("Script quantum statistics cleared.\r\n");
+        } else if (!rest_of_line || !isNumeric(arg2) || !isNumeric(rest_of_line)
+                   || (atoi(arg2) <= 0 && atoi(rest_of_line) <= 0)) {
+            AddProgramMessage("Usage: -script q [lines us | r], one budget must be > 0\r\n");
+        } else {
+            scriptQuantum.maxLines = atoi(arg2) > 0 ? atoi(arg2) : 0;
+            scriptQuantum.maxUs = atoi(rest_of_line) > 0 ? atoi(rest_of_line) : 0;
+            print_script_quantum();
+        }
+        return;
+    }
+
+    // -script image: State of the last bulk upload
+    if (strcmp(arg1, "image") == 0) {
+        print_script_image();
+        return;
+    }
+
+    // -script r: Stop all scripts
     if (strcmp(arg1, "r") == 0) {
-        // Reset the script execution
-        glo.scriptPointer = -1;  // Reset script pointer
+        script_kill_all();
+        return;
+    }
+
+    // -script list / suspend N / resume N / kill N: Manage the script contexts
+    if (strcmp(arg1, "list") == 0) {
+        print_script_contexts();
+        return;
+    }
+    if (strcmp(arg1, "suspend") == 0 || strcmp(arg1, "resume") == 0 || strcmp(arg1, "kill") == 0) {
+        int id = arg2 ? atoi(arg2) : -1;
+        char msg[BUFFER_SIZE];
+        if (!arg2 || !isNumeric(arg2) || id < 0 || id >= SCRIPT_CONTEXTS) {
+            AddProgramMessage("Usage: -script suspend|resume|kill [context]\r\n");
+            return;
+        }
+        if (arg1[0] == 'k') {
+            script_kill(id);
+        } else if (!script_suspend(id, arg1[0] == 's')) {
+            sprintf(msg, "Script context %d is not running.\r\n", id);
+            AddProgramMessage(msg);
+            return;
+        }
+        sprintf(msg, "Script context %d %s.\r\n", id,
+                arg1[0] == 'k' ? "killed" : (arg1[0] == 's' ? "suspended" : "resumed"));
+        AddProgramMessage(msg);
         return;
     }
 
-    int line_number = atoi(arg1);
+    int line_number = isNumeric(arg1) ? atoi(arg1) : script_find_label(arg1, (int)strlen(arg1));
     if (line_number < 0 || line_number >= SCRIPT_LINE_COUNT) {
         AddProgramMessage(raiseError(ERR_INVALID_SCRIPT_LINE));
         return;
@@ -1902,6 +2647,7 @@ void CMD_script(char **saveptr) {
         }
         strncpy(scriptLines[line_number], rest_of_line, SCRIPT_LINE_SIZE - 1);
         scriptLines[line_number][SCRIPT_LINE_SIZE - 1] = '\0';  // Ensure null-terminated
+        script_compile_line(line_number);
         char msg[SCRIPT_LINE_SIZE];
         sprintf(msg, "Script line %d set to: %s\r\n", line_number, scriptLines[line_number]);
         AddProgramMessage(msg);
@@ -1913,6 +2659,7 @@ void CMD_script(char **saveptr) {
     } else if (strcmp(arg2, "c") == 0) {
         // Clear script line
         scriptLines[line_number][0] = '\0';
+        script_compile_line(line_number);
         char msg[BUFFER_SIZE];
         sprintf(msg, "Script line %d cleared.\r\n", line_number);
         AddProgramMessage(msg);
@@ -1921,6 +2668,44 @@ void CMD_script(char **saveptr) {
     }
 }
 
+void CMD_shadow(char **saveptr) {
+    char *name_token = strtok_r(NULL, " \t\r\n", saveptr);
+    char *value_token;
+    int32_t value;
+    int reg;
+
+    if (!name_token) {
+        print_all_shadow_registers();
+        return;
+    }
+    if (strcmp(name_token, "reset") == 0) {
+        init_shadow_registers();
+        AddProgramMessage("Shadow registers reset to their defaults.\r\n");
+        return;
+    }
+    reg = shadow_lookup(name_token);
+    if (reg == -1) {
+        AddProgramMessage("Error: Unknown shadow register.\r\n");
+        return;
+    }
+
+    value_token = strtok_r(NULL, " \t\r\n", saveptr);
+    if (value_token) {
+        if (!shadow_parse_value(reg, value_token, &value) || !shadow_set(reg, value)) {
+            AddProgramMessage("Error: Invalid value or out of range.\r\n");
+            return;
+        }
+    }
+    print_shadow_register(reg);
+}
+
+/// @brief Audio virtual timer handler of -sine
+static void sine_fire(UArg arg) {
+    if (glo.audioController.lutDelta > 0.0) {
+        generateSineSample();
+    }
+}
+
 void CMD_sine(char **saveptr) {
     char *freq_token = strtok_r(NULL, " \t\r\n", saveptr);  // Frequency token in Hz, try 261.63 for middle C
     char msg[BUFFER_SIZE];
@@ -1935,9 +2720,15 @@ void CMD_sine(char **saveptr) {
         }
     }
     else if(freq_token) {
-        // Parse the frequency token
-        bool success;
-        glo.audioController.setFreq = parseDouble(freq_token, &success);
+        // Parse the frequency token, a float register is read without parsing text
+        bool success = true;
+        RegType type;
+        int index;
+        if (parse_typed_register(freq_token, &type, &index) && type == RT_FLOAT) {
+            glo.audioController.setFreq = floatRegisters[index];
+        } else {
+            glo.audioController.setFreq = parseDouble(freq_token, &success);
+        }
         if (!success) {
             AddProgramMessage("Error: Invalid frequency input.\r\n");
             return;
@@ -1947,23 +2738,17 @@ void CMD_sine(char **saveptr) {
         if (glo.audioController.setFreq <= 0)
         {
             // Stop sine generation
-            execute_payload("-callback 0 0");
-            execute_payload("-timer 0");
+            vtimer_stop(VTIMER_AUDIO);
             glo.audioController.lutDelta = 0.0;
             glo.audioController.setFreq = 0.0;
             AddProgramMessage("Sine wave generation stopped.\r\n");
             return;
         } else {
-            // Set up callback for infinite -sine calls
-            // Also set glo.audioController.lutDelta using freq and period
-        
-
             // Calculate lutDelta
-            // lutDelta = freq * SINE_TABLE_SIZE * Timer0Period / 1,000,000
-            // Timer0Period is in microseconds
-            glo.audioController.lutDelta = (glo.audioController.setFreq * (double)SINE_TABLE_SIZE * (125 / 1000000.0));
-            sprintf(msg, "lutDelta: %.2f, Timer0Period: %u us\r\n", glo.audioController.lutDelta, glo.Timer0Period);
-            AddProgramMessage(msg);
+            // lutDelta = freq * SINE_TABLE_SIZE * sample period / 1,000,000
+            // The audio virtual timer runs at AUDIO_SAMPLE_PERIOD_US whatever Timer0's tick is
+            glo.audioController.lutDelta = (glo.audioController.setFreq * (double)SINE_TABLE_SIZE * (AUDIO_SAMPLE_PERIOD_US / 1000000.0));
+            LOG(AUDIO, LOG_DEBUG, "lutDelta: %.2f, Timer0 tick: %u us\r\n", glo.audioController.lutDelta, glo.Timer0Period);
 
             // Check for Nyquist violation
             if (glo.audioController.lutDelta >= (double)(SINE_TABLE_SIZE / 2)) {
@@ -1972,17 +2757,17 @@ void CMD_sine(char **saveptr) {
                 return;
             }
 
-            char cbCommand[64];
-            snprintf(cbCommand, sizeof(cbCommand), "-callback 0 -1 -sine");
-            execute_payload(cbCommand); // sets callback0 payload to "-sine"
-            if(glo.Timer0Period != 125) {
-                execute_payload("-timer 125");
-                AddProgramMessage("Timer0 restarted with 125 us period.\r\n");
+            // Samples come from the audio virtual timer, callback 0 and -timer stay free
+            const char *error;
+            if (!vtimer_start(VTIMER_AUDIO, AUDIO_SAMPLE_PERIOD_US, sine_fire, 0, NULL, -1, &error)) {
+                glo.audioController.lutDelta = 0.0;
+                sprintf(msg, "Error: %s.\r\n", error);
+                AddProgramMessage(msg);
+                return;
             }
-            
+
             // Provide feedback to the user
-            sprintf(msg, "Sine wave generation started with frequency %.2f Hz.\r\n", glo.audioController.setFreq);
-            AddProgramMessage(msg);
+            LOG(AUDIO, LOG_INFO, "Sine wave generation started with frequency %.2f Hz.\r\n", glo.audioController.setFreq);
         }
     } 
     else {
@@ -2082,10 +2867,8 @@ void CMD_ticker(char **saveptr) {
     tickers[index].payload[BUFFER_SIZE - 1] = '\0';  // Ensure null-terminated
 
     // Acknowledge
-    char msg[BUFFER_SIZE];
-    sprintf(msg, "Ticker %d set with delay %u, period %u, count %d, payload: %s\r\n",
-            index, initialDelay, period, count, tickers[index].payload);
-    AddProgramMessage(msg);
+    LOG(CMD, LOG_INFO, "Ticker %d set with delay %u, period %u, count %d, payload: %s\r\n",
+        index, initialDelay, period, count, tickers[index].payload);
 }
 
 /// @brief Command function to parse and set up a timer
@@ -2093,12 +2876,14 @@ void CMD_timer(char **saveptr) {
     // Next parameter should be the period in microseconds
     char *val_token = strtok_r(NULL, " \t\r\n", saveptr);
     char output_msg[BUFFER_SIZE];
-    uint32_t gateKey;
+    const char *error;
 
     if(!val_token) {
-        // No period provided, display current Timer0 period
-        sprintf(output_msg, "Current Timer0 period is %u us\r\n", glo.Timer0Period);
-    AddProgramMessage(output_msg);
+        // No period provided, display the callback 0 period and the Timer0 tick
+        sprintf(output_msg, "Callback 0 period is %u us, Timer0 tick %u us\r\n",
+                vtimers[VTIMER_CALLBACK].active ? (unsigned)vtimers[VTIMER_CALLBACK].periodUs : 0,
+                (unsigned)glo.Timer0Period);
+        AddProgramMessage(output_msg);
         return;
     }
 
@@ -2107,13 +2892,8 @@ void CMD_timer(char **saveptr) {
 
     // Stop the timer if the value is 0
     if(val_us == 0) {
-        // Stop the timer
-        gateKey = GateSwi_enter(gateSwi0);
-        Timer_stop(glo.Timer0);
-        glo.Timer0Period = 0;
-        Timer_setPeriod(glo.Timer0, Timer_PERIOD_US, 0);  // Set period to 0 to stop timer
-        GateSwi_leave(gateSwi0, gateKey);
-        AddProgramMessage("Timer0 stopped\r\n");
+        vtimer_stop(VTIMER_CALLBACK);
+        LOG(CMD, LOG_INFO, "Callback 0 timer stopped\r\n");
         return;
     }
 
@@ -2123,24 +2903,13 @@ void CMD_timer(char **saveptr) {
         AddProgramMessage(raiseError(ERR_INVALID_TIMER_PERIOD));
         return; // No change
     }
-    //UART_write_safe_strlen("Time to write...\r\n");
-    //AddProgramMessage("Time to write...\r\n");
 
-    gateKey = GateSwi_enter(gateSwi0);
-    Timer_stop(glo.Timer0);
-    glo.Timer0Period = val_us;
-    Timer_setPeriod(glo.Timer0, Timer_PERIOD_US, val_us);
-    int32_t status = Timer_start(glo.Timer0);
-    GateSwi_leave(gateSwi0, gateKey);
-
-    if(status == Timer_STATUS_ERROR) {
-        //UART_write_safe_strlen(raiseError(ERR_TIMER_STATUS_ERROR));
-        AddProgramMessage(raiseError(ERR_TIMER_STATUS_ERROR));
+    if(!vtimer_start(VTIMER_CALLBACK, val_us, callback0_fire, 0, NULL, -1, &error)) {
+        sprintf(output_msg, "Error: %s.\r\n", error);
+        AddProgramMessage(output_msg);
     }
     else {
-        sprintf(output_msg, "Set Timer0 period to %d us\r\n", val_us);
-        //UART_write_safe_strlen(output_msg);
-        AddProgramMessage(output_msg);
+        LOG(CMD, LOG_INFO, "Set callback 0 period to %d us\r\n", val_us);
     }
 }
 
@@ -2171,97 +2940,125 @@ void CMD_uart(char **saveptr) {
     AddProgramMessage("Payload sent over UART 1.\r\n");
 }
 
-// Format: "-voice dest_choice 128  \0sample0 sample1 ... sample127"
-// Copies the given 128 samples into the correct TX buffers and applies correction logic.
-// Cannot be parsed like the others due to null terminators in the samples.
-// 
+void CMD_vtimer(char **saveptr) {
+    char *index_token = strtok_r(NULL, " \t\r\n", saveptr);
+    char *period_token, *count_token, *payload;
+    char msg[BUFFER_SIZE];
+    const char *error;
+    uint32_t period;
+    int index;
 
-// Assume NextSubString(char *msg, bool Print) is defined similarly to the example code.
-// It returns the start of the next token in 'msg' or NULL if none.
-// 'Print' could be a flag indicating debugging prints.
-// This code assumes that NextSubString navigates through the given buffer without inserting null terminators.
+    if (!index_token) {
+        print_vtimers();
+        return;
+    }
+    index = atoi(index_token);
+    period_token = strtok_r(NULL, " \t\r\n", saveptr);
+    if (index < VTIMER_USER || index >= MAX_VTIMERS || !period_token) {
+        AddProgramMessage("Usage: -vtimer [index 2-7] [period_us] [count] [payload]\r\n");
+        return;
+    }
+    period = strtoul(period_token, NULL, 10);
+    if (period == 0) {
+        vtimer_stop(index);
+        sprintf(msg, "Virtual timer %d stopped.\r\n", index);
+        AddProgramMessage(msg);
+        return;
+    }
 
-void ParseVoice(char *ch) {
-    int32_t dest_choice;
-    int32_t bufflen;
-    int32_t TX01;
-    int32_t current;
-    uint16_t *dest_buffer;
+    count_token = strtok_r(NULL, " \t\r\n", saveptr);
+    payload = strtok_r(NULL, "\r\n", saveptr);
+    if (!count_token || !payload) {
+        AddProgramMessage(raiseError(ERR_MISSING_PAYLOAD));
+        return;
+    }
+    if (!vtimer_start(index, period, NULL, 0, payload, atoi(count_token), &error)) {
+        sprintf(msg, "Error: %s.\r\n", error);
+        AddProgramMessage(msg);
+        return;
+    }
+    LOG(CMD, LOG_INFO, "Virtual timer %d set with period %u us, Timer0 tick %u us\r\n",
+        index, (unsigned)period, (unsigned)glo.Timer0Period);
+}
 
-    static int32_t last[2] = {-2, -2};
-    static int32_t lastlast[2] = {-4, -4};
+void CMD_var(char **saveptr) {
+    char *token = strtok_r(NULL, " \t\r\n", saveptr);
+    int slot;
 
-    // Retrieve dest_choice
-    char *StrBuffPTR = NextSubString(ch, true);
-    if (!StrBuffPTR) {
-        AddProgramMessage("Error: Missing dest_choice for -voice.\r\n");
+    if (!token) {
+        print_all_vars();
         return;
     }
-    dest_choice = atoi(StrBuffPTR);
-
-    // Retrieve bufflen
-    StrBuffPTR = NextSubString(StrBuffPTR, true);
-    if (!StrBuffPTR) {
-        AddProgramMessage("Error: Missing bufflen for -voice.\r\n");
+    if (strcmp(token, "c") == 0) {
+        var_zero_all();
+        AddProgramMessage("All variables set to 0.\r\n");
         return;
     }
-    bufflen = atoi(StrBuffPTR);
-
-    if (bufflen != DATABLOCKSIZE) {
-        AddProgramMessage("Error: Blocksize Error in -voice command.\r\n");
+    if (token[0] != '$' || (slot = var_lookup(&token[1], strlen(&token[1]))) == -1) {
+        AddProgramMessage("Error: Unknown variable.\r\n");
         return;
     }
+    print_var(slot);
+}
 
-    // As in the example code, advance the pointer a few times:
-    // This is to skip over the spaces or control characters before the binary data starts
-    StrBuffPTR++; 
-    StrBuffPTR++;
-    StrBuffPTR++;
-    StrBuffPTR++;
-    StrBuffPTR++;
-    StrBuffPTR++;
+void CMD_watch(char **saveptr) {
+    char *rest = strtok_r(NULL, "\r\n", saveptr);
+    char *payload;
+    const char *error;
+    char msg[2 * BUFFER_SIZE];
+    int index;
 
-    // Now StrBuffPTR should point to the start of the binary data
-    // Identify the correct TX buffer based on dest_choice
-    if (dest_choice == 0) {
-        TX01 = 0;
-        dest_buffer = glo.audioController.txBufControl[TX01].TX_Ping;
-    } else if (dest_choice == 1) {
-        TX01 = 0;
-        dest_buffer = glo.audioController.txBufControl[TX01].TX_Pong;
-    } else if (dest_choice == 2) {
-        TX01 = 1;
-        dest_buffer = glo.audioController.txBufControl[TX01].TX_Ping;
-    } else if (dest_choice == 3) {
-        TX01 = 1;
-        dest_buffer = glo.audioController.txBufControl[TX01].TX_Pong;
-    } else {
-        AddProgramMessage("Error: Destination Choice Error in -voice.\r\n");
+    if (!rest) {
+        print_all_watches();
         return;
     }
+    trim(rest);
 
-    // Copy the binary samples into the chosen buffer
-    memcpy(dest_buffer, StrBuffPTR, sizeof(uint16_t)*DATABLOCKSIZE);
-
-    // If first time, set TX_Completed and TX_index
-    if (glo.audioController.txBufControl[TX01].TX_Completed == NULL) {
-        glo.audioController.txBufControl[TX01].TX_Completed = dest_buffer;
-        glo.audioController.txBufControl[TX01].TX_index = 0;
+    // Special case: -watch c [index] clears one or all watches
+    if (rest[0] == 'c' && (rest[1] == '\0' || isspace((unsigned char)rest[1]))) {
+        if (rest[1] == '\0') {
+            watch_clear_all();
+            AddProgramMessage("All watches cleared.\r\n");
+            return;
+        }
+        index = atoi(&rest[2]);
+        if (!isNumeric(&rest[2]) || index < 0 || index >= MAX_WATCHES) {
+            AddProgramMessage("Error: Invalid watch index.\r\n");
+            return;
+        }
+        watch_clear(index);
+        sprintf(msg, "Watch %d cleared.\r\n", index);
+        AddProgramMessage(msg);
+        return;
     }
 
-    // Apply correction logic from example code
-    current = glo.audioController.txBufControl[TX01].TX_index;
-    if (last[TX01] != current && lastlast[TX01] != current) {
-        lastlast[TX01] = last[TX01];
-        last[TX01] = current;
-        if (current >= DATABLOCKSIZE - DATADELAY + 4) {
-            glo.audioController.txBufControl[TX01].TX_correction = -1;
-        } else if (current <= DATABLOCKSIZE - DATADELAY - 4) {
-            glo.audioController.txBufControl[TX01].TX_correction = +1;
+    // The payload starts at the first "-xx" word, "-R5" or "-p0" belong to the condition
+    for (payload = rest + 1; *payload; payload++) {
+        if (payload[0] == '-' && isspace((unsigned char)payload[-1])
+            && isalpha((unsigned char)payload[1]) && isalpha((unsigned char)payload[2])) {
+            break;
         }
     }
+    if (!*payload) {
+        AddProgramMessage("Usage: -watch [condition payload | c [index]]\r\n");
+        return;
+    }
+    payload[-1] = '\0';
+
+    index = watch_add(rest, payload, &error);
+    if (index < 0) {
+        sprintf(msg, "Error: %s.\r\n", error);
+        AddProgramMessage(msg);
+        return;
+    }
+    sprintf(msg, "Watch %d: %s -> %s\r\n", index, watches[index].condText, watches[index].payload);
+    AddProgramMessage(msg);
 }
 
+/// @brief Audio virtual timer handler of -stream
+static void stream_fire(UArg arg) {
+    CMD_audio(NULL);
+}
 
 void CMD_stream(char **saveptr) {
     char *arg = strtok_r(NULL, " \t\r\n", saveptr);
@@ -2275,11 +3072,8 @@ void CMD_stream(char **saveptr) {
         // Stop sine (if running)
         execute_payload("-sine 0");
 
-        // Clear callback0 (so no -audio or -sine is being called)
-        execute_payload("-callback 0 0");
-
-        // Stop the timers
-        execute_payload("-timer 0");
+        // Stop the audio virtual timer, callback 0 and other timers keep running
+        vtimer_stop(VTIMER_AUDIO);
 
         // Stop streaming if currently active
         if (glo.audioController.adcBufControl.converting == 2) {
@@ -2313,11 +3107,14 @@ void CMD_stream(char **saveptr) {
         digitalWrite(4, 0); // PK5 low = enable audio amp
         digitalWrite(5, 1); // PD4 high = enable mic
 
-        // Set callback0 to -audio continuously at 125us
-        execute_payload("-callback 0 -1 -audio");
-
-        // Timer0 at 125us for audio
-        execute_payload("-timer 125");
+        // Play out with -audio from the audio virtual timer at 125us
+        const char *error;
+        if (!vtimer_start(VTIMER_AUDIO, AUDIO_SAMPLE_PERIOD_US, stream_fire, 0, NULL, -1, &error)) {
+            char msg[BUFFER_SIZE];
+            sprintf(msg, "Error: %s.\r\n", error);
+            AddProgramMessage(msg);
+            return;
+        }
 
         // Clear audio buffers
         int i, j;
@@ -2334,6 +3131,7 @@ void CMD_stream(char **saveptr) {
             glo.audioController.txBufControl[i].TX_index = -1;
             glo.audioController.txBufControl[i].TX_delay = DATADELAY;
             glo.audioController.txBufControl[i].TX_correction = 0;
+            VoiceReset(i);
         }
 
         // Set converting = 1 but don't start ADC yet
@@ -2413,6 +3211,7 @@ void ParseNetUDP(char *ch, int32_t binaryCount) {
     if(payloadnext >= NetQueueLen)
         payloadnext = 0;
     if(payloadnext == glo.NetOutQ.payloadReading) {
+        netstat_drop(&netStats.tx, NET_DROP_QUEUE_FULL);
         GateSwi_leave(gateSwi4, gateKey);
         AddProgramMessage("Network Queue Overflow.\r\n"); // Replaced AddError with AddProgramMessage
         return;
@@ -2421,10 +3220,62 @@ void ParseNetUDP(char *ch, int32_t binaryCount) {
     // Copy payload plus binary data
     memcpy(glo.NetOutQ.payloads[glo.NetOutQ.payloadWriting], StrBuffPTR, strlen(StrBuffPTR) + binaryCount + 1);
     glo.NetOutQ.binaryCount[glo.NetOutQ.payloadWriting] = binaryCount;
+    glo.NetOutQ.raw[glo.NetOutQ.payloadWriting] = false;
+    glo.NetOutQ.queuedAt[glo.NetOutQ.payloadWriting] = timestamp_now();
+    glo.NetOutQ.payloadWriting = payloadnext;
+    netstat_queue_depth((payloadnext - glo.NetOutQ.payloadReading + NetQueueLen) % NetQueueLen);
+    GateSwi_leave(gateSwi4, gateKey);
+
+    Semaphore_post(glo.bios.NetSemaphore);
+}
+
+/**
+ * @brief Queues a binary packet (header + body) for TransmitFxn.
+ * The header and body are written directly into the queue slot, so callers
+ * do not need to stage the datagram in a buffer of their own.
+ * @param ipAddr Destination IP address in host byte order (same format as REG_DIAL1)
+ * @param port Destination port in host byte order
+ * @return Whether the packet was queued
+ */
+bool AddNetPacket(uint32_t ipAddr, uint16_t port, const NetPacketHeader *hdr, const void *body, int32_t bodyLen) {
+    uint32_t gateKey;
+    int32_t payloadnext;
+    int32_t total = (int32_t)sizeof(NetPacketHeader) + bodyLen;
+    char *slot;
+
+    if (bodyLen < 0 || total > NetQueueSize) {
+        netstat_drop(&netStats.tx, NET_DROP_TOO_LARGE);
+        AddProgramMessage("Error: Network packet too large.\r\n");
+        return false;
+    }
+
+    gateKey = GateSwi_enter(gateSwi4);
+    payloadnext = glo.NetOutQ.payloadWriting + 1;
+    if(payloadnext >= NetQueueLen)
+        payloadnext = 0;
+    if(payloadnext == glo.NetOutQ.payloadReading) {
+        netstat_drop(&netStats.tx, NET_DROP_QUEUE_FULL);
+        GateSwi_leave(gateSwi4, gateKey);
+        AddProgramMessage("Network Queue Overflow.\r\n");
+        return false;
+    }
+
+    slot = glo.NetOutQ.payloads[glo.NetOutQ.payloadWriting];
+    memcpy(slot, hdr, sizeof(NetPacketHeader));
+    if (bodyLen > 0) {
+        memcpy(slot + sizeof(NetPacketHeader), body, bodyLen);
+    }
+    glo.NetOutQ.binaryCount[glo.NetOutQ.payloadWriting] = total;
+    glo.NetOutQ.raw[glo.NetOutQ.payloadWriting] = true;
+    glo.NetOutQ.rawAddr[glo.NetOutQ.payloadWriting] = ipAddr;
+    glo.NetOutQ.rawPort[glo.NetOutQ.payloadWriting] = port;
+    glo.NetOutQ.queuedAt[glo.NetOutQ.payloadWriting] = timestamp_now();
     glo.NetOutQ.payloadWriting = payloadnext;
+    netstat_queue_depth((payloadnext - glo.NetOutQ.payloadReading + NetQueueLen) % NetQueueLen);
     GateSwi_leave(gateSwi4, gateKey);
 
     Semaphore_post(glo.bios.NetSemaphore);
+    return true;
 }
 
 
@@ -21,6 +21,10 @@
 
 // User defined headers
 #include "audio.h"
+#include "netpacket.h"
+#include "netstat.h"
+#include "voice.h"
+#include "tcpconsole.h"
 
 // NETUDP
 #define NetQueueLen 32
@@ -38,6 +42,7 @@
 #define NEW_LINE_RETURN "\r\n"
 #define CLEAR_CONSOLE "\033[2J\033[H"
 
+#define UART1_READ_TIMEOUT_MS 250    // Longest wait for one UART1 read, a full script chunk takes ~90 ms at 115200 baud
 #define MIN_TIMER_PERIOD_US 100
 
 // Extern declarations for BIOS objects created in .cfg
@@ -46,6 +51,7 @@ extern Task_Handle UARTWriter;
 extern Task_Handle UARTReader1;
 extern Task_Handle PayloadExecutor;
 extern Task_Handle TickerProcessor;
+extern Task_Handle ADCStreamer;
 
 extern Semaphore_Handle UARTWriteSem;
 extern Semaphore_Handle PayloadSem;
@@ -71,12 +77,19 @@ typedef struct PayloadMessage {
     Queue_Elem elem;
     char *data;
     bool isProgramOutput;
+    int32_t source;     // Console the payload came from (CONSOLE_UART or a TCP session)
+    int32_t profile;    // PROFILE_TAG of the ticker or callback that queued it, or PROFILE_NONE
+    uint32_t queued;    // timestamp_now() when the payload was queued (latency.h)
 } PayloadMessage, *PMsg;
 
 typedef struct NetOutQ {
     int32_t payloadWriting, payloadReading;
     char    payloads[NetQueueLen][NetQueueSize];
-    int32_t binaryCount[320];
+    int32_t binaryCount[NetQueueLen];
+    bool    raw[NetQueueLen];           // Binary packet: payloads[] holds the whole datagram
+    uint32_t rawAddr[NetQueueLen];      // Binary packet destination IP (host byte order)
+    uint16_t rawPort[NetQueueLen];      // Binary packet destination port (host byte order)
+    uint32_t queuedAt[NetQueueLen];     // timestamp_now() when the slot was filled (latency.h)
 } NetOutQ;
 
 typedef struct Discoveries{
@@ -124,6 +137,7 @@ struct Globals {
     int progOutputLines;            // Number of lines program output occupies
     UART_Handle uart0;
     UART_Params uartParams0;
+    int32_t payloadSource;          // Source of the payload being executed, selects where its output goes
 
     // TODO look at switching to callbacks for uart0 and uart1
     // UART1 for outputting payloads to another device
@@ -144,7 +158,7 @@ struct Globals {
 
     BiosList bios;
     
-    int scriptPointer;
+    int scriptContext;              // Script context the executor is running, -1 between quanta
 
     bool emergencyStopActive;
     Semaphore_Handle emergencyStopSem;
@@ -212,6 +226,7 @@ void emergency_stop();
 //================================================
 
 char *memory_strdup(const char *src);                   // Duplicate a string in memory
+const char *bios_object_name(const void *handle);       // Name of a task or Swi from release.cfg
 int isPrintable(char ch);                               // ASCII printable characters
 bool isNumeric(const char *str);                        // Check if a string is numeric.
 double parseDouble(const char *str, bool *success);     // Parse a double from a string
@@ -265,6 +280,7 @@ bool UART_write_safe_strlen(const char *message);
 
 // UART1 Comms (Called by UARTReader1)
 void handle_UART1();
+void handle_UART1_packet();
 void reset_buffer_uart1();
 
 
@@ -274,28 +290,43 @@ void reset_buffer_uart1();
 
 // Payload Handling (Called by PayloadExecutor)
 void AddPayload(char *payload);  // Should this use gates to block swi? Nuter does with his AddPayload() function
+void AddPayloadSource(char *payload, int32_t source);  // Payload typed into a console, output goes back to it
+void AddPayloadTagged(char *payload, int32_t source, int32_t profile);  // Payload timed into a profile entry
 void execute_payload(char *msg);
 
 void CMD_about(char **saveptr);       // Print about / system info
 void CMD_audio(char **saveptr);       // Generate audio sample and send to DAC over SPI
 void CMD_callback(char **saveptr);    // Configure a callback for timer or GPIO events
+void CMD_cpu(char **saveptr);         // Display CPU load per Task, Swi and Hwi
 void CMD_error(char **saveptr);       // Display count of each error type
+void CMD_fec(char **saveptr);         // Configure voice FEC per dial target and the receive jitter depth
+void CMD_flow(char **saveptr);        // Report -goto, -call, -ret and -loop used outside a script line
 void CMD_gpio(char **saveptr);        // Read/Write/Toggle inputed GPIO pin
 void CMD_help(char **saveptr);        // Print help info about all/specific command(s)
 void CMD_if(char **saveptr);          // Conditional execution of payload
+void CMD_lat(char **saveptr);         // Display or reset the latency histograms
+void CMD_load(char **saveptr);        // Restore state saved in the flash store
+void CMD_mem(char **saveptr);         // Display stack, heap and static memory use
 void CMD_memr(char **saveptr);        // Display contents of memory address
+void CMD_netstat(char **saveptr);     // Display or reset network statistics
+void CMD_plc(char **saveptr);         // Select voice loss concealment mode or display its statistics
 void CMD_print(char **saveptr);       // Print inputed string
 void CMD_reg(char **saveptr);         // Perform register operations
 void CMD_rem(char **saveptr);         // Add comments or remarks in scripts
+void CMD_save(char **saveptr);        // Save state to the flash store and set what startup loads
 void CMD_script(char **saveptr);      // Handle operations related to loading and executing scripts
+void CMD_shadow(char **saveptr);      // Show or set shadow registers (log levels, console setup)
 void CMD_sine(char **saveptr);        // Generate a sine wave sample or set the frequency for continuous generation with sample rate based on timer0 period
-void CMD_timer(char **saveptr);       // Sets the periodic timer0 period
+void CMD_timer(char **saveptr);       // Sets the period of callback 0 on Timer0
 void CMD_ticker(char **saveptr);      // Configures ticker and payload
 void CMD_uart(char **saveptr);        // Send payload to UART1
-void ParseVoice(char *ch);       // Copies the given 128 samples into the correct TX buffers and applies correction logic.
+void CMD_var(char **saveptr);         // List named variables
+void CMD_vtimer(char **saveptr);      // Run a payload on its own period, sharing Timer0
+void CMD_watch(char **saveptr);       // Run a payload when a register write makes a condition true
 void CMD_sus(char **saveptr);         // The imposter is sus
 
 // NETUDP
 void ParseNetUDP(char *ch, int32_t binaryCount);
+bool AddNetPacket(uint32_t ipAddr, uint16_t port, const NetPacketHeader *hdr, const void *body, int32_t bodyLen);
 
 #endif  // End of include guard
@@ -0,0 +1,242 @@
+/*
+ *  ======== plc.c ========
+ */
+#include <string.h>
+
+#include "plc.h"
+
+#define PLC_REPEAT_MAX (PLC_HISTORY_LEN * 4 / 5)   // Longest loop that still leaves room for the crossfade
+
+void plc_init(PlcState *st, PlcMode mode, int32_t blockLen) {
+    memset(st, 0, sizeof(PlcState));
+    st->mode = mode;
+    st->blockLen = blockLen;
+}
+
+/// @brief Forget the audio history, keeping the mode and statistics. Used when a stream restarts.
+void plc_reset(PlcState *st) {
+    st->primed = false;
+    st->dc = 0;
+    st->erased = 0;
+    memset(st->history, 0, sizeof(st->history));
+}
+
+void plc_reset_stats(PlcState *st) {
+    st->goodBlocks = 0;
+    st->concealedBlocks = 0;
+    st->mutedBlocks = 0;
+    st->erasures = 0;
+    st->lateBlocks = 0;
+    st->costTotal = 0;
+    st->costMax = 0;
+}
+
+/// @brief Append one block of output to the history, with the DC level removed
+static void plc_push_history(PlcState *st, const uint16_t *block) {
+    int32_t len = st->blockLen;
+    int32_t keep = PLC_HISTORY_LEN - len;
+    int16_t *dst;
+    int32_t i, s;
+
+    if (keep < 0) {
+        block += -keep;
+        len = PLC_HISTORY_LEN;
+        keep = 0;
+    }
+    memmove(st->history, st->history + len, keep * sizeof(int16_t));
+    dst = st->history + keep;
+    for (i = 0; i < len; i++) {
+        s = (int32_t)block[i] - st->dc;
+        if (s > INT16_MAX) s = INT16_MAX;
+        if (s < INT16_MIN) s = INT16_MIN;
+        dst[i] = (int16_t)s;
+    }
+}
+
+/**
+ * @brief Estimates the pitch period of the last PLC_CORR_LEN samples of history.
+ * Coarse search on a 2:1 decimated signal over every second lag, then a full
+ * resolution refinement around the best coarse lag, as in G.711 Appendix I.
+ * The coarse window energy is updated incrementally, so the search costs about
+ * 4k multiply-accumulates and runs once per loss event.
+ * @return Lag in samples, PLC_PITCH_MAX when nothing correlates
+ */
+static int32_t plc_find_pitch(const int16_t *h) {
+    const int16_t *win = h + PLC_HISTORY_LEN - PLC_CORR_LEN;
+    int64_t corr, energy = 0;
+    float score, bestScore = 0.0f;
+    int32_t bestLag = 0;
+    int32_t lag, j, lo, hi;
+
+    // Energy of the decimated window at the first coarse lag
+    for (j = 0; j < PLC_CORR_LEN; j += 2) {
+        energy += (int32_t)win[j - PLC_PITCH_MIN] * win[j - PLC_PITCH_MIN];
+    }
+
+    for (lag = PLC_PITCH_MIN; lag <= PLC_PITCH_MAX; lag += 2) {
+        corr = 0;
+        for (j = 0; j < PLC_CORR_LEN; j += 2) {
+            corr += (int32_t)win[j] * win[j - lag];
+        }
+        if (corr > 0 && energy > 0) {
+            score = (float)corr * (float)corr / (float)energy;
+            if (score > bestScore) {
+                bestScore = score;
+                bestLag = lag;
+            }
+        }
+        // Slide the energy window to lag + 2
+        energy += (int32_t)win[-lag - 2] * win[-lag - 2];
+        energy -= (int32_t)win[PLC_CORR_LEN - 2 - lag] * win[PLC_CORR_LEN - 2 - lag];
+    }
+
+    if (bestLag == 0) {
+        return PLC_PITCH_MAX;   // Silence or noise: a long loop sounds least tonal
+    }
+
+    // Refine at full resolution
+    lo = bestLag - 1 < PLC_PITCH_MIN ? PLC_PITCH_MIN : bestLag - 1;
+    hi = bestLag + 1 > PLC_PITCH_MAX ? PLC_PITCH_MAX : bestLag + 1;
+    bestScore = 0.0f;
+    for (lag = lo; lag <= hi; lag++) {
+        corr = 0;
+        energy = 0;
+        for (j = 0; j < PLC_CORR_LEN; j++) {
+            corr += (int32_t)win[j] * win[j - lag];
+            energy += (int32_t)win[j - lag] * win[j - lag];
+        }
+        if (corr > 0 && energy > 0) {
+            score = (float)corr * (float)corr / (float)energy;
+            if (score > bestScore) {
+                bestScore = score;
+                bestLag = lag;
+            }
+        }
+    }
+    return bestLag;
+}
+
+/**
+ * @brief Next synthetic sample (DC removed). Loops the last periods * pitch samples
+ * of pitchBuf. The last quarter period of the loop is crossfaded into the samples
+ * preceding the loop start, so wrapping around does not click.
+ */
+static int32_t plc_synth(PlcState *st) {
+    int32_t window = st->pitch * st->periods;
+    int32_t q = st->pitch >> 2;
+    int32_t s = st->pitchBuf[st->pos];
+
+    if (st->pos >= PLC_HISTORY_LEN - q) {
+        int32_t k = st->pos - (PLC_HISTORY_LEN - q);
+        int32_t t = st->pitchBuf[st->pos - window];
+        s = (s * (q - k) + t * (k + 1)) / (q + 1);
+    }
+
+    if (++st->pos >= PLC_HISTORY_LEN) {
+        st->pos = PLC_HISTORY_LEN - window;
+    }
+    return s;
+}
+
+/// @brief Q15 gain for the n-th concealed sample of an erasure
+static int32_t plc_gain(const PlcState *st, int32_t n) {
+    if (st->mode == PLC_REPEAT) {
+        // Linear fade over the whole mute interval
+        if (n >= PLC_MUTE_SAMPLES) return 0;
+        return (32768 * (PLC_MUTE_SAMPLES - n)) / PLC_MUTE_SAMPLES;
+    }
+    // Appendix I: full level for 10 ms, then 20% per 10 ms
+    if (n < PLC_ATTEN_START) return 32768;
+    if (n >= PLC_MUTE_SAMPLES) return 0;
+    return (32768 * (PLC_MUTE_SAMPLES - n)) / (PLC_MUTE_SAMPLES - PLC_ATTEN_START);
+}
+
+static uint16_t plc_clamp(int32_t s) {
+    if (s < 0) return 0;
+    if (s > PLC_SAMPLE_MAX) return PLC_SAMPLE_MAX;
+    return (uint16_t)s;
+}
+
+static void plc_start_erasure(PlcState *st) {
+    memcpy(st->pitchBuf, st->history, sizeof(st->pitchBuf));
+
+    if (st->mode == PLC_PITCH) {
+        st->pitch = plc_find_pitch(st->pitchBuf);
+    } else {
+        st->pitch = st->blockLen > PLC_REPEAT_MAX ? PLC_REPEAT_MAX : st->blockLen;
+    }
+    st->lastPitch = st->pitch;
+    st->periods = 1;
+    st->pos = PLC_HISTORY_LEN - st->pitch;
+    st->erasures++;
+}
+
+/**
+ * @brief Overwrites a block that was not refreshed in time with concealment audio.
+ * Consecutive calls continue the same erasure.
+ */
+void plc_conceal_block(PlcState *st, uint16_t *block) {
+    int32_t i, g;
+
+    st->concealedBlocks++;
+    if (st->mode == PLC_OFF || !st->primed) {
+        return;     // Nothing to conceal from, leave the buffer as is
+    }
+
+    if (st->erased == 0) {
+        plc_start_erasure(st);
+    } else if (st->mode == PLC_PITCH && st->periods < 3
+               && st->pitch * (st->periods + 1) + (st->pitch >> 2) <= PLC_HISTORY_LEN) {
+        // Loop more periods as the erasure gets longer, which sounds less buzzy
+        st->periods++;
+    }
+
+    if (st->erased >= PLC_MUTE_SAMPLES) {
+        st->mutedBlocks++;
+    }
+
+    for (i = 0; i < st->blockLen; i++) {
+        g = plc_gain(st, st->erased + i);
+        block[i] = plc_clamp(st->dc + ((plc_synth(st) * g) >> 15));
+    }
+    st->erased += st->blockLen;
+
+    plc_push_history(st, block);
+}
+
+/**
+ * @brief Accepts a freshly received block. After an erasure the start of the block
+ * is overlap-added with the continuing synthetic signal (4 ms, plus 4 ms per
+ * further 10 ms lost, up to 10 ms).
+ */
+void plc_good_block(PlcState *st, uint16_t *block) {
+    int32_t i, sum = 0, mean;
+
+    if (st->erased > 0 && st->mode != PLC_OFF) {
+        int32_t olaLen = PLC_OLA_MIN + PLC_OLA_MIN * ((st->erased - 1) / PLC_ATTEN_START);
+        int32_t syn, good;
+
+        if (olaLen > PLC_OLA_MAX) olaLen = PLC_OLA_MAX;
+        if (olaLen > st->blockLen) olaLen = st->blockLen;
+        for (i = 0; i < olaLen; i++) {
+            syn = (plc_synth(st) * plc_gain(st, st->erased + i)) >> 15;
+            good = (int32_t)block[i] - st->dc;
+            block[i] = plc_clamp(st->dc + (syn * (olaLen - i) + good * i) / olaLen);
+        }
+    }
+    st->erased = 0;
+    st->goodBlocks++;
+
+    for (i = 0; i < st->blockLen; i++) {
+        sum += block[i];
+    }
+    mean = sum / st->blockLen;
+    if (!st->primed) {
+        st->dc = mean;
+        st->primed = true;
+    } else {
+        st->dc += (mean - st->dc) >> 3;
+    }
+
+    plc_push_history(st, block);
+}
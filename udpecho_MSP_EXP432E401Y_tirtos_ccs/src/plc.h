@@ -0,0 +1,75 @@
+/*
+ * plc.h
+ *
+ * Packet loss concealment for 8 kHz voice blocks.
+ *
+ * When the playout reaches a block that no packet refreshed, the block is
+ * synthesized from the recent output instead of replaying stale samples:
+ *   PLC_REPEAT: the last block is looped and faded out over 60 ms.
+ *   PLC_PITCH:  G.711 Appendix I style waveform substitution. The pitch period
+ *               of the last 20 ms is estimated, the last 1-3 periods are looped
+ *               with a quarter-period crossfade and attenuated after 10 ms,
+ *               reaching silence at 60 ms. The first good block after a loss is
+ *               overlap-added with the synthetic signal.
+ *
+ * Samples are unsigned DAC/ADC codes, so all processing is done on the signal
+ * with its running DC level removed. Plain C with no driver dependencies.
+ */
+
+#ifndef SRC_PLC_H_
+#define SRC_PLC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PLC_PITCH_MIN     40    // 5 ms at 8 kHz
+#define PLC_PITCH_MAX     120   // 15 ms at 8 kHz
+#define PLC_CORR_LEN      160   // 20 ms correlation window for the pitch search
+#define PLC_HISTORY_LEN   (PLC_PITCH_MAX * 3 + PLC_PITCH_MAX / 4)   // 3 periods + crossfade (48.75 ms)
+#define PLC_ATTEN_START   80    // Samples concealed before attenuation starts (10 ms)
+#define PLC_MUTE_SAMPLES  480   // Samples concealed before the output is silent (60 ms)
+#define PLC_OLA_MIN       32    // Recovery overlap-add length after a short loss (4 ms)
+#define PLC_OLA_MAX       80    // Recovery overlap-add length cap (10 ms)
+#define PLC_SAMPLE_MAX    0x3FFF  // 14-bit DAC
+
+typedef enum {
+    PLC_OFF,        // Replay whatever is in the buffer (original behaviour)
+    PLC_REPEAT,     // Tier 1: repeat last block with fade
+    PLC_PITCH,      // Tier 2: pitch period waveform substitution
+
+    PLC_MODE_COUNT  // Keeps track of the number of modes
+} PlcMode;
+
+typedef struct PlcState {
+    PlcMode mode;
+    int32_t blockLen;
+    bool    primed;                         // dc and history hold real audio
+    int32_t dc;                             // Running DC level of good blocks
+    int16_t history[PLC_HISTORY_LEN];       // Last output samples minus dc, oldest first
+    int16_t pitchBuf[PLC_HISTORY_LEN];      // Snapshot of history when the erasure started
+
+    // Current erasure
+    int32_t erased;                         // Samples concealed so far, 0 when receiving
+    int32_t pitch;                          // Loop period in samples
+    int32_t periods;                        // Periods looped (1..3)
+    int32_t pos;                            // Read position in pitchBuf
+
+    // Statistics
+    uint32_t goodBlocks;
+    uint32_t concealedBlocks;
+    uint32_t mutedBlocks;                   // Concealed blocks past PLC_MUTE_SAMPLES
+    uint32_t erasures;                      // Runs of consecutive concealed blocks
+    uint32_t lateBlocks;                    // Out of order blocks dropped by the receive path
+    uint32_t costTotal;                     // Concealment cost in us, measured by the caller
+    uint32_t costMax;
+    int32_t  lastPitch;
+} PlcState;
+
+void plc_init(PlcState *st, PlcMode mode, int32_t blockLen);
+void plc_reset(PlcState *st);
+void plc_reset_stats(PlcState *st);
+
+void plc_good_block(PlcState *st, uint16_t *block);
+void plc_conceal_block(PlcState *st, uint16_t *block);
+
+#endif /* SRC_PLC_H_ */
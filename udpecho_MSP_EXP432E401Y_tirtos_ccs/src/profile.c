@@ -0,0 +1,101 @@
+/*
+ *  ======== profile.c ========
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "p100.h"
+#include "script.h"
+#include "tickers.h"
+#include "callback.h"
+#include "profile.h"
+
+ProfileEntry profileScript[SCRIPT_LINE_COUNT];
+static ProfileEntry profileTicker[MAX_TICKERS];
+static ProfileEntry profileCallback[MAX_CALLBACKS];
+
+bool profilePayloads = false;
+
+static const char *profileKindNames[PROF_KIND_COUNT] = { "line", "ticker", "callback" };
+
+static ProfileEntry *profile_entry(ProfileKind kind, int index) {
+    switch (kind) {
+    case PROF_SCRIPT:   return (index >= 0 && index < SCRIPT_LINE_COUNT) ? &profileScript[index] : NULL;
+    case PROF_TICKER:   return (index >= 0 && index < MAX_TICKERS) ? &profileTicker[index] : NULL;
+    case PROF_CALLBACK: return (index >= 0 && index < MAX_CALLBACKS) ? &profileCallback[index] : NULL;
+    default:            return NULL;
+    }
+}
+
+/// @return Tag for a payload queued by a ticker or callback, PROFILE_NONE while payloads are not profiled
+int32_t profile_tag(ProfileKind kind, int index) {
+    return profilePayloads ? PROFILE_TAG(kind, index) : PROFILE_NONE;
+}
+
+void profile_record_tag(int32_t tag, uint32_t cycles) {
+    ProfileEntry *entry;
+
+    if (tag == PROFILE_NONE) {
+        return;
+    }
+    entry = profile_entry((ProfileKind)(tag >> 8), tag & 0xFF);
+    if (entry) {
+        profile_record(entry, cycles);
+    }
+}
+
+void profile_reset() {
+    memset(profileScript, 0, sizeof(profileScript));
+    memset(profileTicker, 0, sizeof(profileTicker));
+    memset(profileCallback, 0, sizeof(profileCallback));
+}
+
+/// @brief Prints every entry that ran, most total cycles first
+void print_profile() {
+    int32_t order[SCRIPT_LINE_COUNT + MAX_TICKERS + MAX_CALLBACKS];
+    const char *text;
+    char msg[128];
+    ProfileEntry *entry, *other;
+    int count = 0, kind, index, i, j;
+    int32_t tag;
+
+    for (kind = 0; kind < PROF_KIND_COUNT; kind++) {
+        for (index = 0; (entry = profile_entry((ProfileKind)kind, index)) != NULL; index++) {
+            if (entry->count == 0) {
+                continue;
+            }
+            // Insertion sort by total cycles, descending
+            tag = PROFILE_TAG(kind, index);
+            for (j = count; j > 0; j--) {
+                other = profile_entry((ProfileKind)(order[j - 1] >> 8), order[j - 1] & 0xFF);
+                if (other->total >= entry->total) {
+                    break;
+                }
+                order[j] = order[j - 1];
+            }
+            order[j] = tag;
+            count++;
+        }
+    }
+
+    AddProgramMessage("=================================== Profile ====================================\r\n");
+    AddProgramMessage("| Source      |    Runs |  Total us | Avg cycle | Max cycle | Payload\r\n");
+    AddProgramMessage("|-------------|---------|-----------|-----------|-----------|--------------------\r\n");
+    for (i = 0; i < count; i++) {
+        kind = order[i] >> 8;
+        index = order[i] & 0xFF;
+        entry = profile_entry((ProfileKind)kind, index);
+        text = kind == PROF_SCRIPT ? scriptLines[index]
+             : (kind == PROF_TICKER ? tickers[index].payload : callbacks[index].payload);
+        sprintf(msg, "| %-8s %2d | %7u | %9u | %9u | %9u | %.18s\r\n", profileKindNames[kind], index,
+                entry->count, (uint32_t)(entry->total / CYCLES_PER_US),
+                (uint32_t)(entry->total / entry->count), entry->max, text);
+        AddProgramMessage(msg);
+    }
+    if (count == 0) {
+        AddProgramMessage("| Nothing profiled yet.\r\n");
+    }
+    sprintf(msg, "| Ticker and callback payloads: %s\r\n", profilePayloads ? "profiled" : "not profiled");
+    AddProgramMessage(msg);
+    AddProgramMessage("================================================================================\r\n");
+}
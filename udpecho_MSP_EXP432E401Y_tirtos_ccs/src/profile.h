@@ -0,0 +1,54 @@
+/*
+ * profile.h
+ *
+ * Execution profile of script lines and, when profilePayloads is set, of
+ * ticker and callback payloads. Each entry counts runs and accumulates the
+ * cycles (cycles.h) they took:
+ *
+ *   script lines   timed around script_exec_line() by script_run_quantum()
+ *   tickers        queued with a PROFILE_TAG and timed by executePayloadTask
+ *   callbacks      the same, callback 0 is timed in timer0SWI
+ */
+
+#ifndef SRC_PROFILE_H_
+#define SRC_PROFILE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "cycles.h"
+
+typedef enum {
+    PROF_SCRIPT,
+    PROF_TICKER,
+    PROF_CALLBACK,
+
+    PROF_KIND_COUNT
+} ProfileKind;
+
+#define PROFILE_TAG(kind, index) ((int32_t)(kind) << 8 | (index))  // Identifies a queued payload
+#define PROFILE_NONE             -1
+
+typedef struct ProfileEntry {
+    uint32_t count;
+    uint32_t max;               // Cycles of the longest run
+    uint64_t total;             // Cycles of all runs
+} ProfileEntry;
+
+extern ProfileEntry profileScript[];
+extern bool profilePayloads;    // Also tag and time ticker and callback payloads
+
+static inline void profile_record(ProfileEntry *entry, uint32_t cycles) {
+    entry->count++;
+    entry->total += cycles;
+    if (cycles > entry->max) {
+        entry->max = cycles;
+    }
+}
+
+int32_t profile_tag(ProfileKind kind, int index);
+void profile_record_tag(int32_t tag, uint32_t cycles);
+void profile_reset();
+void print_profile();
+
+#endif /* SRC_PROFILE_H_ */
@@ -17,7 +17,15 @@
  */
 #include "register.h"
 #include <stdbool.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
 #include "p100.h"
+#include "watch.h"
+#include "atomic.h"
+#include "var.h"
 
 int32_t registers[NUM_REGISTERS] = {0};
 
@@ -27,6 +35,9 @@ void init_registers() {
     for (i = 0; i < NUM_REGISTERS; i++) {
         registers[i] = 0;
     }
+    memset(longRegisters, 0, sizeof(longRegisters));
+    memset(floatRegisters, 0, sizeof(floatRegisters));
+    memset(stringRegisters, 0, sizeof(stringRegisters));
 }
 
 /// @brief Print the values of all registers
@@ -44,25 +55,22 @@ void print_all_registers() {
     }
 }
 
-/// @brief Returns the register number for a given token
+/// @brief Returns the register number for a given token (eg. R5, r5 or 5)
 /// @param token Character array containing the token to parse
 /// @return Register number if valid, -1 otherwise
 int parse_register(char *token) {
+    const char *digits;
+    char *endptr;
+    long reg_num;
+
     if (!token) return -1;
-    // Check for register with 'r' prefix
-    if (token[0] == 'r' || token[0] == 'R') {
-        int reg_num = atoi(&token[1]);
-        if (reg_num >= 0 && reg_num < NUM_REGISTERS) {
-            return reg_num;
-        }
-    // Check for register without 'r' prefix
-    } else if (token[0] != '#' && token[0] != '@' && token[0] != '$' && token[0] != 'h') {
-        int reg_num = atoi(token);
-        if (reg_num >= 0 && reg_num < NUM_REGISTERS) {
-            return reg_num;
-        }
-    }
-    return -1; // Invalid register
+    digits = (token[0] == 'r' || token[0] == 'R') ? &token[1] : token;
+
+    // Only plain decimal digits, so "foo" or "R5x" are not taken for a register
+    if (!isdigit((unsigned char)digits[0])) return -1;
+    reg_num = strtol(digits, &endptr, 10);
+    if (*endptr != '\0' || reg_num >= NUM_REGISTERS) return -1;
+    return (int)reg_num;
 }
 
 /// @brief Parses immediate values (eg. #10, #0xFF)
@@ -115,7 +123,7 @@ bool parse_memory_address(char *token, uint32_t *address) {
         return (*endptr == '\0');
     }
     
-    return (*endptr == '\0');
+    return false;
 }
 
 
@@ -140,164 +148,278 @@ bool is_valid_memory_address(uint32_t address) {
 // Register Operations
 //==============================================================================
 
-/// @brief Move a value to a register, whether it be a register, immediate value, or memory address
-/// @param dest_token Character array containing the destination token
-/// @param src_token Character array containing the source token
-void reg_mov(char *dest_token, char *src_token) {
-    int dest_reg = parse_register(dest_token);
-    int32_t src_value;
-
-    // Parse operands
-    if (!parse_operands(dest_token, src_token, &dest_reg, &src_value)) {
-        return;
+const char *regOpNames[REG_OP_COUNT] = {
+    "mov", "xchg", "inc", "dec", "not", "neg", "and", "ior",
+    "xor", "add", "sub", "mul", "div", "rem", "max", "min"
+};
+
+/// @brief Looks up an operation name (lower case)
+/// @return The operation, REG_OP_COUNT if unknown
+RegOp reg_lookup_op(const char *name) {
+    int op;
+    for (op = 0; op < REG_OP_COUNT; op++) {
+        if (strcmp(name, regOpNames[op]) == 0) {
+            break;
+        }
     }
+    return (RegOp)op;
+}
 
-    registers[dest_reg] = src_value;
-
-    char msg[BUFFER_SIZE];
-    sprintf(msg, "R%d = %d\r\n", dest_reg, src_value);
-    AddProgramMessage(msg);
+/// @brief Number of operands an operation takes (1 or 2)
+int reg_op_operands(RegOp op) {
+    return (op == REG_INC || op == REG_DEC || op == REG_NOT || op == REG_NEG) ? 1 : 2;
 }
 
-/// @brief Exchange the values of two registers
-/// @param reg1_token Character array containing the first register token
-/// @param reg2_token Character array containing the second register token
-void reg_xchg(char *reg1_token, char *reg2_token) {
-    int reg1 = parse_register(reg1_token);
-    int reg2 = parse_register(reg2_token);
-
-    if (reg1 == -1 || reg2 == -1) {
-        AddProgramMessage("Error: Invalid register.\r\n");  //  TODO: Add to errors
-        return;
+/// @brief Result of a single operand or two operand operation on values a and b
+/// @return False on division by zero
+static bool reg_compute(RegOp op, int32_t a, int32_t b, int32_t *result) {
+    switch (op) {
+    case REG_NOT:  *result = ~a;                    break;
+    case REG_NEG:  *result = (int32_t)-(uint32_t)a;  break;
+    case REG_AND:  *result = a & b;                 break;
+    case REG_IOR:  *result = a | b;                 break;
+    case REG_XOR:  *result = a ^ b;                 break;
+    case REG_MUL:  *result = (int32_t)((uint32_t)a * (uint32_t)b); break;
+    case REG_DIV:
+        if (b == 0) return false;
+        *result = a / b;
+        break;
+    case REG_REM:
+        if (b == 0) return false;
+        *result = a % b;
+        break;
+    case REG_MAX:  *result = a < b ? b : a;         break;
+    case REG_MIN:  *result = a > b ? b : a;         break;
+    default:       *result = a;                     break;
     }
+    return true;
+}
 
-    int32_t temp = registers[reg1];
-    registers[reg1] = registers[reg2];
-    registers[reg2] = temp;
+/// @brief Applies an operation to operands that are already resolved. The update of dst
+/// is atomic (atomic.h), so Swis and Hwis writing the same register lose no updates.
+/// @param dst Destination register
+/// @param src Source value (a register for REG_XCHG), unused by single operand operations
+/// @return False on division by zero, dst is left unchanged
+bool reg_apply(RegOp op, int32_t *dst, int32_t *src) {
+    int32_t old, value, operand;
+
+    switch (op) {
+    case REG_MOV:  atomic32_store(dst, atomic32_load(src));     return true;
+    case REG_INC:  atomic32_fetch_add(dst, 1);                  return true;
+    case REG_DEC:  atomic32_fetch_add(dst, -1);                 return true;
+    case REG_ADD:  atomic32_fetch_add(dst, atomic32_load(src)); return true;
+    case REG_SUB:  atomic32_fetch_sub(dst, atomic32_load(src)); return true;
+    case REG_XCHG:
+        // Each register is written atomically, the pair is not swapped as one
+        value = atomic32_load(src);
+        atomic32_store(src, atomic32_xchg(dst, value));
+        return true;
+    default:
+        break;
+    }
 
-    char msg[BUFFER_SIZE];
-    sprintf(msg, "R%d = %d, R%d = %d\r\n", reg1, registers[reg1], reg2, registers[reg2]);
-    AddProgramMessage(msg);
+    operand = src ? atomic32_load(src) : 0;
+    old = atomic32_load(dst);
+    do {
+        if (!reg_compute(op, old, operand, &value)) {
+            return false;
+        }
+    } while (!atomic32_cas(dst, &old, value));
+    return true;
 }
 
-/// @brief Increment the value in a register
-/// @param reg_token Character array containing the register token
-void reg_inc(char *reg_token) {
-    int reg = parse_register(reg_token);
+/// @brief Returns the register or variable a token names: Rn, r5, 5 or $name
+/// @param reg Set to the register number, -1 for a variable
+/// @return Pointer to its value, NULL if the token names neither
+int32_t *parse_target(char *token, int *reg) {
+    int slot;
 
-    if (reg == -1) {
-        AddProgramMessage("Error: Invalid register.\r\n");  // TODO: Add to errors
-        return;
+    if ((*reg = parse_register(token)) != -1) {
+        return &registers[*reg];
     }
-
-    registers[reg] += 1;
-
-    char msg[BUFFER_SIZE];
-    sprintf(msg, "R%d = %d\r\n", reg, registers[reg]);
-    AddProgramMessage(msg);
+    if ((slot = var_parse(token)) != -1) {
+        return &varValues[slot];
+    }
+    return NULL;
 }
 
-/// @brief Decrement the value in a register
-/// @param reg_token Character array containing the register token
-void reg_dec(char *reg_token) {
-    int reg = parse_register(reg_token);
+/// @brief Formats the name of a register or variable: R5 or $gain
+static void reg_target_name(char *name, const int32_t *target) {
+    int slot = var_slot(target);
 
-    if (reg == -1) {
-        AddProgramMessage("Error: Invalid register.\r\n");  // TODO: Add to errors
-        return;
+    if (slot != -1) {
+        sprintf(name, "$%s", var_name(slot));
+    } else {
+        sprintf(name, "R%d", (int)(target - registers));
     }
+}
 
-    registers[reg] -= 1;
-
+/// @brief Prints the registers or variables changed by an operation
+/// @param src Source for REG_XCHG, ignored otherwise
+void reg_report(RegOp op, int32_t *dst, int32_t *src) {
     char msg[BUFFER_SIZE];
-    sprintf(msg, "R%d = %d\r\n", reg, registers[reg]);
+    char dstName[VAR_NAME_SIZE + 1], srcName[VAR_NAME_SIZE + 1];
+
+    reg_target_name(dstName, dst);
+    if (op == REG_XCHG) {
+        reg_target_name(srcName, src);
+        sprintf(msg, "%s = %d, %s = %d\r\n", dstName, (int)*dst, srcName, (int)*src);
+    } else {
+        sprintf(msg, "%s = %d\r\n", dstName, (int)*dst);
+    }
     AddProgramMessage(msg);
 }
 
-
-//==============================================================================
-// Logical operations
-//==============================================================================
-
-/// @brief Perform bitwise NOT operation on a register
-/// @param reg_token Character array containing the register token
-void reg_not(char *reg_token) {
-    int reg = parse_register(reg_token);
-
-    if (reg == -1) {
-        AddProgramMessage("Error: Invalid register.\r\n");  // TODO: Add to errors
-        return;
+/// @brief Parses the operand tokens of an operation, applies it and prints the result
+/// @param dest_token Character array containing the destination register or variable token
+/// @param src_token Character array containing the source token, NULL for single operand operations
+/// @param quiet Skip the result line, errors are still printed
+/// @return Whether the operation was applied
+bool reg_exec(RegOp op, char *dest_token, char *src_token, bool quiet) {
+    int dest_reg, src_reg = -1;
+    int32_t src_value = 0;
+    int32_t *dst, *src = &src_value;
+
+    if (reg_is_typed(dest_token, src_token)) {
+        return reg_exec_typed(op, dest_token, src_token, quiet);
+    }
+    if (op == REG_XCHG || reg_op_operands(op) == 1) {
+        dst = parse_target(dest_token, &dest_reg);
+        if (op == REG_XCHG) {
+            src = parse_target(src_token, &src_reg);
+        }
+        if (!dst || !src) {
+            AddProgramMessage("Error: Invalid register.\r\n");  // TODO: Add to errors
+            return false;
+        }
+    } else if (!parse_operands(dest_token, src_token, &dst, &dest_reg, &src_value)) {
+        return false;
     }
 
-    registers[reg] = ~registers[reg];
-
-    char msg[BUFFER_SIZE];
-    sprintf(msg, "R%d = %d\r\n", reg, registers[reg]);
-    AddProgramMessage(msg);
+    if (!reg_apply(op, dst, src)) {
+        AddProgramMessage("Error: Division by zero.\r\n");
+        return false;
+    }
+    if (!quiet) {
+        reg_report(op, dst, src);
+    }
+    if (dest_reg != -1) {
+        watch_notify(dest_reg);
+    }
+    if (src_reg != -1) {
+        watch_notify(src_reg);
+    }
+    return true;
 }
 
-/// @brief Perform bitwise AND operation on two values and store the result in the destination register
-/// @param dest_token Character array containing the destination token
-/// @param src_token Character array containing the source token
-void reg_and(char *dest_token, char *src_token) {
-    int dest_reg;
-    int32_t src_value;
+/**
+ * @brief Applies "op a b; op a b; ..." in one call. Operations run in order and
+ * the first one that fails stops the batch. Instead of a line per operation, a
+ * single summary lists the registers that were written.
+ * @param ops Operations separated by ';', optionally enclosed in double quotes
+ * @param quiet Skip the summary, errors are still printed
+ * @return Number of operations applied
+ */
+int reg_batch(char *ops, bool quiet) {
+    char msg[NUM_REGISTERS * 20 + 48];
+    char *opSave, *argSave;
+    char *item, *op_token, *arg1, *arg2, *p;
+    uint32_t written = 0;
+    uint32_t mask;
+    int applied = 0;
+    int len, reg;
+    RegOp op;
+    VecOp vop;
+
+    while (*ops == ' ' || *ops == '"') {
+        ops++;
+    }
+    len = strlen(ops);
+    while (len > 0 && (ops[len - 1] == ' ' || ops[len - 1] == '"')) {
+        ops[--len] = '\0';
+    }
+
+    for (item = strtok_r(ops, ";", &opSave); item; item = strtok_r(NULL, ";", &opSave)) {
+        op_token = strtok_r(item, " \t", &argSave);
+        if (!op_token) {
+            continue;   // Empty item, e.g. a trailing ';'
+        }
+        for (p = op_token; *p; ++p) {
+            *p = tolower((unsigned char)*p);
+        }
+        arg1 = strtok_r(NULL, " \t", &argSave);
+        arg2 = strtok_r(NULL, " \t", &argSave);
+
+        vop = vec_lookup_op(op_token);
+        if (vop != VEC_OP_COUNT && arg1 && arg2) {
+            mask = vec_exec(vop, arg1, arg2, strtok_r(NULL, " \t", &argSave), true);
+            if (mask == 0) {
+                break;
+            }
+            applied++;
+            written |= mask;
+            continue;
+        }
 
-    // Parse operands
-    if (!parse_operands(dest_token, src_token, &dest_reg, &src_value)) {
-        return;
+        op = reg_lookup_op(op_token);
+        if (vop != VEC_OP_COUNT || op == REG_OP_COUNT || !arg1 || (reg_op_operands(op) == 2 && !arg2)) {
+            sprintf(msg, "Error: Invalid batch operation \"%.20s\".\r\n", op_token);
+            AddProgramMessage(msg);
+            break;
+        }
+        if (!reg_exec(op, arg1, arg2, true)) {
+            break;
+        }
+        applied++;
+        if ((reg = parse_register(arg1)) != -1) {
+            written |= 1u << reg;       // Typed registers are not in the summary
+        }
+        if (op == REG_XCHG && (reg = parse_register(arg2)) != -1) {
+            written |= 1u << reg;
+        }
     }
 
-    // Perform bitwise AND operation
-    registers[dest_reg] &= src_value;
-
-    // Output the result
-    char msg[BUFFER_SIZE];
-    sprintf(msg, "R%d = %d\r\n", dest_reg, registers[dest_reg]);
-    AddProgramMessage(msg);
+    if (!quiet) {
+        len = sprintf(msg, "Batch: %d ops applied", applied);
+        for (reg = 0; reg < NUM_REGISTERS; reg++) {
+            if (written & (1u << reg)) {
+                len += sprintf(&msg[len], ", R%d = %d", reg, registers[reg]);
+            }
+        }
+        sprintf(&msg[len], "\r\n");
+        AddProgramMessage(msg);
+    }
+    return applied;
 }
 
-/// @brief Perform bitwise OR operation on two values and store the result in the destination register
-/// @param dest_token Character array containing the destination token
-/// @param src_token Character array containing the source token
-void reg_ior(char *dest_token, char *src_token) {
-    int dest_reg;
-    int32_t src_value;
+/// @brief Move a value to a register, whether it be a register, immediate value, or memory address
+void reg_mov(char *dest_token, char *src_token) { reg_exec(REG_MOV, dest_token, src_token, false); }
 
-    // Parse operands
-    if (!parse_operands(dest_token, src_token, &dest_reg, &src_value)) {
-        return;
-    }
+/// @brief Exchange the values of two registers
+void reg_xchg(char *reg1_token, char *reg2_token) { reg_exec(REG_XCHG, reg1_token, reg2_token, false); }
 
-    // Perform bitwise OR operation
-    registers[dest_reg] |= src_value;
+/// @brief Increment the value in a register
+void reg_inc(char *reg_token) { reg_exec(REG_INC, reg_token, NULL, false); }
 
-    // Output the result
-    char msg[BUFFER_SIZE];
-    sprintf(msg, "R%d = %d\r\n", dest_reg, registers[dest_reg]);
-    AddProgramMessage(msg);
-}
+/// @brief Decrement the value in a register
+void reg_dec(char *reg_token) { reg_exec(REG_DEC, reg_token, NULL, false); }
 
-/// @brief Perform bitwise XOR operation on two values and store the result in the destination register
-/// @param dest_token Character array containing the destination token
-/// @param src_token Character array containing the source token
-void reg_xor(char *dest_token, char *src_token) {
-    int dest_reg;
-    int32_t src_value;
 
-    // Parse operands
-    if (!parse_operands(dest_token, src_token, &dest_reg, &src_value)) {
-        return;
-    }
+//==============================================================================
+// Logical operations
+//==============================================================================
 
-    // Perform bitwise XOR operation
-    registers[dest_reg] ^= src_value;
+/// @brief Perform bitwise NOT operation on a register
+void reg_not(char *reg_token) { reg_exec(REG_NOT, reg_token, NULL, false); }
 
-    // Output the result
-    char msg[BUFFER_SIZE];
-    sprintf(msg, "R%d = %d\r\n", dest_reg, registers[dest_reg]);
-    AddProgramMessage(msg);
-}
+/// @brief Perform bitwise AND operation on two values and store the result in the destination register
+void reg_and(char *dest_token, char *src_token) { reg_exec(REG_AND, dest_token, src_token, false); }
+
+/// @brief Perform bitwise OR operation on two values and store the result in the destination register
+void reg_ior(char *dest_token, char *src_token) { reg_exec(REG_IOR, dest_token, src_token, false); }
+
+/// @brief Perform bitwise XOR operation on two values and store the result in the destination register
+void reg_xor(char *dest_token, char *src_token) { reg_exec(REG_XOR, dest_token, src_token, false); }
 
 
 
@@ -308,26 +430,28 @@ void reg_xor(char *dest_token, char *src_token) {
 /// @brief Parses operands for arithmetic operations
 /// @param dest_token Character array containing the destination token
 /// @param src_token Character array containing the source token
-/// @param dest_reg Integer to store the destination register
+/// @param dest Pointer to store the destination register or variable
+/// @param dest_reg Integer to store the destination register, -1 for a variable
 /// @param src_value 32-bit integer to store the source value
 /// @return 
-bool parse_operands(char *dest_token, char *src_token, int *dest_reg, int32_t *src_value) {
+bool parse_operands(char *dest_token, char *src_token, int32_t **dest, int *dest_reg, int32_t *src_value) {
     uint32_t address;
-    *dest_reg = parse_register(dest_token);
-    if (*dest_reg == -1) {
+    int32_t *src;
+    int src_reg;
+
+    *dest = parse_target(dest_token, dest_reg);
+    if (!*dest) {
         AddProgramMessage("Error: Invalid destination register.\r\n");  // TODO: Add to errors
         return false;
     }
 
-    int src_reg = parse_register(src_token);
-    if (src_reg != -1) {
-        // Source is a register
-        *src_value = registers[src_reg];
-        AddProgramMessage("Register.\r\n");
+    src = parse_target(src_token, &src_reg);
+    if (src) {
+        // Source is a register or variable
+        *src_value = atomic32_load(src);
     }
     else if (parse_immediate(src_token, src_value)) {
-        // Immediate value
-        AddProgramMessage("Immediate.\r\n");
+        // Immediate value, already in *src_value
     }
     else if (parse_memory_address(src_token, &address)) {
         if (!is_valid_memory_address(address)) {
@@ -336,7 +460,6 @@ bool parse_operands(char *dest_token, char *src_token, int *dest_reg, int32_t *s
         }
         // Memory address (grad students)
         *src_value = *(int32_t *)address;
-        AddProgramMessage("Memory Address.\r\n");
     }
     else {
         AddProgramMessage("Error: Invalid source operand.\r\n");  // TODO: Add to errors
@@ -347,169 +470,532 @@ bool parse_operands(char *dest_token, char *src_token, int *dest_reg, int32_t *s
 }
 
 /// @brief Add two values and store the result in the destination register
-/// @param dest_token 
-/// @param src_token 
-void reg_add(char *dest_token, char *src_token) {
-    int dest_reg;
-    int32_t src_value;
+void reg_add(char *dest_token, char *src_token) { reg_exec(REG_ADD, dest_token, src_token, false); }
 
-    if (!parse_operands(dest_token, src_token, &dest_reg, &src_value)) {
-        return;
+/// @brief Subtract two values and store the result in the destination register
+void reg_sub(char *dest_token, char *src_token) { reg_exec(REG_SUB, dest_token, src_token, false); }
+
+/// @brief Multiply two values and store the result in the destination register
+void reg_mul(char *dest_token, char *src_token) { reg_exec(REG_MUL, dest_token, src_token, false); }
+
+/// @brief Divide two values and store the result in the destination register
+void reg_div(char *dest_token, char *src_token) { reg_exec(REG_DIV, dest_token, src_token, false); }
+
+/// @brief Take the remainder of two values and store the result in the destination register
+void reg_rem(char *dest_token, char *src_token) { reg_exec(REG_REM, dest_token, src_token, false); }
+
+/// @brief Negate the value in a register
+void reg_neg(char *reg_token) { reg_exec(REG_NEG, reg_token, NULL, false); }
+
+
+//==============================================================================
+// Maximum and Minimum
+//==============================================================================
+
+/// @brief Store the maximum of two values in the destination register
+void reg_max(char *dest_token, char *src_token) { reg_exec(REG_MAX, dest_token, src_token, false); }
+
+/// @brief Store the minimum of two values in the destination register
+void reg_min(char *dest_token, char *src_token) { reg_exec(REG_MIN, dest_token, src_token, false); }
+
+
+//==============================================================================
+// Vector Operations
+//==============================================================================
+
+const char *vecOpNames[VEC_OP_COUNT] = {
+    "vmov", "vadd", "vsub", "vmul", "vand", "vior", "vxor", "vmax", "vmin",
+    "vscale", "vsum", "vdot", "vrmax", "vrmin"
+};
+
+/// @brief Looks up a vector operation name (lower case)
+/// @return The operation, VEC_OP_COUNT if unknown
+VecOp vec_lookup_op(const char *name) {
+    int op;
+    for (op = 0; op < VEC_OP_COUNT; op++) {
+        if (strcmp(name, vecOpNames[op]) == 0) {
+            break;
+        }
     }
+    return (VecOp)op;
+}
 
-    registers[dest_reg] += src_value;
+/// @brief Parses a register range (eg. r0:7, r0:r7, 0:7) or a single register (r3)
+/// @return Whether the token is a valid range, first <= last
+bool parse_register_range(char *token, int *first, int *count) {
+    char *colon;
+    int last;
+
+    if (!token) return false;
+    colon = strchr(token, ':');
+    if (!colon) {
+        *first = parse_register(token);
+        *count = 1;
+        return *first != -1;
+    }
+
+    *colon = '\0';
+    *first = parse_register(token);
+    last = parse_register(colon + 1);
+    *colon = ':';
+    if (*first == -1 || last < *first) return false;
+    *count = last - *first + 1;
+    return true;
+}
 
-    char msg[BUFFER_SIZE];
-    sprintf(msg, "R%d = %d\r\n", dest_reg, registers[dest_reg]);
-    AddProgramMessage(msg);
+/// @brief Clamps a 64-bit accumulator to the int32_t range
+static int32_t vec_saturate(int64_t value) {
+    if (value > INT32_MAX) return INT32_MAX;
+    if (value < INT32_MIN) return INT32_MIN;
+    return (int32_t)value;
 }
 
-/// @brief Subtract two values and store the result in the destination register
-/// @param dest_token 
-/// @param src_token 
-void reg_sub(char *dest_token, char *src_token) {
-    int dest_reg;
-    int32_t src_value;
+// Atomically replaces every element with expr of its old value, see reg_apply()
+#define VEC_UPDATE(expr)                                                    \
+    for (; dst < end; dst++, src += step) {                                 \
+        old = atomic32_load(dst);                                           \
+        while (!atomic32_cas(dst, &old, (expr)));                           \
+    }
+
+/// @brief Element-wise dst[i] op= src[i]. step is 0 to apply one source value to every element.
+static void vec_elementwise(VecOp op, int32_t *dst, const int32_t *src, int step, int n) {
+    int32_t *end = dst + n;
+    int32_t old;
+
+    switch (op) {
+    case VEC_MOV: for (; dst < end; dst++, src += step) atomic32_store(dst, *src); break;
+    case VEC_ADD: for (; dst < end; dst++, src += step) atomic32_fetch_add(dst, *src); break;
+    case VEC_SUB: for (; dst < end; dst++, src += step) atomic32_fetch_sub(dst, *src); break;
+    case VEC_MUL: VEC_UPDATE((int32_t)((uint32_t)old * (uint32_t)*src)); break;
+    case VEC_AND: VEC_UPDATE(old & *src);                   break;
+    case VEC_IOR: VEC_UPDATE(old | *src);                   break;
+    case VEC_XOR: VEC_UPDATE(old ^ *src);                   break;
+    case VEC_MAX: VEC_UPDATE(old < *src ? *src : old);      break;
+    case VEC_MIN: VEC_UPDATE(old > *src ? *src : old);      break;
+    default:
+        break;
+    }
+}
 
-    if (!parse_operands(dest_token, src_token, &dest_reg, &src_value)) {
-        return;
+/// @brief Reduces n registers to one value: sum, dot product with b, maximum or minimum
+static int32_t vec_reduce(VecOp op, const int32_t *a, const int32_t *b, int n) {
+    const int32_t *end = a + n;
+    int64_t acc = 0;    // 64-bit multiply-accumulate, a single SMLAL per element on the M4
+    int32_t best;
+
+    switch (op) {
+    case VEC_SUM:
+        for (; a < end; a++) acc += *a;
+        return vec_saturate(acc);
+    case VEC_DOT:
+        for (; a < end; a++, b++) acc += (int64_t)*a * *b;
+        return vec_saturate(acc);
+    case VEC_RMAX:
+        for (best = *a++; a < end; a++) if (best < *a) best = *a;
+        return best;
+    default:
+        for (best = *a++; a < end; a++) if (best > *a) best = *a;
+        return best;
     }
+}
 
-    registers[dest_reg] -= src_value;
+/// @brief Prints registers first..first+count-1 on one line
+static void vec_report(int first, int count) {
+    char msg[NUM_REGISTERS * 12 + 16];
+    int len, i;
 
-    char msg[BUFFER_SIZE];
-    sprintf(msg, "R%d = %d\r\n", dest_reg, registers[dest_reg]);
+    if (count == 1) {
+        len = sprintf(msg, "R%d =", first);
+    } else {
+        len = sprintf(msg, "R%d-R%d =", first, first + count - 1);
+    }
+    for (i = first; i < first + count; i++) {
+        len += sprintf(&msg[len], " %d", registers[i]);
+    }
+    sprintf(&msg[len], "\r\n");
     AddProgramMessage(msg);
 }
 
-/// @brief Multiply two values and store the result in the destination register
-/// @param dest_token 
-/// @param src_token 
-void reg_mul(char *dest_token, char *src_token) {
-    int dest_reg;
-    int32_t src_value;
+/**
+ * @brief Parses and applies a vector operation:
+ *   vmov..vmin  dst-range src        src is a range of the same length, or one
+ *                                    register, immediate or memory value
+ *   vscale      dst-range #k [#s]    dst[i] = dst[i] * k >> s, saturated
+ *   vsum, vrmax, vrmin  dst src-range
+ *   vdot        dst a-range b-range  sum of a[i] * b[i], saturated
+ * Ranges may overlap, elements are processed from the lowest register up.
+ * @param quiet Skip the result line, errors are still printed
+ * @return Bit per register written, 0 if the operation was not applied
+ */
+uint32_t vec_exec(VecOp op, char *arg1, char *arg2, char *arg3, bool quiet) {
+    int dst, dstCount, src, srcCount, b, bCount;
+    int32_t value, shift = 0;
+    uint32_t address;
+    int i;
 
-    if (!parse_operands(dest_token, src_token, &dest_reg, &src_value)) {
-        return;
+    if (!parse_register_range(arg1, &dst, &dstCount)) {
+        AddProgramMessage("Error: Invalid destination register range.\r\n");
+        return 0;
     }
 
-    registers[dest_reg] *= src_value;
+    if (op >= VEC_SUM) {
+        if (dstCount != 1 || !parse_register_range(arg2, &src, &srcCount)
+            || (op == VEC_DOT && (!parse_register_range(arg3, &b, &bCount) || bCount != srcCount))) {
+            AddProgramMessage("Error: Usage: vsum|vrmax|vrmin Rd Ra:b, vdot Rd Ra:b Rc:d\r\n");
+            return 0;
+        }
+        atomic32_store(&registers[dst],
+                       vec_reduce(op, &registers[src], op == VEC_DOT ? &registers[b] : NULL, srcCount));
 
-    char msg[BUFFER_SIZE];
-    sprintf(msg, "R%d = %d\r\n", dest_reg, registers[dest_reg]);
-    AddProgramMessage(msg);
-}
+    } else if (op == VEC_SCALE) {
+        if (!parse_immediate(arg2, &value) || (arg3 && (!parse_immediate(arg3, &shift) || shift < 0 || shift > 31))) {
+            AddProgramMessage("Error: Usage: vscale Ra:b #factor [#shift]\r\n");
+            return 0;
+        }
+        for (i = dst; i < dst + dstCount; i++) {
+            int32_t old = atomic32_load(&registers[i]);
+            while (!atomic32_cas(&registers[i], &old, vec_saturate(((int64_t)old * value) >> shift)));
+        }
 
-/// @brief Divide two values and store the result in the destination register
-/// @param dest_token 
-/// @param src_token 
-void reg_div(char *dest_token, char *src_token) {
-    int dest_reg;
-    int32_t src_value;
+    } else if (parse_register_range(arg2, &src, &srcCount) && srcCount > 1) {
+        if (srcCount != dstCount) {
+            AddProgramMessage("Error: Register ranges differ in length.\r\n");
+            return 0;
+        }
+        vec_elementwise(op, &registers[dst], &registers[src], 1, dstCount);
 
-    if (!parse_operands(dest_token, src_token, &dest_reg, &src_value)) {
-        return;
+    } else {
+        // One value applied to every element
+        if (parse_register_range(arg2, &src, &srcCount)) {
+            value = registers[src];
+        } else if (parse_memory_address(arg2, &address) && is_valid_memory_address(address)) {
+            value = *(int32_t *)address;
+        } else if (!parse_immediate(arg2, &value)) {
+            AddProgramMessage("Error: Invalid source operand.\r\n");
+            return 0;
+        }
+        vec_elementwise(op, &registers[dst], &value, 0, dstCount);
     }
 
-    if (src_value == 0) {
-        AddProgramMessage("Error: Division by zero.\r\n");
-        return;
+    if (!quiet) {
+        vec_report(dst, dstCount);
+    }
+    for (i = dst; i < dst + dstCount; i++) {
+        watch_notify(i);
     }
+    return dstCount == NUM_REGISTERS ? 0xFFFFFFFFu : ((1u << dstCount) - 1) << dst;
+}
 
-    registers[dest_reg] /= src_value;
 
-    char msg[BUFFER_SIZE];
-    sprintf(msg, "R%d = %d\r\n", dest_reg, registers[dest_reg]);
-    AddProgramMessage(msg);
-}
+//==============================================================================
+// Typed Register Banks
+//==============================================================================
 
-/// @brief Take the remainder of two values and store the result in the destination register
-/// @param dest_token 
-/// @param src_token 
-void reg_rem(char *dest_token, char *src_token) {
-    int dest_reg;
-    int32_t src_value;
+int64_t longRegisters[NUM_LONG_REGISTERS];
+float   floatRegisters[NUM_FLOAT_REGISTERS];
+char    stringRegisters[NUM_STRING_REGISTERS][STRING_REGISTER_SIZE];
 
-    if (!parse_operands(dest_token, src_token, &dest_reg, &src_value)) {
-        return;
+static const char regTypePrefix[RT_TYPE_COUNT] = { 'R', 'L', 'F', 'S' };
+static const int  regTypeCount[RT_TYPE_COUNT] = {
+    NUM_REGISTERS, NUM_LONG_REGISTERS, NUM_FLOAT_REGISTERS, NUM_STRING_REGISTERS
+};
+
+/// @brief Parses a typed register token: Ln (64-bit), Fn (float) or Sn (string), either case
+/// @return Whether the token names one, *type and *index are set if so
+bool parse_typed_register(const char *token, RegType *type, int *index) {
+    char *endptr;
+    long num;
+    int t;
+
+    if (!token) return false;
+    for (t = RT_LONG; t < RT_TYPE_COUNT; t++) {
+        if (toupper((unsigned char)token[0]) == regTypePrefix[t]) {
+            break;
+        }
     }
+    if (t == RT_TYPE_COUNT || !isdigit((unsigned char)token[1])) return false;
+    num = strtol(&token[1], &endptr, 10);
+    if (*endptr != '\0' || num >= regTypeCount[t]) return false;
+    *type = (RegType)t;
+    *index = (int)num;
+    return true;
+}
 
-    if (src_value == 0) {
-        AddProgramMessage("Error: Division by zero.\r\n");
-        return;
+/// @brief Parses any source operand into a typed value. Immediates with a '.' or an
+/// exponent are float, "text" (no blanks) is a string.
+static bool parse_typed_value(char *token, RegValue *value) {
+    int32_t *target;
+    RegType type;
+    uint32_t address;
+    char *endptr;
+    int index, len;
+
+    value->reg = -1;
+    if (!token) {
+        return false;
     }
+    if (parse_typed_register(token, &type, &index)) {
+        value->type = type;
+        value->reg = index;
+        switch (type) {
+        case RT_LONG:  value->v.l = longRegisters[index];    break;
+        case RT_FLOAT: value->v.f = floatRegisters[index];   break;
+        default:       value->v.s = stringRegisters[index];  break;
+        }
+        return true;
+    }
+    value->type = RT_INT;
+    if ((target = parse_target(token, &index)) != NULL) {
+        value->reg = index;
+        value->v.i = atomic32_load(target);
+        return true;
+    }
+    if (parse_immediate(token, &value->v.i)) {
+        return true;
+    }
+    if (token[0] == '#' && strpbrk(token, ".eE")) {
+        value->type = RT_FLOAT;
+        value->v.f = strtof(&token[1], &endptr);
+        return *endptr == '\0';
+    }
+    if (parse_memory_address(token, &address) && is_valid_memory_address(address)) {
+        value->v.i = *(int32_t *)address;
+        return true;
+    }
+    len = strlen(token);
+    if (len >= 2 && token[0] == '"' && token[len - 1] == '"') {
+        token[len - 1] = '\0';
+        value->type = RT_STRING;
+        value->v.s = &token[1];
+        return true;
+    }
+    return false;
+}
 
-    registers[dest_reg] %= src_value;
+/// @return Whether an operation must go through reg_exec_typed()
+bool reg_is_typed(char *dest_token, char *src_token) {
+    RegType type;
+    int index;
 
-    char msg[BUFFER_SIZE];
-    sprintf(msg, "R%d = %d\r\n", dest_reg, registers[dest_reg]);
-    AddProgramMessage(msg);
+    return parse_typed_register(dest_token, &type, &index)
+        || parse_typed_register(src_token, &type, &index)
+        || (src_token && src_token[0] == '#' && strpbrk(src_token, ".eE") && !strpbrk(src_token, "xX$hH"))
+        || (src_token && src_token[0] == '"');
 }
 
-/// @brief Negate the value in a register
-/// @param reg_token 
-void reg_neg(char *reg_token) {
-    int reg = parse_register(reg_token);
+static float reg_value_float(const RegValue *value) {
+    switch (value->type) {
+    case RT_INT:   return (float)value->v.i;
+    case RT_LONG:  return (float)value->v.l;
+    case RT_FLOAT: return value->v.f;
+    default:       return strtof(value->v.s, NULL);
+    }
+}
 
-    if (reg == -1) {
-        AddProgramMessage("Error: Invalid register.\r\n");
-        return;
+static int64_t reg_value_long(const RegValue *value) {
+    switch (value->type) {
+    case RT_INT:   return value->v.i;
+    case RT_LONG:  return value->v.l;
+    case RT_FLOAT: return (int64_t)value->v.f;
+    default:       return strtoll(value->v.s, NULL, 0);
     }
+}
 
-    registers[reg] = -registers[reg];
+/// @brief Formats a value for a string register or the console
+static void reg_value_text(const RegValue *value, char *text, int size) {
+    switch (value->type) {
+    case RT_INT:   snprintf(text, size, "%d", (int)value->v.i);             break;
+    case RT_LONG:  snprintf(text, size, "%lld", (long long)value->v.l);     break;
+    case RT_FLOAT: snprintf(text, size, "%g", (double)value->v.f);          break;
+    default:       snprintf(text, size, "%s", value->v.s);                  break;
+    }
+}
 
-    char msg[BUFFER_SIZE];
-    sprintf(msg, "R%d = %d\r\n", reg, registers[reg]);
-    AddProgramMessage(msg);
+/// @brief Float arithmetic in the FPU. Bitwise operations and rem are not defined.
+static bool reg_apply_float(RegOp op, float *dst, float src) {
+    switch (op) {
+    case REG_MOV:  *dst = src;                      break;
+    case REG_INC:  *dst += 1.0f;                    break;
+    case REG_DEC:  *dst -= 1.0f;                    break;
+    case REG_NEG:  *dst = -*dst;                    break;
+    case REG_ADD:  *dst += src;                     break;
+    case REG_SUB:  *dst -= src;                     break;
+    case REG_MUL:  *dst *= src;                     break;
+    case REG_DIV:
+        if (src == 0.0f) {
+            AddProgramMessage("Error: Division by zero.\r\n");
+            return false;
+        }
+        *dst /= src;
+        break;
+    case REG_MAX:  if (*dst < src) *dst = src;      break;
+    case REG_MIN:  if (*dst > src) *dst = src;      break;
+    default:
+        AddProgramMessage("Error: Operation not defined for float registers.\r\n");
+        return false;
+    }
+    return true;
 }
 
+/// @brief 64-bit arithmetic, the same operations as reg_apply()
+static bool reg_apply_long(RegOp op, int64_t *dst, int64_t src) {
+    switch (op) {
+    case REG_MOV:  *dst = src;                      break;
+    case REG_INC:  *dst += 1;                       break;
+    case REG_DEC:  *dst -= 1;                       break;
+    case REG_NOT:  *dst = ~*dst;                    break;
+    case REG_NEG:  *dst = -*dst;                    break;
+    case REG_AND:  *dst &= src;                     break;
+    case REG_IOR:  *dst |= src;                     break;
+    case REG_XOR:  *dst ^= src;                     break;
+    case REG_ADD:  *dst += src;                     break;
+    case REG_SUB:  *dst -= src;                     break;
+    case REG_MUL:  *dst *= src;                     break;
+    case REG_DIV:
+    case REG_REM:
+        if (src == 0) {
+            AddProgramMessage("Error: Division by zero.\r\n");
+            return false;
+        }
+        *dst = op == REG_DIV ? *dst / src : *dst % src;
+        break;
+    case REG_MAX:  if (*dst < src) *dst = src;      break;
+    case REG_MIN:  if (*dst > src) *dst = src;      break;
+    default:
+        break;
+    }
+    return true;
+}
 
-//==============================================================================
-// Maximum and Minimum
-//==============================================================================
+/// @brief String registers: mov copies or formats a number, add appends
+static bool reg_apply_string(RegOp op, char *dst, const RegValue *src) {
+    char text[STRING_REGISTER_SIZE];
+    int len;
+
+    reg_value_text(src, text, sizeof(text));
+    if (op == REG_MOV) {
+        strcpy(dst, text);
+    } else if (op == REG_ADD) {
+        len = strlen(dst);
+        snprintf(&dst[len], STRING_REGISTER_SIZE - len, "%s", text);
+    } else {
+        AddProgramMessage("Error: Only mov, add and xchg are defined for string registers.\r\n");
+        return false;
+    }
+    return true;
+}
 
-/// @brief Store the maximum of two values in the destination register
-/// @param dest_token Character array containing the destination token
-/// @param src_token Character array containing the source token
-void reg_max(char *dest_token, char *src_token) {
-    int dest_reg;
-    int32_t src_value;
+/// @brief Prints register index of a bank, eg. "F2 = 1.5"
+static void reg_report_typed(RegType type, int index) {
+    char msg[STRING_REGISTER_SIZE + 16];
+    RegValue value;
+
+    value.type = type;
+    switch (type) {
+    case RT_INT:   value.v.i = registers[index];         break;
+    case RT_LONG:  value.v.l = longRegisters[index];     break;
+    case RT_FLOAT: value.v.f = floatRegisters[index];    break;
+    default:       value.v.s = stringRegisters[index];   break;
+    }
+    sprintf(msg, type == RT_STRING ? "%c%d = \"" : "%c%d = ", regTypePrefix[type], index);
+    reg_value_text(&value, &msg[strlen(msg)], STRING_REGISTER_SIZE);
+    strcat(msg, type == RT_STRING ? "\"\r\n" : "\r\n");
+    AddProgramMessage(msg);
+}
 
-    // Parse operands
-    if (!parse_operands(dest_token, src_token, &dest_reg, &src_value)) {
-        return;
+/**
+ * @brief Runs an operation whose destination or source is a typed register, a float
+ * immediate or a string. The destination's type selects the arithmetic and the
+ * source is converted to it; xchg needs two registers of the same type.
+ * @return Whether the operation was applied
+ */
+bool reg_exec_typed(RegOp op, char *dest_token, char *src_token, bool quiet) {
+    RegValue src;
+    RegType type;
+    int32_t *target = NULL;
+    int dst;
+    bool ok;
+
+    if (!parse_typed_register(dest_token, &type, &dst)) {
+        type = RT_INT;
+        if (!(target = parse_target(dest_token, &dst))) {
+            AddProgramMessage("Error: Invalid destination register.\r\n");
+            return false;
+        }
+    }
+    if (reg_op_operands(op) == 1) {
+        src.type = type;
+        src.reg = -1;
+        src.v.l = 0;
+    } else if (!parse_typed_value(src_token, &src)) {
+        AddProgramMessage("Error: Invalid source operand.\r\n");
+        return false;
     }
 
-    // Determine the maximum value
-    if (registers[dest_reg] < src_value) {
-        registers[dest_reg] = src_value;
+    if (op == REG_XCHG) {
+        if (src.reg == -1 || src.type != type) {
+            AddProgramMessage("Error: xchg needs two registers of the same type.\r\n");
+            return false;
+        }
+        switch (type) {
+        case RT_LONG:  { int64_t t = longRegisters[dst]; longRegisters[dst] = longRegisters[src.reg]; longRegisters[src.reg] = t; break; }
+        case RT_FLOAT: { float t = floatRegisters[dst]; floatRegisters[dst] = floatRegisters[src.reg]; floatRegisters[src.reg] = t; break; }
+        default: {
+            char t[STRING_REGISTER_SIZE];
+            strcpy(t, stringRegisters[dst]);
+            strcpy(stringRegisters[dst], stringRegisters[src.reg]);
+            strcpy(stringRegisters[src.reg], t);
+            break;
+        }
+        }
+        if (!quiet) {
+            reg_report_typed(type, dst);
+            reg_report_typed(type, src.reg);
+        }
+        return true;
     }
 
-    // Output the result
-    char msg[BUFFER_SIZE];
-    sprintf(msg, "R%d = %d\r\n", dest_reg, registers[dest_reg]);
-    AddProgramMessage(msg);
+    switch (type) {
+    case RT_LONG:  ok = reg_apply_long(op, &longRegisters[dst], reg_value_long(&src));   break;
+    case RT_FLOAT: ok = reg_apply_float(op, &floatRegisters[dst], reg_value_float(&src)); break;
+    case RT_STRING: ok = reg_apply_string(op, stringRegisters[dst], &src);               break;
+    default: {
+        int32_t value = (int32_t)reg_value_long(&src);
+        ok = reg_apply(op, target, &value);
+        if (!ok) {
+            AddProgramMessage("Error: Division by zero.\r\n");
+        } else if (dst != -1) {
+            watch_notify(dst);
+        }
+        break;
+    }
+    }
+    if (ok && !quiet) {
+        if (target) {
+            reg_report(op, target, NULL);
+        } else {
+            reg_report_typed(type, dst);
+        }
+    }
+    return ok;
 }
 
-/// @brief Store the minimum of two values in the destination register
-/// @param dest_token Character array containing the destination token
-/// @param src_token Character array containing the source token
-void reg_min(char *dest_token, char *src_token) {
-    int dest_reg;
-    int32_t src_value;
+/// @brief Prints one typed bank
+void print_typed_registers(RegType type) {
+    static const char *titles[RT_TYPE_COUNT] = {
+        "================================== Registers ===================================\r\n",
+        "============================= 64-bit Registers =================================\r\n",
+        "============================== Float Registers =================================\r\n",
+        "============================= String Registers =================================\r\n",
+    };
+    int i;
 
-    // Parse operands
-    if (!parse_operands(dest_token, src_token, &dest_reg, &src_value)) {
+    if (type == RT_INT) {
+        print_all_registers();
         return;
     }
-
-    // Determine the minimum value
-    if (registers[dest_reg] > src_value) {
-        registers[dest_reg] = src_value;
+    AddProgramMessage((char *)titles[type]);
+    for (i = 0; i < regTypeCount[type]; i++) {
+        reg_report_typed(type, i);
     }
-
-    // Output the result
-    char msg[BUFFER_SIZE];
-    sprintf(msg, "R%d = %d\r\n", dest_reg, registers[dest_reg]);
-    AddProgramMessage(msg);
 }
@@ -7,17 +7,88 @@
 
 #define NUM_REGISTERS 32
 
+// Register operations, in the order of regOpNames
+typedef enum {
+    REG_MOV, REG_XCHG, REG_INC, REG_DEC, REG_NOT, REG_NEG, REG_AND, REG_IOR,
+    REG_XOR, REG_ADD, REG_SUB, REG_MUL, REG_DIV, REG_REM, REG_MAX, REG_MIN,
+
+    REG_OP_COUNT    // Keeps track of the number of operations
+} RegOp;
+
+extern const char *regOpNames[REG_OP_COUNT];
+
+// Vector operations over register ranges, in the order of vecOpNames. Reductions last.
+typedef enum {
+    VEC_MOV, VEC_ADD, VEC_SUB, VEC_MUL, VEC_AND, VEC_IOR, VEC_XOR, VEC_MAX, VEC_MIN,
+    VEC_SCALE, VEC_SUM, VEC_DOT, VEC_RMAX, VEC_RMIN,
+
+    VEC_OP_COUNT    // Keeps track of the number of operations
+} VecOp;
+
+extern const char *vecOpNames[VEC_OP_COUNT];
+
 extern int32_t registers[NUM_REGISTERS];
 
+// Typed register banks: Ln 64-bit integers, Fn single precision floats, Sn short strings
+#define NUM_LONG_REGISTERS   8
+#define NUM_FLOAT_REGISTERS  16
+#define NUM_STRING_REGISTERS 8
+#define STRING_REGISTER_SIZE 32
+
+typedef enum {
+    RT_INT,         // Rn, the int32 register file
+    RT_LONG,
+    RT_FLOAT,
+    RT_STRING,
+
+    RT_TYPE_COUNT   // Keeps track of the number of register types
+} RegType;
+
+// An operand of any type, read from a register or an immediate
+typedef struct RegValue {
+    uint8_t type;           // RegType
+    int8_t  reg;            // Register number, -1 for an immediate or memory value
+    union {
+        int32_t i;
+        int64_t l;
+        float f;
+        const char *s;
+    } v;
+} RegValue;
+
+extern int64_t longRegisters[NUM_LONG_REGISTERS];
+extern float   floatRegisters[NUM_FLOAT_REGISTERS];
+extern char    stringRegisters[NUM_STRING_REGISTERS][STRING_REGISTER_SIZE];
+
 
 void init_registers();
 void print_all_registers();
 
 int parse_register(char *token);
+int32_t *parse_target(char *token, int *reg);
 bool parse_immediate(char *token, int32_t *value);
 bool parse_memory_address(char *token, uint32_t *address);
 bool is_valid_memory_address(uint32_t address);
 
+// Operation core, shared by CMD_reg and compiled scripts (scriptvm.c)
+RegOp reg_lookup_op(const char *name);
+int reg_op_operands(RegOp op);
+bool reg_apply(RegOp op, int32_t *dst, int32_t *src);
+void reg_report(RegOp op, int32_t *dst, int32_t *src);
+bool reg_exec(RegOp op, char *dest_token, char *src_token, bool quiet);
+int reg_batch(char *ops, bool quiet);
+
+// Typed registers, reg_exec() hands these operations to reg_exec_typed()
+bool parse_typed_register(const char *token, RegType *type, int *index);
+bool reg_is_typed(char *dest_token, char *src_token);
+bool reg_exec_typed(RegOp op, char *dest_token, char *src_token, bool quiet);
+void print_typed_registers(RegType type);
+
+// Vector operations over register ranges (r0:7)
+bool parse_register_range(char *token, int *first, int *count);
+VecOp vec_lookup_op(const char *name);
+uint32_t vec_exec(VecOp op, char *arg1, char *arg2, char *arg3, bool quiet);
+
 // Register operations
 void reg_mov(char *dest_token, char *src_token);
 void reg_xchg(char *reg1_token, char *reg2_token);
@@ -31,7 +102,7 @@ void reg_ior(char *dest_token, char *src_token);
 void reg_xor(char *dest_token, char *src_token);
 
 // Multiplication, Division, and Remainder
-bool parse_operands(char *dest_token, char *src_token, int *dest_reg, int32_t *src_value);
+bool parse_operands(char *dest_token, char *src_token, int32_t **dest, int *dest_reg, int32_t *src_value);
 void reg_add(char *dest_token, char *src_token);
 void reg_sub(char *dest_token, char *src_token);
 void reg_mul(char *dest_token, char *src_token);
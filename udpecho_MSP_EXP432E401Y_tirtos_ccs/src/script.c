@@ -1,7 +1,11 @@
 /*
  *  ======== script.c ========
  */
+#include <stdlib.h>
+#include <string.h>
+
 #include "script.h"
+#include "scriptvm.h"
 #include "register.h"
 #include "p100.h"
 
@@ -10,6 +14,7 @@ void init_script_lines() {
     for (i = 0; i < SCRIPT_LINE_COUNT; i++) {
         scriptLines[i][0] = '\0';  // Set first character to null terminator
     }
+    script_compile_all();
 }
 
 void print_all_script_lines() {
@@ -51,11 +56,22 @@ void execute_script_from_line(int line_number) {
         return; // Empty script line
     }
 
-    // Set scriptPointer to the starting line
-    glo.scriptPointer = line_number;
+    // From inside a running script this is a jump within its own context
+    ScriptContext *ctx = script_current();
+    if (ctx) {
+        ctx->pc = line_number;
+        return;
+    }
 
-    // Allow the first line to execute.  Otherwise, the task will wait for the semaphore from regular payloads
-    Semaphore_post(glo.bios.PayloadSem);
+    // Otherwise start the script in a free context, next to any that are running
+    int id = script_start(line_number);
+    char msg[BUFFER_SIZE];
+    if (id < 0) {
+        AddProgramMessage("Error: No free script context.\r\n");
+        return;
+    }
+    sprintf(msg, "Script context %d started at line %d.\r\n", id, line_number);
+    AddProgramMessage(msg);
 
     // // Add the first line to the PayloadQueue
     // AddPayload(scriptLines[line_number]);
@@ -65,29 +81,6 @@ void execute_script_from_line(int line_number) {
 // Conditionals
 //=============================================================================
 
-// Get the value of an operand
-int getOperandValue(const char *operand) {
-    // Check if it's an immediate value
-    if (operand[0] == '#') {
-        // Immediate value
-        char *endptr;
-        int value = strtol(operand + 1, &endptr, 0);
-        if (*endptr != '\0') {
-            AddProgramMessage("Error: Invalid immediate value.\r\n");  // TODO: Add to errors
-            return INT64_MIN;
-        }
-        return value;
-    } else {
-        // Should be a register
-        int regIndex = parse_register(operand);
-        if (regIndex < 0 || regIndex >= NUM_REGISTERS) {
-            AddProgramMessage("Error: Invalid register.\r\n");  // TODO: Add to errors
-            return INT64_MIN;
-        }
-        return registers[regIndex];
-    }
-}
-
 // Execute the destination of a conditional
 void execute_destination(const char *dest) {
     // Trim leading and trailing whitespaces
@@ -106,8 +99,10 @@ void execute_destination(const char *dest) {
 
 // Trim leading and trailing whitespaces
 void trim(char *str) {
-    // Trim leading spaces
-    while(isspace((unsigned char)*str)) str++;
+    // Trim leading spaces, moving the rest of the string to the start
+    char *start = str;
+    while(isspace((unsigned char)*start)) start++;
+    memmove(str, start, strlen(start) + 1);
 
     // Trim trailing spaces
     char *end = str + strlen(str) - 1;
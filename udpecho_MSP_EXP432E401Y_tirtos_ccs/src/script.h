@@ -11,6 +11,5 @@ void print_script_line(int line_number);
 void execute_script_from_line(int line_number);
 
 // Conditionals
-int getOperandValue(const char *operand);
 void execute_destination(const char *dest);
 void trim(char *str);
@@ -0,0 +1,208 @@
+/*
+ *  ======== scriptimage.c ========
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "p100.h"
+#include "script.h"
+#include "scriptvm.h"
+#include "crc32.h"
+#include "scriptimage.h"
+#include "shadow.h"
+
+#define SCRIPT_IMAGE_MAX     (SCRIPT_LINE_COUNT * SCRIPT_LINE_SIZE)
+#define SCRIPT_IMAGE_CHUNKS  (SCRIPT_IMAGE_MAX / SCRIPT_IMAGE_CHUNK)
+#define SCRIPT_IMAGE_LINE_MAX (BUFFER_SIZE - 1)    // Longest line the compiler and the executor read
+
+typedef enum {
+    IMAGE_IDLE,         // Nothing received yet, or the last image was applied
+    IMAGE_RECEIVING,    // Chunks of transfer are coming in
+    IMAGE_READY,        // Complete and valid, waiting for the executor
+
+    IMAGE_STATE_COUNT   // Keeps track of the number of states
+} ScriptImageState;
+
+static const char *imageStateNames[IMAGE_STATE_COUNT] = { "idle", "receiving", "ready" };
+
+typedef struct ScriptImage {
+    volatile uint8_t state;     // ScriptImageState, only the executor leaves IMAGE_READY
+    uint16_t transfer;
+    uint16_t chunks;
+    uint32_t length;
+    uint32_t crc;
+    uint32_t received;          // Bit per chunk
+    int32_t  lines;             // Lines in the ready image
+    uint32_t applied;           // Images swapped in
+    uint32_t rejected;          // Malformed chunks and images that failed validation
+} ScriptImage;
+
+static char imageBuffer[SCRIPT_IMAGE_MAX];
+static ScriptImage scriptImage;
+
+/// @brief Counts a chunk or image that was dropped, also called for UART1 frames cut short
+void script_image_reject(const char *error) {
+    scriptImage.rejected++;
+    LOG(SCRIPT, LOG_ERROR, "Error: Script image %s.\r\n", error);
+}
+
+/**
+ * @brief Walks the lines of the received image, copying them to scriptLines when store is set
+ * @return Number of lines, -1 with *bad set to the offending line when one is too long
+ * or there are too many
+ */
+static int32_t script_image_lines(bool store, int32_t *bad) {
+    const char *p = imageBuffer;
+    const char *end = imageBuffer + scriptImage.length;
+    int32_t line = 0;
+    int32_t len;
+
+    while (p < end) {
+        if (line >= SCRIPT_LINE_COUNT) {
+            *bad = line;
+            return -1;
+        }
+        for (len = 0; p < end && *p != '\n'; p++) {
+            if (*p == '\r') {
+                continue;
+            }
+            if (len >= SCRIPT_IMAGE_LINE_MAX) {
+                *bad = line;
+                return -1;
+            }
+            if (store) {
+                scriptLines[line][len] = *p;
+            }
+            len++;
+        }
+        if (store) {
+            scriptLines[line][len] = '\0';
+        }
+        p++;    // Past the '\n'
+        line++;
+    }
+    return line;
+}
+
+/// @brief Checks the completed image and hands it to the executor
+static void script_image_complete() {
+    char msg[BUFFER_SIZE];
+    int32_t bad;
+
+    if (crc32(CRC32_INIT, imageBuffer, scriptImage.length) != scriptImage.crc) {
+        scriptImage.state = IMAGE_IDLE;
+        script_image_reject("CRC mismatch");
+        return;
+    }
+    scriptImage.lines = script_image_lines(false, &bad);
+    if (scriptImage.lines < 0) {
+        scriptImage.state = IMAGE_IDLE;
+        sprintf(msg, "line %d too long or past the last script line", (int)bad);
+        script_image_reject(msg);
+        return;
+    }
+
+    LOG(SCRIPT, LOG_INFO, "Script image received: %d lines, %u bytes.\r\n",
+        (int)scriptImage.lines, (unsigned)scriptImage.length);
+
+    scriptImage.state = IMAGE_READY;
+    Semaphore_post(glo.bios.PayloadSem);    // Wake the executor to apply it
+}
+
+/**
+ * @brief Takes one NETPKT_SCRIPT packet, from ListenFxn or the UART1 reader. The
+ * magic and type have already been checked. Chunks are ignored while a complete
+ * image is waiting to be applied.
+ */
+void script_image_receive(const char *packet, int32_t len) {
+    const ScriptImageChunk *chunk = (const ScriptImageChunk *)(packet + sizeof(NetPacketHeader));
+    uint32_t expect;
+
+    if (len < (int32_t)(sizeof(NetPacketHeader) + sizeof(ScriptImageChunk))
+        || len < (int32_t)(sizeof(NetPacketHeader) + sizeof(ScriptImageChunk) + chunk->length)) {
+        script_image_reject("chunk truncated");
+        return;
+    }
+    if (chunk->imageLength > SCRIPT_IMAGE_MAX
+        || chunk->chunks != (chunk->imageLength + SCRIPT_IMAGE_CHUNK - 1) / SCRIPT_IMAGE_CHUNK
+        || chunk->index >= chunk->chunks) {
+        script_image_reject("chunk header invalid");
+        return;
+    }
+    expect = chunk->index + 1 < chunk->chunks ? SCRIPT_IMAGE_CHUNK
+                                              : chunk->imageLength - chunk->index * SCRIPT_IMAGE_CHUNK;
+    if (chunk->length != expect) {
+        script_image_reject("chunk length invalid");
+        return;
+    }
+    if (scriptImage.state == IMAGE_READY) {
+        return;
+    }
+
+    if (scriptImage.state != IMAGE_RECEIVING || chunk->transfer != scriptImage.transfer
+        || chunk->imageLength != scriptImage.length || chunk->imageCrc != scriptImage.crc) {
+        scriptImage.transfer = chunk->transfer;
+        scriptImage.chunks = chunk->chunks;
+        scriptImage.length = chunk->imageLength;
+        scriptImage.crc = chunk->imageCrc;
+        scriptImage.received = 0;
+        scriptImage.state = IMAGE_RECEIVING;
+    }
+
+    if (scriptImage.received & (1u << chunk->index)) {
+        return;     // Repeated chunk
+    }
+    memcpy(&imageBuffer[chunk->index * SCRIPT_IMAGE_CHUNK], (const char *)(chunk + 1), chunk->length);
+    scriptImage.received |= 1u << chunk->index;
+
+    if (scriptImage.received == (1u << scriptImage.chunks) - 1) {
+        script_image_complete();
+    }
+}
+
+bool script_image_ready() {
+    return scriptImage.state == IMAGE_READY;
+}
+
+/**
+ * @brief Replaces every script line with the ready image and compiles them. Runs in
+ * the executor once no script is runnable; suspended scripts are stopped, as they
+ * would resume in the middle of different code.
+ */
+void script_image_apply() {
+    int32_t bad;
+    int32_t i;
+
+    if (scriptImage.state != IMAGE_READY) {
+        return;
+    }
+
+    script_kill_all();
+    script_image_lines(true, &bad);
+    for (i = scriptImage.lines; i < SCRIPT_LINE_COUNT; i++) {
+        scriptLines[i][0] = '\0';
+    }
+    script_compile_all();
+
+    scriptImage.applied++;
+    scriptImage.state = IMAGE_IDLE;
+    LOG(SCRIPT, LOG_INFO, "Script image loaded: %d lines, crc 0x%08X.\r\n",
+        (int)scriptImage.lines, (unsigned)scriptImage.crc);
+}
+
+void print_script_image() {
+    char msg[2 * BUFFER_SIZE];      // A status line with a 5-digit transfer id is over 80 bytes
+    uint32_t have = 0;
+    int i;
+
+    for (i = 0; i < SCRIPT_IMAGE_CHUNKS; i++) {
+        have += (scriptImage.received >> i) & 1;
+    }
+    snprintf(msg, sizeof(msg), "Script image: %s, transfer %u, %u of %u chunks, %u bytes, crc 0x%08X\r\n",
+            imageStateNames[scriptImage.state], scriptImage.transfer, (unsigned)have,
+            scriptImage.chunks, (unsigned)scriptImage.length, (unsigned)scriptImage.crc);
+    AddProgramMessage(msg);
+    sprintf(msg, "| %u applied, %u rejected\r\n",
+            (unsigned)scriptImage.applied, (unsigned)scriptImage.rejected);
+    AddProgramMessage(msg);
+}
@@ -0,0 +1,32 @@
+/*
+ * scriptimage.h
+ *
+ * Bulk script upload. A script image is the text of script lines 0, 1, ...
+ * separated by '\n' ('\r' is dropped). The sender splits it into chunks of
+ * SCRIPT_IMAGE_CHUNK bytes and sends each one as a NETPKT_SCRIPT packet, as a
+ * UDP datagram or as a frame on UART1:
+ *
+ *   | NetPacketHeader | ScriptImageChunk | data (length bytes)
+ *
+ * Chunks may arrive in any order and repeats are ignored, so a sender that is
+ * unsure the upload arrived can simply send it again. Once every chunk is in,
+ * the image is checked against its CRC and split into lines. Only a valid
+ * image is handed to the payload executor, which waits until no script is
+ * runnable, then replaces all script lines at once and compiles them.
+ */
+
+#ifndef SRC_SCRIPTIMAGE_H_
+#define SRC_SCRIPTIMAGE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SCRIPT_IMAGE_CHUNK  1024    // Image bytes per chunk, one chunk fits a UDP datagram
+
+void script_image_receive(const char *packet, int32_t len);
+void script_image_reject(const char *error);
+bool script_image_ready();
+void script_image_apply();
+void print_script_image();
+
+#endif /* SRC_SCRIPTIMAGE_H_ */
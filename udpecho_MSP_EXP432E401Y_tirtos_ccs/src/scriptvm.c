@@ -0,0 +1,778 @@
+/*
+ *  ======== scriptvm.c ========
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "p100.h"
+#include "script.h"
+#include "scriptvm.h"
+#include "profile.h"
+#include "watch.h"
+#include "atomic.h"
+#include "var.h"
+#include "shadow.h"
+#include "timestamp.h"
+
+static ScriptInsn scriptInsns[SCRIPT_LINE_COUNT];
+static uint8_t labelStart[SCRIPT_LINE_COUNT];   // "name:" at the start of each line,
+static uint8_t labelLen[SCRIPT_LINE_COUNT];     // labelLen 0 when the line has no label
+
+ScriptQuantum scriptQuantum = { SCRIPT_QUANTUM_LINES, SCRIPT_QUANTUM_US };
+ScriptContext scriptContexts[SCRIPT_CONTEXTS];
+
+static int scriptNext;      // Context to try first in the next quantum
+static uint32_t scriptQuantumEnd;       // timestamp_us() when the last quantum ended
+static bool scriptQuantumPending;       // The last quantum left a script runnable
+
+static const char *contextStateNames[CTX_STATE_COUNT] = { "free", "running", "suspended" };
+
+/// @brief Narrows [*start, *start + *len) of text to its non-blank part
+static void script_trim_slice(const char *text, int *start, int *len) {
+    while (*len > 0 && isspace((unsigned char)text[*start])) {
+        (*start)++;
+        (*len)--;
+    }
+    while (*len > 0 && isspace((unsigned char)text[*start + *len - 1])) {
+        (*len)--;
+    }
+}
+
+/// @brief Returns the number of a private register token (p0..p7), -1 otherwise
+int script_parse_private(const char *token) {
+    char *endptr;
+    long reg_num;
+
+    if ((token[0] != 'p' && token[0] != 'P') || !isdigit((unsigned char)token[1])) return -1;
+    reg_num = strtol(&token[1], &endptr, 10);
+    if (*endptr != '\0' || reg_num >= SCRIPT_PRIVATE_REGS) return -1;
+    return (int)reg_num;
+}
+
+/// @brief Resolves a source operand the way parse_operands() does, without printing
+static bool script_resolve_src(char *token, ScriptAction *act) {
+    uint32_t address;
+    int reg = script_parse_private(token);
+
+    if (reg != -1) {
+        act->priv |= SCRIPT_PRIV_SRC;
+        act->srcReg = reg;
+        return true;
+    }
+    reg = parse_register(token);
+    if (reg != -1) {
+        act->src = &registers[reg];
+        act->srcReg = reg;
+        return true;
+    }
+    reg = var_parse(token);
+    if (reg != -1) {
+        act->priv |= SCRIPT_VAR_SRC;
+        act->src = &varValues[reg];
+        act->srcReg = reg;
+        return true;
+    }
+    if (parse_immediate(token, &act->imm)) {
+        act->src = &act->imm;
+        return true;
+    }
+    if (parse_memory_address(token, &address) && is_valid_memory_address(address)) {
+        act->src = (int32_t *)address;
+        return true;
+    }
+    return false;
+}
+
+/// @brief Compiles "-reg <op> <operands>". Incomplete or invalid operations are left to CMD_reg.
+static bool script_compile_reg(char **saveptr, ScriptAction *act) {
+    char *op_token = strtok_r(NULL, " \t\r\n", saveptr);
+    char *arg1 = strtok_r(NULL, " \t\r\n", saveptr);
+    char *arg2 = strtok_r(NULL, " \t\r\n", saveptr);
+    RegOp op;
+    char *p;
+    int reg;
+
+    if (!op_token || !arg1) {
+        return false;
+    }
+    for (p = op_token; *p; ++p) {
+        *p = tolower((unsigned char)*p);
+    }
+    op = reg_lookup_op(op_token);
+    if (op == REG_OP_COUNT || (reg_op_operands(op) == 2 && !arg2)) {
+        return false;
+    }
+
+    act->regOp = op;
+    act->src = NULL;
+    act->srcReg = -1;
+    if ((reg = script_parse_private(arg1)) != -1) {
+        act->priv |= SCRIPT_PRIV_DST;
+    } else if ((reg = parse_register(arg1)) != -1) {
+        act->dst = &registers[reg];
+    } else if ((reg = var_parse(arg1)) != -1) {
+        act->priv |= SCRIPT_VAR_DST;
+        act->dst = &varValues[reg];
+    } else {
+        return false;
+    }
+    act->dstReg = reg;
+
+    if (op == REG_XCHG) {
+        if ((reg = script_parse_private(arg2)) != -1) {
+            act->priv |= SCRIPT_PRIV_SRC;
+        } else if ((reg = parse_register(arg2)) != -1) {
+            act->src = &registers[reg];
+        } else if ((reg = var_parse(arg2)) != -1) {
+            act->priv |= SCRIPT_VAR_SRC;
+            act->src = &varValues[reg];
+        } else {
+            return false;
+        }
+        act->srcReg = reg;
+    } else if (reg_op_operands(op) == 2 && !script_resolve_src(arg2, act)) {
+        return false;
+    }
+
+    act->type = ACT_REG;
+    return true;
+}
+
+/// @brief Compiles "-script N x" into a jump
+static bool script_compile_jump(char **saveptr, ScriptAction *act) {
+    char *arg1 = strtok_r(NULL, " \t\r\n", saveptr);
+    char *arg2 = strtok_r(NULL, " \t\r\n", saveptr);
+    char *endptr;
+    long target;
+
+    if (!arg1 || !arg2 || strcmp(arg2, "x") != 0 || strtok_r(NULL, " \t\r\n", saveptr)) {
+        return false;
+    }
+    target = strtol(arg1, &endptr, 10);
+    if (*endptr != '\0' || target < 0 || target >= SCRIPT_LINE_COUNT) {
+        return false;
+    }
+
+    act->type = ACT_JUMP;
+    act->target = (int16_t)target;
+    return true;
+}
+
+static bool is_label_char(char ch) {
+    return isalnum((unsigned char)ch) || ch == '_';
+}
+
+/// @brief Length of the label name a line starts with ("name:"), 0 if there is none
+static int script_label_length(const char *text, int start, int len) {
+    int i;
+
+    if (len < 2 || isdigit((unsigned char)text[start]) || !is_label_char(text[start])) {
+        return 0;
+    }
+    for (i = 1; i < len && is_label_char(text[start + i]); i++);
+    if (i == len || text[start + i] != ':' || (i + 1 < len && !isspace((unsigned char)text[start + i + 1]))) {
+        return 0;
+    }
+    return i;
+}
+
+/// @return Line defining the label, the first one if several do, -1 if none does
+int script_find_label(const char *name, int len) {
+    int i;
+    for (i = 0; i < SCRIPT_LINE_COUNT; i++) {
+        if (labelLen[i] == len && memcmp(&scriptLines[i][labelStart[i]], name, len) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Parses a jump target, a line number or a label name. Labels are resolved
+ * by script_resolve_labels(), offset is where the token starts in the source line.
+ */
+static bool script_parse_target(const char *token, int offset, ScriptAction *act) {
+    char *endptr;
+    long target;
+    const char *p;
+
+    if (isdigit((unsigned char)token[0])) {
+        target = strtol(token, &endptr, 10);
+        if (*endptr != '\0' || target >= SCRIPT_LINE_COUNT) {
+            return false;
+        }
+        act->target = (int16_t)target;
+        return true;
+    }
+    for (p = token; *p; p++) {
+        if (!is_label_char(*p)) {
+            return false;
+        }
+    }
+    act->label = 1;
+    act->textStart = (uint8_t)offset;
+    act->textLen = (uint8_t)(p - token);
+    act->target = -1;
+    return true;
+}
+
+/// @brief Compiles -goto T, -call T, -ret and -loop Rn T. Invalid ones are left as payloads.
+static void script_compile_flow(const char *token, char *buf, int start, char **saveptr, ScriptAction *act) {
+    char *arg1 = strtok_r(NULL, " \t\r\n", saveptr);
+    char *arg2 = arg1 ? strtok_r(NULL, " \t\r\n", saveptr) : NULL;
+    char *target;
+    int reg;
+
+    if (strcmp(token, "-ret") == 0) {
+        if (!arg1) {
+            act->type = ACT_RET;
+        }
+        return;
+    }
+    if (!arg1 || strtok_r(NULL, " \t\r\n", saveptr)) {
+        return;
+    }
+
+    if (strcmp(token, "-loop") == 0) {
+        if (!arg2) {
+            return;
+        }
+        if ((reg = script_parse_private(arg1)) != -1) {
+            act->priv |= SCRIPT_PRIV_DST;
+        } else if ((reg = parse_register(arg1)) != -1) {
+            act->dst = &registers[reg];
+        } else if ((reg = var_parse(arg1)) != -1) {
+            act->priv |= SCRIPT_VAR_DST;
+            act->dst = &varValues[reg];
+        } else {
+            return;
+        }
+        act->dstReg = reg;
+        target = arg2;
+    } else if (arg2) {
+        return;
+    } else {
+        target = arg1;
+    }
+
+    if (script_parse_target(target, start + (int)(target - buf), act)) {
+        act->type = token[1] == 'g' ? ACT_GOTO : (token[1] == 'c' ? ACT_CALL : ACT_LOOP);
+    }
+}
+
+/// @brief Compiles one payload, given as a slice of the source line
+static void script_compile_action(const char *text, int start, int len, ScriptAction *act) {
+    char buf[BUFFER_SIZE];
+    char *saveptr;
+    char *token;
+    char *p;
+
+    memset(act, 0, sizeof(ScriptAction));
+    act->srcReg = -1;
+
+    script_trim_slice(text, &start, &len);
+    if (len == 0) {
+        act->type = ACT_NONE;
+        return;
+    }
+    if (len > BUFFER_SIZE - 1) {
+        len = BUFFER_SIZE - 1;  // execute_payload() reads no further either
+    }
+    act->type = ACT_PAYLOAD;
+    act->textStart = (uint8_t)start;
+    act->textLen = (uint8_t)len;
+
+    memcpy(buf, &text[start], len);
+    buf[len] = '\0';
+    token = strtok_r(buf, " \t\r\n", &saveptr);
+    for (p = token; *p; ++p) {
+        *p = tolower((unsigned char)*p);
+    }
+
+    if (strcmp(token, "-rem") == 0) {
+        act->type = ACT_NONE;
+    } else if (strcmp(token, "-reg") == 0) {
+        if (!script_compile_reg(&saveptr, act)) {
+            act->type = ACT_PAYLOAD;
+        }
+    } else if (strcmp(token, "-script") == 0) {
+        if (!script_compile_jump(&saveptr, act)) {
+            act->type = ACT_PAYLOAD;
+        }
+    } else if (strcmp(token, "-goto") == 0 || strcmp(token, "-call") == 0
+               || strcmp(token, "-ret") == 0 || strcmp(token, "-loop") == 0) {
+        script_compile_flow(token, buf, start, &saveptr, act);
+    }
+}
+
+/// @brief Compiles "-if <expr> ? T : F". Returns false if the line should stay text.
+static bool script_compile_if(const char *text, int len, ScriptInsn *insn) {
+    char condition[BUFFER_SIZE];
+    const char *question, *colon, *end = text + len;
+    const char *error;
+    int condStart, condLen;
+
+    question = memchr(text, '?', len);
+    if (!question) {
+        return false;
+    }
+    colon = memchr(question, ':', end - question);
+
+    // Condition between "-if" and '?'
+    condStart = 3;      // strlen("-if")
+    condLen = (int)(question - text) - condStart;
+    memcpy(condition, &text[condStart], condLen);
+    condition[condLen] = '\0';
+
+    if (!expr_compile(condition, true, &insn->cond, &error)) {
+        return false;   // CMD_if reports the error when the line runs
+    }
+
+    if (question + 1 == end) {
+        return false;   // Nothing after '?', let CMD_if report the missing destination
+    }
+
+    if (colon) {
+        script_compile_action(text, (int)(question + 1 - text), (int)(colon - question - 1), &insn->then);
+        script_compile_action(text, (int)(colon + 1 - text), (int)(end - colon - 1), &insn->other);
+    } else {
+        script_compile_action(text, (int)(question + 1 - text), (int)(end - question - 1), &insn->then);
+        script_compile_action(text, 0, 0, &insn->other);
+    }
+    insn->op = SOP_IF;
+    return true;
+}
+
+static void script_compile_insn(int line_number) {
+    ScriptInsn *insn = &scriptInsns[line_number];
+    const char *text = scriptLines[line_number];
+    int start = 0, len;
+
+    memset(insn, 0, sizeof(ScriptInsn));
+    labelLen[line_number] = 0;
+
+    len = (int)strnlen(text, BUFFER_SIZE - 1);
+    script_trim_slice(text, &start, &len);
+    if (len == 0) {
+        insn->op = SOP_EMPTY;
+        return;
+    }
+
+    labelLen[line_number] = (uint8_t)script_label_length(text, start, len);
+    if (labelLen[line_number]) {
+        labelStart[line_number] = (uint8_t)start;
+        start += labelLen[line_number] + 1;
+        len -= labelLen[line_number] + 1;
+        script_trim_slice(text, &start, &len);
+    }
+
+    if (len > 3 && tolower((unsigned char)text[start]) == '-' && tolower((unsigned char)text[start + 1]) == 'i'
+        && tolower((unsigned char)text[start + 2]) == 'f' && isspace((unsigned char)text[start + 3])
+        && script_compile_if(&text[start], len, insn)) {
+        // Slices in the branches are relative to the trimmed line
+        if (insn->then.type == ACT_PAYLOAD || insn->then.label) insn->then.textStart += start;
+        if (insn->other.type == ACT_PAYLOAD || insn->other.label) insn->other.textStart += start;
+        return;
+    }
+
+    memset(insn, 0, sizeof(ScriptInsn));
+    insn->op = SOP_ACT;
+    script_compile_action(text, start, len, &insn->then);
+}
+
+static void script_resolve_action(int line_number, ScriptAction *act) {
+    if (act->label) {
+        act->target = (int16_t)script_find_label(&scriptLines[line_number][act->textStart], act->textLen);
+    }
+}
+
+/// @brief Points every label target at the line now defining the label
+static void script_resolve_labels() {
+    int i;
+    for (i = 0; i < SCRIPT_LINE_COUNT; i++) {
+        script_resolve_action(i, &scriptInsns[i].then);
+        script_resolve_action(i, &scriptInsns[i].other);
+    }
+}
+
+/**
+ * @brief Compiles a script line. Called whenever the line is written or cleared.
+ * The line may have added, moved or removed a label, so all label targets are
+ * resolved again.
+ */
+void script_compile_line(int line_number) {
+    if (line_number < 0 || line_number >= SCRIPT_LINE_COUNT) {
+        return;
+    }
+    script_compile_insn(line_number);
+    script_resolve_labels();
+}
+
+void script_compile_all() {
+    int i;
+    for (i = 0; i < SCRIPT_LINE_COUNT; i++) {
+        script_compile_insn(i);
+    }
+    script_resolve_labels();
+}
+
+/// @brief Formats an operand name: Pn for a private register, $name or Rn
+static void script_operand_name(char *name, uint8_t priv, uint8_t privFlag, uint8_t varFlag, int reg) {
+    if (priv & privFlag) {
+        sprintf(name, "P%d", reg);
+    } else if (priv & varFlag) {
+        sprintf(name, "$%s", var_name(reg));
+    } else {
+        sprintf(name, "R%d", reg);
+    }
+}
+
+/// @brief Prints the registers an operation changed, naming private registers p0..p7
+static void script_report(ScriptAction *act, int32_t *dst, int32_t *src) {
+    char msg[BUFFER_SIZE];
+    char dstName[VAR_NAME_SIZE + 1], srcName[VAR_NAME_SIZE + 1];
+
+    script_operand_name(dstName, act->priv, SCRIPT_PRIV_DST, SCRIPT_VAR_DST, act->dstReg);
+    if (act->regOp == REG_XCHG) {
+        script_operand_name(srcName, act->priv, SCRIPT_PRIV_SRC, SCRIPT_VAR_SRC, act->srcReg);
+        sprintf(msg, "%s = %d, %s = %d\r\n", dstName, *dst, srcName, *src);
+    } else {
+        sprintf(msg, "%s = %d\r\n", dstName, *dst);
+    }
+    AddProgramMessage(msg);
+}
+
+/// @return True when the action moved ctx->pc
+static bool script_run_action(ScriptContext *ctx, int line_number, ScriptAction *act) {
+    char buf[BUFFER_SIZE];
+    char msg[BUFFER_SIZE + 48];
+    int32_t *dst, *src;
+    int32_t value;
+
+    switch (act->type) {
+    case ACT_REG:
+        dst = (act->priv & SCRIPT_PRIV_DST) ? &ctx->p[act->dstReg] : act->dst;
+        src = (act->priv & SCRIPT_PRIV_SRC) ? &ctx->p[act->srcReg] : act->src;
+        if (!reg_apply((RegOp)act->regOp, dst, src)) {
+            AddProgramMessage("Error: Division by zero.\r\n");
+            return false;
+        }
+        if (!ctx->quiet) {
+            script_report(act, dst, src);
+        }
+        if (!(act->priv & (SCRIPT_PRIV_DST | SCRIPT_VAR_DST))) {
+            watch_notify(act->dstReg);
+        }
+        if (act->regOp == REG_XCHG && !(act->priv & (SCRIPT_PRIV_SRC | SCRIPT_VAR_SRC))) {
+            watch_notify(act->srcReg);
+        }
+        return false;
+
+    case ACT_JUMP:
+        if (scriptLines[act->target][0] == '\0') {
+            return false;   // Like execute_script_from_line(), an empty target is ignored
+        }
+        ctx->pc = act->target;
+        return true;
+
+    case ACT_PAYLOAD:
+        memcpy(buf, &scriptLines[line_number][act->textStart], act->textLen);
+        buf[act->textLen] = '\0';
+        execute_payload(buf);
+        return false;
+
+    case ACT_LOOP:
+        dst = (act->priv & SCRIPT_PRIV_DST) ? &ctx->p[act->dstReg] : act->dst;
+        value = atomic32_fetch_add(dst, -1);    // Before the decrement, so INT32_MIN cannot overflow
+        if (!(act->priv & (SCRIPT_PRIV_DST | SCRIPT_VAR_DST))) {
+            watch_notify(act->dstReg);
+        }
+        if (value <= 1) {
+            return false;   // Counter now 0 or below, also when it started there or the body overwrote it
+        }
+        // no break, jump back
+    case ACT_GOTO:
+    case ACT_CALL:
+        if (act->target < 0) {
+            memcpy(buf, &scriptLines[line_number][act->textStart], act->textLen);
+            buf[act->textLen] = '\0';
+            sprintf(msg, "Error: Unknown script label %s on line %d.\r\n", buf, line_number);
+            AddProgramMessage(msg);
+            ctx->state = CTX_FREE;
+            return true;
+        }
+        if (act->type == ACT_CALL) {
+            if (ctx->sp >= SCRIPT_CALL_DEPTH) {
+                AddProgramMessage("Error: Script call stack overflow.\r\n");
+                ctx->state = CTX_FREE;
+                return true;
+            }
+            ctx->stack[ctx->sp++] = (int16_t)(line_number + 1);
+        }
+        ctx->pc = act->target;
+        return true;
+
+    case ACT_RET:
+        if (ctx->sp == 0) {
+            ctx->state = CTX_FREE;  // Returning from the outermost level ends the script
+        } else {
+            ctx->pc = ctx->stack[--ctx->sp];
+        }
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief Runs the compiled line at ctx->pc. Called from script_run_quantum().
+ * @return True when the line jumped, so the caller must not advance ctx->pc
+ */
+bool script_exec_line(ScriptContext *ctx) {
+    int line_number = ctx->pc;
+    ScriptInsn *insn = &scriptInsns[line_number];
+    int32_t value;
+
+    switch (insn->op) {
+    case SOP_ACT:
+        return script_run_action(ctx, line_number, &insn->then);
+
+    case SOP_IF:
+        if (!expr_eval(&insn->cond, ctx->p, &value)) {
+            AddProgramMessage("Error: Division by zero.\r\n");
+            return false;
+        }
+        return script_run_action(ctx, line_number, value ? &insn->then : &insn->other);
+
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief Context whose line the executor is running, NULL when called from
+ * anywhere else (another task, a callback Swi, or between quanta).
+ */
+ScriptContext *script_current() {
+    if (glo.scriptContext < 0 || BIOS_getThreadType() != BIOS_ThreadType_Task
+        || Task_self() != glo.bios.PayloadExecutor) {
+        return NULL;
+    }
+    return &scriptContexts[glo.scriptContext];
+}
+
+bool script_runnable() {
+    int i;
+    for (i = 0; i < SCRIPT_CONTEXTS; i++) {
+        if (scriptContexts[i].state == CTX_RUNNABLE) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Starts a script in a free context. The line is expected to be non-empty.
+ * Callback 0 runs its payload in the Timer0 Swi, so a context is claimed and set
+ * up with gateSwi1 held, like the payload queue.
+ * @return Context id, -1 when all contexts are in use
+ */
+int script_start(int line_number) {
+    ScriptContext *ctx;
+    uint32_t gateKey;
+    bool idle;
+    int id;
+
+    gateKey = GateSwi_enter(gateSwi1);
+    idle = !script_runnable();
+    for (id = 0; id < SCRIPT_CONTEXTS; id++) {
+        if (scriptContexts[id].state == CTX_FREE) {
+            break;
+        }
+    }
+    if (id == SCRIPT_CONTEXTS) {
+        GateSwi_leave(gateSwi1, gateKey);
+        return -1;
+    }
+
+    ctx = &scriptContexts[id];
+    memset(ctx, 0, sizeof(ScriptContext));
+    ctx->start = line_number;
+    ctx->pc = line_number;
+    ctx->quiet = shadowRegisters[SHADOW_QUIET] != 0;
+    ctx->state = CTX_RUNNABLE;
+    GateSwi_leave(gateSwi1, gateKey);
+
+    // Wake the executor. A busy one picks the context up in its next quantum.
+    if (idle) {
+        Semaphore_post(glo.bios.PayloadSem);
+    }
+    return id;
+}
+
+/// @return False if the context is not running or suspended
+bool script_suspend(int id, bool suspend) {
+    ScriptContext *ctx = &scriptContexts[id];
+    uint32_t gateKey;
+    bool idle;
+
+    gateKey = GateSwi_enter(gateSwi1);
+    idle = !script_runnable();
+    if (ctx->state == CTX_FREE) {
+        GateSwi_leave(gateSwi1, gateKey);
+        return false;
+    }
+    ctx->state = suspend ? CTX_SUSPENDED : CTX_RUNNABLE;
+    GateSwi_leave(gateSwi1, gateKey);
+
+    if (!suspend && idle) {
+        Semaphore_post(glo.bios.PayloadSem);
+    }
+    return true;
+}
+
+void script_kill(int id) {
+    uint32_t gateKey = GateSwi_enter(gateSwi1);
+    scriptContexts[id].state = CTX_FREE;
+    GateSwi_leave(gateSwi1, gateKey);
+}
+
+void script_kill_all() {
+    uint32_t gateKey = GateSwi_enter(gateSwi1);
+    int i;
+
+    for (i = 0; i < SCRIPT_CONTEXTS; i++) {
+        scriptContexts[i].state = CTX_FREE;
+    }
+    GateSwi_leave(gateSwi1, gateKey);
+}
+
+void print_script_contexts() {
+    char msg[MAX_LINE_LENGTH + 8 * 11 + 8];    // p0-p7 can be 8 values of 11 characters
+    ScriptContext *ctx;
+    int i;
+
+    AddProgramMessage("================================ Script Contexts ===============================\r\n");
+    AddProgramMessage("| Id | State     | Start | Line | Depth | Lines run\r\n");
+    AddProgramMessage("|----|-----------|-------|------|-------|----------------------------------------\r\n");
+    for (i = 0; i < SCRIPT_CONTEXTS; i++) {
+        ctx = &scriptContexts[i];
+        if (ctx->state == CTX_FREE) {
+            sprintf(msg, "| %-2d | %-9s |\r\n", i, contextStateNames[ctx->state]);
+            AddProgramMessage(msg);
+            continue;
+        }
+        sprintf(msg, "| %-2d | %-9s | %-5d | %-4d | %-5d | %u%s\r\n", i, contextStateNames[ctx->state],
+                ctx->start, ctx->pc, ctx->sp, ctx->lines, ctx->quiet ? " (quiet)" : "");
+        AddProgramMessage(msg);
+        snprintf(msg, sizeof(msg), "|    | p0-p7: %d %d %d %d %d %d %d %d\r\n",
+                ctx->p[0], ctx->p[1], ctx->p[2], ctx->p[3], ctx->p[4], ctx->p[5], ctx->p[6], ctx->p[7]);
+        AddProgramMessage(msg);
+    }
+    AddProgramMessage("================================================================================\r\n");
+}
+
+/**
+ * @brief Runs one quantum of the next runnable context, round robin. Lines run
+ * back to back until the script ends or is suspended, or the line or time budget
+ * of scriptQuantum is used up. Called by executePayloadTask, which then serves
+ * one queued payload and blocks for SCRIPT_QUANTUM_GAP_TICKS before the next
+ * quantum, so lower priority tasks run too.
+ * @return Number of lines run
+ */
+int32_t script_run_quantum() {
+    uint32_t start = timestamp_us();
+    uint32_t elapsed = 0;
+    int32_t lines = 0;
+    ScriptContext *ctx = NULL;
+    int currentLine;
+    uint32_t lineStart;
+    bool jumped;
+    int i, id;
+
+    for (i = 0; i < SCRIPT_CONTEXTS; i++) {
+        id = (scriptNext + i) % SCRIPT_CONTEXTS;
+        if (scriptContexts[id].state == CTX_RUNNABLE) {
+            ctx = &scriptContexts[id];
+            break;
+        }
+    }
+    if (ctx == NULL) {
+        scriptQuantumPending = false;
+        return 0;
+    }
+    if (scriptQuantumPending) {
+        uint32_t gap = start - scriptQuantumEnd;
+        scriptQuantum.gaps++;
+        scriptQuantum.gapUsTotal += gap;
+        if (gap > scriptQuantum.gapUsMax) scriptQuantum.gapUsMax = gap;
+    }
+    scriptNext = id + 1;
+    glo.scriptContext = id;
+
+    while (ctx->state == CTX_RUNNABLE) {
+        currentLine = ctx->pc;
+        if (currentLine < 0 || currentLine >= SCRIPT_LINE_COUNT || scriptLines[currentLine][0] == '\0') {
+            ctx->state = CTX_FREE;      // End of script
+            break;
+        }
+
+        lineStart = cycles_now();
+        jumped = script_exec_line(ctx);
+        profile_record(&profileScript[currentLine], cycles_now() - lineStart);
+        lines++;
+
+        // Advance unless the line jumped or a payload moved the pc (-script N x)
+        if (!jumped && currentLine == ctx->pc) {
+            ctx->pc++;
+        }
+
+        elapsed = timestamp_us() - start;
+        if ((scriptQuantum.maxLines && lines >= (int32_t)scriptQuantum.maxLines)
+            || (scriptQuantum.maxUs && elapsed >= scriptQuantum.maxUs)) {
+            break;
+        }
+    }
+    glo.scriptContext = -1;
+
+    ctx->lines += lines;
+    scriptQuantum.quanta++;
+    scriptQuantum.lines += lines;
+    if (lines > (int32_t)scriptQuantum.linesMax) scriptQuantum.linesMax = lines;
+    if (elapsed > scriptQuantum.usMax) scriptQuantum.usMax = elapsed;
+    scriptQuantumEnd = timestamp_us();
+    scriptQuantumPending = script_runnable();
+    return lines;
+}
+
+void script_reset_quantum_stats() {
+    scriptQuantum.quanta = 0;
+    scriptQuantum.lines = 0;
+    scriptQuantum.linesMax = 0;
+    scriptQuantum.usMax = 0;
+    scriptQuantum.gaps = 0;
+    scriptQuantum.gapUsTotal = 0;
+    scriptQuantum.gapUsMax = 0;
+}
+
+void print_script_quantum() {
+    char msg[2 * BUFFER_SIZE];
+
+    sprintf(msg, "Script quantum: %u lines, %u us (0 = no limit)\r\n",
+            scriptQuantum.maxLines, scriptQuantum.maxUs);
+    AddProgramMessage(msg);
+    sprintf(msg, "| quanta: %u  lines: %u  lines/quantum avg: %u  max: %u\r\n",
+            scriptQuantum.quanta, scriptQuantum.lines,
+            scriptQuantum.quanta ? scriptQuantum.lines / scriptQuantum.quanta : 0,
+            scriptQuantum.linesMax);
+    AddProgramMessage(msg);
+    sprintf(msg, "| longest quantum: %u us\r\n", scriptQuantum.usMax);
+    AddProgramMessage(msg);
+    sprintf(msg, "| gap between quanta avg: %u us  max: %u us\r\n",
+            scriptQuantum.gaps ? scriptQuantum.gapUsTotal / scriptQuantum.gaps : 0,
+            scriptQuantum.gapUsMax);
+    AddProgramMessage(msg);
+}
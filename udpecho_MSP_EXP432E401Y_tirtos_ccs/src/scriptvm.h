@@ -0,0 +1,147 @@
+/*
+ * scriptvm.h
+ *
+ * Compiled script lines. Each line of scriptLines[] is compiled when it is
+ * written, so running a script does not tokenize and look up the same text on
+ * every pass through a loop:
+ *
+ *   -reg <op> <dst> <src>       register operation with the operands resolved
+ *                               to pointers (immediates point into the insn).
+ *                               p0..p7 name the running context's private
+ *                               registers and are resolved when the line runs,
+ *                               $name variables are resolved to their slot
+ *   -if <expr> ? T : F          condition compiled by expr_compile(), T and F
+ *                               compiled as actions
+ *   -script N x                 jump to line N
+ *   -goto T, -call T, -ret      jump, call and return. T is a line number or a
+ *                               label, -ret from the outermost level ends
+ *                               the script
+ *   -loop Rn T                  Rn -= 1, then jump to T unless Rn is 0 (also
+ *                               pN or $name)
+ *   -rem                        nothing
+ *
+ * A line starting with "name:" defines the label name for that line, the rest
+ * of the line is compiled as usual. Label targets are resolved to line numbers
+ * whenever a line is written, so a label may be used before it is defined.
+ *
+ * Anything else, and any line the compiler cannot fully resolve, is kept as a
+ * payload action that runs the text through execute_payload() as before, so
+ * errors are reported the same way as when the line is typed in.
+ */
+
+#ifndef SRC_SCRIPTVM_H_
+#define SRC_SCRIPTVM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "register.h"
+#include "expr.h"
+
+typedef enum {
+    ACT_NONE,           // -rem
+    ACT_REG,            // reg_apply(regOp, dst, src)
+    ACT_JUMP,           // execute_script_from_line(target)
+    ACT_PAYLOAD,        // execute_payload() on a slice of the source line
+    ACT_GOTO,           // pc = target
+    ACT_CALL,           // Push the next line, pc = target
+    ACT_RET,            // Pop the return line, end the script when the stack is empty
+    ACT_LOOP,           // --*dst, pc = target while *dst > 0
+} ScriptActionType;
+
+#define SCRIPT_PRIV_DST 0x01        // ScriptAction.priv: dstReg is a private register p0..p7
+#define SCRIPT_PRIV_SRC 0x02        // ScriptAction.priv: srcReg is a private register
+#define SCRIPT_VAR_DST  0x04        // ScriptAction.priv: dstReg is a variable slot (var.h)
+#define SCRIPT_VAR_SRC  0x08        // ScriptAction.priv: srcReg is a variable slot
+
+typedef struct ScriptAction {
+    uint8_t  type;          // ScriptActionType
+    uint8_t  regOp;         // RegOp
+    uint8_t  priv;          // SCRIPT_PRIV_xxx, SCRIPT_VAR_xxx
+    int16_t  dstReg;        // Register numbers or variable slots for script_report()
+    int16_t  srcReg;        // -1 unless the source is a register or variable
+    uint8_t  label;         // target names a label, textStart/textLen hold the name
+    uint8_t  textStart;     // ACT_PAYLOAD slice of scriptLines[line]
+    uint8_t  textLen;
+    int16_t  target;        // ACT_JUMP to ACT_LOOP line, -1 while the label is undefined
+    int32_t *dst;
+    int32_t *src;           // Register, memory address or &imm
+    int32_t  imm;
+} ScriptAction;
+
+typedef enum {
+    SOP_EMPTY,          // Empty line, skipped
+    SOP_ACT,            // Run then
+    SOP_IF,             // Run then when cond is non-zero, otherwise other
+} ScriptOpcode;
+
+typedef struct ScriptInsn {
+    uint8_t  op;            // ScriptOpcode
+    ExprProgram cond;       // SOP_IF condition
+    ScriptAction then;
+    ScriptAction other;     // SOP_IF false branch
+} ScriptInsn;
+
+#define SCRIPT_CONTEXTS      4      // Scripts that can run side by side
+#define SCRIPT_CALL_DEPTH    8      // Return lines per context
+#define SCRIPT_PRIVATE_REGS  8      // Scratch registers p0..p7 per context
+
+typedef enum {
+    CTX_FREE,
+    CTX_RUNNABLE,
+    CTX_SUSPENDED,
+
+    CTX_STATE_COUNT     // Keeps track of the number of states
+} ScriptContextState;
+
+// One running script. The executor runs a quantum of each runnable context in turn.
+typedef struct ScriptContext {
+    uint8_t  state;                         // ScriptContextState
+    uint8_t  quiet;                         // Register operations print nothing
+    int16_t  start;                         // Line the script was started from
+    int16_t  pc;                            // Next line to run
+    int16_t  sp;                            // Entries on the call stack
+    int16_t  stack[SCRIPT_CALL_DEPTH];      // Return lines
+    int32_t  p[SCRIPT_PRIVATE_REGS];        // Private scratch registers
+    uint32_t lines;                         // Lines run
+} ScriptContext;
+
+extern ScriptContext scriptContexts[SCRIPT_CONTEXTS];
+
+#define SCRIPT_QUANTUM_LINES 32     // Default line budget of one executor quantum
+#define SCRIPT_QUANTUM_US    1000   // Default time budget of one executor quantum
+#define SCRIPT_QUANTUM_GAP_TICKS 1  // Clock ticks (1 ms) the executor blocks between quanta
+
+// Script lines run back to back until either budget is used up (0 = no limit)
+typedef struct ScriptQuantum {
+    uint32_t maxLines;
+    uint32_t maxUs;
+    uint32_t quanta;            // Quanta run
+    uint32_t lines;             // Lines run in all quanta
+    uint32_t linesMax;          // Most lines run in one quantum
+    uint32_t usMax;             // Longest quantum, the worst delay seen by queued payloads
+    uint32_t gaps;              // Pauses between two quanta of running scripts
+    uint32_t gapUsTotal;
+    uint32_t gapUsMax;          // Longest pause, the delay scripts see from other tasks
+} ScriptQuantum;
+
+extern ScriptQuantum scriptQuantum;
+
+int script_parse_private(const char *token);
+void script_compile_line(int line_number);
+void script_compile_all();
+int script_find_label(const char *name, int len);
+bool script_exec_line(ScriptContext *ctx);
+int32_t script_run_quantum();
+
+ScriptContext *script_current();
+int script_start(int line_number);
+bool script_runnable();
+bool script_suspend(int id, bool suspend);
+void script_kill(int id);
+void script_kill_all();
+void print_script_contexts();
+void script_reset_quantum_stats();
+void print_script_quantum();
+
+#endif /* SRC_SCRIPTVM_H_ */
@@ -0,0 +1,110 @@
+/*
+ *  ======== shadow.c ========
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include "p100.h"
+#include "shadow.h"
+
+int32_t shadowRegisters[SHADOW_COUNT];
+
+const ShadowInfo shadowInfo[SHADOW_COUNT] = {
+    { "log_cmd",    LOG_INFO, LOG_OFF, LOG_DEBUG,      "Command acknowledgements" },
+    { "log_audio",  LOG_INFO, LOG_OFF, LOG_DEBUG,      "Sine and audio setup" },
+    { "log_net",    LOG_INFO, LOG_OFF, LOG_DEBUG,      "UDP tasks and packets" },
+    { "log_script", LOG_INFO, LOG_OFF, LOG_DEBUG,      "Script image transfers" },
+    { "echo",       1,        0,       1,              "Echo typed characters" },
+    { "quiet",      0,        0,       1,              "New scripts run quietly" },
+    { "outq_max",   MAX_QUEUE_SIZE, 1, MAX_QUEUE_SIZE, "Output queue limit" },
+};
+
+const char *logLevelNames[LOG_LEVEL_COUNT] = { "off", "error", "warn", "info", "debug" };
+
+/// @brief Formats a message and queues it like AddProgramMessage(), called by LOG()
+void log_message(const char *format, ...) {
+    char msg[MAX_LINE_LENGTH * 2];
+    va_list args;
+
+    va_start(args, format);
+    vsnprintf(msg, sizeof(msg), format, args);
+    va_end(args);
+    AddProgramMessage(msg);
+}
+
+void init_shadow_registers() {
+    int i;
+    for (i = 0; i < SHADOW_COUNT; i++) {
+        shadowRegisters[i] = shadowInfo[i].initial;
+    }
+}
+
+/// @return Index of the shadow register called name, -1 if there is none
+int shadow_lookup(const char *name) {
+    int i;
+    for (i = 0; i < SHADOW_COUNT; i++) {
+        if (strcmp(name, shadowInfo[i].name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/// @brief Parses a value for reg: a number, on/off, or a level name for the log_xxx registers
+bool shadow_parse_value(int reg, const char *text, int32_t *value) {
+    char *endptr;
+    int i;
+
+    if (strcmp(text, "on") == 0 || strcmp(text, "off") == 0) {
+        *value = text[1] == 'n';
+        return true;
+    }
+    if (reg <= SHADOW_LOG_SCRIPT) {
+        for (i = 0; i < LOG_LEVEL_COUNT; i++) {
+            if (strcmp(text, logLevelNames[i]) == 0) {
+                *value = i;
+                return true;
+            }
+        }
+    }
+    *value = (int32_t)strtol(text, &endptr, 0);
+    return *text != '\0' && *endptr == '\0';
+}
+
+/// @return False if the value is outside the register's range, the register is left unchanged
+bool shadow_set(int reg, int32_t value) {
+    if (value < shadowInfo[reg].min || value > shadowInfo[reg].max) {
+        return false;
+    }
+    shadowRegisters[reg] = value;
+    return true;
+}
+
+void print_shadow_register(int reg) {
+    const ShadowInfo *info = &shadowInfo[reg];
+    char msg[MAX_LINE_LENGTH + 8];
+    char range[32];
+
+    if (reg <= SHADOW_LOG_SCRIPT) {
+        sprintf(msg, "| %-10s | %-5s | off..debug | %s\r\n",
+                info->name, logLevelNames[shadowRegisters[reg]], info->description);
+    } else {
+        sprintf(range, "%d..%d", (int)info->min, (int)info->max);
+        sprintf(msg, "| %-10s | %-5d | %-10s | %s\r\n",
+                info->name, (int)shadowRegisters[reg], range, info->description);
+    }
+    AddProgramMessage(msg);
+}
+
+void print_all_shadow_registers() {
+    int i;
+
+    AddProgramMessage("=============================== Shadow Registers ===============================\r\n");
+    AddProgramMessage("| Name       | Value | Range      | Description\r\n");
+    AddProgramMessage("|------------|-------|------------|--------------------------------------------\r\n");
+    for (i = 0; i < SHADOW_COUNT; i++) {
+        print_shadow_register(i);
+    }
+}
@@ -0,0 +1,73 @@
+/*
+ * shadow.h
+ *
+ * Shadow registers: a bank of system configuration values kept apart from the
+ * R registers, read and set with -shadow. Each has a name, a default and a
+ * range that -shadow checks before writing.
+ *
+ * The log_xxx registers hold the level of each subsystem's diagnostics. LOG()
+ * compares the level before anything is formatted, so a message that is
+ * filtered out costs one load and compare instead of sprintf, a heap copy and
+ * UART time:
+ *
+ *   LOG(AUDIO, LOG_DEBUG, "lutDelta: %.2f\r\n", delta);
+ */
+
+#ifndef SRC_SHADOW_H_
+#define SRC_SHADOW_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+    LOG_OFF,
+    LOG_ERROR,
+    LOG_WARN,
+    LOG_INFO,           // Acknowledgements, the default
+    LOG_DEBUG,
+
+    LOG_LEVEL_COUNT     // Keeps track of the number of levels
+} LogLevel;
+
+// Shadow registers, in the order of shadowInfo
+typedef enum {
+    SHADOW_LOG_CMD,     // Command acknowledgements (-callback, -ticker, -timer)
+    SHADOW_LOG_AUDIO,   // -sine and audio setup
+    SHADOW_LOG_NET,     // UDP receive and transmit tasks
+    SHADOW_LOG_SCRIPT,  // Script image transfers
+    SHADOW_ECHO,        // Echo characters typed on the UART console
+    SHADOW_QUIET,       // quiet of scripts started from now on
+    SHADOW_OUTQ_MAX,    // Output messages queued before new ones are dropped
+
+    SHADOW_COUNT        // Keeps track of the number of shadow registers
+} ShadowReg;
+
+typedef struct ShadowInfo {
+    const char *name;
+    int32_t     initial;
+    int32_t     min;
+    int32_t     max;
+    const char *description;
+} ShadowInfo;
+
+extern int32_t shadowRegisters[SHADOW_COUNT];
+extern const ShadowInfo shadowInfo[SHADOW_COUNT];
+extern const char *logLevelNames[LOG_LEVEL_COUNT];
+
+#define LOG(sub, level, ...) \
+    do { \
+        if ((level) <= shadowRegisters[SHADOW_LOG_##sub]) { \
+            log_message(__VA_ARGS__); \
+        } \
+    } while (0)
+
+void log_message(const char *format, ...);
+
+void init_shadow_registers();
+int shadow_lookup(const char *name);
+bool shadow_parse_value(int reg, const char *text, int32_t *value);
+bool shadow_set(int reg, int32_t value);
+void print_shadow_register(int reg);
+void print_all_shadow_registers();
+
+#endif /* SRC_SHADOW_H_ */
@@ -0,0 +1,208 @@
+/*
+ *  ======== storage.c ========
+ */
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "p100.h"
+#include "register.h"
+#include "script.h"
+#include "scriptvm.h"
+#include "tickers.h"
+#include "callback.h"
+#include "watch.h"
+#include "flashstore.h"
+#include "storage.h"
+
+// Record layouts. Payloads are stored up to their terminating NUL.
+typedef struct StoredTicker {
+    uint32_t initialDelay;
+    uint32_t period;
+    int32_t  count;
+    char     payload[BUFFER_SIZE];
+} StoredTicker;
+
+typedef struct StoredCallback {
+    int32_t  count;
+    char     payload[BUFFER_SIZE];
+} StoredCallback;
+
+/// @brief Mounts the flash store and, when the boot record asks for it, loads the saved state
+void storage_init() {
+    StorageBoot boot;
+    char msg[BUFFER_SIZE];
+
+    if (!flashstore_mount(&flashHalInternal)) {
+        AddProgramMessage("Error: Flash store could not be mounted.\r\n");
+        return;
+    }
+    if (!storage_get_boot(&boot) || !boot.autoload) {
+        return;
+    }
+
+    sprintf(msg, "Flash store: %d records loaded.\r\n", (int)storage_load(STORAGE_ALL));
+    AddProgramMessage(msg);
+    if (boot.scriptLine != STORAGE_BOOT_NO_SCRIPT) {
+        execute_script_from_line(boot.scriptLine);
+    }
+}
+
+/// @return STORAGE_xxx mask for "reg", "script", "ticker", "callback" or "all", 0 otherwise
+uint32_t storage_parse_what(const char *token) {
+    if (strcmp(token, "all") == 0)      return STORAGE_ALL;
+    if (strcmp(token, "reg") == 0)      return STORAGE_REGISTERS;
+    if (strcmp(token, "script") == 0)   return STORAGE_SCRIPTS;
+    if (strcmp(token, "ticker") == 0)   return STORAGE_TICKERS;
+    if (strcmp(token, "callback") == 0) return STORAGE_CALLBACKS;
+    return 0;
+}
+
+/// @brief Writes data as the value of key, or deletes key when keep is false
+static bool storage_put(uint16_t key, const void *data, uint32_t len, bool keep) {
+    return keep ? flashstore_write(key, data, (uint16_t)len) : flashstore_delete(key);
+}
+
+/**
+ * @brief Saves the selected parts of the state. Unchanged records are not rewritten.
+ * @return Records written to flash, -1 if the store is not mounted, full or failed
+ */
+int32_t storage_save(uint32_t what) {
+    FlashStoreStats before, after;
+    StoredTicker ticker;
+    StoredCallback callback;
+    bool ok = flashstore_mounted();
+    uint32_t len;
+    int i;
+
+    flashstore_stats(&before);
+
+    if (ok && (what & STORAGE_REGISTERS)) {
+        ok = flashstore_write(STORAGE_KEY_REGISTERS, registers, sizeof(registers));
+    }
+    for (i = 0; ok && (what & STORAGE_SCRIPTS) && i < SCRIPT_LINE_COUNT; i++) {
+        len = strnlen(scriptLines[i], SCRIPT_LINE_SIZE - 1);
+        ok = storage_put(STORAGE_KEY_SCRIPT + i, scriptLines[i], len, len > 0);
+    }
+    for (i = 0; ok && (what & STORAGE_TICKERS) && i < MAX_TICKERS; i++) {
+        memset(&ticker, 0, sizeof(ticker));
+        ticker.initialDelay = tickers[i].initialDelay;
+        ticker.period = tickers[i].period;
+        ticker.count = tickers[i].count;
+        strncpy(ticker.payload, tickers[i].payload, BUFFER_SIZE - 1);
+        len = offsetof(StoredTicker, payload) + strlen(ticker.payload) + 1;
+        ok = storage_put(STORAGE_KEY_TICKER + i, &ticker, len, tickers[i].active);
+    }
+    for (i = 0; ok && (what & STORAGE_CALLBACKS) && i < MAX_CALLBACKS; i++) {
+        memset(&callback, 0, sizeof(callback));
+        callback.count = callbacks[i].count;
+        strncpy(callback.payload, callbacks[i].payload, BUFFER_SIZE - 1);
+        len = offsetof(StoredCallback, payload) + strlen(callback.payload) + 1;
+        ok = storage_put(STORAGE_KEY_CALLBACK + i, &callback, len, callbacks[i].count != 0);
+    }
+
+    flashstore_stats(&after);
+    return ok ? (int32_t)(after.writes - before.writes) : -1;
+}
+
+/**
+ * @brief Restores the selected parts of the state. Script lines, tickers and
+ * callbacks missing from the store are cleared, running scripts are stopped
+ * before their lines are replaced.
+ * @return Records loaded, -1 if the store is not mounted
+ */
+int32_t storage_load(uint32_t what) {
+    int32_t saved[NUM_REGISTERS];
+    StoredTicker ticker;
+    StoredCallback callback;
+    int32_t loaded = 0, len;
+    int i;
+
+    if (!flashstore_mounted()) {
+        return -1;
+    }
+
+    if ((what & STORAGE_REGISTERS)
+        && flashstore_read(STORAGE_KEY_REGISTERS, saved, sizeof(saved)) == sizeof(saved)) {
+        memcpy(registers, saved, sizeof(saved));
+        for (i = 0; i < NUM_REGISTERS; i++) {
+            watch_notify(i);
+        }
+        loaded++;
+    }
+
+    if (what & STORAGE_SCRIPTS) {
+        script_kill_all();
+        for (i = 0; i < SCRIPT_LINE_COUNT; i++) {
+            len = flashstore_read(STORAGE_KEY_SCRIPT + i, scriptLines[i], SCRIPT_LINE_SIZE - 1);
+            if (len > SCRIPT_LINE_SIZE - 1) len = SCRIPT_LINE_SIZE - 1;
+            scriptLines[i][len > 0 ? len : 0] = '\0';
+            if (len > 0) loaded++;
+        }
+        script_compile_all();
+    }
+
+    for (i = 0; (what & STORAGE_TICKERS) && i < MAX_TICKERS; i++) {
+        len = flashstore_read(STORAGE_KEY_TICKER + i, &ticker, sizeof(ticker));
+        tickers[i].active = false;
+        if (len <= (int32_t)offsetof(StoredTicker, payload)) {
+            continue;
+        }
+        ticker.payload[BUFFER_SIZE - 1] = '\0';
+        tickers[i].initialDelay = ticker.initialDelay;
+        tickers[i].period = ticker.period;
+        tickers[i].count = ticker.count;
+        tickers[i].currentDelay = ticker.initialDelay;
+        strcpy(tickers[i].payload, ticker.payload);
+        tickers[i].active = true;   // Last, the ticker Swi may run in between
+        loaded++;
+    }
+
+    for (i = 0; (what & STORAGE_CALLBACKS) && i < MAX_CALLBACKS; i++) {
+        len = flashstore_read(STORAGE_KEY_CALLBACK + i, &callback, sizeof(callback));
+        callbacks[i].count = 0;
+        if (len <= (int32_t)offsetof(StoredCallback, payload)) {
+            memset(callbacks[i].payload, 0, BUFFER_SIZE);
+            continue;
+        }
+        callback.payload[BUFFER_SIZE - 1] = '\0';
+        strcpy(callbacks[i].payload, callback.payload);
+        callbacks[i].count = callback.count;
+        loaded++;
+    }
+    return loaded;
+}
+
+bool storage_get_boot(StorageBoot *boot) {
+    return flashstore_read(STORAGE_KEY_BOOT, boot, sizeof(StorageBoot)) == sizeof(StorageBoot);
+}
+
+bool storage_set_boot(const StorageBoot *boot) {
+    return flashstore_write(STORAGE_KEY_BOOT, boot, sizeof(StorageBoot));
+}
+
+void print_storage() {
+    FlashStoreStats stats;
+    StorageBoot boot;
+    char msg[2 * BUFFER_SIZE];  // Five 32-bit counters take up to 117 bytes
+
+    if (!flashstore_mounted()) {
+        AddProgramMessage("Flash store not mounted.\r\n");
+        return;
+    }
+    flashstore_stats(&stats);
+    snprintf(msg, sizeof(msg), "Flash store: %u keys, %u of %u bytes used, head sector %u (%u bytes free)\r\n",
+            stats.keys, stats.liveBytes, stats.capacity, stats.head, stats.headFree);
+    AddProgramMessage(msg);
+    snprintf(msg, sizeof(msg), "| writes: %u  unchanged: %u  erases: %u  bad records at mount: %u\r\n",
+            stats.writes, stats.skipped, stats.erases, stats.corrupt);
+    AddProgramMessage(msg);
+    if (!storage_get_boot(&boot) || !boot.autoload) {
+        AddProgramMessage("| boot: off\r\n");
+    } else if (boot.scriptLine == STORAGE_BOOT_NO_SCRIPT) {
+        AddProgramMessage("| boot: load\r\n");
+    } else {
+        sprintf(msg, "| boot: load, then run script line %d\r\n", boot.scriptLine);
+        AddProgramMessage(msg);
+    }
+}
@@ -0,0 +1,43 @@
+/*
+ * storage.h
+ *
+ * Saves and restores the operating state (registers, script lines, tickers and
+ * callbacks) in the flash store, one record per register file, script line,
+ * ticker and callback, so -save only rewrites what changed. A boot record can
+ * make startup load the saved state and start a script.
+ */
+
+#ifndef SRC_STORAGE_H_
+#define SRC_STORAGE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define STORAGE_REGISTERS   0x01
+#define STORAGE_SCRIPTS     0x02
+#define STORAGE_TICKERS     0x04
+#define STORAGE_CALLBACKS   0x08
+#define STORAGE_ALL         0x0F
+
+#define STORAGE_KEY_REGISTERS   0x0001
+#define STORAGE_KEY_BOOT        0x0002
+#define STORAGE_KEY_SCRIPT      0x0100      // + line
+#define STORAGE_KEY_TICKER      0x0200      // + index
+#define STORAGE_KEY_CALLBACK    0x0300      // + index
+
+#define STORAGE_BOOT_NO_SCRIPT  -1
+
+typedef struct StorageBoot {
+    uint8_t autoload;           // Load everything at startup
+    int8_t  scriptLine;         // Script started after loading, STORAGE_BOOT_NO_SCRIPT for none
+} StorageBoot;
+
+void storage_init();
+uint32_t storage_parse_what(const char *token);
+int32_t storage_save(uint32_t what);
+int32_t storage_load(uint32_t what);
+bool storage_get_boot(StorageBoot *boot);
+bool storage_set_boot(const StorageBoot *boot);
+void print_storage();
+
+#endif /* SRC_STORAGE_H_ */
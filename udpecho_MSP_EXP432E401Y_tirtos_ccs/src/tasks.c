@@ -1,15 +1,27 @@
 /*
  *  ======== tasks.c ========
  */
+#include <string.h>
 #include "p100.h"
 #include <xdc/runtime/Memory.h>
 #include "script.h"
+#include "scriptvm.h"
 #include "register.h"
+#include "profile.h"
+#include "scriptimage.h"
+#include "atomic.h"
+#include "netregs.h"
+#include "latency.h"
+#include "timestamp.h"
+#include "cpuload.h"
+#include "memstat.h"
 
 #ifdef Globals
 extern Globals glo;
 #endif
 
+#define UART_BATCH_SIZE 256     // Program output is written to UART0 in chunks of up to this many bytes
+
 // Process user input to input_buffer -> PayloadQueue
 void uart0ReadTask(UArg arg0, UArg arg1) {
 
@@ -95,34 +107,43 @@ void uartWriteTask(UArg arg0, UArg arg1) {
             // Move cursor to the last known program output column position
             moveCursorToColumn(glo.progOutputCol);
 
-            // Process the message character by character
+            // Format the message into a batch and write it in as few UART_write calls as possible
             char *data = out_message->data;
-            int len = strlen(data);
+            char batch[UART_BATCH_SIZE];
+            int n = 0;
+
+            for (; *data; data++) {
+                char ch = *data;
 
-            int i;
-            for (i = 0; i < len; i++) {
-                char ch = data[i];
+                if (n > UART_BATCH_SIZE - 16) {     // Room for a newline and line clear
+                    UART_write_safe(batch, n);
+                    n = 0;
+                }
 
                 if (ch == '\n') {
                     // Newline or carriage return resets the column position
                     // Move to the beginning of next line
-                    UART_write_safe("\r\n", 2);
-                    glo.progOutputCol = 0;
                     // Need to clear the line which had the user input before
-                    UART_write_safe_strlen(CLEAR_LINE_RESET);
+                    memcpy(&batch[n], "\r\n" CLEAR_LINE_RESET, sizeof("\r\n" CLEAR_LINE_RESET) - 1);
+                    n += sizeof("\r\n" CLEAR_LINE_RESET) - 1;
+                    glo.progOutputCol = 0;
                 } else if (isPrintable(ch) && ch != '\r') {
                     // Printable character
-                    UART_write_safe(&ch, 1);
+                    batch[n++] = ch;
                     glo.progOutputCol++;
 
                     if (glo.progOutputCol > MAX_LINE_LENGTH) {
                         // Move to the beginning of next line
-                        UART_write_safe("\r\n", 2);
+                        batch[n++] = '\r';
+                        batch[n++] = '\n';
                         glo.progOutputCol = 0;
                     }
                 }
                 // Handle other characters if needed
             }
+            if (n > 0) {
+                UART_write_safe(batch, n);
+            }
 
             // After writing, move cursor down to user input line
             //moveCursorDown(progOutputLines);
@@ -136,8 +157,8 @@ void uartWriteTask(UArg arg0, UArg arg1) {
         }
 
         // Free allocated memory
-        Memory_free(NULL, out_message->data, strlen(out_message->data) + 1);
-        Memory_free(NULL, out_message, sizeof(PayloadMessage));
+        mem_free(out_message->data, strlen(out_message->data) + 1);
+        mem_free(out_message, sizeof(PayloadMessage));
     }
 }
 
@@ -154,7 +175,10 @@ void executePayloadTask(UArg arg0, UArg arg1) {
     PMsg exec_payload;
 
     while (1) {
-        Semaphore_pend(glo.bios.PayloadSem, BIOS_WAIT_FOREVER);  // Wait for payload
+        // Wait for a payload. While a script runs, wait at most the gap between quanta:
+        // blocking, unlike Task_yield(), also lets UARTWriter and the NDK threads run,
+        // which have a lower priority than this task
+        Semaphore_pend(glo.bios.PayloadSem, script_runnable() ? SCRIPT_QUANTUM_GAP_TICKS : BIOS_WAIT_FOREVER);
 
         // Check for emergency stop
         if (glo.emergencyStopActive) {
@@ -171,22 +195,15 @@ void executePayloadTask(UArg arg0, UArg arg1) {
             continue;
         }
 
-        // If script is running, execute the current line and move to the next
-        if (glo.scriptPointer >= 0) {
-            if (glo.scriptPointer < SCRIPT_LINE_COUNT && scriptLines[glo.scriptPointer]
-                && scriptLines[glo.scriptPointer][0] != '\0') { // Check for valid script line. Empty lines are skipped
-
-                int currentLine = glo.scriptPointer;
-                execute_payload(scriptLines[glo.scriptPointer]);
+        // If scripts are running, run one quantum of the next one. Between quanta one queued
+        // payload is served and the pend above gives the other tasks a chance to run.
+        if (script_runnable()) {
+            script_run_quantum();
+        }
 
-                // Increment scriptPointer if the line was executed and did not result in a line change
-                if(currentLine == glo.scriptPointer) {
-                    glo.scriptPointer++;                    // Move to the next line
-                    Semaphore_post(glo.bios.PayloadSem);    // Allow next line to execute
-                }
-            } else {
-                glo.scriptPointer = -1; // End of script
-            }
+        // A script upload is swapped in between scripts, never under a running one
+        if (script_image_ready() && !script_runnable()) {
+            script_image_apply();
         }
 
         // Do not execute if PayloadQueue is empty
@@ -195,9 +212,18 @@ void executePayloadTask(UArg arg0, UArg arg1) {
         }
 
         exec_payload = (PayloadMessage *)Queue_get(glo.bios.PayloadQueue);
+        lat_record(LAT_PAYLOAD, exec_payload->queued);
 
-        // Execute the payload
-        execute_payload(exec_payload->data);
+        // Execute the payload, its output goes back to the console it came from
+        glo.payloadSource = exec_payload->source;
+        if (exec_payload->profile == PROFILE_NONE) {
+            execute_payload(exec_payload->data);
+        } else {
+            uint32_t start = cycles_now();
+            execute_payload(exec_payload->data);
+            profile_record_tag(exec_payload->profile, cycles_now() - start);
+        }
+        glo.payloadSource = CONSOLE_UART;
 
         // if (glo.scriptPointer >= 0) {
         //     glo.scriptPointer++; // Move to the next line
@@ -209,8 +235,8 @@ void executePayloadTask(UArg arg0, UArg arg1) {
         // }
 
         // Free allocated memory
-        Memory_free(NULL, exec_payload->data, strlen(exec_payload->data) + 1);
-        Memory_free(NULL, exec_payload, sizeof(PayloadMessage));
+        mem_free(exec_payload->data, strlen(exec_payload->data) + 1);
+        mem_free(exec_payload, sizeof(PayloadMessage));
     }
 }
 
@@ -237,6 +263,8 @@ void tickerProcessingTask(UArg arg0, UArg arg1) {
 
         // Process tickers
         process_tickers();
+        netregs_tick();
+        cpuload_tick();
     }
 }
 
@@ -267,15 +295,20 @@ void uart1ReadTask(UArg arg0, UArg arg1) {
 
 void ADCStream() {
     uint16_t *source;
-    // A safe buffer size: header + binary data
-    // Each sample is 2 bytes * 128 = 256 bytes + overhead
-    char longload[512]; 
     int32_t dest_choice;
-    int32_t hdrlen;
+    NetPacketHeader hdr;
+
+    // Voice packet header, filled in per block below
+    hdr.magic[0] = NETPKT_MAGIC0;
+    hdr.magic[1] = NETPKT_MAGIC1;
+    hdr.type = NETPKT_VOICE;
+    hdr.seq = 0;
+    hdr.count = DATABLOCKSIZE;
 
     while (1) {
         // Wait until ADCBuf has new data
         Semaphore_pend(glo.bios.ADCSemaphore, BIOS_WAIT_FOREVER);
+        lat_record(LAT_ADC, glo.audioController.adcBufControl.completedAt);
 
         if (glo.audioController.adcBufControl.RX_Completed == glo.audioController.adcBufControl.RX_Ping) {
             source = glo.audioController.adcBufControl.RX_Completed;
@@ -293,52 +326,30 @@ void ADCStream() {
 
         // If networking is desired (REG_DIAL1 or REG_DIAL2 != 0), send over network:
         if (glo.audioController.adcBufControl.converting == 2) {
-            // If global registers for dial1/dial2 are implemented:
-            uint32_t ipDial1 = registers[REG_DIAL1]; // Store the IP address in REG_DIAL1 (R0)
-            uint32_t ipDial2 = registers[REG_DIAL2]; // Store the IP address in REG_DIAL2 (R1)
+            uint32_t ipDial1 = atomic32_load(&registers[REG_DIAL1]); // Store the IP address in REG_DIAL1 (R0)
+            uint32_t ipDial2 = atomic32_load(&registers[REG_DIAL2]); // Store the IP address in REG_DIAL2 (R1)
 
+            // Samples go straight from the ADC buffer into the network queue slot
             bool local = true;
+            hdr.timestamp = timestamp_us();
             if (ipDial1 != 0) {
-                sprintf(longload, "-netudp %d.%d.%d.%d:%d -voice %d 128  ",
-                        (uint8_t)(ipDial1 >> 24) & 0xFF,
-                        (uint8_t)(ipDial1 >> 16) & 0xFF,
-                        (uint8_t)(ipDial1 >> 8 ) & 0xFF,
-                        (uint8_t)(ipDial1      ) & 0xFF,
-                        DEFAULTPORT, dest_choice);
-
-                hdrlen = (int32_t)(strlen(longload)+1);
-                memcpy(&longload[hdrlen], source, sizeof(uint16_t)*DATABLOCKSIZE);
-                ParseNetUDP(longload, sizeof(uint16_t)*DATABLOCKSIZE);
+                hdr.dest = dest_choice;
+                VoiceSend(ipDial1, &hdr, source);
                 local = false;
             }
 
             if (ipDial2 != 0) {
-                sprintf(longload, "-netudp %d.%d.%d.%d:%d -voice %d 128  ",
-                        (uint8_t)(ipDial1 >> 24) & 0xFF,
-                        (uint8_t)(ipDial1 >> 16) & 0xFF,
-                        (uint8_t)(ipDial1 >> 8 ) & 0xFF,
-                        (uint8_t)(ipDial1      ) & 0xFF,
-                        DEFAULTPORT, dest_choice+2);
-                hdrlen = (int32_t)(strlen(longload)+1);
-                memcpy(&longload[hdrlen], source, sizeof(uint16_t)*DATABLOCKSIZE);
-                ParseNetUDP(longload, sizeof(uint16_t)*DATABLOCKSIZE);
+                hdr.dest = dest_choice + 2;
+                VoiceSend(ipDial2, &hdr, source);
                 local = false;
             }
 
             if(local == true) {
-                // Construct the message: "-voice dest_choice 128  " followed by binary data
-                sprintf(longload, "-voice %d 128  ", dest_choice);
-                hdrlen = (int32_t)(strlen(longload) + 1);
-                memcpy(&longload[hdrlen], source, sizeof(uint16_t) * DATABLOCKSIZE);
-
-                // Now we have a buffer that resembles the format:
-                // "-voice <dest_choice> <bufflen>  <binary_data...>"
-                // We can call ParseVoice directly:
-                ParseVoice(longload);
+                // No dial target, play the block locally
+                VoiceWriteBlock(dest_choice, source);
             }
 
-            // If local == true, we have already done the local voice via ParseVoice above.
-            // If not local, we have sent it over network as well.
+            hdr.seq++;
         }
 
     }
@@ -0,0 +1,350 @@
+/*
+ * tcpconsole.c
+ * BSD Sockets TCP console server. One task serves every session with select().
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+/* Include TI-RTOS NDK BSD headers */
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <sys/time.h>
+
+#include "p100.h"
+#include "tcpconsole.h"
+
+#define TELNET_IAC  0xFF
+#define TELNET_WILL 251     // WILL, WONT, DO and DONT carry one option byte
+#define TELNET_DONT 254
+
+extern void fdOpenSession(void *taskHandle);
+extern void fdCloseSession(void *taskHandle);
+extern void *TaskSelf(void);
+
+typedef struct ConsoleSession {
+    int      fd;                        // -1 when the slot is free
+    uint32_t peer;                      // Client IP (host byte order)
+    char     line[BUFFER_SIZE];         // Input line being typed
+    int32_t  cursor;
+    int32_t  telnet;                    // Telnet command bytes still to skip, -1 after IAC
+    volatile uint32_t outHead;          // Written by console_capture under gateSwi3
+    volatile uint32_t outTail;          // Advanced by ConsoleFxn after send()
+    uint32_t outDropped;                // Messages that did not fit in out[]
+    char     out[CONSOLE_OUT_SIZE];
+} ConsoleSession;
+
+static ConsoleSession sessions[CONSOLE_MAX_SESSIONS];
+
+/// @brief Console text as it would appear on UART0: '\n' becomes "\r\n", '\r' and control characters are dropped
+static int32_t console_text_len(const char *data) {
+    int32_t n = 0;
+
+    for (; *data; data++) {
+        if (*data == '\n') {
+            n += 2;
+        } else if (isPrintable(*data) || *data == '\t') {
+            n++;
+        }
+    }
+    return n;
+}
+
+/// @brief Appends text to a session's output. Call with gateSwi3 entered.
+static bool console_append(ConsoleSession *s, const char *data) {
+    uint32_t head = s->outHead;
+
+    if (console_text_len(data) > CONSOLE_OUT_SIZE - (int32_t)(head - s->outTail)) {
+        s->outDropped++;    // Drop whole messages so the output never ends mid-line
+        return false;
+    }
+
+    for (; *data; data++) {
+        if (*data == '\n') {
+            s->out[head++ & (CONSOLE_OUT_SIZE - 1)] = '\r';
+            s->out[head++ & (CONSOLE_OUT_SIZE - 1)] = '\n';
+        } else if (isPrintable(*data) || *data == '\t') {
+            s->out[head++ & (CONSOLE_OUT_SIZE - 1)] = *data;
+        }
+    }
+    s->outHead = head;
+    return true;
+}
+
+static void console_puts(ConsoleSession *s, const char *data) {
+    uint32_t gateKey = GateSwi_enter(gateSwi3);
+    console_append(s, data);
+    GateSwi_leave(gateSwi3, gateKey);
+}
+
+/**
+ * @brief Console the running code belongs to. Only the payload executor task works
+ * on behalf of a TCP session, Swis and other tasks that preempt it stay on UART0.
+ */
+int32_t console_source() {
+    if (glo.payloadSource == CONSOLE_UART || BIOS_getThreadType() != BIOS_ThreadType_Task
+        || Task_self() != glo.bios.PayloadExecutor) {
+        return CONSOLE_UART;
+    }
+    return glo.payloadSource;
+}
+
+/**
+ * @brief Routes program output of a payload that came from a TCP session back to
+ * that session.
+ * @return True when data was consumed, false when it should go to UART0
+ */
+bool console_capture(const char *data) {
+    int32_t source = console_source();
+    ConsoleSession *s;
+    uint32_t gateKey;
+
+    if (source < 1 || source > CONSOLE_MAX_SESSIONS) {
+        return false;
+    }
+
+    s = &sessions[source - 1];
+    gateKey = GateSwi_enter(gateSwi3);
+    if (s->fd >= 0) {
+        console_append(s, data);
+    }
+    GateSwi_leave(gateSwi3, gateKey);
+    return true;    // A closed session's output is discarded
+}
+
+static void console_close(ConsoleSession *s) {
+    int fd = s->fd;
+    uint32_t gateKey = GateSwi_enter(gateSwi3);
+
+    s->fd = -1;
+    s->outHead = 0;
+    s->outTail = 0;
+    GateSwi_leave(gateSwi3, gateKey);
+    close(fd);
+}
+
+static void console_open(int fd, const struct sockaddr_in *clientAddr) {
+    ConsoleSession *s = NULL;
+    char MsgBuff[96];
+    uint32_t gateKey;
+    int32_t i;
+
+    for (i = 0; i < CONSOLE_MAX_SESSIONS; i++) {
+        if (sessions[i].fd < 0) {
+            s = &sessions[i];
+            break;
+        }
+    }
+    if (s == NULL) {
+        send(fd, "Console busy.\r\n", 15, MSG_DONTWAIT);
+        close(fd);
+        return;
+    }
+
+    s->peer = ntohl(clientAddr->sin_addr.s_addr);
+    s->cursor = 0;
+    s->telnet = 0;
+    memset(s->line, 0, BUFFER_SIZE);
+
+    // Start from an empty output ring, whatever the previous client left behind
+    gateKey = GateSwi_enter(gateSwi3);
+    s->outHead = 0;
+    s->outTail = 0;
+    s->outDropped = 0;
+    s->fd = fd;
+    GateSwi_leave(gateSwi3, gateKey);
+
+    sprintf(MsgBuff, "TCP console %d opened by %d.%d.%d.%d\r\n", (int)(i + 1),
+            (int)(s->peer >> 24) & 0xFF, (int)(s->peer >> 16) & 0xFF,
+            (int)(s->peer >> 8) & 0xFF, (int)s->peer & 0xFF);
+    AddProgramMessage(MsgBuff);     // Announce on UART0
+    console_puts(s, MsgBuff);
+}
+
+/// @brief Line editing for one session. Telnet negotiation bytes are skipped.
+static void console_input(ConsoleSession *s, const char *buf, int32_t len) {
+    int32_t i;
+    char ch;
+
+    for (i = 0; i < len; i++) {
+        ch = buf[i];
+
+        if (s->telnet != 0) {
+            if (s->telnet < 0 && (uint8_t)ch >= TELNET_WILL && (uint8_t)ch <= TELNET_DONT) {
+                s->telnet = 1;      // Option byte follows
+            } else {
+                s->telnet = 0;
+            }
+            continue;
+        }
+
+        if ((uint8_t)ch == TELNET_IAC) {
+            s->telnet = -1;
+        } else if (ch == '\r' || ch == '\n') {
+            if (s->cursor > 0) {
+                AddPayloadSource(s->line, (int32_t)(s - sessions) + 1);
+            }
+            s->cursor = 0;
+            memset(s->line, 0, BUFFER_SIZE);
+        } else if (ch == '\b' || ch == 0x7F) {
+            if (s->cursor > 0) {
+                s->line[--s->cursor] = '\0';
+            }
+        } else if (isPrintable(ch)) {
+            if (s->cursor < BUFFER_SIZE - 1) {
+                s->line[s->cursor++] = ch;
+                s->line[s->cursor] = '\0';
+            } else {
+                s->cursor = 0;
+                memset(s->line, 0, BUFFER_SIZE);
+                console_puts(s, "Error: Buffer overflow.\n");
+            }
+        }
+    }
+}
+
+/**
+ * @brief Sends as much buffered output as the socket takes without blocking,
+ * one send() per contiguous part of the ring.
+ * @return False when the connection failed
+ */
+static bool console_flush(ConsoleSession *s) {
+    uint32_t tail, pending, chunk;
+    int sent;
+
+    while ((pending = s->outHead - s->outTail) != 0) {
+        tail = s->outTail & (CONSOLE_OUT_SIZE - 1);
+        chunk = CONSOLE_OUT_SIZE - tail;
+        if (chunk > pending) {
+            chunk = pending;
+        }
+
+        sent = (int)send(s->fd, &s->out[tail], chunk, MSG_DONTWAIT);
+        if (sent <= 0) {
+            return sent == 0 || errno == EWOULDBLOCK || errno == EAGAIN;
+        }
+        s->outTail += sent;     // Only this task moves the tail, the writer only reads it
+    }
+    return true;
+}
+
+void *ConsoleFxn(void *arg0)
+{
+    int status;
+    int server = -1;
+    int client, maxfd;
+    int32_t i, n;
+    int32_t optval = 1;
+    fd_set readSet, writeSet;
+    struct timeval timeout;
+    struct sockaddr_in localAddr, clientAddr;
+    socklen_t addrlen;
+    char buffer[BUFFER_SIZE];
+    char MsgBuff[64];
+    uint16_t listeningPort = *(uint16_t *)arg0;
+
+    fdOpenSession(TaskSelf());
+
+    for (i = 0; i < CONSOLE_MAX_SESSIONS; i++) {
+        sessions[i].fd = -1;
+    }
+
+    server = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (server == -1) {
+        AddProgramMessage("Error: Console socket not created.\r\n");
+        goto shutdown;
+    }
+    setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
+
+    memset(&localAddr, 0, sizeof(localAddr));
+    localAddr.sin_family = AF_INET;
+    localAddr.sin_addr.s_addr = htonl(INADDR_ANY);
+    localAddr.sin_port = htons(listeningPort);
+
+    status = bind(server, (struct sockaddr *)&localAddr, sizeof(localAddr));
+    if (status == -1) {
+        AddProgramMessage("Error: Console bind failed.\r\n");
+        goto shutdown;
+    }
+    status = listen(server, CONSOLE_MAX_SESSIONS);
+    if (status == -1) {
+        AddProgramMessage("Error: Console listen failed.\r\n");
+        goto shutdown;
+    }
+
+    sprintf(MsgBuff, "TCP console started : %u\r\n", (unsigned)listeningPort);
+    AddProgramMessage(MsgBuff);
+
+    while (1) {
+        FD_ZERO(&readSet);
+        FD_ZERO(&writeSet);
+        FD_SET(server, &readSet);
+        maxfd = server;
+        for (i = 0; i < CONSOLE_MAX_SESSIONS; i++) {
+            if (sessions[i].fd < 0) {
+                continue;
+            }
+            FD_SET(sessions[i].fd, &readSet);
+            if (sessions[i].outHead != sessions[i].outTail) {
+                FD_SET(sessions[i].fd, &writeSet);
+            }
+            if (sessions[i].fd > maxfd) {
+                maxfd = sessions[i].fd;
+            }
+        }
+
+        // Output is produced by the payload executor, so wake up regularly to pick it up
+        timeout.tv_sec = 0;
+        timeout.tv_usec = CONSOLE_POLL_MS * 1000;
+        status = select(maxfd + 1, &readSet, &writeSet, NULL, &timeout);
+        if (status < 0) {
+            AddProgramMessage("Error: Console select() failed.\r\n");
+            break;
+        }
+
+        if (status > 0 && FD_ISSET(server, &readSet)) {
+            addrlen = sizeof(clientAddr);
+            client = accept(server, (struct sockaddr *)&clientAddr, &addrlen);
+            if (client != -1) {
+                console_open(client, &clientAddr);
+            }
+        }
+
+        for (i = 0; i < CONSOLE_MAX_SESSIONS; i++) {
+            if (sessions[i].fd < 0) {
+                continue;
+            }
+            if (status > 0 && FD_ISSET(sessions[i].fd, &readSet)) {
+                n = (int32_t)recv(sessions[i].fd, buffer, sizeof(buffer), 0);
+                if (n <= 0) {
+                    sprintf(MsgBuff, "TCP console %d closed\r\n", (int)(i + 1));
+                    AddProgramMessage(MsgBuff);
+                    console_close(&sessions[i]);
+                    continue;
+                }
+                console_input(&sessions[i], buffer, n);
+            }
+            if (!console_flush(&sessions[i])) {
+                console_close(&sessions[i]);
+            }
+        }
+    }
+
+shutdown:
+    for (i = 0; i < CONSOLE_MAX_SESSIONS; i++) {
+        if (sessions[i].fd >= 0) {
+            console_close(&sessions[i]);
+        }
+    }
+    if (server != -1) {
+        close(server);
+    }
+
+    fdCloseSession(TaskSelf());
+    return (NULL);
+}
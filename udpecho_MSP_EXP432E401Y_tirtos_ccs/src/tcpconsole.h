@@ -0,0 +1,31 @@
+/*
+ * tcpconsole.h
+ *
+ * TCP console server running next to the UART0 console. Each connected
+ * session has its own input line and output stream. Lines typed into a
+ * session are queued with AddPayloadSource() and run by the same
+ * executePayloadTask as UART0 input. AddProgramMessage() calls made while the
+ * executor runs that payload are routed back to the session instead of UART0.
+ *
+ * Output is buffered per session and sent in as few send() calls as the
+ * socket allows, so a -help dump goes out in a couple of segments.
+ */
+
+#ifndef SRC_TCPCONSOLE_H_
+#define SRC_TCPCONSOLE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define CONSOLE_UART          0     // Payload source of UART0 and every internal payload
+#define CONSOLE_TCP_PORT      23
+#define CONSOLE_MAX_SESSIONS  3     // Payload sources 1..CONSOLE_MAX_SESSIONS
+#define CONSOLE_OUT_SIZE      4096  // Output bytes buffered per session, power of 2
+#define CONSOLE_POLL_MS       10    // select() timeout, bounds the output latency
+
+int32_t console_source();
+bool console_capture(const char *data);
+
+void *ConsoleFxn(void *arg0);
+
+#endif /* SRC_TCPCONSOLE_H_ */
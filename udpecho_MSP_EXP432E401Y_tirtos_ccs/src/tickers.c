@@ -6,6 +6,7 @@
 #include "tickers.h"
 #include "tasks.h"   // For execute_payload()
 #include "callback.h" // For BUFFER_SIZE
+#include "profile.h"
 #include <ti/sysbios/knl/Queue.h>
 #include <ti/sysbios/BIOS.h>
 #include <xdc/runtime/System.h>
@@ -99,7 +100,7 @@ void process_tickers() {
                 tickers[i].currentDelay--;
             } else {
                 // Add payload for execution
-                AddPayload(tickers[i].payload);
+                AddPayloadTagged(tickers[i].payload, CONSOLE_UART, profile_tag(PROF_TICKER, i));
 
                 // Handle count and period
                 if (tickers[i].count == 0) {
@@ -0,0 +1,52 @@
+/*
+ *  ======== timestamp.c ========
+ */
+#include "timestamp.h"
+
+#if defined(__TI_ARM__) || defined(__ARM_ARCH)
+
+#include <xdc/runtime/Types.h>
+
+uint32_t timestamp_ticks_per_us() {
+    static uint32_t ticksPerUs = 0;
+    if (ticksPerUs == 0) {
+        Types_FreqHz freq;
+        Timestamp_getFreq(&freq);
+        ticksPerUs = freq.lo / 1000000;
+        if (ticksPerUs == 0) {
+            ticksPerUs = 1;
+        }
+    }
+    return ticksPerUs;
+}
+
+/// @brief The provider counts the wraps of the 32-bit timer, so this is callable from any context
+uint64_t timestamp_ticks() {
+    Types_Timestamp64 ts;
+    Timestamp_get64(&ts);
+    return (uint64_t)ts.hi << 32 | ts.lo;
+}
+
+#else
+
+#include <time.h>
+
+uint32_t timestamp_ticks_per_us() {
+    return CYCLES_PER_US;
+}
+
+uint64_t timestamp_ticks() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec) * CYCLES_PER_US / 1000;
+}
+
+#endif
+
+uint64_t timestamp_us64() {
+    return timestamp_ticks() / timestamp_ticks_per_us();
+}
+
+uint32_t timestamp_us() {
+    return (uint32_t)timestamp_us64();
+}
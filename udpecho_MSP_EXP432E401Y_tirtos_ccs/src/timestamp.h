@@ -0,0 +1,44 @@
+/*
+ * timestamp.h
+ *
+ * Monotonic system time from the xdc Timestamp provider, a free-running
+ * general purpose timer on the 120 MHz system clock. Unlike the DWT counter
+ * of cycles.h it keeps counting while the Idle loop sleeps the core in WFI,
+ * so it is the clock for anything that can span idle time. Host builds read
+ * CLOCK_MONOTONIC scaled to the same rate.
+ *
+ *   timestamp_now()     32-bit ticks, one load, for intervals under ~35 s
+ *   timestamp_ticks()   64-bit ticks since boot, never wraps
+ *   timestamp_us()      microseconds, 32 bits, wraps modulo 2^32 (~71 minutes)
+ */
+
+#ifndef SRC_TIMESTAMP_H_
+#define SRC_TIMESTAMP_H_
+
+#include <stdint.h>
+
+#include "cycles.h"
+
+#if defined(__TI_ARM__) || defined(__ARM_ARCH)
+
+#include <xdc/std.h>
+#include <xdc/runtime/Timestamp.h>
+
+static inline uint32_t timestamp_now() {
+    return Timestamp_get32();
+}
+
+#else
+
+static inline uint32_t timestamp_now() {
+    return cycles_now();
+}
+
+#endif
+
+uint32_t timestamp_ticks_per_us();
+uint64_t timestamp_ticks();
+uint64_t timestamp_us64();
+uint32_t timestamp_us();
+
+#endif /* SRC_TIMESTAMP_H_ */
@@ -21,6 +21,10 @@
 
 /* Include your user globals and functions */
 #include "p100.h"  // For glo, AddProgramMessage, raiseError, etc.
+#include "shadow.h"
+#include "scriptimage.h"
+#include "netregs.h"
+#include "latency.h"
 
 #define UDPPACKETSIZE 1472
 #define MAXPORTLEN    6
@@ -35,10 +39,27 @@ extern void fdOpenSession(void *taskHandle);
 extern void fdCloseSession(void *taskHandle);
 extern void *TaskSelf(void);
 
-extern void ParseVoice(char *ch);
 extern void ParseNetUDP(char *ch, int32_t binaryCount);
 extern bool MatchSubString(const char *needle, const char *haystack);
 
+// Receive handlers. packet points at a buffer with room for a terminator at packet[len].
+typedef void (*NetPacketHandler)(char *packet, int32_t len, struct sockaddr_in *clientAddr);
+
+static void NetHandleText(char *packet, int32_t len, struct sockaddr_in *clientAddr);
+static void NetHandleVoice(char *packet, int32_t len, struct sockaddr_in *clientAddr);
+static void NetHandleParity(char *packet, int32_t len, struct sockaddr_in *clientAddr);
+static void NetHandleScript(char *packet, int32_t len, struct sockaddr_in *clientAddr);
+static void NetHandleRegs(char *packet, int32_t len, struct sockaddr_in *clientAddr);
+
+// Indexed by NetPacketType
+static const NetPacketHandler netPacketHandlers[NETPKT_TYPE_COUNT] = {
+    NetHandleVoice,     // NETPKT_VOICE
+    NetHandleVoice,     // NETPKT_VOICE_RED
+    NetHandleParity,    // NETPKT_PARITY
+    NetHandleScript,    // NETPKT_SCRIPT
+    NetHandleRegs,      // NETPKT_REGS
+};
+
 // Replace AddError(...) with AddProgramMessage("Error: ...\r\n")
 // Replace AddPayload(... with -print) with AddProgramMessage(...)
 
@@ -118,6 +139,102 @@ coloncheck:
     return StrBufPTR;
 }
 
+/**
+ * @brief Text payload received over UDP (e.g. "-print hello" from another board).
+ * Displays it and queues it for execution. All copies are bounded by len.
+ */
+static void NetHandleText(char *packet, int32_t len, struct sockaddr_in *clientAddr) {
+    packet[len] = '\0';
+    LOG(NET, LOG_INFO, "UDP %d.%d.%d.%d> %.*s\r\n",
+        (uint8_t)(clientAddr->sin_addr.s_addr      & 0xFF),
+        (uint8_t)((clientAddr->sin_addr.s_addr>> 8)&0xFF),
+        (uint8_t)((clientAddr->sin_addr.s_addr>>16)&0xFF),
+        (uint8_t)((clientAddr->sin_addr.s_addr>>24)&0xFF),
+        (int)len, packet);
+    AddPayload(packet);
+}
+
+/**
+ * @brief Voice block received over UDP, optionally followed by a redundant copy
+ * of the previous block. The samples are copied from the receive buffer straight
+ * into the jitter buffer.
+ */
+static void NetHandleVoice(char *packet, int32_t len, struct sockaddr_in *clientAddr) {
+    const NetPacketHeader *hdr = (const NetPacketHeader *)packet;
+    int32_t need = sizeof(NetPacketHeader) + sizeof(uint16_t) * DATABLOCKSIZE;
+
+    if (hdr->type == NETPKT_VOICE_RED) {
+        need += sizeof(FecRedundant);
+    }
+    if (hdr->count != DATABLOCKSIZE || len < need) {
+        netstat_drop(&netStats.rx, NET_DROP_SHORT);
+        LOG(NET, LOG_WARN, "Error: Blocksize Error in voice packet.\r\n");
+        return;
+    }
+    if (hdr->dest > 3) {
+        netstat_drop(&netStats.rx, NET_DROP_BAD_DEST);
+        LOG(NET, LOG_WARN, "Error: Destination Choice Error in voice packet.\r\n");
+        return;
+    }
+
+    netstat_voice_rx(ntohl(clientAddr->sin_addr.s_addr), hdr->seq, hdr->timestamp);
+
+    VoiceReceiveBlock(hdr->dest, hdr->seq, (const uint16_t *)(packet + sizeof(NetPacketHeader)));
+    if (hdr->type == NETPKT_VOICE_RED) {
+        VoiceReceiveRedundant(hdr->dest, hdr->seq - 1,
+                (const FecRedundant *)(packet + sizeof(NetPacketHeader) + sizeof(uint16_t) * DATABLOCKSIZE));
+    }
+}
+
+/// @brief XOR parity over a group of voice blocks, used to rebuild one lost block
+static void NetHandleParity(char *packet, int32_t len, struct sockaddr_in *clientAddr) {
+    const NetPacketHeader *hdr = (const NetPacketHeader *)packet;
+
+    if (hdr->count < FEC_MIN_K || hdr->count > FEC_MAX_K ||
+        len < (int32_t)(sizeof(NetPacketHeader) + sizeof(uint16_t) * DATABLOCKSIZE)) {
+        netstat_drop(&netStats.rx, NET_DROP_SHORT);
+        LOG(NET, LOG_WARN, "Error: Malformed parity packet.\r\n");
+        return;
+    }
+    if (hdr->dest > 3) {
+        netstat_drop(&netStats.rx, NET_DROP_BAD_DEST);
+        return;
+    }
+
+    VoiceReceiveParity(hdr, (const uint16_t *)(packet + sizeof(NetPacketHeader)));
+}
+
+/// @brief One chunk of a script upload (scriptimage.h)
+static void NetHandleScript(char *packet, int32_t len, struct sockaddr_in *clientAddr) {
+    script_image_receive(packet, len);
+}
+
+/// @brief Register file read, write or subscription, answered to the sender (netregs.h)
+static void NetHandleRegs(char *packet, int32_t len, struct sockaddr_in *clientAddr) {
+    netregs_receive(packet, len, ntohl(clientAddr->sin_addr.s_addr), ntohs(clientAddr->sin_port));
+}
+
+/**
+ * @brief Classifies a datagram by the magic prefix at offset 0 and dispatches it
+ * through netPacketHandlers. Datagrams without the prefix are text payloads.
+ */
+static void NetDispatchPacket(char *packet, int32_t len, struct sockaddr_in *clientAddr) {
+    const NetPacketHeader *hdr = (const NetPacketHeader *)packet;
+
+    if (len >= (int32_t)sizeof(NetPacketHeader)
+        && hdr->magic[0] == NETPKT_MAGIC0 && hdr->magic[1] == NETPKT_MAGIC1) {
+        if (hdr->type < NETPKT_TYPE_COUNT) {
+            netPacketHandlers[hdr->type](packet, len, clientAddr);
+        } else {
+            netstat_drop(&netStats.rx, NET_DROP_UNKNOWN_TYPE);
+            LOG(NET, LOG_WARN, "Error: Unknown UDP packet type.\r\n");
+        }
+        return;
+    }
+
+    NetHandleText(packet, len, clientAddr);
+}
+
 void *ListenFxn(void *arg0)
 {
     int bytesRcvd;
@@ -128,9 +245,9 @@ void *ListenFxn(void *arg0)
     struct addrinfo *res = NULL, *p = NULL;
     struct sockaddr_in clientAddr;
     socklen_t addrlen;
-    char buffer[UDPPACKETSIZE+1]; // +1 for null terminator
+    uint32_t bufferWords[(UDPPACKETSIZE + sizeof(uint32_t)) / sizeof(uint32_t)]; // Word aligned so packet headers and samples can be read in place
+    char *buffer = (char *)bufferWords;   // UDPPACKETSIZE bytes +1 for null terminator
     char portNumber[MAXPORTLEN];
-    char MsgBuff[320];
     int32_t optval = 1;
     my_ip_mreq mreq;
     uint16_t listeningPort = *(uint16_t *)arg0;
@@ -138,8 +255,7 @@ void *ListenFxn(void *arg0)
     fdOpenSession(TaskSelf());
 
     sprintf(portNumber, "%u", (unsigned)listeningPort);
-    sprintf(MsgBuff, "UDP Recv started : %s\r\n", portNumber);
-    AddProgramMessage(MsgBuff);
+    LOG(NET, LOG_INFO, "UDP Recv started : %s\r\n", portNumber);
 
     memset(&hints, 0, sizeof(hints));
     hints.ai_family   = AF_INET;
@@ -195,21 +311,8 @@ void *ListenFxn(void *arg0)
                                          (struct sockaddr *)&clientAddr, &addrlen);
 
                 if (bytesRcvd > 0) {
-                    buffer[bytesRcvd] = '\0';
-                    if(MatchSubString("-voice", buffer))
-                        ParseVoice(buffer);
-                    else {
-                        sprintf(MsgBuff, "UDP %d.%d.%d.%d> %s\r\n",
-                                (uint8_t)(clientAddr.sin_addr.s_addr      & 0xFF),
-                                (uint8_t)((clientAddr.sin_addr.s_addr>> 8)&0xFF),
-                                (uint8_t)((clientAddr.sin_addr.s_addr>>16)&0xFF),
-                                (uint8_t)((clientAddr.sin_addr.s_addr>>24)&0xFF),
-                                buffer);
-                        AddProgramMessage(MsgBuff);
-                        // Add message to queue if needed or just processed above
-                        // If needed:
-                        AddPayload(buffer);
-                    }
+                    netstat_rx(bytesRcvd);
+                    NetDispatchPacket(buffer, bytesRcvd, &clientAddr);
                 }
             }
         }
@@ -244,7 +347,7 @@ void *TransmitFxn(void *arg0)
 
     fdOpenSession(TaskSelf());
 
-    AddProgramMessage("UDP Transmit started.\r\n");
+    LOG(NET, LOG_INFO, "UDP Transmit started.\r\n");
 
     // Just create a socket for sending
     server = socket(AF_INET, SOCK_DGRAM, 0);
@@ -268,20 +371,37 @@ void *TransmitFxn(void *arg0)
         bytesSent = -1;
         gateKey = GateSwi_enter(gateSwi4);
 
-        // Assume glo.NetOutQ structure and usage similar to example code
-        StrBufPTR = UDPParse(glo.NetOutQ.payloads[glo.NetOutQ.payloadReading], &clientAddr, true);
-        if(StrBufPTR){
-            bytesRequested = (int)strlen(StrBufPTR) + 1;
-            bytesRequested += glo.NetOutQ.binaryCount[glo.NetOutQ.payloadReading];
+        if(glo.NetOutQ.raw[glo.NetOutQ.payloadReading]) {
+            // Binary packet: the slot already holds the complete datagram
+            memset(&clientAddr, 0, sizeof(clientAddr));
+            clientAddr.sin_family = AF_INET;
+            clientAddr.sin_addr.s_addr = htonl(glo.NetOutQ.rawAddr[glo.NetOutQ.payloadReading]);
+            clientAddr.sin_port = htons(glo.NetOutQ.rawPort[glo.NetOutQ.payloadReading]);
+            StrBufPTR = glo.NetOutQ.payloads[glo.NetOutQ.payloadReading];
+            bytesRequested = glo.NetOutQ.binaryCount[glo.NetOutQ.payloadReading];
+        } else {
+            // Text payload: "<ip>:<port> <payload>" followed by binaryCount bytes
+            StrBufPTR = UDPParse(glo.NetOutQ.payloads[glo.NetOutQ.payloadReading], &clientAddr, true);
+            if(StrBufPTR){
+                bytesRequested = (int)strlen(StrBufPTR) + 1;
+                bytesRequested += glo.NetOutQ.binaryCount[glo.NetOutQ.payloadReading];
+            }
+        }
 
+        if(StrBufPTR){
+            lat_record(LAT_NET_TX, glo.NetOutQ.queuedAt[glo.NetOutQ.payloadReading]);
             bytesSent = (int)sendto(server, StrBufPTR, bytesRequested, 0,
                                     (struct sockaddr *)&clientAddr, sizeof(clientAddr));
         }
 
         if(!StrBufPTR) {
+            netstat_drop(&netStats.tx, NET_DROP_PARSE);
             AddProgramMessage("Error: UDP Parse Failed.\r\n");
         } else if(bytesSent < 0 || bytesSent != bytesRequested) {
+            netstat_drop(&netStats.tx, NET_DROP_SENDTO);
             AddProgramMessage("Error: Sendto() failed.\r\n");
+        } else {
+            netstat_tx(bytesSent);
         }
 
         payloadnext = glo.NetOutQ.payloadReading + 1;
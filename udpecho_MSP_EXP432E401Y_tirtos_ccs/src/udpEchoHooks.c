@@ -26,6 +26,7 @@
 
 extern void *ListenFxn(void *arg0);
 extern void *TransmitFxn(void *arg0);
+extern void *ConsoleFxn(void *arg0);
 
 void netIPAddrHook(uint32_t IPAddr, unsigned int IfIdx, unsigned int fAdd)
 {
@@ -36,6 +37,7 @@ void netIPAddrHook(uint32_t IPAddr, unsigned int IfIdx, unsigned int fAdd)
     int detachState;
     uint32_t hostByteAddr;
     static uint16_t arg0 = UDPPORT;
+    static uint16_t consolePort = CONSOLE_TCP_PORT;
     static bool createTask = true;
     int32_t status = 0;
     char MsgBuffer[128];
@@ -100,6 +102,12 @@ void netIPAddrHook(uint32_t IPAddr, unsigned int IfIdx, unsigned int fAdd)
             while (1);
         }
 
+        retc = pthread_create(&thread, &attrs, ConsoleFxn, (void *)&consolePort);
+        if (retc != 0) {
+            AddProgramMessage("Error: ConsoleFxn pthread_create() failed.\r\n");
+            while (1);
+        }
+
         createTask = false;
     }
 }
@@ -0,0 +1,132 @@
+/*
+ *  ======== var.c ========
+ */
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "p100.h"
+#include "var.h"
+
+int32_t varValues[MAX_VARS];
+
+static char varNames[MAX_VARS][VAR_NAME_SIZE];
+static int16_t varTable[VAR_TABLE_SIZE];    // Slot + 1, 0 for an empty bucket
+static int varCount;
+static int varProbeMax;                     // Longest probe sequence of any name
+
+/// @brief FNV-1a over the first len characters of name
+static uint32_t var_hash(const char *name, int len) {
+    uint32_t hash = 2166136261u;
+    int i;
+
+    for (i = 0; i < len; i++) {
+        hash = (hash ^ (uint8_t)name[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/// @brief Finds the bucket of name, or the empty bucket where it would go
+static int var_bucket(const char *name, int len, int *probes) {
+    uint32_t bucket = var_hash(name, len) & (VAR_TABLE_SIZE - 1);
+    int slot;
+
+    for (*probes = 1; ; (*probes)++) {
+        slot = varTable[bucket] - 1;
+        if (slot < 0 || (strncmp(varNames[slot], name, len) == 0 && varNames[slot][len] == '\0')) {
+            return bucket;
+        }
+        bucket = (bucket + 1) & (VAR_TABLE_SIZE - 1);
+    }
+}
+
+/// @return Slot of the variable called name (without '$'), -1 if it does not exist
+int var_lookup(const char *name, int len) {
+    int probes;
+    return varTable[var_bucket(name, len, &probes)] - 1;
+}
+
+/**
+ * @brief Returns the slot of a variable, taking a new one from the pool if the
+ * name is not yet defined
+ * @param name Letters, digits and '_', not starting with a digit
+ * @return Slot number, -1 if the name is invalid or the pool is used up
+ */
+int var_intern(const char *name, int len) {
+    int bucket, probes, i;
+
+    if (len <= 0 || len >= VAR_NAME_SIZE || isdigit((unsigned char)name[0])) {
+        return -1;
+    }
+    for (i = 0; i < len; i++) {
+        if (!isalnum((unsigned char)name[i]) && name[i] != '_') {
+            return -1;
+        }
+    }
+
+    bucket = var_bucket(name, len, &probes);
+    if (varTable[bucket] != 0) {
+        return varTable[bucket] - 1;
+    }
+    if (varCount == MAX_VARS) {
+        return -1;
+    }
+    memcpy(varNames[varCount], name, len);
+    varNames[varCount][len] = '\0';
+    varValues[varCount] = 0;
+    varTable[bucket] = ++varCount;
+    if (probes > varProbeMax) {
+        varProbeMax = probes;
+    }
+    return varCount - 1;
+}
+
+/// @brief Returns the slot of a "$name" token, defining the variable on first use
+/// @return Slot number, -1 if the token is not a valid variable
+int var_parse(const char *token) {
+    if (!token || token[0] != '$') {
+        return -1;
+    }
+    return var_intern(&token[1], strlen(&token[1]));
+}
+
+const char *var_name(int slot) {
+    return varNames[slot];
+}
+
+/// @return Slot whose value is at the given address, -1 if it is not a variable
+int var_slot(const volatile int32_t *value) {
+    if (value < varValues || value >= &varValues[varCount]) {
+        return -1;
+    }
+    return (int)(value - varValues);
+}
+
+int var_count() {
+    return varCount;
+}
+
+void var_zero_all() {
+    memset(varValues, 0, sizeof(varValues));
+}
+
+void print_var(int slot) {
+    char msg[BUFFER_SIZE];
+
+    sprintf(msg, "$%-15s = %d\r\n", varNames[slot], (int)varValues[slot]);
+    AddProgramMessage(msg);
+}
+
+/// @brief Lists the variables in the order they were defined
+void print_all_vars() {
+    char msg[BUFFER_SIZE];
+    int i;
+
+    AddProgramMessage("================================== Variables ===================================\r\n");
+    sprintf(msg, "%d of %d defined, longest probe %d of %d buckets\r\n",
+            varCount, MAX_VARS, varProbeMax, VAR_TABLE_SIZE);
+    AddProgramMessage(msg);
+    for (i = 0; i < varCount; i++) {
+        print_var(i);
+    }
+}
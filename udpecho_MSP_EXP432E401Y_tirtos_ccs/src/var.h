@@ -0,0 +1,38 @@
+/*
+ * var.h
+ *
+ * Named variables: $gain, $peer_count. Each name owns one int32 slot of
+ * varValues[], taken from a fixed pool the first time the name is used, and
+ * an open-addressing hash table (FNV-1a, linear probing, at most half full)
+ * maps names to slots. Script lines, -if conditions and watches resolve a
+ * name to its slot when they are compiled, so using a variable costs the
+ * same as using a register; only typed commands hash the name each time.
+ *
+ * Slots are never freed because compiled lines point at them, "-var c" sets
+ * every value back to 0. Names are case sensitive and created only by the
+ * payload executor.
+ */
+
+#ifndef SRC_VAR_H_
+#define SRC_VAR_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MAX_VARS        256
+#define VAR_TABLE_SIZE  512     // Power of two, twice MAX_VARS
+#define VAR_NAME_SIZE   16      // Name without the '$', including the terminator
+
+extern int32_t varValues[MAX_VARS];
+
+int var_lookup(const char *name, int len);
+int var_intern(const char *name, int len);
+int var_parse(const char *token);
+const char *var_name(int slot);
+int var_slot(const volatile int32_t *value);
+int var_count();
+void var_zero_all();
+void print_var(int slot);
+void print_all_vars();
+
+#endif /* SRC_VAR_H_ */
@@ -0,0 +1,388 @@
+/*
+ *  ======== voice.c ========
+ */
+#include <string.h>
+#include <stdio.h>
+
+#include "p100.h"
+#include "voice.h"
+#include "timestamp.h"
+
+#if FEC_BLOCK_SAMPLES != DATABLOCKSIZE
+#error "FEC_BLOCK_SAMPLES must match DATABLOCKSIZE"
+#endif
+
+// Received blocks of one channel. Slots are indexed by seq % JITTER_SLOTS and keep
+// their block after it is played, so parity groups can still be completed.
+// ListenFxn writes, the playout in the Timer0 Swi reads.
+typedef struct JitterBuffer {
+    uint16_t block[JITTER_SLOTS][DATABLOCKSIZE];
+    uint16_t seq[JITTER_SLOTS];
+    volatile bool valid[JITTER_SLOTS];
+    volatile uint16_t playSeq;      // Next block the playout takes
+    volatile bool active;           // Channel is fed from the network
+} JitterBuffer;
+
+static JitterBuffer jitter[TXBUFCOUNT];
+static int32_t jitterDepth = JITTER_DEFAULT_DEPTH;
+
+FecEncoder fecTx[VOICE_TARGETS];        // Indexed by dial target
+VoiceRxStats voiceRxStats[VOICE_TARGETS];   // Indexed by receive channel (TX0, TX1)
+
+void VoiceInit() {
+    int i;
+    for (i = 0; i < TXBUFCOUNT; i++) {
+        plc_init(&glo.audioController.txBufControl[i].plc, PLC_PITCH, DATABLOCKSIZE);
+        VoiceReset(i);
+    }
+    for (i = 0; i < VOICE_TARGETS; i++) {
+        fec_encoder_init(&fecTx[i], FEC_NONE, FEC_DEFAULT_K);
+    }
+}
+
+/// @brief Forget all received audio for a channel. Used when a stream (re)starts.
+void VoiceReset(int32_t TX01) {
+    TXBufControl *tx = &glo.audioController.txBufControl[TX01];
+    uint32_t gateKey = GateSwi_enter(gateSwi0);
+
+    memset((void *)jitter[TX01].valid, 0, sizeof(jitter[TX01].valid));
+    jitter[TX01].active = false;
+    tx->TX_fresh[0] = false;
+    tx->TX_fresh[1] = false;
+    plc_reset(&tx->plc);
+
+    GateSwi_leave(gateSwi0, gateKey);
+}
+
+void VoiceSetDepth(int32_t depth) {
+    if (depth < 0) depth = 0;
+    if (depth > JITTER_SLOTS / 2) depth = JITTER_SLOTS / 2;
+    jitterDepth = depth;
+}
+
+int32_t VoiceGetDepth() {
+    return jitterDepth;
+}
+
+//================================================
+// Send
+//================================================
+
+/**
+ * @brief Sends one block to a dial target, adding the FEC selected for that target.
+ * hdr->dest selects the target (0/1 = dial 1, 2/3 = dial 2); hdr->type is set here.
+ */
+void VoiceSend(uint32_t ipAddr, NetPacketHeader *hdr, const uint16_t *samples) {
+    FecEncoder *enc = &fecTx[hdr->dest >> 1];
+
+    if (enc->mode == FEC_RED && enc->havePrev && enc->prevSeq == (uint16_t)(hdr->seq - 1)) {
+        // Voice block followed by the redundant copy of the previous one
+        uint16_t body[DATABLOCKSIZE + sizeof(FecRedundant) / sizeof(uint16_t)];
+        memcpy(body, samples, sizeof(uint16_t) * DATABLOCKSIZE);
+        memcpy(&body[DATABLOCKSIZE], &enc->prev, sizeof(FecRedundant));
+        hdr->type = NETPKT_VOICE_RED;
+        AddNetPacket(ipAddr, DEFAULTPORT, hdr, body, sizeof(body));
+    } else {
+        hdr->type = NETPKT_VOICE;
+        AddNetPacket(ipAddr, DEFAULTPORT, hdr, samples, sizeof(uint16_t) * DATABLOCKSIZE);
+    }
+
+    if (enc->mode == FEC_RED) {
+        fec_red_encode(samples, &enc->prev);
+        enc->prevSeq = hdr->seq;
+        enc->havePrev = true;
+    } else if (enc->mode == FEC_XOR && fec_xor_add(enc, hdr->seq, samples)) {
+        NetPacketHeader parityHdr = *hdr;
+        parityHdr.type = NETPKT_PARITY;
+        parityHdr.dest = hdr->dest & ~1;
+        parityHdr.seq = enc->firstSeq;
+        parityHdr.count = enc->k;
+        AddNetPacket(ipAddr, DEFAULTPORT, &parityHdr, enc->parity, sizeof(enc->parity));
+    }
+}
+
+//================================================
+// Jitter buffer
+//================================================
+
+static void jitter_restart(int32_t TX01, uint16_t seq) {
+    TXBufControl *tx = &glo.audioController.txBufControl[TX01];
+    JitterBuffer *jb = &jitter[TX01];
+    uint32_t gateKey = GateSwi_enter(gateSwi0);
+
+    memset((void *)jb->valid, 0, sizeof(jb->valid));
+    if (jb->active) {
+        voiceRxStats[TX01].restarts++;
+    }
+    jb->playSeq = seq;
+    jb->active = true;
+    tx->TX_Completed = NULL;    // Playout waits until jitterDepth blocks are buffered again
+    tx->TX_index = -1;
+
+    GateSwi_leave(gateSwi0, gateKey);
+}
+
+static const uint16_t *jitter_peek(int32_t TX01, uint16_t seq) {
+    JitterBuffer *jb = &jitter[TX01];
+    int32_t slot = seq % JITTER_SLOTS;
+
+    if (jb->valid[slot] && jb->seq[slot] == seq) {
+        return jb->block[slot];
+    }
+    return NULL;
+}
+
+/// @return False if the block's turn to play has already passed
+static bool jitter_insert(int32_t TX01, uint16_t seq, const uint16_t *samples) {
+    JitterBuffer *jb = &jitter[TX01];
+    int16_t ahead;
+    int32_t slot;
+
+    if (!jb->active) {
+        jitter_restart(TX01, seq);
+    }
+
+    ahead = (int16_t)(seq - jb->playSeq);
+    if (ahead < 0 && ahead > -JITTER_RESYNC) {
+        return false;
+    }
+    if (ahead < 0 || ahead >= JITTER_SLOTS) {
+        // Sender restarted or a long outage, start over from this block
+        jitter_restart(TX01, seq);
+    }
+
+    slot = seq % JITTER_SLOTS;
+    jb->valid[slot] = false;    // The playout skips the slot while it is rewritten
+    memcpy(jb->block[slot], samples, sizeof(jb->block[slot]));
+    jb->seq[slot] = seq;
+    jb->valid[slot] = true;
+    return true;
+}
+
+/// @brief Takes the next block for the playout. Called from the Timer0 Swi.
+static bool jitter_pop(int32_t TX01, uint16_t *out) {
+    JitterBuffer *jb = &jitter[TX01];
+    const uint16_t *block = jitter_peek(TX01, jb->playSeq);
+
+    jb->playSeq++;
+    if (block == NULL) {
+        return false;
+    }
+    memcpy(out, block, sizeof(uint16_t) * DATABLOCKSIZE);
+    return true;
+}
+
+//================================================
+// Receive
+//================================================
+
+// Nudges the playout rate so blocks keep arriving DATADELAY samples before the
+// end of the block being played (correction logic from the example code).
+static void VoiceCorrectDrift(int32_t TX01) {
+    static int32_t last[2] = {-2, -2};
+    static int32_t lastlast[2] = {-4, -4};
+    int32_t current = glo.audioController.txBufControl[TX01].TX_index;
+
+    if (last[TX01] != current && lastlast[TX01] != current) {
+        lastlast[TX01] = last[TX01];
+        last[TX01] = current;
+        if (current >= DATABLOCKSIZE - DATADELAY + 4) {
+            glo.audioController.txBufControl[TX01].TX_correction = -1;
+        } else if (current <= DATABLOCKSIZE - DATADELAY - 4) {
+            glo.audioController.txBufControl[TX01].TX_correction = +1;
+        }
+    }
+}
+
+// Copies one block of DATABLOCKSIZE samples into the TX buffer selected by dest_choice
+// (0/1 = TX0 ping/pong, 2/3 = TX1 ping/pong) and applies correction logic.
+// Used for local playback of the ADC stream, which cannot lose blocks.
+void VoiceWriteBlock(int32_t dest_choice, const uint16_t *samples) {
+    int32_t TX01;
+    uint16_t *dest_buffer;
+    int32_t which = dest_choice & 1;
+
+    // Identify the correct TX buffer based on dest_choice
+    if (dest_choice == 0) {
+        TX01 = 0;
+        dest_buffer = glo.audioController.txBufControl[TX01].TX_Ping;
+    } else if (dest_choice == 1) {
+        TX01 = 0;
+        dest_buffer = glo.audioController.txBufControl[TX01].TX_Pong;
+    } else if (dest_choice == 2) {
+        TX01 = 1;
+        dest_buffer = glo.audioController.txBufControl[TX01].TX_Ping;
+    } else if (dest_choice == 3) {
+        TX01 = 1;
+        dest_buffer = glo.audioController.txBufControl[TX01].TX_Pong;
+    } else {
+        AddProgramMessage("Error: Destination Choice Error in voice block.\r\n");
+        return;
+    }
+
+    // Copy the binary samples into the chosen buffer
+    memcpy(dest_buffer, samples, sizeof(uint16_t)*DATABLOCKSIZE);
+    glo.audioController.txBufControl[TX01].TX_fresh[which] = true;
+
+    // If first time, set TX_Completed and TX_index
+    if (glo.audioController.txBufControl[TX01].TX_Completed == NULL) {
+        glo.audioController.txBufControl[TX01].TX_Completed = dest_buffer;
+        glo.audioController.txBufControl[TX01].TX_index = 0;
+    }
+
+    VoiceCorrectDrift(TX01);
+}
+
+// Starts the playout of a network channel once jitterDepth blocks are buffered
+static void VoiceStartPlayout(int32_t TX01, uint16_t newestSeq) {
+    TXBufControl *tx = &glo.audioController.txBufControl[TX01];
+    uint32_t gateKey;
+
+    if (tx->TX_Completed != NULL || (int16_t)(newestSeq - jitter[TX01].playSeq) < jitterDepth) {
+        return;
+    }
+
+    gateKey = GateSwi_enter(gateSwi0);
+    if (jitter_pop(TX01, tx->TX_Ping)) {
+        plc_good_block(&tx->plc, tx->TX_Ping);
+    } else {
+        plc_conceal_block(&tx->plc, tx->TX_Ping);
+    }
+    tx->TX_index = 0;
+    tx->TX_Completed = tx->TX_Ping;
+    GateSwi_leave(gateSwi0, gateKey);
+}
+
+/// @brief Voice block received over UDP. dest_choice must be 0-3.
+void VoiceReceiveBlock(int32_t dest_choice, uint16_t seq, const uint16_t *samples) {
+    int32_t TX01 = dest_choice >> 1;
+    TXBufControl *tx = &glo.audioController.txBufControl[TX01];
+
+    if (!jitter_insert(TX01, seq, samples)) {
+        tx->plc.lateBlocks++;
+        netstat_drop(&netStats.rx, NET_DROP_LATE);
+        return;
+    }
+    voiceRxStats[TX01].received++;
+
+    VoiceStartPlayout(TX01, seq);
+    if (tx->TX_Completed != NULL) {
+        VoiceCorrectDrift(TX01);
+    }
+}
+
+/// @brief Redundant copy of block seq, carried by the packet of block seq + 1
+void VoiceReceiveRedundant(int32_t dest_choice, uint16_t seq, const FecRedundant *red) {
+    int32_t TX01 = dest_choice >> 1;
+    uint16_t block[DATABLOCKSIZE];
+
+    if (!jitter[TX01].active || jitter_peek(TX01, seq) != NULL
+        || (int16_t)(seq - jitter[TX01].playSeq) < 0) {
+        return;     // Not needed, or too late to help
+    }
+
+    fec_red_decode(red, block);
+    if (jitter_insert(TX01, seq, block)) {
+        voiceRxStats[TX01].redRecovered++;
+    }
+}
+
+/// @brief XOR parity of hdr->count blocks starting at hdr->seq. Rebuilds one missing block.
+void VoiceReceiveParity(const NetPacketHeader *hdr, const uint16_t *parity) {
+    int32_t TX01 = hdr->dest >> 1;
+    const uint16_t *blocks[FEC_MAX_K];
+    uint16_t rebuilt[DATABLOCKSIZE];
+    uint16_t missingSeq = 0;
+    int32_t i, lost = 0;
+
+    voiceRxStats[TX01].parityRx++;
+    if (!jitter[TX01].active || hdr->count < FEC_MIN_K || hdr->count > FEC_MAX_K) {
+        return;
+    }
+
+    for (i = 0; i < hdr->count; i++) {
+        blocks[i] = jitter_peek(TX01, hdr->seq + i);
+        if (blocks[i] == NULL) {
+            missingSeq = hdr->seq + i;
+            lost++;
+        }
+    }
+    if (lost == 0) {
+        return;
+    }
+    if (lost > 1) {
+        voiceRxStats[TX01].xorUnrecoverable++;
+        return;
+    }
+    if ((int16_t)(missingSeq - jitter[TX01].playSeq) < 0) {
+        return;     // Its turn to play has passed, a deeper jitter buffer would help
+    }
+
+    fec_xor_recover(parity, blocks, hdr->count, rebuilt);
+    if (jitter_insert(TX01, missingSeq, rebuilt)) {
+        voiceRxStats[TX01].xorRecovered++;
+    }
+}
+
+//================================================
+// Playout
+//================================================
+
+/**
+ * @brief Called by the playout (CMD_audio) when TX buffer TX01 switches to its
+ * other ping/pong block. Network channels take the next block from the jitter
+ * buffer; the local channel uses the block if VoiceWriteBlock refreshed it.
+ * A missing block is concealed instead of replaying the stale samples.
+ * Runs in Timer0 Swi context, so the concealment cost is tracked per block.
+ */
+void VoicePlayoutBlock(int32_t TX01) {
+    TXBufControl *tx = &glo.audioController.txBufControl[TX01];
+    int32_t which = (tx->TX_Completed == tx->TX_Pong) ? 1 : 0;
+    uint32_t start, cost;
+    bool good;
+
+    if (jitter[TX01].active) {
+        good = jitter_pop(TX01, tx->TX_Completed);
+    } else {
+        good = tx->TX_fresh[which];
+        tx->TX_fresh[which] = false;
+    }
+
+    if (good) {
+        plc_good_block(&tx->plc, tx->TX_Completed);
+        return;
+    }
+
+    start = timestamp_us();
+    plc_conceal_block(&tx->plc, tx->TX_Completed);
+    cost = timestamp_us() - start;
+    tx->plc.costTotal += cost;
+    if (cost > tx->plc.costMax) {
+        tx->plc.costMax = cost;
+    }
+}
+
+void print_voice_stats() {
+    char msg[MAX_LINE_LENGTH + 8];
+    int i;
+
+    sprintf(msg, "Jitter depth: %d blocks (%d ms)\r\n", jitterDepth, jitterDepth * DATABLOCKSIZE / 8);
+    AddProgramMessage(msg);
+    for (i = 0; i < VOICE_TARGETS; i++) {
+        if (fecTx[i].mode == FEC_XOR) {
+            sprintf(msg, "| Dial %d FEC: %s (K = %d)\r\n", i + 1, fecModeNames[fecTx[i].mode], fecTx[i].k);
+        } else {
+            sprintf(msg, "| Dial %d FEC: %s\r\n", i + 1, fecModeNames[fecTx[i].mode]);
+        }
+        AddProgramMessage(msg);
+    }
+    for (i = 0; i < VOICE_TARGETS; i++) {
+        VoiceRxStats *st = &voiceRxStats[i];
+        sprintf(msg, "| RX TX%d blocks: %u  parity: %u  restarts: %u\r\n",
+                i, st->received, st->parityRx, st->restarts);
+        AddProgramMessage(msg);
+        sprintf(msg, "|   recovered red: %u  xor: %u  unrecoverable groups: %u\r\n",
+                st->redRecovered, st->xorRecovered, st->xorUnrecoverable);
+        AddProgramMessage(msg);
+    }
+}
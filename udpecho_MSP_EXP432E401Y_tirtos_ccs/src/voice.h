@@ -0,0 +1,59 @@
+/*
+ * voice.h
+ *
+ * Voice send and receive path between ADCStream, the UDP tasks and the
+ * CMD_audio playout.
+ *
+ * Received blocks go into a per-channel jitter buffer keyed by sequence number
+ * instead of straight into the ping/pong TX buffers. The playout fills each
+ * ping/pong block from the buffer as it reaches it, and conceals the block
+ * (plc.h) when it is missing. Holding a few blocks gives FEC (fec.h) time to
+ * rebuild a lost block before its turn to play.
+ */
+
+#ifndef SRC_VOICE_H_
+#define SRC_VOICE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "netpacket.h"
+#include "fec.h"
+
+#define VOICE_TARGETS        2      // Dial targets (REG_DIAL1, REG_DIAL2)
+#define JITTER_SLOTS         16     // Received blocks kept per channel
+#define JITTER_DEFAULT_DEPTH 2      // Blocks buffered before playout starts (32 ms)
+#define JITTER_RESYNC        32     // Blocks behind the playout that mean a sender restart
+
+typedef struct VoiceRxStats {
+    uint32_t received;          // Blocks inserted from voice packets
+    uint32_t restarts;          // Playout restarted after a sequence jump
+    uint32_t parityRx;          // XOR parity packets received
+    uint32_t xorRecovered;      // Blocks rebuilt from parity
+    uint32_t xorUnrecoverable;  // Parity groups with more than one block missing
+    uint32_t redRecovered;      // Blocks rebuilt from a redundant copy
+} VoiceRxStats;
+
+extern FecEncoder fecTx[VOICE_TARGETS];
+extern VoiceRxStats voiceRxStats[VOICE_TARGETS];
+
+void VoiceInit();
+void VoiceReset(int32_t TX01);
+void VoiceSetDepth(int32_t depth);
+int32_t VoiceGetDepth();
+
+// Send side (ADCStream)
+void VoiceSend(uint32_t ipAddr, NetPacketHeader *hdr, const uint16_t *samples);
+
+// Receive side
+void VoiceWriteBlock(int32_t dest_choice, const uint16_t *samples);     // Local loopback, straight into ping/pong
+void VoiceReceiveBlock(int32_t dest_choice, uint16_t seq, const uint16_t *samples);
+void VoiceReceiveRedundant(int32_t dest_choice, uint16_t seq, const FecRedundant *red);
+void VoiceReceiveParity(const NetPacketHeader *hdr, const uint16_t *parity);
+
+// Playout (CMD_audio)
+void VoicePlayoutBlock(int32_t TX01);
+
+void print_voice_stats();
+
+#endif /* SRC_VOICE_H_ */
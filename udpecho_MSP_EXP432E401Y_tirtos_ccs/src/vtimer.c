@@ -0,0 +1,223 @@
+/*
+ *  ======== vtimer.c ========
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "p100.h"
+#include "vtimer.h"
+
+VTimer vtimers[MAX_VTIMERS];
+const char *vtimerNames[VTIMER_USER] = { "callback 0", "audio" };
+static bool vtimerRebase;               // A timer ran out, Timer0 is still on the old base tick
+
+static uint32_t vtimer_gcd(uint32_t a, uint32_t b) {
+    uint32_t t;
+    while (b != 0) {
+        t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/// @return Base tick the active timers need, with id taking periodUs (0 = stopped)
+static uint32_t vtimer_base_with(int id, uint32_t periodUs) {
+    uint32_t base = periodUs;
+    int i;
+
+    for (i = 0; i < MAX_VTIMERS; i++) {
+        if (i != id && vtimers[i].active) {
+            base = vtimer_gcd(base, vtimers[i].periodUs);
+        }
+    }
+    return base;
+}
+
+/**
+ * @brief Reprograms Timer0 for the active timers and rescales their countdowns,
+ * called with gateSwi0 held or from the Timer0 Swi. Timer0 is stopped when none is active.
+ * @return False if Timer0 failed to start
+ */
+static bool vtimer_program() {
+    uint32_t base = vtimer_base_with(-1, 0);
+    uint32_t oldBase = glo.Timer0Period;
+    int32_t status = Timer_STATUS_SUCCESS;
+    VTimer *vt;
+    int i;
+
+    for (i = 0; i < MAX_VTIMERS; i++) {
+        vt = &vtimers[i];
+        if (!vt->active) {
+            continue;
+        }
+        if (oldBase != 0 && vt->ticks != 0) {
+            // Keep the time left to the next fire
+            vt->countdown = (vt->countdown * oldBase + base - 1) / base;
+        } else {
+            vt->countdown = vt->periodUs / base;
+        }
+        vt->ticks = vt->periodUs / base;
+        if (vt->countdown == 0) {
+            vt->countdown = 1;
+        }
+    }
+
+    vtimerRebase = false;
+    if (base == oldBase) {
+        return true;
+    }
+    Timer_stop(glo.Timer0);
+    glo.Timer0Period = base;
+    Timer_setPeriod(glo.Timer0, Timer_PERIOD_US, base);
+    if (base != 0) {
+        status = Timer_start(glo.Timer0);
+    }
+    return status != Timer_STATUS_ERROR;
+}
+
+/**
+ * @brief True once Timer0 can move to the base tick of the active timers without
+ * making one of them late: a timer is due on a multiple of the new base. That
+ * happens within one new base tick, as the old base divides the new one.
+ */
+static bool vtimer_rebase_due() {
+    uint32_t base = vtimer_base_with(-1, 0);
+    int i;
+
+    if (base == 0) {
+        return true;
+    }
+    for (i = 0; i < MAX_VTIMERS; i++) {
+        if (vtimers[i].active && vtimers[i].countdown * glo.Timer0Period % base == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Starts or restarts a virtual timer
+ * @param fxn Native handler run in the Timer0 Swi, NULL to run payload instead
+ * @param count Fires before the timer stops itself, -1 for no limit. 0 is refused.
+ * @param error Set to a message when the timer cannot be started
+ */
+bool vtimer_start(int id, uint32_t periodUs, VTimerFxn fxn, UArg arg, const char *payload,
+                  int32_t count, const char **error) {
+    VTimer *vt = &vtimers[id];
+    uint32_t gateKey;
+    bool ok;
+
+    if (periodUs < MIN_TIMER_PERIOD_US) {
+        *error = "Period below the minimum";
+        return false;
+    }
+    if (count == 0 || count < -1) {
+        *error = "Count must be 1 or more, or -1 for no limit";
+        return false;
+    }
+    gateKey = GateSwi_enter(gateSwi0);
+    if (vtimer_base_with(id, periodUs) < VTIMER_MIN_BASE_US) {
+        GateSwi_leave(gateSwi0, gateKey);
+        *error = "Period shares no base tick of 100 us or more with the running timers";
+        return false;
+    }
+    vt->periodUs = periodUs;
+    vt->ticks = 0;              // New timer, full period before the first fire
+    vt->count = count;
+    vt->fires = 0;
+    vt->fxn = fxn;
+    vt->arg = arg;
+    if (payload) {
+        strncpy(vt->payload, payload, BUFFER_SIZE - 1);
+        vt->payload[BUFFER_SIZE - 1] = '\0';
+    } else {
+        vt->payload[0] = '\0';
+    }
+    vt->active = true;
+    ok = vtimer_program();
+    GateSwi_leave(gateSwi0, gateKey);
+
+    if (!ok) {
+        *error = "Timer0 failed to start";
+    }
+    return ok;
+}
+
+void vtimer_stop(int id) {
+    uint32_t gateKey = GateSwi_enter(gateSwi0);
+    vtimers[id].active = false;
+    vtimer_program();
+    GateSwi_leave(gateSwi0, gateKey);
+}
+
+void vtimer_stop_all() {
+    uint32_t gateKey = GateSwi_enter(gateSwi0);
+    int i;
+
+    for (i = 0; i < MAX_VTIMERS; i++) {
+        vtimers[i].active = false;
+    }
+    vtimer_program();
+    GateSwi_leave(gateSwi0, gateKey);
+}
+
+/**
+ * @brief Runs the virtual timers that are due, called from the Timer0 Swi on every base tick.
+ * When a count-limited timer runs out Timer0 is moved to the new base tick from
+ * here, as soon as vtimer_rebase_due(). The Swi already excludes every other
+ * user of gateSwi0.
+ */
+void vtimer_dispatch() {
+    VTimer *vt;
+    int i;
+
+    for (i = 0; i < MAX_VTIMERS; i++) {
+        vt = &vtimers[i];
+        if (!vt->active || --vt->countdown != 0) {
+            continue;
+        }
+        vt->countdown = vt->ticks;
+        vt->fires++;
+        if (vt->count > 0 && --vt->count == 0) {
+            vt->active = false;
+            vtimerRebase = true;
+        }
+        if (vt->fxn) {
+            vt->fxn(vt->arg);
+        } else {
+            execute_payload(vt->payload);
+        }
+    }
+
+    // After the handlers, which may have restarted the timer
+    if (vtimerRebase && vtimer_rebase_due()) {
+        vtimer_program();
+    }
+}
+
+void print_vtimers() {
+    VTimer snapshot[MAX_VTIMERS];
+    char msg[BUFFER_SIZE + 48];
+    uint32_t gateKey;
+    int i;
+
+    gateKey = GateSwi_enter(gateSwi0);
+    memcpy(snapshot, vtimers, sizeof(snapshot));
+    GateSwi_leave(gateSwi0, gateKey);
+
+    AddProgramMessage("================================ Virtual Timers ================================\r\n");
+    sprintf(msg, "Timer0 base tick: %u us\r\n", (unsigned)glo.Timer0Period);
+    AddProgramMessage(msg);
+    AddProgramMessage("| Id | Period us | Count | Fires      | Handler\r\n");
+    AddProgramMessage("|----|-----------|-------|------------|-------------------------------------------\r\n");
+    for (i = 0; i < MAX_VTIMERS; i++) {
+        VTimer *vt = &snapshot[i];
+        if (!vt->active) {
+            continue;
+        }
+        sprintf(msg, "| %-2d | %-9u | %-5d | %-10u | %s\r\n", i, (unsigned)vt->periodUs, (int)vt->count,
+                (unsigned)vt->fires, (vt->fxn && i < VTIMER_USER) ? vtimerNames[i] : vt->payload);
+        AddProgramMessage(msg);
+    }
+}
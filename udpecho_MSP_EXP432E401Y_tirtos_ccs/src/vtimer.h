@@ -0,0 +1,62 @@
+/*
+ * vtimer.h
+ *
+ * Virtual timers multiplexed on Timer0. Each client asks for its own period
+ * and Timer0 runs at the greatest common divisor of the active periods, so
+ * every virtual timer fires on an exact multiple of the base tick without
+ * drift. On each tick the Timer0 Swi counts every active timer down and runs
+ * the ones that are due, either a native handler or a payload:
+ *
+ *   VTIMER_CALLBACK    callback 0, period set by -timer
+ *   VTIMER_AUDIO       8 kHz -sine generation or -stream playout
+ *   VTIMER_USER..      payload timers set by -vtimer
+ *
+ * A period that would pull the base tick below VTIMER_MIN_BASE_US is refused,
+ * e.g. 125 us and 1000 us share a 125 us tick, 125 us and 300 us would need 25.
+ * The table is changed with gateSwi0 held so the Swi never sees half an update.
+ * A timer started with a count stops itself after that many fires, and the Swi
+ * then moves Timer0 to the base tick the remaining timers need.
+ */
+
+#ifndef SRC_VTIMER_H_
+#define SRC_VTIMER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "p100.h"
+
+#define MAX_VTIMERS         8
+#define VTIMER_MIN_BASE_US  MIN_TIMER_PERIOD_US
+
+typedef enum {
+    VTIMER_CALLBACK,
+    VTIMER_AUDIO,
+    VTIMER_USER,        // First of the -vtimer payload timers
+} VTimerId;
+
+typedef void (*VTimerFxn)(UArg arg);
+
+typedef struct VTimer {
+    bool      active;
+    uint32_t  periodUs;
+    uint32_t  ticks;                // periodUs / vtimerBaseUs
+    uint32_t  countdown;            // Base ticks to the next fire
+    int32_t   count;                // Fires left, -1 for no limit
+    uint32_t  fires;
+    VTimerFxn fxn;                  // Native handler, NULL runs payload
+    UArg      arg;
+    char      payload[BUFFER_SIZE];
+} VTimer;
+
+extern VTimer vtimers[MAX_VTIMERS];
+extern const char *vtimerNames[VTIMER_USER];
+
+bool vtimer_start(int id, uint32_t periodUs, VTimerFxn fxn, UArg arg, const char *payload,
+                  int32_t count, const char **error);
+void vtimer_stop(int id);
+void vtimer_stop_all();
+void vtimer_dispatch();
+void print_vtimers();
+
+#endif /* SRC_VTIMER_H_ */
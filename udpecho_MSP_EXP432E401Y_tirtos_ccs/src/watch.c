@@ -0,0 +1,124 @@
+/*
+ *  ======== watch.c ========
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "p100.h"
+#include "watch.h"
+
+Watch watches[MAX_WATCHES];
+uint8_t watchMask[NUM_REGISTERS];
+
+static bool watch_eval(Watch *w) {
+    int32_t result;
+    return expr_eval(&w->cond, NULL, &result) && result != 0;
+}
+
+/// @brief Re-evaluates the watches attached to reg and queues the payloads of those that became true
+void watch_check(int reg) {
+    uint8_t mask = watchMask[reg];
+    Watch *w;
+    bool now;
+    int i;
+
+    for (i = 0; mask; i++, mask >>= 1) {
+        if (!(mask & 1)) {
+            continue;
+        }
+        w = &watches[i];
+        now = watch_eval(w);
+        if (now && !w->state) {
+            w->hits++;
+            AddPayload(w->payload);
+        }
+        w->state = now;
+    }
+}
+
+/**
+ * @brief Compiles a condition and attaches it to the registers it reads. The watch
+ * starts from the condition's current value, so it first fires on the next rise.
+ * @return Watch index, -1 with *error set when the condition is invalid or all watches are in use
+ */
+int watch_add(const char *condText, const char *payload, const char **error) {
+    Watch *w;
+    ExprInsn *insn;
+    int index, reg;
+
+    for (index = 0; index < MAX_WATCHES; index++) {
+        if (!watches[index].active) {
+            break;
+        }
+    }
+    if (index == MAX_WATCHES) {
+        *error = "All watches are in use";
+        return -1;
+    }
+
+    w = &watches[index];
+    if (!expr_compile(condText, false, &w->cond, error)) {
+        return -1;
+    }
+    w->regs = 0;
+    for (insn = w->cond.insns; insn < w->cond.insns + w->cond.count; insn++) {
+        if (insn->op == EXPR_PUSH_PTR && insn->arg.ptr >= registers
+            && insn->arg.ptr < registers + NUM_REGISTERS) {
+            w->regs |= 1u << (insn->arg.ptr - registers);
+        }
+    }
+    if (w->regs == 0) {
+        *error = "The condition reads no register";
+        return -1;
+    }
+
+    strncpy(w->condText, condText, BUFFER_SIZE - 1);
+    w->condText[BUFFER_SIZE - 1] = '\0';
+    strncpy(w->payload, payload, BUFFER_SIZE - 1);
+    w->payload[BUFFER_SIZE - 1] = '\0';
+    w->hits = 0;
+    w->state = watch_eval(w);
+    w->active = true;
+
+    for (reg = 0; reg < NUM_REGISTERS; reg++) {
+        if (w->regs & (1u << reg)) {
+            watchMask[reg] |= 1u << index;
+        }
+    }
+    return index;
+}
+
+void watch_clear(int index) {
+    int reg;
+
+    for (reg = 0; reg < NUM_REGISTERS; reg++) {
+        watchMask[reg] &= ~(1u << index);
+    }
+    watches[index].active = false;
+}
+
+void watch_clear_all() {
+    int i;
+    for (i = 0; i < MAX_WATCHES; i++) {
+        watch_clear(i);
+    }
+}
+
+void print_all_watches() {
+    char msg[2 * BUFFER_SIZE + 32];
+    Watch *w;
+    int i;
+
+    AddProgramMessage("=================================== Watches ====================================\r\n");
+    AddProgramMessage("Idx | State | Hits     | Condition -> Payload\r\n");
+    AddProgramMessage("----|-------|----------|---------------------\r\n");
+    for (i = 0; i < MAX_WATCHES; i++) {
+        w = &watches[i];
+        if (!w->active) {
+            continue;
+        }
+        sprintf(msg, "%3d | %-5s | %8u | %s -> %s\r\n", i, w->state ? "true" : "false",
+                (unsigned)w->hits, w->condText, w->payload);
+        AddProgramMessage(msg);
+    }
+}
@@ -0,0 +1,54 @@
+/*
+ * watch.h
+ *
+ * Register watchpoints. A watch is a compiled condition (expr.h) and a payload
+ * that is queued when the condition goes from false to true:
+ *
+ *   -watch R5 > #100 -print hot
+ *
+ * The watch is attached to every register its condition reads. Whatever
+ * writes a register calls watch_notify() for it, which costs one table load
+ * when nothing watches that register and otherwise evaluates only the
+ * watches attached to it. Nothing is polled.
+ */
+
+#ifndef SRC_WATCH_H_
+#define SRC_WATCH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "p100.h"
+#include "register.h"
+#include "expr.h"
+
+#define MAX_WATCHES 8
+
+typedef struct Watch {
+    bool        active;
+    bool        state;          // Condition result after the last check
+    uint32_t    regs;           // Bit per register the condition reads
+    uint32_t    hits;           // Times the payload was queued
+    ExprProgram cond;
+    char        condText[BUFFER_SIZE];
+    char        payload[BUFFER_SIZE];
+} Watch;
+
+extern Watch watches[MAX_WATCHES];
+extern uint8_t watchMask[NUM_REGISTERS];    // Bit per watch attached to the register
+
+void watch_check(int reg);
+
+/// @brief Called after register reg was written
+static inline void watch_notify(int reg) {
+    if (watchMask[reg]) {
+        watch_check(reg);
+    }
+}
+
+int watch_add(const char *condText, const char *payload, const char **error);
+void watch_clear(int index);
+void watch_clear_all();
+void print_all_watches();
+
+#endif /* SRC_WATCH_H_ */